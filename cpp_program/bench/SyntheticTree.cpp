@@ -0,0 +1,210 @@
+#include "SyntheticTree.h"
+#include <fstream>
+#include <random>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+namespace Bench {
+
+    const char* const ContentNeedle = "fsmanager_needle";
+
+    namespace {
+
+        // 2020-01-01T00:00:00Z, applied to every generated file
+        const std::time_t FixedModifiedTime = 1577836800;
+
+        const char* const Words[] = {
+            "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+            "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa"
+        };
+        const char* const TextExtensions[] = {".txt", ".log", ".cpp", ".md", ".csv"};
+        const char* const BinaryExtensions[] = {".bin", ".dat", ".png", ".o"};
+
+        // Lines of words; every needleEvery-th line carries the needle (0 = never)
+        std::string makeText(std::mt19937_64& random, size_t bytes, size_t needleEvery) {
+            std::string text;
+            text.reserve(bytes + 64);
+            size_t line = 0;
+            while (text.size() < bytes) {
+                size_t words = 4 + random() % 8;
+                for (size_t i = 0; i < words; ++i) {
+                    if (i > 0) text += ' ';
+                    text += Words[random() % (sizeof(Words) / sizeof(Words[0]))];
+                }
+                if (needleEvery > 0 && line % needleEvery == needleEvery - 1) {
+                    text += ' ';
+                    text += ContentNeedle;
+                }
+                text += '\n';
+                line++;
+            }
+            text.resize(bytes);
+            return text;
+        }
+
+        std::string makeBinary(std::mt19937_64& random, size_t bytes) {
+            std::string data(bytes, '\0');
+            for (size_t i = 0; i < bytes; ++i) {
+                // Roughly one byte in eight is NUL, like typical object files
+                uint64_t value = random();
+                data[i] = (value & 7) == 0 ? '\0' : static_cast<char>(value >> 8);
+            }
+            return data;
+        }
+
+        void writeFile(TreeInfo& info, const fs::path& path, const std::string& content) {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(content.data(), static_cast<std::streamsize>(content.size()));
+            file.close();
+
+            std::error_code ec;
+            fs::last_write_time(path, fs::file_time_type::clock::now() -
+                (std::chrono::system_clock::now() - std::chrono::system_clock::from_time_t(FixedModifiedTime)), ec);
+
+            info.fileCount++;
+            info.totalBytes += content.size();
+            info.files.push_back(path.string());
+        }
+
+        void makeDirectory(TreeInfo& info, const fs::path& path) {
+            fs::create_directories(path);
+            info.directoryCount++;
+        }
+
+        void buildWide(TreeInfo& info, std::mt19937_64& random) {
+            makeDirectory(info, info.root);
+            for (size_t i = 0; i < 5000; ++i) {
+                const char* extension = TextExtensions[i % 5];
+                writeFile(info, fs::path(info.root) / ("file_" + std::to_string(i) + extension),
+                          makeText(random, 64 + random() % 512, 4));
+            }
+        }
+
+        void buildDeep(TreeInfo& info, std::mt19937_64& random) {
+            fs::path current = info.root;
+            for (size_t depth = 0; depth < 64; ++depth) {
+                makeDirectory(info, current);
+                for (size_t i = 0; i < 4; ++i) {
+                    writeFile(info, current / ("level" + std::to_string(depth) + "_" + std::to_string(i) + TextExtensions[i % 5]),
+                              makeText(random, 256 + random() % 1024, 8));
+                }
+                current /= "d" + std::to_string(depth);
+            }
+        }
+
+        void buildTiny(TreeInfo& info, std::mt19937_64& random) {
+            makeDirectory(info, info.root);
+            for (size_t d = 0; d < 100; ++d) {
+                fs::path directory = fs::path(info.root) / ("dir_" + std::to_string(d));
+                makeDirectory(info, directory);
+                for (size_t i = 0; i < 100; ++i) {
+                    writeFile(info, directory / ("t" + std::to_string(i) + TextExtensions[(d + i) % 5]),
+                              makeText(random, 16 + random() % 48, 0));
+                }
+            }
+        }
+
+        void buildHuge(TreeInfo& info, std::mt19937_64& random) {
+            makeDirectory(info, info.root);
+            for (size_t i = 0; i < 4; ++i) {
+                writeFile(info, fs::path(info.root) / ("huge_" + std::to_string(i) + ".log"),
+                          makeText(random, 16 * 1024 * 1024, 10000));
+            }
+        }
+
+        void buildMixed(TreeInfo& info, std::mt19937_64& random) {
+            makeDirectory(info, info.root);
+            for (size_t d = 0; d < 20; ++d) {
+                fs::path directory = fs::path(info.root) / ("mixed_" + std::to_string(d));
+                makeDirectory(info, directory);
+                for (size_t i = 0; i < 100; ++i) {
+                    // Sizes spread over several orders of magnitude
+                    size_t bytes = static_cast<size_t>(32) << (random() % 12);
+                    std::string name = "m" + std::to_string(i);
+                    if (i % 2 == 0) {
+                        writeFile(info, directory / (name + TextExtensions[i % 5]), makeText(random, bytes, 32));
+                    } else {
+                        writeFile(info, directory / (name + BinaryExtensions[i % 4]), makeBinary(random, bytes));
+                    }
+                }
+            }
+        }
+
+    }
+
+    const char* treeShapeName(TreeShape shape) {
+        switch (shape) {
+            case TreeShape::Wide: return "wide";
+            case TreeShape::Deep: return "deep";
+            case TreeShape::Tiny: return "tiny";
+            case TreeShape::Huge: return "huge";
+            default: return "mixed";
+        }
+    }
+
+    SyntheticTree::SyntheticTree(const std::string& baseDir) : baseDirectory(baseDir), ownsBase(baseDir.empty()) {
+        if (ownsBase) {
+#ifndef _WIN32
+            std::string suffix = std::to_string(::getpid());
+#else
+            std::string suffix = "run";
+#endif
+            baseDirectory = (fs::temp_directory_path() / ("fsmanager-bench-" + suffix)).string();
+        }
+        fs::create_directories(baseDirectory);
+    }
+
+    SyntheticTree::~SyntheticTree() {
+        std::error_code ec;
+        if (ownsBase) {
+            fs::remove_all(baseDirectory, ec);
+        } else {
+            for (const auto& [shape, info] : trees) {
+                fs::remove_all(info.root, ec);
+            }
+        }
+    }
+
+    const TreeInfo& SyntheticTree::get(TreeShape shape) {
+        auto it = trees.find(shape);
+        if (it != trees.end()) {
+            return it->second;
+        }
+
+        TreeInfo info;
+        info.root = (fs::path(baseDirectory) / treeShapeName(shape)).string();
+        std::error_code ec;
+        fs::remove_all(info.root, ec);
+
+        // Seeded per shape so adding a shape never changes the others
+        std::mt19937_64 random(0x5eed0000ULL + static_cast<uint64_t>(shape));
+        switch (shape) {
+            case TreeShape::Wide: buildWide(info, random); break;
+            case TreeShape::Deep: buildDeep(info, random); break;
+            case TreeShape::Tiny: buildTiny(info, random); break;
+            case TreeShape::Huge: buildHuge(info, random); break;
+            case TreeShape::Mixed: buildMixed(info, random); break;
+        }
+        return trees.emplace(shape, std::move(info)).first->second;
+    }
+
+    TreeInfo SyntheticTree::writeFlat(const std::string& directory, size_t count, size_t fileSize, uint64_t seed) {
+        TreeInfo info;
+        info.root = directory;
+        makeDirectory(info, directory);
+        std::mt19937_64 random(seed);
+        for (size_t i = 0; i < count; ++i) {
+            writeFile(info, fs::path(directory) / ("flat_" + std::to_string(i) + ".txt"), makeText(random, fileSize, 0));
+        }
+        return info;
+    }
+
+    const std::string& SyntheticTree::getBaseDirectory() const {
+        return baseDirectory;
+    }
+
+}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+#include <map>
+
+namespace FileSystemManager {
+namespace Bench {
+
+    // Shapes of generated directory trees
+    enum class TreeShape {
+        Wide,        // One directory with many small files
+        Deep,        // A long chain of nested directories with a few files each
+        Tiny,        // Many directories full of very small files
+        Huge,        // A handful of multi-megabyte text files
+        Mixed        // Interleaved text and binary files of varied size
+    };
+
+    const char* treeShapeName(TreeShape shape);
+
+    // Summary of what was written, used for throughput counters
+    struct TreeInfo {
+        std::string root;
+        size_t fileCount = 0;
+        size_t directoryCount = 0;
+        uint64_t totalBytes = 0;
+        std::vector<std::string> files;
+    };
+
+    // Marker written into some text files so content searches have hits
+    extern const char* const ContentNeedle;
+
+    // Generates trees byte-for-byte identically on every run: content comes
+    // from a fixed-seed generator and every file gets the same mtime, so
+    // results are comparable across commits.
+    class SyntheticTree {
+    private:
+        std::string baseDirectory;
+        bool ownsBase;
+        std::map<TreeShape, TreeInfo> trees;
+
+    public:
+        // Trees are created below baseDir, or a fresh temp directory if empty
+        explicit SyntheticTree(const std::string& baseDir = "");
+        ~SyntheticTree();
+
+        SyntheticTree(const SyntheticTree&) = delete;
+        SyntheticTree& operator=(const SyntheticTree&) = delete;
+
+        // Builds (or returns the already built) tree of the given shape
+        const TreeInfo& get(TreeShape shape);
+
+        // Writes a flat directory of count small files; used by destructive benchmarks
+        static TreeInfo writeFlat(const std::string& directory, size_t count, size_t fileSize, uint64_t seed);
+
+        const std::string& getBaseDirectory() const;
+    };
+
+}
+}
@@ -0,0 +1,194 @@
+#include "SyntheticTree.h"
+#include "FileManager.h"
+#include "SearchEngine.h"
+#include "BatchOperations.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+using namespace FileSystemManager;
+using Bench::SyntheticTree;
+using Bench::TreeShape;
+
+namespace {
+
+    // Trees are generated on first use and shared by all benchmarks.
+    // FSMANAGER_BENCH_DIR selects where (e.g. a specific filesystem).
+    SyntheticTree& trees() {
+        static std::unique_ptr<SyntheticTree> instance;
+        if (!instance) {
+            const char* base = std::getenv("FSMANAGER_BENCH_DIR");
+            instance = std::make_unique<SyntheticTree>(base != nullptr ? base : "");
+        }
+        return *instance;
+    }
+
+    const Bench::TreeInfo& treeFor(const benchmark::State& state) {
+        return trees().get(static_cast<TreeShape>(state.range(0)));
+    }
+
+    void setTreeLabel(benchmark::State& state, const Bench::TreeInfo& info) {
+        state.SetLabel(Bench::treeShapeName(static_cast<TreeShape>(state.range(0))));
+        state.counters["files"] = static_cast<double>(info.fileCount);
+    }
+
+    void allShapes(benchmark::internal::Benchmark* benchmark) {
+        for (TreeShape shape : {TreeShape::Wide, TreeShape::Deep, TreeShape::Tiny, TreeShape::Huge, TreeShape::Mixed}) {
+            benchmark->Arg(static_cast<int64_t>(shape));
+        }
+    }
+
+    // Search
+
+    void BM_SearchByName(benchmark::State& state) {
+        const auto& info = treeFor(state);
+        SearchEngine engine(info.root);
+        size_t matches = 0;
+        for (auto _ : state) {
+            auto results = engine.searchByName("*.txt", true);
+            matches = results.size();
+            benchmark::DoNotOptimize(results.data());
+        }
+        setTreeLabel(state, info);
+        state.counters["matches"] = static_cast<double>(matches);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * info.fileCount));
+    }
+    BENCHMARK(BM_SearchByName)->Apply(allShapes)->Unit(benchmark::kMillisecond);
+
+    void BM_SearchInContent(benchmark::State& state) {
+        const auto& info = treeFor(state);
+        SearchEngine engine(info.root);
+        size_t matches = 0;
+        for (auto _ : state) {
+            auto results = engine.searchInContent(Bench::ContentNeedle, true);
+            matches = results.size();
+            benchmark::DoNotOptimize(results.data());
+        }
+        setTreeLabel(state, info);
+        state.counters["matches"] = static_cast<double>(matches);
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * info.totalBytes));
+    }
+    BENCHMARK(BM_SearchInContent)->Apply(allShapes)->Unit(benchmark::kMillisecond);
+
+    // Metadata
+
+    void BM_GetDirectorySize(benchmark::State& state) {
+        const auto& info = treeFor(state);
+        FileManager manager(info.root);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(manager.getDirectorySize(info.root));
+        }
+        setTreeLabel(state, info);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * info.fileCount));
+    }
+    BENCHMARK(BM_GetDirectorySize)->Apply(allShapes)->Unit(benchmark::kMillisecond);
+
+    void BM_ListFiles(benchmark::State& state) {
+        const auto& info = treeFor(state);
+        FileManager manager(info.root);
+        size_t listed = 0;
+        for (auto _ : state) {
+            // Drop the listing cache so every iteration reads the directory
+            manager.refreshCache();
+            auto files = manager.listFiles(true);
+            listed = files.size();
+            benchmark::DoNotOptimize(files.data());
+        }
+        setTreeLabel(state, info);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * listed));
+    }
+    BENCHMARK(BM_ListFiles)->Arg(static_cast<int64_t>(TreeShape::Wide))->Arg(static_cast<int64_t>(TreeShape::Tiny))
+        ->Unit(benchmark::kMillisecond);
+
+    // Batch operations
+
+    void BM_CopyDirectory(benchmark::State& state) {
+        const auto& info = treeFor(state);
+        std::string destination = (fs::path(trees().getBaseDirectory()) / "copy_target").string();
+        BatchOperations batch;
+        std::error_code ec;
+        for (auto _ : state) {
+            state.PauseTiming();
+            fs::remove_all(destination, ec);
+            state.ResumeTiming();
+
+            auto result = batch.copyDirectory(info.root, destination, true);
+            benchmark::DoNotOptimize(result.filesProcessed);
+        }
+        fs::remove_all(destination, ec);
+        setTreeLabel(state, info);
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * info.totalBytes));
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * info.fileCount));
+    }
+    BENCHMARK(BM_CopyDirectory)->Apply(allShapes)->Unit(benchmark::kMillisecond);
+
+    void BM_DeleteFiles(benchmark::State& state) {
+        const size_t count = static_cast<size_t>(state.range(0));
+        std::string directory = (fs::path(trees().getBaseDirectory()) / "delete_target").string();
+        BatchOperations batch;
+        std::error_code ec;
+        for (auto _ : state) {
+            state.PauseTiming();
+            fs::remove_all(directory, ec);
+            auto info = SyntheticTree::writeFlat(directory, count, 128, 42);
+            state.ResumeTiming();
+
+            auto result = batch.deleteFiles(info.files);
+            benchmark::DoNotOptimize(result.filesProcessed);
+        }
+        fs::remove_all(directory, ec);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    }
+    BENCHMARK(BM_DeleteFiles)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+    // Pattern matching
+
+    void BM_MatchesPattern(benchmark::State& state) {
+        static const char* const Names[] = {
+            "main.cpp", "README.md", "CMakeLists.txt", "libfsmanager.a", "photo_2020_01_01.JPG",
+            "a_rather_long_file_name_with_many_parts.tar.gz", "x", ".hidden", "report-final-v2.docx", "data.csv"
+        };
+        static const char* const Patterns[] = {"*.cpp", "*", "*.txt", "photo_*.jpg", "*_*_*.*", "?", "report*v?.doc*"};
+
+        const char* pattern = Patterns[state.range(0)];
+        size_t matched = 0;
+        for (auto _ : state) {
+            for (const char* name : Names) {
+                matched += matchesPattern(name, pattern) ? 1 : 0;
+            }
+            benchmark::DoNotOptimize(matched);
+        }
+        state.SetLabel(pattern);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (sizeof(Names) / sizeof(Names[0]))));
+    }
+    BENCHMARK(BM_MatchesPattern)->DenseRange(0, 6);
+
+}
+
+// Writes JSON results to fsmanager_bench.json unless --benchmark_out is given,
+// so every run leaves a file that can be diffed against the previous one
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool hasOutput = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            hasOutput = true;
+        }
+    }
+    std::string outputArg = "--benchmark_out=fsmanager_bench.json";
+    std::string formatArg = "--benchmark_out_format=json";
+    if (!hasOutput) {
+        args.push_back(outputArg.data());
+        args.push_back(formatArg.data());
+    }
+    int count = static_cast<int>(args.size());
+
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace FileSystemManager {
+
+    // Finds any number of fixed strings in one pass. The patterns are built
+    // into an Aho-Corasick automaton whose failure links are resolved ahead of
+    // time, so scanning is one table lookup per byte however many patterns
+    // there are. Transitions are indexed by byte class (bytes that occur in
+    // no pattern share one) to keep the table small. Immutable once built
+    // and safe to share between threads.
+    class AhoCorasick {
+    public:
+        // patternIds are sorted and distinct
+        using LineVisitor = std::function<void(size_t lineNumber, std::string_view line,
+                                               const std::vector<uint32_t>& patternIds)>;
+
+    private:
+        std::vector<std::string> patterns;
+        bool caseSensitive;
+        std::array<uint8_t, 256> byteClasses;
+        size_t classCount;
+        std::vector<int32_t> transitions;       // states x classes, complete
+        std::vector<uint32_t> outputStart;      // Patterns ending at state s: outputIds[outputStart[s], outputStart[s + 1])
+        std::vector<uint32_t> outputIds;
+        std::vector<int32_t> outputLinks;       // Nearest suffix state with patterns of its own, or -1
+        std::vector<uint8_t> reportsMatch;      // Own patterns or an output link
+
+    public:
+        AhoCorasick();
+
+        // Patterns that are empty or contain '\n' keep their id but never match
+        void build(const std::vector<std::string>& patternList, bool caseSensitive);
+
+        bool isCaseSensitive() const { return caseSensitive; }
+        size_t getPatternCount() const { return patterns.size(); }
+        const std::string& getPattern(uint32_t id) const { return patterns[id]; }
+        size_t getStateCount() const { return outputLinks.size(); }
+
+        // Reports each line of buffer holding at least one pattern, in order,
+        // with 1-based line numbers and the patterns found on it. Returns the
+        // number of lines reported.
+        size_t forEachMatchingLine(std::string_view buffer, const LineVisitor& visit) const;
+    };
+
+}
@@ -1,42 +1,145 @@
 #pragma once
 
 #include "Common.h"
+#include "ProgressTracker.h"
+#include "CancellationToken.h"
+#include "IoThrottle.h"
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <future>
 #include <functional>
+#include <memory>
+#include <string_view>
 
 namespace FileSystemManager {
 
+    struct EntryMetadata;
+    class RenameTemplate;
+    class TextTransform;
+
+    // What one cleanup sweep removes: regular files that end in one of the
+    // extensions or, with emptyFiles, are empty, and that are at least
+    // minimumAgeSeconds old. Symlinks are never followed or removed.
+    struct CleanupOptions {
+        std::vector<std::string> extensions;    // Name endings such as ".tmp" or "~", any case
+        bool emptyFiles = false;
+        bool recursive = true;
+        int64_t minimumAgeSeconds = 0;          // By modification time
+        bool dryRun = false;                    // Only report what would be removed
+        // Each file removed (or that would be), called from the walk's
+        // threads one at a time
+        std::function<void(const std::string& path, uint64_t size)> onMatch;
+    };
+
+    // One batch's progress, cancellation and I/O limits. Every operation
+    // runs with its own, so batches running at once on one BatchOperations
+    // neither share counters nor stop each other; the throttle is the one
+    // thing they share.
+    class BatchContext {
+    public:
+        ProgressTracker progress;
+        CancellationToken cancellation;
+        std::shared_ptr<IoThrottle> throttle;
+        // The throttle's I/O class, held on the batch's thread while it runs
+        std::unique_ptr<ScopedIoPriority> ioPriority;
+
+        // One more file done; the name is only copied when the reporter asked for one
+        void advance(std::string_view currentFile, uint64_t bytes = 0) {
+            progress.advance(1, bytes);
+            if (progress.wantsName()) progress.offerName(currentFile);
+        }
+        bool shouldContinue() const {
+            return !cancellation.isCancelled();
+        }
+        // Charges I/O just done against the throttle, waiting if the batch
+        // is over its limits
+        void pace(uint64_t bytes, uint64_t operations = 1) const {
+            if (throttle) throttle->acquire(bytes, operations, &cancellation);
+        }
+        void cancel();
+    };
+
+    // A batch running on its own thread. The handle shares the batch's
+    // context, so its progress can be read and the batch cancelled while
+    // others run on the same BatchOperations.
+    class BatchHandle {
+    private:
+        std::shared_ptr<BatchContext> context;
+        std::shared_future<OperationResult> outcome;
+
+    public:
+        BatchHandle() = default;
+        BatchHandle(std::shared_ptr<BatchContext> batchContext, std::shared_future<OperationResult> batchOutcome)
+            : context(std::move(batchContext)), outcome(std::move(batchOutcome)) {}
+
+        bool valid() const { return outcome.valid(); }
+        bool isReady() const;
+        // Waits for the batch to finish
+        OperationResult get() const;
+        // The batch stops at its next check: between files, or between
+        // chunks of a file being copied or rewritten
+        void cancel();
+        void setDeadline(std::chrono::steady_clock::time_point deadline);
+        void setTimeout(std::chrono::nanoseconds timeout);
+        size_t getProcessedFiles() const;
+        size_t getTotalFiles() const;
+    };
+
     class BatchOperations {
     private:
-        std::atomic<bool> operationInProgress;
-        std::atomic<size_t> processedFiles;
-        std::atomic<size_t> totalFiles;
-        std::mutex progressMutex;
-        
-        struct ProgressCallback {
-            std::function<void(size_t current, size_t total, const std::string& currentFile)> callback;
-        };
-        
-        ProgressCallback progressCallback;
+        // Every batch running now, for cancelOperation and the progress getters
+        std::vector<std::shared_ptr<BatchContext>> active;
+        mutable std::mutex activeMutex;
+        ProgressTracker::Callback progressCallback;
+        std::chrono::milliseconds progressInterval;
+        std::chrono::milliseconds timeout;
+        std::shared_ptr<IoThrottle> throttle;
         
     public:
         BatchOperations();
         ~BatchOperations() = default;
         
-        // Progress tracking
+        // Progress tracking. Callbacks run on a reporter thread, every
+        // interval while a batch runs and once more when it ends; workers
+        // only bump counters. Each batch has its own reporter, so with
+        // batches running at once the callback is called from several threads.
+        // A change applies to batches started after it.
         void setProgressCallback(std::function<void(size_t, size_t, const std::string&)> callback);
+        void setProgressReporter(ProgressTracker::Callback callback,
+                                 std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+        // Time limit of every batch started after this; 0 = none. A batch
+        // past its limit stops as if cancelled and reports a timeout.
+        void setTimeout(std::chrono::milliseconds limit);
+        // Limits on the bytes and operations per second of every batch, and
+        // the I/O class they run in. Batches copy, rewrite, delete and
+        // rename at that pace; a throttle shared with other engines limits
+        // them all together. Null (the default) means no limits.
+        void setIoThrottle(std::shared_ptr<IoThrottle> ioThrottle);
+        
+        // Over every batch running now
         bool isOperationInProgress() const;
         double getProgressPercentage() const;
         size_t getProcessedFiles() const;
         size_t getTotalFiles() const;
         
-        // Batch copy operations
-        OperationResult copyFiles(const std::vector<std::string>& sourceFiles, const std::string& destinationDir);
-        OperationResult copyDirectory(const std::string& sourceDir, const std::string& destinationDir, bool recursive = true);
-        OperationResult copyFilesByPattern(const std::string& sourceDir, const std::string& pattern, const std::string& destinationDir);
+        // Batch copy operations. With verify, each file is hashed as it is
+        // copied and the copy read back and compared on other threads while
+        // the next file copies; a copy that differs is removed and reported.
+        // Hashes of good copies go into the destination's checksum manifest.
+        OperationResult copyFiles(const std::vector<std::string>& sourceFiles, const std::string& destinationDir,
+                                  bool verify = false);
+        OperationResult copyDirectory(const std::string& sourceDir, const std::string& destinationDir, bool recursive = true,
+                                      bool verify = false);
+        OperationResult copyFilesByPattern(const std::string& sourceDir, const std::string& pattern, const std::string& destinationDir,
+                                           bool verify = false);
+        // Checks a tree against its checksum manifest (ChecksumManifest) in
+        // parallel and brings the manifest up to date: files new or changed
+        // since (other size or time) are hashed and recorded, missing ones
+        // dropped, and a file whose hash changed while its size and time did
+        // not is reported corrupt. changedOnly trusts unchanged files instead
+        // of rereading them.
+        OperationResult verifyChecksums(const std::string& directory, bool changedOnly = false);
         
         // Batch move operations
         OperationResult moveFiles(const std::vector<std::string>& sourceFiles, const std::string& destinationDir);
@@ -47,11 +150,16 @@ namespace FileSystemManager {
         OperationResult deleteFilesByPattern(const std::string& directory, const std::string& pattern);
         OperationResult deleteEmptyDirectories(const std::string& directory, bool recursive = true);
         
-        // Batch rename operations
+        // Batch rename operations. newPattern is a RenameTemplate ("{name}_v2{ext}").
+        // The whole batch is planned in memory first; if any new name is
+        // invalid or collides, nothing is renamed. Each batch leaves a
+        // journal that undoRename plays backwards.
         OperationResult renameFiles(const std::vector<std::string>& files, const std::string& newPattern);
         OperationResult renameFilesByPattern(const std::string& directory, const std::string& oldPattern, const std::string& newPattern);
         OperationResult addPrefix(const std::vector<std::string>& files, const std::string& prefix);
         OperationResult addSuffix(const std::vector<std::string>& files, const std::string& suffix);
+        // The most recent batch's journal when journalPath is empty
+        OperationResult undoRename(const std::string& journalPath = "");
         
         // File organization
         OperationResult organizeByExtension(const std::string& sourceDir, const std::string& destinationDir);
@@ -62,28 +170,60 @@ namespace FileSystemManager {
         // File conversion
         OperationResult convertTextEncoding(const std::vector<std::string>& files, const std::string& fromEncoding, const std::string& toEncoding);
         OperationResult normalizeLineEndings(const std::vector<std::string>& files, const std::string& targetLineEnding = "LF");
+        OperationResult convertTextEncodingByPattern(const std::string& directory, const std::string& pattern,
+                                                     const std::string& fromEncoding, const std::string& toEncoding);
+        OperationResult normalizeLineEndingsByPattern(const std::string& directory, const std::string& pattern,
+                                                      const std::string& targetLineEnding = "LF");
         
         // File cleanup
         OperationResult removeEmptyFiles(const std::string& directory, bool recursive = true);
         OperationResult removeDuplicateFiles(const std::string& directory, bool byContent = true);
         OperationResult cleanupTempFiles(const std::string& directory, const std::vector<std::string>& tempExtensions = {".tmp", ".temp", ".bak"});
+        // The sweep behind removeEmptyFiles and cleanupTempFiles, for any mix of the two
+        OperationResult cleanup(const std::string& directory, const CleanupOptions& options);
         
-        // Async operations
-        std::future<OperationResult> copyFilesAsync(const std::vector<std::string>& sourceFiles, const std::string& destinationDir);
-        std::future<OperationResult> deleteFilesAsync(const std::vector<std::string>& files);
+        // Async operations. Any operation can be started on its own thread
+        // with start(), e.g. start([=](BatchOperations& ops) { return ops.cleanup(dir, options); });
+        // the BatchOperations must outlive the batches it runs.
+        BatchHandle start(std::function<OperationResult(BatchOperations&)> operation);
+        BatchHandle copyFilesAsync(const std::vector<std::string>& sourceFiles, const std::string& destinationDir);
+        BatchHandle deleteFilesAsync(const std::vector<std::string>& files);
         
-        // Operation cancellation
+        // Operation cancellation: every batch running now. A handle cancels just its own.
         void cancelOperation();
         void resetProgress();
         
     private:
-        void updateProgress(size_t current, const std::string& currentFile = "");
-        bool shouldContinue() const;
-        std::string generateUniqueFileName(const std::string& directory, const std::string& fileName);
-        void copyDirectoryRecursive(const std::string& sourceDir, const std::string& destinationDir, OperationResult& result);
-        void copyDirectoryNonRecursive(const std::string& sourceDir, const std::string& destinationDir, OperationResult& result);
-        void deleteEmptyDirectoriesRecursive(const std::string& directory, OperationResult& result);
-        void deleteEmptyDirectoriesNonRecursive(const std::string& directory, OperationResult& result);
+        // Registers a batch and starts its progress; batches started through
+        // start() bring their handle's context
+        std::shared_ptr<BatchContext> openBatch(size_t fileTotal);
+        void closeBatch(const std::shared_ptr<BatchContext>& batch);
+        struct CopyPlan;
+        void planDirectoryCopy(const std::string& sourceDir, bool recursive, CopyPlan& plan) const;
+        void executeCopyPlan(BatchContext& batch, const CopyPlan& plan, const std::string& sourceDir,
+                             const std::string& destinationDir, bool verify, OperationResult& result);
+        // Target directory (relative to the destination) for one file, or
+        // false to leave the file where it is. Every classification worker
+        // makes its own, so classifiers may keep unsynchronised caches.
+        using BucketClassifier = std::function<bool(const std::string& name, const EntryMetadata& metadata, std::string& bucket)>;
+        using ClassifierFactory = std::function<BucketClassifier()>;
+        struct OrganizePlan;
+        struct BucketMove;
+        OperationResult organize(const std::string& sourceDir, const std::string& destinationDir, const char* phaseName,
+                                 bool needsMetadata, const ClassifierFactory& makeClassifier);
+        void planOrganize(const std::string& sourceDir, bool needsMetadata, const ClassifierFactory& makeClassifier,
+                          OrganizePlan& plan, OperationResult& result) const;
+        void executeOrganizePlan(BatchContext& batch, const OrganizePlan& plan, const std::string& sourceDir,
+                                 const std::string& destinationDir, OperationResult& result);
+        void moveIntoBucket(BatchContext& batch, const OrganizePlan& plan, const BucketMove& move, const std::string& sourceDir,
+                            const std::string& destinationDir, OperationResult& result);
+        struct RenamePlan;
+        OperationResult renameBatch(RenamePlan& plan, const std::string& sourcePattern, const std::string& newPattern);
+        bool planRenames(RenamePlan& plan, RenameTemplate& compiled, OperationResult& result) const;
+        void executeRenamePlan(BatchContext& batch, const RenamePlan& plan, OperationResult& result);
+        OperationResult rewriteTextFiles(const std::vector<std::string>& files, const char* phaseName, const TextTransform& prototype);
+        void deleteEmptyDirectoriesRecursive(BatchContext& batch, const std::string& directory, OperationResult& result);
+        void deleteEmptyDirectoriesNonRecursive(BatchContext& batch, const std::string& directory, OperationResult& result);
     };
 
 }
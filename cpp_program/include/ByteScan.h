@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace FileSystemManager {
+
+    // Vectorized byte scanning primitives used by the content matchers. Each
+    // returns nullptr (or 0) when nothing is found in [begin, end).
+    const char* findByte(const char* begin, const char* end, unsigned char byte);
+    const char* findLastByte(const char* begin, const char* end, unsigned char byte);
+    // First position holding either byte (16 bytes per step with SSE2)
+    const char* findEitherByte(const char* begin, const char* end, unsigned char a, unsigned char b);
+    size_t countByte(const char* begin, const char* end, unsigned char byte);
+    // Bytes below 0x20 other than whitespace, backspace and escape: the
+    // control characters that do not occur in text
+    size_t countControlBytes(const char* begin, const char* end);
+    // Length of the leading run of bytes below 0x80 (16 bytes per step with SSE2)
+    size_t asciiPrefix(const char* begin, const char* end);
+
+    // Finds a fixed string by scanning for its rarest byte and verifying the
+    // candidates, so most of the input is only touched by the vector scan.
+    class LiteralFinder {
+    private:
+        std::string literal;        // Lowercased when case-insensitive
+        bool caseSensitive;
+        size_t anchorIndex;         // Position of the scanned byte within literal
+        unsigned char anchorLower;
+        unsigned char anchorUpper;
+
+        bool verify(const char* candidate) const;
+
+    public:
+        LiteralFinder();
+        LiteralFinder(const std::string& text, bool caseSensitive);
+
+        bool empty() const { return literal.empty(); }
+        const std::string& getLiteral() const { return literal; }
+
+        // Start of the first occurrence in [begin, end)
+        const char* find(const char* begin, const char* end) const;
+    };
+
+}
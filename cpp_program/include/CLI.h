@@ -4,7 +4,13 @@
 #include "FileManager.h"
 #include "SearchEngine.h"
 #include "BatchOperations.h"
+#include "StatisticsEngine.h"
+#include "OutputWriter.h"
+#include "RecordWriter.h"
+#include "TreeCache.h"
+#include "Instrumentation.h"
 #include <map>
+#include <memory>
 #include <functional>
 
 namespace FileSystemManager {
@@ -14,6 +20,10 @@ namespace FileSystemManager {
         FileManager fileManager;
         SearchEngine searchEngine;
         BatchOperations batchOps;
+        OutputWriter out;
+        RecordWriter records;
+        std::shared_ptr<TreeCache> treeCache;   // Shared snapshot cache (daemon mode)
+        std::shared_ptr<IoThrottle> ioThrottle; // Limits of both engines; shared in daemon mode
         
         std::map<std::string, std::function<void(const std::vector<std::string>&)>> commands;
         bool running;
@@ -39,12 +49,19 @@ namespace FileSystemManager {
         void handleCat(const std::vector<std::string>& args);
         void handleEcho(const std::vector<std::string>& args);
         void handleFind(const std::vector<std::string>& args);
+        void handleFindDate(const std::vector<std::string>& args);
+        void handleDateIndex(const std::vector<std::string>& args);
         void handleGrep(const std::vector<std::string>& args);
         void handleSize(const std::vector<std::string>& args);
         void handleTree(const std::vector<std::string>& args);
         void handleSearch(const std::vector<std::string>& args);
         void handleBatch(const std::vector<std::string>& args);
+        void handleOrganize(const std::vector<std::string>& args);
+        void handleCleanup(const std::vector<std::string>& args);
+        void handleVerify(const std::vector<std::string>& args);
         void handleStats(const std::vector<std::string>& args);
+        void handleProfile(const std::vector<std::string>& args);
+        void handleThrottle(const std::vector<std::string>& args);
         void handleClear(const std::vector<std::string>& args);
         
         // Utility functions
@@ -55,12 +72,26 @@ namespace FileSystemManager {
         void printFileInfo(const FileInfo& info);
         void printSearchResult(const SearchResult& result);
         void printOperationResult(const OperationResult& result);
+        void printTreeStatistics(const TreeStatistics& stats);
+        void printProfile(const std::string& command, uint64_t wallNs, const MetricsSnapshot& metrics);
         
         // Formatting
         std::string formatFileSize(size_t bytes);
         std::string formatTimestamp(const std::string& timestamp);
         void printTable(const std::vector<std::vector<std::string>>& data, const std::vector<std::string>& headers);
         
+        // Cache-aware lookups (fall back to a live walk without a cache)
+        std::vector<SearchResult> findByName(const std::string& pattern);
+        bool scopeGrep(const std::string& target, SearchQuery& query, std::string& error) const;
+        size_t directorySize(const std::string& path);
+        // After a command that writes: marks cached trees covering the
+        // current directory or any argument stale, without waiting for
+        // (or, past the watch limit, never getting) a change notification
+        void invalidateCachedTrees(const std::string& command, const std::vector<std::string>& args);
+        
+        // Parallel script support
+        void syncFrom(const CLI& source);
+        
     public:
         CLI();
         explicit CLI(const std::string& initialPath);
@@ -69,11 +100,24 @@ namespace FileSystemManager {
         // Main interface
         void run();
         void runScript(const std::string& scriptPath);
+        void runScriptParallel(const std::string& scriptPath, size_t jobs = 0);
         void executeCommand(const std::string& command);
         
         // Configuration
         void setPrompt(const std::string& newPrompt);
         void setVerbose(bool verbose);
+        void setOutputFormat(OutputFormat format, bool withFormattedFields = false);
+        void setOutputDescriptor(int fd);
+        void setTreeCache(std::shared_ptr<TreeCache> cache);
+        // Shows batch progress on stderr every interval; 0 turns it off
+        void setProgressInterval(std::chrono::milliseconds interval);
+        // Time limit of each search and batch command; 0 = none
+        void setOperationTimeout(std::chrono::milliseconds timeout);
+        // I/O limits of searches and batches. Sessions given the same
+        // throttle share its limits, and the throttle command changes them
+        // for everything running on it.
+        void setIoThrottle(std::shared_ptr<IoThrottle> throttle);
+        void setIoLimits(const IoLimits& limits);
         
         // Interactive features
         void enableAutoComplete();
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace FileSystemManager {
+
+    // Cooperative cancellation of one operation: cancel() from any thread,
+    // or a deadline. Loops check isCancelled() between files and between
+    // chunks of a file, so even a single large copy or scan stops within
+    // one chunk. Without a deadline a check is one relaxed load; with one
+    // it also reads the monotonic clock.
+    class CancellationToken {
+    public:
+        enum class State : uint8_t {
+            Running,
+            Cancelled,
+            TimedOut
+        };
+
+    private:
+        mutable std::atomic<State> state;
+        std::atomic<int64_t> deadlineNs;    // steady_clock; INT64_MAX = none
+
+        static int64_t nowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    public:
+        CancellationToken() : state(State::Running), deadlineNs(INT64_MAX) {}
+
+        CancellationToken(const CancellationToken&) = delete;
+        CancellationToken& operator=(const CancellationToken&) = delete;
+
+        void cancel();
+        // A deadline only ever moves earlier; a zero or negative timeout does nothing
+        void setDeadline(std::chrono::steady_clock::time_point deadline);
+        void setTimeout(std::chrono::nanoseconds timeout);
+        bool hasDeadline() const;
+
+        bool isCancelled() const {
+            if (state.load(std::memory_order_relaxed) != State::Running) return true;
+            int64_t deadline = deadlineNs.load(std::memory_order_relaxed);
+            if (deadline == INT64_MAX || nowNs() < deadline) return false;
+            State running = State::Running;
+            state.compare_exchange_strong(running, State::TimedOut, std::memory_order_relaxed);
+            return true;
+        }
+        State getState() const;
+
+        // "Operation cancelled" or "Operation timed out"
+        std::string describe() const;
+    };
+
+}
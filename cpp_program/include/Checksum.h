@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace FileSystemManager {
+
+    // Streaming XXH64: a non-cryptographic 64-bit hash that runs at memory
+    // speed, for telling whether a copy came out the same as its source.
+    // Matches the reference xxHash implementation for any way the input is
+    // split into update() calls.
+    class Xxh64 {
+    private:
+        uint64_t lanes[4];
+        unsigned char pending[32];     // Input not yet folded into the lanes
+        size_t pendingLength;
+        uint64_t totalLength;
+        uint64_t seed;
+
+    public:
+        explicit Xxh64(uint64_t hashSeed = 0);
+
+        void reset();
+        void update(const void* data, size_t length);
+        uint64_t digest() const;
+
+        static uint64_t hash(const void* data, size_t length, uint64_t seed = 0);
+        // 16 lowercase hex digits, as xxhsum prints them
+        static std::string toHex(uint64_t value);
+        static bool fromHex(const std::string& text, uint64_t& value);
+    };
+
+    // One file as the manifest last saw it. Size and modification time are
+    // the file's when it was hashed, so a later run can tell a file that was
+    // changed (new time or size) from one that went bad (same time and size,
+    // different hash).
+    struct ManifestEntry {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+        int64_t modifiedNs = 0;
+    };
+
+    // Per-file checksums of one directory tree, kept in a text file at its
+    // root. One line per file, sorted by path:
+    //
+    //   <xxh64 hex> <size> <mtime ns> <path relative to the root>
+    //
+    // Backslashes and newlines in paths are written as \\ and \n.
+    class ChecksumManifest {
+    private:
+        std::map<std::string, ManifestEntry> entries;
+
+    public:
+        static constexpr const char* FileName = ".fsmanager-checksums";
+        static std::string pathFor(const std::string& directory);
+
+        // A missing file loads as an empty manifest
+        bool load(const std::string& path, std::string& error);
+        // Written to a temporary file and renamed over the old one
+        bool save(const std::string& path, std::string& error) const;
+
+        const ManifestEntry* find(const std::string& relativePath) const;
+        void set(const std::string& relativePath, const ManifestEntry& entry);
+        bool erase(const std::string& relativePath);
+        size_t size() const { return entries.size(); }
+        const std::map<std::string, ManifestEntry>& getEntries() const { return entries; }
+    };
+
+}
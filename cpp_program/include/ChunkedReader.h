@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace FileSystemManager {
+
+    class CancellationToken;
+    class IoThrottle;
+
+    // Bounds on how much of a file a content scan holds and reads
+    struct ScanLimits {
+        size_t windowSize = 1 << 20;    // Bytes held in memory at once
+        size_t maxLineLength = 512;     // Longer lines are reported as an excerpt around the match
+        uint64_t maxFileBytes = 0;      // Data read per file before the scan stops; 0 = no cap
+    };
+
+    // A window of file data: whole lines, except where a line is longer than
+    // the window or is interrupted by a hole
+    struct ScanWindow {
+        std::string_view data;
+        uint64_t offset = 0;            // File offset of data[0]
+        size_t firstLine = 1;           // Line number of data[0]
+        bool startsMidLine = false;     // data[0] continues the previous window's last line
+        bool endsMidLine = false;       // The last line goes on in the next window
+
+        // Text of the line [lineStart, lineEnd) within data, cut to at most
+        // maxLength bytes around [focus, focus + focusLength) and marked with
+        // "..." wherever something was left out
+        std::string excerpt(const char* lineStart, const char* lineEnd, const char* focus, size_t focusLength,
+                            size_t maxLength) const;
+    };
+
+    // Reads a file front to back in fixed-size windows, so memory stays
+    // bounded however large the file or its lines are. Windows end after a
+    // newline where there is one; a line longer than the window is split,
+    // and the next window starts with the last `overlap` bytes again so a
+    // match of up to overlap + 1 bytes across the cut is still seen whole.
+    // Holes in sparse files are stepped over with SEEK_DATA instead of being
+    // read as zeros; they break a line like a window cut, without overlap.
+    class ChunkedReader {
+    private:
+        ScanLimits limits;
+        size_t overlap;
+        std::unique_ptr<char[]> buffer; // windowSize bytes, allocated on first open
+        size_t used;                    // Valid bytes in buffer
+        size_t consumed;                // Bytes of buffer handed out by the last next()
+        size_t carried;                 // Leading bytes already handed out once (the overlap)
+        uint64_t bufferOffset;          // File offset of buffer[0]
+        size_t bufferLine;              // Line number of buffer[0]
+        bool bufferStartsMidLine;
+        uint64_t fileOffset;            // Next byte to read
+        uint64_t dataEnd;               // End of the data region holding fileOffset
+        uint64_t bytesRead;
+        bool atEnd;
+        bool holeAhead;                 // Data before a hole is waiting to be handed out
+        bool truncated;
+        IoThrottle* throttle;
+        const CancellationToken* cancellation;
+#ifndef _WIN32
+        int fd;
+#else
+        std::unique_ptr<std::ifstream> stream;
+#endif
+
+        bool isOpen() const;
+        // Reads until target bytes are buffered, a hole or the end
+        void fill(size_t target);
+        // Moves fileOffset past a hole; false at the end of the file
+        bool seekData();
+        size_t readAt(char* destination, size_t length);
+
+    public:
+        ChunkedReader(const ScanLimits& scanLimits, size_t overlapBytes);
+        ~ChunkedReader();
+        ChunkedReader(const ChunkedReader&) = delete;
+        ChunkedReader& operator=(const ChunkedReader&) = delete;
+
+        // Every read is charged to ioThrottle as it happens; a wait for it
+        // ends early once stop is cancelled. Null for neither.
+        void setThrottle(IoThrottle* ioThrottle, const CancellationToken* stop);
+
+        // A reader can be reopened for file after file, reusing its buffer
+        bool open(const std::string& path);
+        void close();
+
+        // The first bytes of the file (at most length, and at most up to a
+        // hole) without consuming them, e.g. to classify the content before
+        // scanning. offset is where they start: nonzero after a leading hole.
+        bool peek(size_t length, std::string_view& sample, uint64_t& offset);
+
+        // The next window; its data stays valid until the following call
+        bool next(ScanWindow& window);
+
+        uint64_t getBytesRead() const { return bytesRead; }
+        // Whether the byte cap stopped the scan before the end of the file
+        bool wasTruncated() const { return truncated; }
+    };
+
+}
@@ -7,7 +7,10 @@
 #include <fstream>
 #include <chrono>
 #include <iomanip>
+#include <map>
 #include <sstream>
+#include <cstdint>
+#include <string_view>
 
 namespace fs = std::filesystem;
 
@@ -21,19 +24,32 @@ namespace FileSystemManager {
         std::string extension;
         size_t size;
         std::string lastModified;
+        int64_t modifiedTime = 0;   // Seconds since the Unix epoch
         bool isDirectory;
         
         FileInfo() = default;
         FileInfo(const fs::path& filePath);
     };
 
+    // One line a content search matched
+    struct LineMatch {
+        size_t lineNumber = 0;                  // 1-based
+        std::string text;                       // The line, or an excerpt around the match if it is long
+        std::vector<std::string> keywords;      // Keywords on the line, for multi-pattern search
+    };
+
+    // "Line 12: text", or "Line 12 [a, b]: text" with keywords
+    std::string describeLineMatch(const LineMatch& match);
+
     // Search result structure
     struct SearchResult {
         std::string filePath;
         std::string fileName;
         size_t fileSize;
-        std::string lastModified;
-        std::vector<std::string> matchingLines; // For content search
+        std::string lastModified;               // Empty when timestamp formatting is disabled
+        int64_t modifiedTime = 0;               // Seconds since the Unix epoch
+        std::vector<LineMatch> matchingLines;   // For content search
+        std::vector<std::string> matchedPatterns; // Keywords found, for multi-pattern search
     };
 
     // Operation result structure
@@ -45,13 +61,61 @@ namespace FileSystemManager {
         std::vector<std::string> errors;
     };
 
+    // Glob pattern ('*' and '?' wildcards) compiled once and matched without std::regex
+    class GlobPattern {
+    private:
+        std::string pattern;
+        bool caseSensitive;
+        
+    public:
+        GlobPattern();
+        explicit GlobPattern(const std::string& glob, bool caseSensitive = false);
+        
+        bool matches(std::string_view name) const;
+        const std::string& getPattern() const;
+    };
+
+    // strftime of modification times, run once per distinct local day; later
+    // times from that day are answered from the cached [midnight, next
+    // midnight) span. Formats showing the time of day are cached per second.
+    // Not safe to share between threads.
+    class DayFormatter {
+    private:
+        using Spans = std::map<int64_t, std::pair<int64_t, std::string>>;
+
+        std::string timeFormat;
+        bool perSecond;
+        Spans spans;                // Start -> end (exclusive) and text, in epoch seconds
+        Spans::const_iterator last; // Span of the previous time: batches cluster by day
+
+    public:
+        explicit DayFormatter(const std::string& dateFormat);
+
+        DayFormatter(const DayFormatter&) = delete;
+        DayFormatter& operator=(const DayFormatter&) = delete;
+
+        // False if the format yields nothing (or more than 255 bytes)
+        bool format(int64_t modifiedNs, std::string& text);
+    };
+
     // Utility functions
     std::string formatFileSize(size_t bytes);
+    size_t formatFileSize(uint64_t bytes, char* buffer, size_t capacity);
     std::string getCurrentTimestamp();
     std::string formatTimestamp(const std::chrono::system_clock::time_point& time);
+    // Local "YYYY-MM-DD", "YYYY-MM-DD HH:MM:SS" or "YYYY-MM-DDTHH:MM:SS" to
+    // nanoseconds since the epoch; endOfRange rounds up to the last nanosecond
+    bool parseTimestamp(const std::string& text, bool endOfRange, int64_t& epochNs);
+    // "10", "4K", "1.5M", "2G" (binary units) to bytes
+    bool parseByteSize(const std::string& text, uint64_t& bytes);
     bool isValidPath(const std::string& path);
+    // $XDG_CACHE_HOME/fsmanager, else ~/.cache/fsmanager, else below the
+    // temp directory; not created here
+    std::string cacheDirectory();
     std::vector<std::string> splitString(const std::string& str, char delimiter);
     std::string toLowerCase(const std::string& str);
     bool matchesPattern(const std::string& filename, const std::string& pattern);
+    std::string escapeJson(const std::string& str);
+    std::string escapeCsv(const std::string& str);
 }
 
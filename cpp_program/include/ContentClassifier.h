@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Common.h"
+#include "DirectoryWalker.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace FileSystemManager {
+
+    enum class ContentKind : uint8_t {
+        Text,
+        Binary,
+        Unreadable
+    };
+
+    enum class TextEncoding : uint8_t {
+        None,           // Not text
+        Plain,          // ASCII or UTF-8 without a byte order mark (not validated)
+        Utf8Bom,
+        Utf16LE,
+        Utf16BE
+    };
+
+    struct ContentVerdict {
+        ContentKind kind = ContentKind::Unreadable;
+        TextEncoding encoding = TextEncoding::None;
+
+        bool isText() const { return kind == ContentKind::Text; }
+        // Text that byte-oriented matchers can search (not UTF-16)
+        bool isSearchable() const {
+            return kind == ContentKind::Text && (encoding == TextEncoding::Plain || encoding == TextEncoding::Utf8Bom);
+        }
+    };
+
+    // Decides whether files are text, for search and file management alike.
+    // Known binary extensions are decided from the name alone; otherwise the
+    // first SampleSize bytes are checked for a byte order mark, then NUL and
+    // control bytes with vector scans. Verdicts are cached process-wide by
+    // (device, inode, mtime, size), so a file is sampled once until it
+    // changes, however many searches look at it.
+    class ContentClassifier {
+    private:
+        struct Key {
+            uint64_t device;
+            uint64_t inode;
+            int64_t modifiedNs;
+            uint64_t size;
+
+            bool operator==(const Key& other) const {
+                return device == other.device && inode == other.inode &&
+                       modifiedNs == other.modifiedNs && size == other.size;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const;
+        };
+
+        static constexpr size_t MaxCachedVerdicts = 1 << 20;
+
+        mutable std::mutex cacheMutex;
+        std::unordered_map<Key, ContentVerdict, KeyHash> verdicts;
+
+        static bool keyFor(const EntryMetadata& metadata, Key& key);
+
+    public:
+        static constexpr size_t SampleSize = 8192;
+
+        static ContentClassifier& shared();
+
+        // Pure content checks on (up to SampleSize bytes of) data
+        static ContentVerdict classifyContent(const char* data, size_t size);
+        static bool hasBinaryExtension(std::string_view fileName);
+
+        // Reads the sample only when neither the name nor the cache decides
+        ContentVerdict classifyFile(const std::string& filePath);
+        ContentVerdict classifyFile(const std::string& filePath, const EntryMetadata& metadata);
+
+        // For callers that read the whole file anyway: decide without
+        // reading if possible, else classify the buffer and remember it
+        bool classifyWithoutReading(std::string_view fileName, const EntryMetadata& metadata, ContentVerdict& verdict) const;
+        ContentVerdict classifyBuffer(const EntryMetadata& metadata, const char* data, size_t size);
+
+        size_t getCachedCount() const;
+        void clear();
+    };
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Common.h"
+#include "TreeCache.h"
+#include "RecordWriter.h"
+#include "IoThrottle.h"
+#include <atomic>
+#include <memory>
+
+namespace FileSystemManager {
+
+    // Long-running server that executes CLI commands on behalf of thin clients
+    // over a Unix domain socket, keeping the tree cache warm between calls.
+    //
+    // Request (text lines, one command per connection):
+    //   cwd <directory>            optional, working directory of the command
+    //   format <name> [timestamps] optional, output format (see RecordWriter)
+    //   exec <command line>        required, terminates the request
+    //   shutdown                   stops the daemon instead of running a command
+    // The response is the command's output streamed as produced; the server
+    // closes the connection when the command completes.
+    class DaemonServer {
+    private:
+        std::string socketPath;
+        int listenFd;
+        std::atomic<bool> running;
+        std::shared_ptr<TreeCache> treeCache;
+        std::shared_ptr<IoThrottle> ioThrottle;     // One set of I/O limits for every session
+        size_t workerCount;
+
+        void handleConnection(int clientFd);
+
+    public:
+        explicit DaemonServer(const std::string& path, size_t workers = 0);
+        ~DaemonServer();
+
+        DaemonServer(const DaemonServer&) = delete;
+        DaemonServer& operator=(const DaemonServer&) = delete;
+
+        // Binds the socket; returns false with a message if that is impossible
+        bool start(std::string& error);
+
+        // Accepts connections until stop() is called
+        void serve();
+        void stop();
+
+        std::shared_ptr<TreeCache> getTreeCache() const;
+        std::shared_ptr<IoThrottle> getIoThrottle() const;
+        static std::string defaultSocketPath();
+
+        // Thin client: sends one command and streams the response to stdout.
+        // Returns the process exit code.
+        static int runClient(const std::string& path, const std::string& command,
+                             OutputFormat format = OutputFormat::Human, bool withFormattedFields = false);
+    };
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+#include <functional>
+
+namespace FileSystemManager {
+
+    // Secondary index of a tree's regular files sorted by modification time,
+    // so a date-range query is two binary searches over a memory-mapped file
+    // instead of a walk.
+    //
+    // File layout (native endianness, 8-byte aligned sections):
+    //   header:  magic "FSMDIDX1", uint32 version, uint32 root length,
+    //            uint64 record count, uint64 directory count, uint64 path bytes,
+    //            int64 build time (ns, when the walk started)
+    //   root:    root path bytes, padded to 8
+    //   records: { int64 mtime ns, uint64 size, uint64 path offset } sorted by mtime
+    //   directories: { int64 mtime ns, uint64 path offset }, the root first
+    //   paths:   NUL-terminated full paths referenced by the records
+    //
+    // The index is a snapshot. Creating, removing or renaming an entry
+    // changes its directory's mtime, which isUpToDate() checks; a file
+    // rewritten in place since the build has an mtime after getBuiltAtNs().
+    class DateIndex {
+    public:
+        struct Record {
+            int64_t modifiedNs;     // Nanoseconds since the Unix epoch
+            uint64_t size;
+            uint64_t pathOffset;    // Into the path section
+        };
+
+        // A directory as it was when the walk reached it
+        struct DirectoryRecord {
+            int64_t modifiedNs;
+            uint64_t pathOffset;
+        };
+
+        using RecordVisitor = std::function<void(const Record& record, std::string_view path)>;
+
+    private:
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t rootLength;
+            uint64_t recordCount;
+            uint64_t directoryCount;
+            uint64_t pathBytes;
+            int64_t builtAtNs;
+        };
+
+        const char* data;
+        size_t dataSize;
+        bool mapped;                // data is an mmap (otherwise heap-owned)
+        const Header* header;
+        const Record* records;
+        const DirectoryRecord* directories;
+        const char* paths;
+
+        static const uint32_t FormatVersion = 2;
+
+        std::string_view pathAt(uint64_t offset) const;
+
+    public:
+        DateIndex();
+        ~DateIndex();
+
+        DateIndex(const DateIndex&) = delete;
+        DateIndex& operator=(const DateIndex&) = delete;
+
+        // Per-user cache location for root's index
+        static std::string defaultPathFor(const std::string& root);
+
+        // Walks root in parallel and atomically replaces the index at indexPath
+        static bool build(const std::string& root, const std::string& indexPath,
+                          size_t& recordCount, std::string& error);
+
+        bool open(const std::string& indexPath, std::string& error);
+        void close();
+        bool isOpen() const;
+
+        std::string getRoot() const;
+        int64_t getBuiltAtNs() const;
+        size_t size() const;
+
+        // True while no directory of the tree was created, removed or had
+        // entries added, removed or renamed since the build (one stat per
+        // directory). Files rewritten in place are not seen here.
+        bool isUpToDate() const;
+
+        // Visits records with startNs <= mtime <= endNs, oldest first; returns
+        // the number visited
+        size_t forEachInRange(int64_t startNs, int64_t endNs, const RecordVisitor& visit) const;
+    };
+
+}
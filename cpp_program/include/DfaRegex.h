@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ByteScan.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace FileSystemManager {
+
+    // A regular expression compiled to a Thompson NFA and run as a lazily
+    // built DFA, so every input byte is examined once and matching time is
+    // linear in the input (std::regex backtracks and can take exponential
+    // time). The compiled program is immutable and may be shared between
+    // threads; matching state lives in RegexMatcher.
+    //
+    // Syntax is the POSIX ERE subset that grep -E users expect: literals,
+    // '.', bracket expressions with ranges and [:class:] names, \d \w \s
+    // (and \D \W \S), \t \n \r, escaped metacharacters, (...) and (?:...),
+    // '|', '*', '+', '?', {m}, {m,}, {m,n}, and '^'/'$' as line anchors.
+    // Backreferences and lookaround are not regular and are rejected.
+    // Matching is on bytes and, as in grep, only an explicit \n matches a
+    // newline, so a match normally stays within one line.
+    class DfaRegex {
+    public:
+        // Program representation, shared with the compiler and RegexMatcher
+        enum class OpCode : uint8_t {
+            ByteSet,        // Consume one byte in byteSets[setIndex], continue at out
+            Split,          // Continue at both out and out1
+            Jump,
+            LineStart,      // Assertions; continue at out if they hold
+            LineEnd,
+            Match
+        };
+
+        struct Instruction {
+            OpCode op;
+            int out;
+            int out1;
+            int setIndex;
+        };
+
+        using ByteSet = std::array<uint64_t, 4>;
+
+    private:
+        friend class RegexMatcher;
+
+        std::string pattern;
+        bool caseSensitive;
+        bool valid;
+        bool newlineMatchable;              // Some byte set contains '\n'
+        bool startAnchored;                 // Uses '^'
+        bool endAnchored;                   // Uses '$'
+        std::vector<Instruction> program;
+        std::vector<ByteSet> byteSets;
+        int startInstruction;
+        // Bytes that no byte set tells apart share a class, so DFA rows have
+        // one column per class instead of 256
+        std::array<uint8_t, 256> byteClasses;
+        std::vector<uint8_t> classRepresentatives;
+        std::string requiredLiteral;
+        LiteralFinder literalFinder;
+
+    public:
+        DfaRegex();
+
+        // Returns false with a description in error when the pattern is invalid
+        bool compile(const std::string& regexPattern, bool caseSensitive, std::string& error);
+
+        bool isValid() const { return valid; }
+        const std::string& getPattern() const { return pattern; }
+        bool isCaseSensitive() const { return caseSensitive; }
+        bool canMatchNewline() const { return newlineMatchable; }
+        bool hasLineStartAnchor() const { return startAnchored; }
+        bool hasLineEndAnchor() const { return endAnchored; }
+        // Longest string every match contains (lowercased when case-insensitive);
+        // empty when there is none. Used to skip input without running the DFA.
+        const std::string& getRequiredLiteral() const { return requiredLiteral; }
+        size_t getClassCount() const { return classRepresentatives.size(); }
+    };
+
+    // Per-thread lazy DFA over a compiled DfaRegex. States are built on demand
+    // from sets of NFA instructions and cached; when the cache grows past its
+    // limit it is flushed and rebuilt from the current position.
+    class RegexMatcher {
+    public:
+        using LineVisitor = std::function<void(size_t lineNumber, std::string_view line)>;
+
+    private:
+        struct State {
+            std::vector<int> instructions;  // Sorted NFA set; unresolved '$' assertions included
+            bool anchored;
+        };
+
+        static const uint8_t MatchNow = 1;
+        static const uint8_t MatchAtLineEnd = 2;
+        static const uint8_t Dead = 4;
+        static const size_t MaxStates = 4096;
+
+        const DfaRegex& regex;
+        std::vector<State> states;
+        std::vector<uint8_t> stateFlags;    // Parallel to states, read in the scan loop
+        std::vector<int32_t> transitions;   // states x classes; -1 = not built yet
+        std::unordered_map<std::string, int> stateIndex;
+        int startStates[2];                 // Unanchored, anchored; -1 = not built yet
+        size_t flushCount;
+        // Closure scratch
+        std::vector<int> stack;
+        std::vector<uint32_t> visited;
+        uint32_t generation;
+        std::vector<int> seeds;
+        std::vector<int> closureSet;
+        std::string keyBuffer;
+
+        void flush();
+        void closure(bool lineStart, bool lineEndKnown, bool atLineEnd, std::vector<int>& out);
+        int stateFor(const std::vector<int>& instructions, bool anchored);
+        int startState(bool anchored);
+        int computeTransition(int state, unsigned char byte);
+
+        int next(int state, unsigned char byte) {
+            int32_t target = transitions[static_cast<size_t>(state) * regex.getClassCount() + regex.byteClasses[byte]];
+            return target >= 0 ? target : computeTransition(state, byte);
+        }
+
+        // End of the earliest match starting at or after begin (which must be
+        // a line start), or nullptr
+        const char* findMatchEnd(const char* begin, const char* end);
+
+    public:
+        explicit RegexMatcher(const DfaRegex& regex);
+
+        const DfaRegex& getRegex() const { return regex; }
+
+        // Whether the whole of text matches
+        bool fullMatch(std::string_view text);
+
+        // Reports each line of buffer that contains a match, at most once and
+        // in order, with 1-based line numbers; a match spanning lines (through
+        // \n) is reported on the line where it ends. Returns the count.
+        size_t forEachMatchingLine(std::string_view buffer, const LineVisitor& visit, size_t maxLines = SIZE_MAX);
+        bool contains(std::string_view buffer);
+    };
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Common.h"
+#include "PathArena.h"
+#include <functional>
+#include <cstdint>
+
+namespace FileSystemManager {
+
+    class CancellationToken;
+    class IoThrottle;
+
+    // Metadata gathered with a single stat call per entry
+    struct EntryMetadata {
+        uint64_t size = 0;
+        int64_t modifiedNs = 0;      // Nanoseconds since the Unix epoch
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        bool isRegularFile = false;
+        bool isDirectory = false;
+    };
+
+    struct WalkOptions {
+        bool recursive = true;
+        bool followSymlinks = false;
+        size_t threadCount = 0;      // 0 = use hardware concurrency
+        // Once cancelled the walk stops listing and returns; checked per entry
+        const CancellationToken* cancellation = nullptr;
+        // Charged one operation per directory listed
+        IoThrottle* throttle = nullptr;
+    };
+
+    enum class EntryType : uint8_t {
+        Unknown,        // Type could not be determined
+        Regular,
+        Directory,
+        Symlink,
+        Other
+    };
+
+    // One entry as seen by a walk callback. The node (and the open parent
+    // directory) are only valid during the callback; directory nodes stay
+    // valid until walk() returns, since they are the parents of later entries.
+    struct WalkEntry {
+        const PathNode* node;
+        int depth;
+        EntryType type;             // From the directory listing, not following symlinks
+        int directoryFd;            // Open parent directory, -1 where unsupported
+
+        std::string_view name() const { return node->getName(); }
+        std::string path() const { return node->path(); }
+        void appendPath(std::string& out) const { node->appendPath(out); }
+    };
+
+    // Parallel directory traversal shared by the tree-wide engines.
+    // Directories are handed out to worker threads from a shared queue; each
+    // callback receives a stable worker index so callers can accumulate
+    // per-worker state without locking and merge it once the walk finishes.
+    //
+    // Paths are kept as PathNodes in per-worker arenas: directory nodes live
+    // for the whole walk, file nodes in a scratch arena rewound after each
+    // directory, so listing an entry costs no heap allocation.
+    class DirectoryWalker {
+    public:
+        using EntryVisitor = std::function<void(size_t workerIndex, const WalkEntry& entry)>;
+        using DirectoryVisitor = std::function<void(size_t workerIndex, const PathNode* directory, size_t entryCount, int depth)>;
+        // Returning false prunes the subtree below a directory entry
+        using DescendFilter = std::function<bool(size_t workerIndex, const WalkEntry& directory)>;
+
+    private:
+        WalkOptions options;
+
+    public:
+        DirectoryWalker();
+        explicit DirectoryWalker(const WalkOptions& walkOptions);
+
+        size_t getThreadCount() const;
+
+        // Visits every entry below root. onDirectory, if set, is called once per
+        // directory after all of its entries have been visited.
+        void walk(const std::string& root, const EntryVisitor& onEntry,
+                  const DirectoryVisitor& onDirectory = DirectoryVisitor(),
+                  const DescendFilter& shouldDescend = DescendFilter()) const;
+
+        // Single stat of an entry (relative to its open parent directory where
+        // supported); returns false if the entry vanished or is unreadable
+        static bool readMetadata(const WalkEntry& entry, EntryMetadata& metadata, bool followSymlinks = true);
+        static bool readPathMetadata(const std::string& filePath, EntryMetadata& metadata, bool followSymlinks = true);
+#ifndef _WIN32
+        // Stat of name inside an already open directory
+        static bool readMetadataAt(int directoryFd, const char* name, EntryMetadata& metadata, bool followSymlinks = true);
+#endif
+    };
+
+}
@@ -54,6 +54,8 @@ namespace FileSystemManager {
         void refreshCache();
         void clearCache();
         std::vector<std::string> getDirectoryTree(const std::string& path = "", int maxDepth = 3);
+        // The same entries, in the same order, as FileInfo
+        std::vector<FileInfo> getDirectoryTreeEntries(const std::string& path = "", int maxDepth = 3);
         
         // File watching (basic implementation)
         void addWatchedDirectory(const std::string& path);
@@ -62,6 +64,7 @@ namespace FileSystemManager {
         
     private:
         void getDirectoryTreeRecursive(const std::string& path, std::vector<std::string>& result, int currentDepth, int maxDepth);
+        void getDirectoryTreeEntriesRecursive(const std::string& path, std::vector<FileInfo>& result, int currentDepth, int maxDepth);
     };
 
 }
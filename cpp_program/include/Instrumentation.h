@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace FileSystemManager {
+
+    // Event counters recorded on hot paths
+    enum class Counter : uint8_t {
+        EntriesVisited,      // Directory entries produced by any traversal
+        StatCalls,           // stat/lstat-equivalent metadata lookups
+        FilesOpened,
+        BytesRead,
+        BytesWritten,
+        RegexCompilations,
+        Allocations,         // operator new calls
+        AllocatedBytes,
+        TasksQueued,         // Work items pushed to walker/pool queues
+        ClassifierCacheHits, // Binary/text verdicts answered without opening the file
+        SparseBytesSkipped,  // File holes stepped over by content scans
+        ScansTruncated,      // Content scans stopped by the per-file byte cap
+        CrossDeviceMoves,    // Moves done as copy + unlink because rename hit EXDEV
+        RenameCycles,        // Rename cycles broken through a temporary name
+        ThrottleWaitNs,      // Time spent waiting for an I/O limit
+        Count
+    };
+
+    // Value distributions, bucketed by power of two
+    enum class Histogram : uint8_t {
+        WalkQueueDepth,      // Pending directories when one is pushed
+        PoolQueueDepth,      // Pending pool tasks when one is submitted
+        FileBytesRead,       // Bytes read per opened file
+        DirectoryEntries,    // Entries per listed directory
+        Count
+    };
+
+    constexpr size_t CounterCount = static_cast<size_t>(Counter::Count);
+    constexpr size_t HistogramCount = static_cast<size_t>(Histogram::Count);
+    constexpr size_t HistogramBuckets = 65;     // Bucket i holds values in [2^(i-1), 2^i)
+
+    struct PhaseTotal {
+        uint64_t calls = 0;
+        uint64_t totalNs = 0;
+    };
+
+    // Point-in-time totals; subtract two snapshots to measure an interval
+    struct MetricsSnapshot {
+        std::array<uint64_t, CounterCount> counters{};
+        std::array<std::array<uint64_t, HistogramBuckets>, HistogramCount> histograms{};
+        std::map<std::string, PhaseTotal> phases;
+
+        uint64_t get(Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+        uint64_t samples(Histogram histogram) const;
+        // Upper bound of the bucket containing the given quantile (0..1)
+        uint64_t quantile(Histogram histogram, double q) const;
+
+        MetricsSnapshot operator-(const MetricsSnapshot& earlier) const;
+
+        // Flat key/value view for structured output: counters, phase_<name>_ns,
+        // phase_<name>_calls, and <histogram>_p50/_p90/_max for non-empty histograms
+        std::vector<std::pair<std::string, uint64_t>> toFields() const;
+    };
+
+    const char* counterName(Counter counter);
+    const char* histogramName(Histogram histogram);
+
+    // Process-wide instrumentation. Disabled by default, in which case every
+    // hook costs one relaxed atomic load. When enabled, counters live in
+    // per-thread blocks written without read-modify-write atomics and are
+    // only summed when a snapshot is taken.
+    class Instrumentation {
+    private:
+        static std::atomic<bool> enabled;
+
+        static void addSlow(Counter counter, uint64_t amount);
+        static void recordSlow(Histogram histogram, uint64_t value);
+
+    public:
+        static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+        static void setEnabled(bool value);
+
+        static void add(Counter counter, uint64_t amount = 1) {
+            if (isEnabled()) addSlow(counter, amount);
+        }
+        static void record(Histogram histogram, uint64_t value) {
+            if (isEnabled()) recordSlow(histogram, value);
+        }
+
+        // Phase timing; also emitted as trace events while tracing
+        static void recordPhase(const char* name, const std::string& detail,
+                                std::chrono::steady_clock::time_point start,
+                                std::chrono::steady_clock::time_point end);
+
+        static MetricsSnapshot snapshot();
+
+        // Chrome trace (chrome://tracing, Perfetto). Starting a trace enables
+        // instrumentation; stopTrace writes the file.
+        static void startTrace(const std::string& path);
+        static bool stopTrace(std::string& error);
+        static bool isTracing();
+        // Adds a counter sample to the trace (no-op when not tracing)
+        static void traceCounters();
+    };
+
+    // Times the enclosing scope as a named phase
+    class ScopedPhase {
+    private:
+        const char* name;
+        std::string detail;
+        std::chrono::steady_clock::time_point start;
+        bool active;
+
+    public:
+        explicit ScopedPhase(const char* phaseName, std::string phaseDetail = "");
+        ~ScopedPhase();
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+    };
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace FileSystemManager {
+
+    class CancellationToken;
+
+    // Kernel I/O scheduling class for a background operation's threads.
+    // Only schedulers that know about classes (BFQ, and mq-deadline in
+    // part) act on it, and buffered writes reach the disk later through
+    // the kernel's writeback threads, so it mostly helps reads.
+    enum class IoPriority : uint8_t {
+        Default,        // Left as the process has it
+        BestEffort,     // Best-effort class at its lowest level
+        Idle            // Only gets the disk when nothing else wants it
+    };
+
+    // "default", "best-effort" (or "be") and "idle"
+    bool parseIoPriority(const std::string& text, IoPriority& priority);
+    const char* ioPriorityName(IoPriority priority);
+
+    struct IoLimits {
+        uint64_t bytesPerSecond = 0;        // 0 = unlimited
+        uint64_t operationsPerSecond = 0;   // 0 = unlimited
+        IoPriority priority = IoPriority::Default;
+    };
+
+    // Token buckets for the bytes and I/O operations of background work.
+    // One throttle is shared by every batch and content scan it is given
+    // to, so the limits hold for all of them together, and setLimits
+    // changes them for operations already running. Callers charge what
+    // they just read or wrote; a caller that goes over the limit sleeps
+    // until the buckets have refilled. Bursts are capped at BurstSeconds
+    // worth of each rate. Unlimited, acquire() is one relaxed load.
+    class IoThrottle {
+    public:
+        static constexpr double BurstSeconds = 0.05;
+
+    private:
+        struct Bucket {
+            double rate = 0;                // Per second; 0 = unlimited
+            double level = 0;               // Negative while callers wait for it
+        };
+
+        mutable std::mutex mutex;
+        std::condition_variable changed;
+        IoLimits limits;
+        Bucket bytes;
+        Bucket operations;
+        std::chrono::steady_clock::time_point refilled;
+        uint64_t generation;                // Bumped by setLimits, which releases waiters
+        std::atomic<bool> limited;
+
+        void refill(std::chrono::steady_clock::time_point now);
+        void wait(uint64_t byteCount, uint64_t operationCount, const CancellationToken* cancellation);
+
+    public:
+        IoThrottle();
+
+        IoThrottle(const IoThrottle&) = delete;
+        IoThrottle& operator=(const IoThrottle&) = delete;
+
+        // Rates apply at once, also to operations already running; the
+        // priority applies to operations started after this
+        void setLimits(const IoLimits& newLimits);
+        IoLimits getLimits() const;
+        IoPriority getPriority() const;
+
+        // Charges byteCount bytes and operationCount operations, waiting
+        // while either bucket is in debt. Returns early once cancellation
+        // fires; the caller notices on its next check.
+        void acquire(uint64_t byteCount, uint64_t operationCount = 1, const CancellationToken* cancellation = nullptr) {
+            if (limited.load(std::memory_order_relaxed)) wait(byteCount, operationCount, cancellation);
+        }
+    };
+
+    // Puts the calling thread in an I/O scheduling class for its lifetime
+    // and restores the previous one afterwards. Threads started meanwhile
+    // (walk workers, pools) inherit the class. Does nothing for Default,
+    // where the kernel refuses, or off Linux.
+    class ScopedIoPriority {
+    private:
+        int previous;       // -1 if nothing was changed
+
+    public:
+        explicit ScopedIoPriority(IoPriority priority);
+        ~ScopedIoPriority();
+
+        ScopedIoPriority(const ScopedIoPriority&) = delete;
+        ScopedIoPriority& operator=(const ScopedIoPriority&) = delete;
+
+        bool isApplied() const { return previous >= 0; }
+    };
+
+}
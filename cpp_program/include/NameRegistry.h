@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace FileSystemManager {
+
+    // Hands out free file names in one destination directory: the name itself
+    // if it is free, else name_N.ext for the lowest N not yet handed out or
+    // seen on disk. Each base name remembers where its N left off, so landing
+    // thousands of same-named files costs O(1) per file instead of one
+    // exists() probe per N.
+    //
+    // The directory is listed once, and only when a claimed name is found
+    // taken on disk. Until then claims are optimistic. Callers create with
+    // createExclusive / renameNoReplace, and on EEXIST call reclaim. A claim
+    // therefore never overwrites anything, even when other processes write
+    // to the directory. Safe to share between threads.
+    class NameRegistry {
+    private:
+        std::string directory;
+        mutable std::mutex mutex;
+        std::unordered_set<std::string> taken;
+        std::unordered_map<std::string, size_t> nextSuffix;    // Base name -> next N to try
+        bool listed;
+
+        void list();
+        std::string claimLocked(const std::string& name);
+
+    public:
+        explicit NameRegistry(std::string destinationDir);
+
+        NameRegistry(const NameRegistry&) = delete;
+        NameRegistry& operator=(const NameRegistry&) = delete;
+
+        // A name for a file called name, reserved for the caller
+        std::string claim(const std::string& name);
+        // The claimed name `existing` turned out to exist on disk: remember it
+        // (listing the directory the first time) and claim the next one
+        std::string reclaim(const std::string& name, const std::string& existing);
+        // Gives back a claim whose file was not created after all
+        void release(const std::string& claimed);
+    };
+
+    // Creates an empty file at path; EEXIST if anything is there already
+    std::error_code createExclusive(const std::string& path);
+
+    // rename that never replaces an existing target (EEXIST instead), using
+    // renameat2(RENAME_NOREPLACE) where the kernel and file system have it
+    std::error_code renameNoReplace(const std::string& from, const std::string& to);
+#ifndef _WIN32
+    std::error_code renameNoReplaceAt(int fromDirectory, const char* from, int toDirectory, const char* to);
+#endif
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace FileSystemManager {
+
+    // Left-justified field, the equivalent of std::left << std::setw(width)
+    struct PaddedText {
+        std::string_view text;
+        size_t width;
+        bool alignRight;
+    };
+
+    // Human readable size ("1.5 MB") formatted straight into the output buffer
+    struct FileSizeText {
+        uint64_t bytes;
+    };
+
+    inline PaddedText padRight(std::string_view text, size_t width) { return PaddedText{text, width, false}; }
+    inline PaddedText padLeft(std::string_view text, size_t width) { return PaddedText{text, width, true}; }
+    inline FileSizeText fileSize(uint64_t bytes) { return FileSizeText{bytes}; }
+
+    // Buffered writer used for all CLI output.
+    // Output is collected in large chunks and written with a single system call
+    // when the buffer fills up or the current command ends. When the target is
+    // an interactive terminal, completed lines are flushed immediately so the
+    // user still sees results as they arrive.
+    class OutputWriter {
+    private:
+        int fileDescriptor;
+        bool interactive;
+        std::vector<char> buffer;
+        size_t used;
+        std::string* captureTarget;
+
+        void writeToTarget(const char* data, size_t length);
+        void append(const char* data, size_t length);
+
+    public:
+        static constexpr size_t DefaultBufferSize = 256 * 1024;
+
+        OutputWriter();
+        explicit OutputWriter(int fd, size_t bufferSize = DefaultBufferSize);
+        ~OutputWriter();
+
+        OutputWriter(const OutputWriter&) = delete;
+        OutputWriter& operator=(const OutputWriter&) = delete;
+
+        // Writing
+        void write(const char* data, size_t length);
+        void write(std::string_view text);
+        void writeChar(char c);
+        void writeUnsigned(uint64_t value);
+        void writeSigned(int64_t value);
+        void writeFileSize(uint64_t bytes);
+        void writePadded(std::string_view text, size_t width, bool alignRight = false);
+
+        OutputWriter& operator<<(std::string_view text) { write(text); return *this; }
+        OutputWriter& operator<<(const std::string& text) { write(text.data(), text.size()); return *this; }
+        OutputWriter& operator<<(const char* text) { write(std::string_view(text)); return *this; }
+        OutputWriter& operator<<(char c) { writeChar(c); return *this; }
+        OutputWriter& operator<<(const PaddedText& padded) { writePadded(padded.text, padded.width, padded.alignRight); return *this; }
+        OutputWriter& operator<<(const FileSizeText& size) { writeFileSize(size.bytes); return *this; }
+
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value &&
+                                                      !std::is_same<T, bool>::value, int>::type = 0>
+        OutputWriter& operator<<(T value) {
+            if (std::is_signed<T>::value) {
+                writeSigned(static_cast<int64_t>(value));
+            } else {
+                writeUnsigned(static_cast<uint64_t>(value));
+            }
+            return *this;
+        }
+
+        // Flushing
+        void flush();
+        void endCommand();
+
+        // Redirects output into a string (nullptr restores the file descriptor)
+        void setCaptureTarget(std::string* target);
+
+        // Sends further output to another descriptor (e.g. a client socket)
+        void setFileDescriptor(int fd);
+
+        // Target information
+        bool isInteractive() const;
+        void setInteractive(bool value);
+        size_t bufferedBytes() const;
+    };
+
+}
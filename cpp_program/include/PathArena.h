@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace FileSystemManager {
+
+    // One path component. A node points at its parent instead of holding the
+    // full path, so a traversal stores each name once and only materializes
+    // full paths for entries that are actually reported.
+    struct PathNode {
+        const PathNode* parent;     // nullptr for a root
+        uint32_t nameLength;
+        uint32_t pathLength;        // Length of the full path this node spells
+
+        // The name is stored NUL-terminated directly after the node
+        const char* nameData() const { return reinterpret_cast<const char*>(this + 1); }
+        std::string_view getName() const { return std::string_view(nameData(), nameLength); }
+
+        // Appends the full path in a single sized write
+        void appendPath(std::string& out) const;
+        std::string path() const;
+
+        // Appends the path below ancestor ("a/b" for ancestor/a/b); ancestor
+        // must be on this node's parent chain
+        void appendRelative(const PathNode* ancestor, std::string& out) const;
+    };
+
+    // Bump allocator for PathNodes. Nodes are never freed individually; the
+    // whole arena is released (or rewound for reuse) at once.
+    class PathArena {
+    private:
+        struct Chunk {
+            std::unique_ptr<char[]> data;
+            size_t capacity;
+        };
+
+        std::vector<Chunk> chunks;
+        size_t currentChunk;
+        size_t offset;              // Bytes used in the current chunk
+        size_t bytesUsed;
+
+        static const size_t ChunkSize = 64 * 1024;
+
+        PathNode* allocate(const PathNode* parent, std::string_view name, uint32_t pathLength);
+
+    public:
+        PathArena();
+
+        PathArena(PathArena&&) = default;
+        PathArena& operator=(PathArena&&) = default;
+        PathArena(const PathArena&) = delete;
+        PathArena& operator=(const PathArena&) = delete;
+
+        // Root node for a traversal; trailing separators are dropped ("/" stays "/")
+        const PathNode* makeRoot(std::string_view path);
+        const PathNode* makeChild(const PathNode* parent, std::string_view name);
+
+        // Invalidates every node but keeps the chunks for reuse
+        void reset();
+
+        size_t getBytesUsed() const;
+        size_t getChunkCount() const;
+    };
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace FileSystemManager {
+
+    // One batch's progress as the reporter hands it out
+    struct ProgressSnapshot {
+        size_t filesDone = 0;
+        size_t filesTotal = 0;          // 0 while unknown
+        uint64_t bytesDone = 0;
+        uint64_t bytesTotal = 0;        // 0 while unknown
+        double filesPerSecond = 0;      // Smoothed over the last few seconds
+        double bytesPerSecond = 0;
+        double etaSeconds = -1;         // -1 while unknown
+        double elapsedSeconds = 0;
+        std::string currentFile;        // A file handled since the previous report; may be empty
+        bool finished = false;          // The last report of the batch
+    };
+
+    // Progress of one batch at a time. Workers only bump relaxed atomic
+    // counters; a reporter thread samples them at a fixed interval, works
+    // out throughput and ETA and calls the callback, so the callback never
+    // runs on a worker. The current file name is handed over on request:
+    // the reporter raises a flag and the next worker to see it copies its
+    // name, so workers do not build names nobody reads.
+    class ProgressTracker {
+    public:
+        using Callback = std::function<void(const ProgressSnapshot&)>;
+
+    private:
+        std::atomic<size_t> files;
+        std::atomic<uint64_t> bytes;
+        std::atomic<size_t> totalFiles;
+        std::atomic<uint64_t> totalBytes;
+        std::atomic<bool> nameWanted;
+        std::mutex nameMutex;
+        std::string name;
+
+        Callback callback;
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point started;
+        std::thread reporter;
+        std::mutex reporterMutex;
+        std::condition_variable wake;
+        bool stopping;
+
+        // Rates from the previous sample, smoothed
+        size_t sampledFiles;
+        uint64_t sampledBytes;
+        std::chrono::steady_clock::time_point sampledAt;
+        double filesRate;
+        double bytesRate;
+
+        void runReporter();
+        void stopReporter();
+        ProgressSnapshot sample(bool finished);
+
+    public:
+        ProgressTracker();
+        ~ProgressTracker();
+
+        ProgressTracker(const ProgressTracker&) = delete;
+        ProgressTracker& operator=(const ProgressTracker&) = delete;
+
+        // Takes effect from the next begin(); an empty callback turns reporting off
+        void setCallback(Callback reportCallback, std::chrono::milliseconds reportInterval);
+
+        // Starts a batch; totals may be 0 (unknown) and set later
+        void begin(size_t fileTotal, uint64_t byteTotal = 0);
+        void setTotal(size_t fileTotal, uint64_t byteTotal = 0);
+        // Stops the reporter and sends the final report
+        void finish();
+        void reset();
+
+        // Worker side
+        void advance(size_t fileCount, uint64_t byteCount = 0) {
+            files.fetch_add(fileCount, std::memory_order_relaxed);
+            if (byteCount) bytes.fetch_add(byteCount, std::memory_order_relaxed);
+        }
+        bool wantsName() const {
+            return nameWanted.load(std::memory_order_relaxed);
+        }
+        void offerName(std::string_view currentFile);
+
+        size_t filesDone() const;
+        size_t filesTotal() const;
+    };
+
+}
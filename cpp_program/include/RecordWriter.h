@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Common.h"
+#include "OutputWriter.h"
+
+namespace FileSystemManager {
+
+    enum class OutputFormat {
+        Human,      // Default, formatted for people
+        Ndjson,     // One JSON object per line
+        Tsv,        // Tab separated, one record per line, first column is the record type
+        Binary      // Length-prefixed little-endian records (see below)
+    };
+
+    bool parseOutputFormat(const std::string& name, OutputFormat& format);
+    const char* outputFormatName(OutputFormat format);
+
+    // Serializes result structures straight into an OutputWriter buffer for
+    // machine consumers. Raw values (bytes, epoch seconds) are always emitted;
+    // the human formatted size and timestamp are only added when requested.
+    //
+    // Binary stream layout:
+    //   header:  "FSMB" + uint8 version (2), written before the first record
+    //   record:  uint8 type, uint32 payload length, payload
+    //   payload: fields in the order listed for each record type below;
+    //            strings are uint32 length + bytes, integers are 64-bit,
+    //            booleans are uint8, string lists are uint32 count + strings
+    class RecordWriter {
+    public:
+        enum RecordType : uint8_t {
+            // path, name, size, mtime, [lastModified],
+            // uint32 count + (uint64 line, text, keywords) per matching line, matchedPatterns
+            SearchResultRecord = 1,
+            FileInfoRecord = 2,         // path, name, extension, size, mtime, isDirectory, [lastModified]
+            OperationResultRecord = 3,  // success, message, filesProcessed, filesSkipped, errors
+            ErrorRecord = 4,            // message
+            ProfileRecord = 5,          // command, wallNs, uint32 count + (name, uint64 value) pairs
+            StatsRecord = 6             // path, uint32 count + (name, uint64 value) pairs
+        };
+
+    private:
+        OutputWriter& out;
+        OutputFormat format;
+        bool includeFormatted;
+        bool headerWritten;
+
+        void writeJsonString(std::string_view text);
+        void writeTsvField(std::string_view text);
+        void writeBinaryHeader(uint8_t type, size_t payloadLength);
+        void writeBinaryString(std::string_view text);
+        void writeBinaryU64(uint64_t value);
+        void writeBinaryU32(uint32_t value);
+
+        static size_t binaryStringSize(const std::string& text) { return 4 + text.size(); }
+        static size_t binaryListSize(const std::vector<std::string>& list);
+
+    public:
+        RecordWriter(OutputWriter& writer, OutputFormat outputFormat, bool withFormattedFields = false);
+
+        void setFormat(OutputFormat outputFormat, bool withFormattedFields = false);
+        OutputFormat getFormat() const;
+        bool isStructured() const;
+        bool includesFormattedFields() const;
+
+        void writeSearchResult(const SearchResult& result);
+        void writeFileInfo(const FileInfo& info);
+        void writeOperationResult(const OperationResult& result);
+        void writeError(const std::string& message);
+        void writeProfile(const std::string& command, uint64_t wallNs,
+                          const std::vector<std::pair<std::string, uint64_t>>& fields);
+        // Directory statistics: counts and byte totals for one root
+        void writeStats(const std::string& path, const std::vector<std::pair<std::string, uint64_t>>& fields);
+    };
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace FileSystemManager {
+
+    // A new-name template, compiled once and expanded for every file of a
+    // batch. Text is copied as written; tokens in braces are replaced:
+    //
+    //   {file}   the old name              {name}  the old name without extension
+    //   {ext}    the extension with its dot, empty if there is none
+    //   {1}..    what the N-th '*' or '?' of the source pattern matched
+    //   {n}      the file's place in the batch from 1; {n:3} pads to three
+    //            digits, {n:3:0} counts from 0
+    //   {date}   modification date as %Y-%m-%d, {date:%Y%m%d} in any strftime format
+    //   {size}   size in bytes
+    //
+    // "{{" and "}}" are literal braces. The source pattern is a glob matched
+    // the way GlobPattern does (case-insensitive); its '*' match as little
+    // as they can, so "*_*" splits "a_b_c" into "a" and "b_c". Expanding
+    // keeps per-day date caches, so one template is not shared between threads.
+    class RenameTemplate {
+    private:
+        enum class Kind : uint8_t {
+            Literal,
+            File,
+            Name,
+            Extension,
+            Capture,
+            Counter,
+            Date,
+            Size
+        };
+
+        struct Part {
+            Kind kind;
+            std::string text;                       // Literal text
+            size_t number = 0;                      // Capture (from 1) or counter width
+            uint64_t start = 1;                     // Counter start
+            std::shared_ptr<DayFormatter> dates;
+        };
+
+        std::string pattern;                        // Lowercased source glob
+        std::vector<size_t> wildcards;              // Positions of '*' and '?' in pattern
+        std::vector<Part> parts;
+        bool metadata;
+
+        void addLiteral(std::string_view text);
+        bool addToken(std::string_view token, std::string& error);
+
+    public:
+        using Captures = std::vector<std::pair<size_t, size_t>>;   // Offset and length in the name
+
+        RenameTemplate();
+
+        // False, with error, for a malformed template or a capture the
+        // source pattern does not have
+        static bool compile(const std::string& sourcePattern, const std::string& target,
+                            RenameTemplate& compiled, std::string& error);
+        // text with its braces doubled, so it compiles to itself
+        static std::string literal(const std::string& text);
+
+        // Whether expanding needs the file's modification time or size
+        bool needsMetadata() const;
+
+        // Whether name matches the source pattern, and what each wildcard matched
+        bool match(std::string_view name, Captures& captures) const;
+
+        // Appends the new name of the index-th file (from 0) of the batch;
+        // false if a date does not format
+        bool expand(std::string_view name, const Captures& captures, size_t index,
+                    int64_t modifiedNs, uint64_t size, std::string& out);
+    };
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Common.h"
+#include "TopK.h"
+
+namespace FileSystemManager {
+
+    enum class SortKey : uint8_t {
+        None,       // Whatever order the search produces
+        Path,
+        Name,
+        Size,
+        Modified
+    };
+
+    // How search results are ordered and how many are kept
+    struct ResultOrder {
+        SortKey key = SortKey::None;
+        bool descending = false;
+        size_t limit = 0;           // 0 = keep all
+
+        // "size", "mtime", "name" or "path", optionally followed by ":asc" or
+        // ":desc". Size and mtime default to descending (largest, newest first).
+        static bool parse(const std::string& text, ResultOrder& order, std::string& error);
+
+        bool isSet() const { return key != SortKey::None || limit > 0; }
+
+        // Strict total order: ties on the key are broken by path, so the
+        // same results come back however the search was split between workers
+        bool precedes(const SearchResult& a, const SearchResult& b) const;
+    };
+
+    const char* sortKeyName(SortKey key);
+
+    // Gathers results in a ResultOrder. With a limit only the best `limit`
+    // results are retained, in a bounded heap, so memory is O(limit) rather
+    // than O(matches). Parallel searches give each worker its own collector
+    // and merge them at the end.
+    class ResultCollector {
+    private:
+        struct RanksBelow {
+            ResultOrder order;
+            bool operator()(const SearchResult& a, const SearchResult& b) const { return order.precedes(b, a); }
+        };
+
+        ResultOrder order;
+        std::vector<SearchResult> all;          // No limit, or no key to rank by
+        TopK<SearchResult, RanksBelow> best;    // A limit and a key
+
+        bool bounded() const { return order.limit > 0 && order.key != SortKey::None; }
+
+    public:
+        explicit ResultCollector(const ResultOrder& resultOrder = ResultOrder());
+
+        // False if a result ranking like candidate would be dropped anyway;
+        // lets callers skip expensive checks (content) on such files
+        bool wouldKeep(const SearchResult& candidate) const;
+
+        void add(SearchResult&& result);
+        void merge(ResultCollector&& other);
+        size_t size() const;
+
+        // The collected results in order; SortKey::None leaves them in
+        // arrival order (and keeps the first `limit` to arrive)
+        std::vector<SearchResult> take();
+    };
+
+}
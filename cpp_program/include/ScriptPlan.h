@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Common.h"
+
+namespace FileSystemManager {
+
+    // A parsed script split into stages for parallel execution.
+    // Read-only commands only depend on the most recent barrier before them, so
+    // every run of consecutive read-only commands forms one stage whose members
+    // may execute concurrently. Barriers (cd, anything that mutates the file
+    // system or CLI state, unknown commands) run alone, after everything before
+    // them has finished.
+    class ScriptPlan {
+    public:
+        struct Command {
+            size_t lineNumber;
+            std::string text;
+            std::string name;
+            bool readOnly;
+        };
+
+        struct Stage {
+            std::vector<size_t> commands;   // Indexes into getCommands(), in script order
+            bool barrier;
+        };
+
+    private:
+        std::vector<Command> commands;
+        std::vector<Stage> stages;
+
+    public:
+        ScriptPlan() = default;
+
+        bool load(const std::string& scriptPath);
+        void addCommand(size_t lineNumber, const std::string& text);
+
+        const std::vector<Command>& getCommands() const;
+        const std::vector<Stage>& getStages() const;
+        size_t getParallelCommandCount() const;
+
+        static bool isReadOnlyCommand(const std::vector<std::string>& args);
+    };
+
+}
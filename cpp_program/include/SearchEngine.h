@@ -1,45 +1,145 @@
 #pragma once
 
 #include "Common.h"
-#include <regex>
+#include "DirectoryWalker.h"
+#include "ResultOrder.h"
+#include "ChunkedReader.h"
+#include "CancellationToken.h"
+#include "IoThrottle.h"
 #include <future>
 #include <functional>
+#include <memory>
+#include <mutex>
 
 namespace FileSystemManager {
 
+    struct SearchQuery;
+    class QueryPlan;
+
+    // How an engine searches; every query works on its own copy, taken when it starts
+    struct SearchSettings {
+        std::string searchRoot;
+        bool caseSensitive = false;
+        bool useRegex = false;
+        bool formatTimestamps = true;
+        std::string dateIndexPath;  // Empty = DateIndex::defaultPathFor(searchRoot)
+        ResultOrder resultOrder;    // For the single-predicate searches; queries carry their own
+        ScanLimits scanLimits;
+        std::chrono::milliseconds timeout{0};   // Per query; 0 = none
+        std::shared_ptr<IoThrottle> throttle;   // Null = no I/O limits
+    };
+
+    // One query's statistics
+    struct SearchStats {
+        size_t filesSearched = 0;
+        size_t filesMatched = 0;
+        std::chrono::milliseconds searchTime{0};
+        std::string searchPattern;
+        bool cancelled = false;     // Stopped early (cancelled or timed out); results are partial
+        std::string error;          // Why the query failed (an invalid regex or date, or an exception); results are empty
+        bool staleIndex = false;    // The date index was out of date, so the tree was walked instead
+    };
+
+    // Everything one query reads and writes. Nothing of a running query is
+    // kept in the engine, so any number of queries may run on one engine.
+    struct SearchContext {
+        SearchSettings settings;
+        size_t filesExamined = 0;   // Regular files looked at
+        std::chrono::steady_clock::time_point started;
+        std::vector<SearchResult> results;
+        SearchStats stats;
+        // Checked per entry and per scan window
+        CancellationToken cancellation;
+
+        explicit SearchContext(SearchSettings querySettings) : settings(std::move(querySettings)) {
+            cancellation.setTimeout(settings.timeout);
+        }
+    };
+
+    // A query running on its own thread. The handle owns the query's
+    // context, so it stays valid after the engine that started it is gone.
+    class SearchHandle {
+    private:
+        std::shared_ptr<SearchContext> context;
+        std::shared_future<void> done;
+
+    public:
+        SearchHandle() = default;
+        SearchHandle(std::shared_ptr<SearchContext> queryContext, std::shared_future<void> finished)
+            : context(std::move(queryContext)), done(std::move(finished)) {}
+
+        bool valid() const { return done.valid(); }
+        bool isReady() const;
+        void wait() const;
+        // Both wait for the query to finish
+        const std::vector<SearchResult>& getResults() const;
+        const SearchStats& getStats() const;
+        // The query stops at its next check and keeps what it found so far
+        void cancel();
+    };
+
     class SearchEngine {
     private:
-        std::string searchRoot;
+        SearchSettings settings;
+        mutable std::mutex settingsMutex;
+        // The most recent synchronous query's results, for getLastResults
         std::vector<SearchResult> lastResults;
-        bool caseSensitive;
-        bool useRegex;
-        
-        bool matchesFileName(const std::string& fileName, const std::string& pattern);
-        bool matchesFileContent(const std::string& filePath, const std::string& searchTerm);
-        std::vector<std::string> findMatchingLines(const std::string& filePath, const std::string& searchTerm);
-        bool isBinaryFile(const std::string& filePath);
+        SearchStats lastSearchStats;
+        mutable std::mutex lastMutex;
+
+        SearchSettings snapshot() const;
+        std::vector<SearchResult> publish(SearchContext& query);
         
     public:
         SearchEngine();
         explicit SearchEngine(const std::string& rootPath);
         ~SearchEngine() = default;
         
-        // Configuration
+        // Configuration; a change applies to queries started after it
         void setSearchRoot(const std::string& path);
         void setCaseSensitive(bool sensitive);
         void setUseRegex(bool useRegex);
+        void setFormatTimestamps(bool format);
+        void setDateIndexPath(const std::string& path);
+        // Orders (and with a limit, trims) the results of searchByName,
+        // searchBySize, searchByDate and searchInContent
+        void setResultOrder(const ResultOrder& order);
+        // Window size, reported line length and per-file byte cap of content
+        // scans; files are read in windows, never whole
+        void setScanLimits(const ScanLimits& limits);
+        ScanLimits getScanLimits() const;
+        // Time limit of every query started after this; 0 = none
+        void setTimeout(std::chrono::milliseconds limit);
+        // I/O limits and class of queries started after this: directory
+        // listings and content reads are charged to the throttle, which
+        // may be shared with BatchOperations. Null means no limits.
+        void setIoThrottle(std::shared_ptr<IoThrottle> ioThrottle);
         
         // File name search
         std::vector<SearchResult> searchByName(const std::string& pattern, bool recursive = true);
         std::vector<SearchResult> searchByExtension(const std::string& extension, bool recursive = true);
         std::vector<SearchResult> searchBySize(size_t minSize, size_t maxSize = SIZE_MAX, bool recursive = true);
+        // Files modified in [startDate, endDate] (see parseTimestamp; an empty
+        // end is open-ended), oldest first. Recursive queries are answered from
+        // the date index when one exists for the search root.
         std::vector<SearchResult> searchByDate(const std::string& startDate, const std::string& endDate = "", bool recursive = true);
+        bool buildDateIndex(size_t& recordCount, std::string& error);
         
-        // Content search
+        // Content search. With setUseRegex the term is an extended regex (see
+        // DfaRegex), as are name patterns, instead of a literal and a glob.
         std::vector<SearchResult> searchInContent(const std::string& searchTerm, bool recursive = true);
         std::vector<SearchResult> searchInContent(const std::string& searchTerm, const std::string& fileExtension, bool recursive = true);
         
-        // Advanced search
+        // Advanced search: predicates are evaluated cheapest first (name, then
+        // stat, then content) and path predicates prune subtrees. Results are
+        // sorted by path unless query.order says otherwise; with a limit each
+        // worker keeps a bounded heap, and files that cannot rank are not opened.
+        std::vector<SearchResult> search(const SearchQuery& query);
+        // The same in two steps: plan() compiles the query with this engine's
+        // case sensitivity, so it can be checked (getError) or shown before
+        // it runs, and search() runs it without compiling it again
+        QueryPlan plan(const SearchQuery& query) const;
+        std::vector<SearchResult> search(const QueryPlan& plan);
         std::vector<SearchResult> searchAdvanced(const std::string& namePattern, const std::string& contentTerm, 
                                                 const std::string& extension = "", size_t minSize = 0, 
                                                 size_t maxSize = SIZE_MAX, bool recursive = true);
@@ -48,35 +148,48 @@ namespace FileSystemManager {
         std::vector<std::vector<SearchResult>> findDuplicateFiles(bool byContent = true);
         std::vector<std::vector<SearchResult>> findDuplicateFilesBySize();
         
-        // Search utilities
+        // Results of the most recent synchronous search. Queries started
+        // through a handle keep theirs in the handle.
         std::vector<SearchResult> getLastResults() const;
         void clearResults();
         size_t getResultCount() const;
         
-        // Async search (for large directories)
-        std::future<std::vector<SearchResult>> searchByNameAsync(const std::string& pattern, bool recursive = true);
-        std::future<std::vector<SearchResult>> searchInContentAsync(const std::string& searchTerm, bool recursive = true);
-        
-        // Search statistics
-        struct SearchStats {
-            size_t filesSearched;
-            size_t filesMatched;
-            std::chrono::milliseconds searchTime;
-            std::string searchPattern;
-        };
+        // Async search (for large directories), each with its own context
+        SearchHandle searchByNameAsync(const std::string& pattern, bool recursive = true);
+        SearchHandle searchInContentAsync(const std::string& searchTerm, bool recursive = true);
+        SearchHandle searchAsync(const SearchQuery& query);
         
         SearchStats getLastSearchStats() const;
         
     private:
-        void searchByNameRecursive(const std::string& directory, const std::string& pattern);
-        void searchByNameInDirectory(const std::string& directory, const std::string& pattern);
-        void searchBySizeRecursive(const std::string& directory, size_t minSize, size_t maxSize);
-        void searchBySizeInDirectory(const std::string& directory, size_t minSize, size_t maxSize);
-        void searchInContentRecursive(const std::string& directory, const std::string& searchTerm);
-        void searchInContentInDirectory(const std::string& directory, const std::string& searchTerm);
-        
-        SearchStats lastSearchStats;
-        std::chrono::steady_clock::time_point searchStartTime;
+        using FileVisitor = std::function<void(const WalkEntry& entry)>;
+
+        // The queries themselves. They are static and see only their
+        // context, so a query never touches the engine once started.
+        static void runByName(SearchContext& query, const std::string& pattern, bool recursive);
+        static void runBySize(SearchContext& query, size_t minSize, size_t maxSize, bool recursive);
+        static void runByDate(SearchContext& query, const std::string& startDate, const std::string& endDate, bool recursive);
+        static void runInContent(SearchContext& query, const std::string& searchTerm, bool recursive);
+        static void runSearch(SearchContext& query, const SearchQuery& search);
+        static void runPlan(SearchContext& query, const QueryPlan& plan);
+        static SearchHandle launch(SearchSettings querySettings, std::function<void(SearchContext&)> run);
+
+        static SearchResult makeSearchResult(const SearchContext& query, const WalkEntry& entry, const EntryMetadata& metadata);
+        static SearchResult makeSearchResult(const SearchContext& query, std::string filePath, size_t nameOffset,
+                                             uint64_t fileSize, int64_t modifiedNs);
+        // Visits regular files (and symlinks to them) on a single-threaded arena walk
+        static void forEachFile(SearchContext& query, const std::string& directory, bool recursive, const FileVisitor& visit);
+        static void searchByNameIn(SearchContext& query, const std::string& directory, const std::string& pattern,
+                                   bool recursive, ResultCollector& results);
+        static void searchBySizeIn(SearchContext& query, const std::string& directory, size_t minSize, size_t maxSize,
+                                   bool recursive, ResultCollector& results);
+        static void searchInContentIn(SearchContext& query, const std::string& directory, const std::string& searchTerm,
+                                      bool recursive, ResultCollector& results);
+        static bool searchByDateIndexed(SearchContext& query, int64_t startNs, int64_t endNs, ResultCollector& results);
+        static void searchByDateIn(SearchContext& query, const std::string& directory, int64_t startNs, int64_t endNs,
+                                   bool recursive, ResultCollector& results);
+        static void runQuery(SearchContext& query, const QueryPlan& plan);
+        static void finishQuery(SearchContext& query, std::string pattern);
     };
 
 }
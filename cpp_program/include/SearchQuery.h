@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Common.h"
+#include "DirectoryWalker.h"
+#include "DfaRegex.h"
+#include "AhoCorasick.h"
+#include "ResultOrder.h"
+#include <cstdint>
+#include <limits>
+
+namespace FileSystemManager {
+
+    // Combined predicates of an advanced search. Every set predicate must
+    // hold (extensions match if any of them does).
+    struct SearchQuery {
+        std::vector<std::string> namePatterns;      // Globs on the file name
+        std::vector<std::string> extensions;        // ".cpp" form
+        std::string pathPattern;                    // Glob on the path below the root; '*' crosses '/'
+        std::vector<std::string> excludeDirectories; // Globs on directory names not to descend into
+        int maxDepth = -1;                          // -1 = unlimited; 1 = root entries only
+        uint64_t minSize = 0;
+        uint64_t maxSize = std::numeric_limits<uint64_t>::max();
+        int64_t modifiedAfterNs = std::numeric_limits<int64_t>::min();
+        int64_t modifiedBeforeNs = std::numeric_limits<int64_t>::max();
+        std::vector<std::string> contentTerms;
+        std::vector<std::string> contentPatterns;   // Extended regexes (see DfaRegex)
+        std::vector<std::string> keywords;          // Content holds any of these (one scan for all)
+        bool recursive = true;
+        ResultOrder order;                          // SortKey::None = by path
+        uint64_t maxScanBytes = 0;                  // Content read per file; 0 = the engine's limit
+
+        // Parses "-name <glob> -ext <a,b> -path <glob> -exclude <dir> -maxdepth <n>
+        // -size <min>-<max> -mtime <from>[..<to>] -content <term> -regex <ere>
+        // -patterns <file> -sort <key>[:asc|:desc] -limit <n> -maxbytes <size>". Sizes accept K/M/G suffixes and "+N" (at least) or
+        // "-N" (at most); -mtime also accepts "-N"/"+N" days (modified within /
+        // more than N days ago). Relative pattern files are opened from
+        // baseDirectory. A lone bare argument is taken as -name for compatibility.
+        static bool parse(const std::vector<std::string>& args, SearchQuery& query, std::string& error,
+                          const std::string& baseDirectory = "");
+
+        // Appends the non-empty lines of a keyword file, skipping repeats
+        static bool loadPatternFile(const std::string& path, std::vector<std::string>& patterns, std::string& error);
+
+        bool hasSizeFilter() const;
+        bool hasTimeFilter() const;
+    };
+
+    // A SearchQuery compiled into cost-ordered stages: predicates on the name
+    // and d_type first, then one stat for size/mtime (and to resolve
+    // symlinks), and content last, so files are only opened once everything
+    // cheaper has passed. Path predicates also prune whole subtrees.
+    class QueryPlan {
+    public:
+        enum class Stage : uint8_t {
+            Prune,          // Decides which directories are walked
+            Name,           // Name, extension, path and entry type; no syscalls
+            Metadata,       // One stat per surviving entry
+            Content         // Opens the file
+        };
+
+        struct Step {
+            Stage stage;
+            std::string description;
+        };
+
+    private:
+        SearchQuery query;
+        std::vector<GlobPattern> nameGlobs;
+        std::vector<std::string> lowerExtensions;
+        GlobPattern pathGlob;
+        std::vector<GlobPattern> pathPrefix;        // Literal leading components of pathPattern
+        std::vector<GlobPattern> excludeGlobs;
+        std::vector<DfaRegex> contentRegexes;
+        AhoCorasick keywordMatcher;
+        bool caseSensitive;
+        std::vector<Step> steps;
+        std::string error;                          // First invalid content pattern
+
+    public:
+        QueryPlan(const SearchQuery& searchQuery, bool caseSensitive);
+
+        const SearchQuery& getQuery() const { return query; }
+        const std::vector<Step>& getSteps() const { return steps; }
+        // Empty unless a content pattern failed to compile; such a plan matches nothing
+        const std::string& getError() const { return error; }
+        bool needsPath() const { return !query.pathPattern.empty(); }
+        bool needsContent() const {
+            return !query.contentTerms.empty() || !contentRegexes.empty() || !query.keywords.empty();
+        }
+        // Compiled once per plan; each thread matches through its own RegexMatcher
+        const std::vector<DfaRegex>& getContentRegexes() const { return contentRegexes; }
+        bool hasKeywords() const { return !query.keywords.empty(); }
+        const AhoCorasick& getKeywordMatcher() const { return keywordMatcher; }
+
+        // Prune stage: whether the walk should enter this directory entry
+        bool shouldDescend(const WalkEntry& directory) const;
+
+        // Name stage. relativePath is only consulted when needsPath()
+        bool matchesName(std::string_view name, std::string_view relativePath) const;
+
+        // Metadata stage
+        bool matchesMetadata(const EntryMetadata& metadata) const;
+    };
+
+    const char* queryStageName(QueryPlan::Stage stage);
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Common.h"
+#include "DirectoryWalker.h"
+#include <map>
+#include <array>
+
+namespace FileSystemManager {
+
+    // Aggregated statistics for a whole directory tree
+    struct TreeStatistics {
+        struct ExtensionStats {
+            size_t count = 0;
+            uint64_t bytes = 0;
+        };
+
+        struct HistogramBucket {
+            size_t count = 0;
+            uint64_t bytes = 0;
+        };
+
+        struct RankedPath {
+            uint64_t value = 0;      // Size, depth or entry count depending on the ranking
+            std::string path;
+
+            bool operator<(const RankedPath& other) const {
+                return value < other.value || (value == other.value && path > other.path);
+            }
+        };
+
+        static constexpr size_t SizeBucketCount = 65;   // 0 bytes, then [2^(i-1), 2^i)
+        static constexpr size_t AgeBucketCount = 8;
+
+        std::string rootPath;
+        size_t totalFiles = 0;
+        size_t totalDirectories = 0;
+        size_t totalOther = 0;
+        uint64_t totalBytes = 0;
+        int maxDepth = 0;
+        std::chrono::milliseconds scanTime{0};
+
+        std::map<std::string, ExtensionStats> byExtension;
+        std::array<HistogramBucket, SizeBucketCount> sizeHistogram{};
+        std::array<HistogramBucket, AgeBucketCount> ageHistogram{};
+
+        std::vector<RankedPath> largestFiles;         // Largest first
+        std::vector<RankedPath> deepestPaths;         // Deepest first
+        std::vector<RankedPath> busiestDirectories;   // Most entries first
+
+        static std::string sizeBucketLabel(size_t bucket);
+        static std::string ageBucketLabel(size_t bucket);
+
+        std::string toCsv() const;
+        std::string toJson() const;
+    };
+
+    // Computes TreeStatistics in a single parallel pass over a tree
+    class StatisticsEngine {
+    private:
+        WalkOptions walkOptions;
+        size_t topCount;
+
+    public:
+        StatisticsEngine();
+        explicit StatisticsEngine(size_t topK);
+        ~StatisticsEngine() = default;
+
+        // Configuration
+        void setTopCount(size_t topK);
+        void setThreadCount(size_t threads);
+        void setRecursive(bool recursive);
+
+        TreeStatistics collect(const std::string& rootPath) const;
+
+        // Export
+        bool exportCsv(const TreeStatistics& stats, const std::string& filePath) const;
+        bool exportJson(const TreeStatistics& stats, const std::string& filePath) const;
+
+        static size_t sizeBucketFor(uint64_t bytes);
+        static size_t ageBucketFor(int64_t ageSeconds);
+    };
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ContentClassifier.h"
+#include <cstdint>
+#include <string>
+
+namespace FileSystemManager {
+
+    enum class LineEnding : uint8_t {
+        LF,
+        CRLF,
+        CR
+    };
+
+    enum class Charset : uint8_t {
+        Auto,       // Source only: UTF-16 by byte order mark, else UTF-8 if valid, else Latin-1
+        Utf8,
+        Utf16LE,
+        Utf16BE,
+        Latin1      // ISO-8859-1
+    };
+
+    // "LF", "CRLF" or "CR", in any case
+    bool parseLineEnding(const std::string& text, LineEnding& ending);
+    // "utf-8", "utf-16" (little-endian), "utf-16le", "utf-16be", "latin1" or
+    // "iso-8859-1", in any case; "auto" where allowAuto
+    bool parseCharset(const std::string& text, bool allowAuto, Charset& charset);
+    const char* charsetName(Charset charset);
+
+    // Rewrites one file's text as a stream of blocks, in bounded memory. A
+    // file is seen twice at most: a checking pass (scan, then conforms)
+    // decides whether it already has the target form and usually stops at
+    // the first block that proves otherwise; only then is it read again and
+    // transcoded. Copy a prototype per file; the state is per file.
+    //
+    // Line endings: CRLF, lone CR and lone LF all end a line and are written
+    // as the target. Charsets: a byte order mark of the source is dropped,
+    // UTF-16 output always starts with one and UTF-8 output never does. A
+    // file that is already valid UTF-8 counts as converted to UTF-8.
+    class TextTransform {
+    private:
+        enum class Kind : uint8_t {
+            LineEndings,
+            Charsets
+        };
+
+        Kind kind;
+        LineEnding ending;
+        Charset from;
+        Charset to;
+        Charset source;             // from, once Auto is resolved
+
+        // Checking pass
+        bool scanCarriageReturn;    // The last block ended in CR
+        bool mismatch;              // A line ending that has to change was seen
+        bool identity;              // The file is in the target charset as it stands
+        bool validating;            // The check is UTF-8 validation
+        bool utf8Valid;
+        bool utf8Ascii;
+        std::string scanPending;    // A UTF-8 sequence cut by the end of a block
+
+        // Rewriting pass
+        bool carriageReturn;        // The last block ended in CR
+        bool atStart;
+        uint64_t consumed;          // Input bytes converted so far, for error offsets
+        std::string pending;        // A sequence cut by the end of a block
+
+        TextTransform(Kind transformKind, LineEnding lineEnding, Charset fromCharset, Charset toCharset);
+
+        bool scanLineEndings(const char* data, size_t size);
+        void scanUtf8(const char* data, size_t size);
+        void convertLineEndings(const char* data, size_t size, std::string& out);
+        // Converts whole units from data; used is how many bytes that took
+        bool convertUnits(const char* data, size_t size, bool final, size_t& used, std::string& out, std::string& error);
+        void appendAscii(const char* data, size_t size, std::string& out) const;
+
+    public:
+        static TextTransform lineEndings(LineEnding target);
+        static TextTransform charsets(Charset fromCharset, Charset toCharset);
+
+        // Whether to touch the file at all, given its classification (from
+        // the first block); reason says why not
+        bool accepts(const ContentVerdict& verdict, std::string& reason);
+
+        // Checking pass: false once further blocks cannot change the answer
+        bool scan(const char* data, size_t size);
+        // After the checking pass: the file needs no rewrite
+        bool conforms();
+
+        // Rewriting pass: appends the output for data. False, with error,
+        // for input that is invalid in the source charset or a character
+        // the target cannot hold.
+        bool transcode(const char* data, size_t size, std::string& out, std::string& error);
+        bool finish(std::string& out, std::string& error);
+    };
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Instrumentation.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <future>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+namespace FileSystemManager {
+
+    // Fixed-size pool of worker threads executing queued tasks in FIFO order
+    class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        bool stopping;
+
+        void workerLoop();
+
+    public:
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t size() const;
+        static size_t defaultThreadCount();
+
+        template <typename Function>
+        auto submit(Function&& function) -> std::future<typename std::invoke_result<Function>::type> {
+            using ResultType = typename std::invoke_result<Function>::type;
+            auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Function>(function));
+            std::future<ResultType> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                tasks.emplace_back([task]() { (*task)(); });
+                Instrumentation::add(Counter::TasksQueued);
+                Instrumentation::record(Histogram::PoolQueueDepth, tasks.size());
+            }
+            queueChanged.notify_one();
+            return result;
+        }
+    };
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace FileSystemManager {
+
+    // Keeps the K "largest" items seen so far (according to Compare) in a
+    // bounded min-heap, so memory stays O(K) regardless of input size.
+    template <typename T, typename Compare = std::less<T>>
+    class TopK {
+    private:
+        size_t capacity;
+        Compare compare;
+        std::vector<T> heap;
+
+        // Heap ordering puts the smallest retained item at the front
+        bool heapOrder(const T& a, const T& b) const {
+            return compare(b, a);
+        }
+
+    public:
+        explicit TopK(size_t k = 0, Compare cmp = Compare()) : capacity(k), compare(cmp) {
+            // A generous limit should not allocate up front
+            heap.reserve(std::min<size_t>(k, 4096));
+        }
+
+        size_t size() const { return heap.size(); }
+        size_t limit() const { return capacity; }
+        bool empty() const { return heap.empty(); }
+
+        // True if an item ranking like `candidate` would be retained
+        bool wouldAccept(const T& candidate) const {
+            if (capacity == 0) return false;
+            return heap.size() < capacity || compare(heap.front(), candidate);
+        }
+
+        void push(const T& item) {
+            if (capacity == 0) return;
+            auto order = [this](const T& a, const T& b) { return heapOrder(a, b); };
+            if (heap.size() < capacity) {
+                heap.push_back(item);
+                std::push_heap(heap.begin(), heap.end(), order);
+            } else if (compare(heap.front(), item)) {
+                std::pop_heap(heap.begin(), heap.end(), order);
+                heap.back() = item;
+                std::push_heap(heap.begin(), heap.end(), order);
+            }
+        }
+
+        void push(T&& item) {
+            if (capacity == 0) return;
+            auto order = [this](const T& a, const T& b) { return heapOrder(a, b); };
+            if (heap.size() < capacity) {
+                heap.push_back(std::move(item));
+                std::push_heap(heap.begin(), heap.end(), order);
+            } else if (compare(heap.front(), item)) {
+                std::pop_heap(heap.begin(), heap.end(), order);
+                heap.back() = std::move(item);
+                std::push_heap(heap.begin(), heap.end(), order);
+            }
+        }
+
+        void merge(const TopK& other) {
+            for (const auto& item : other.heap) {
+                push(item);
+            }
+        }
+
+        void merge(TopK&& other) {
+            for (auto& item : other.heap) {
+                push(std::move(item));
+            }
+            other.heap.clear();
+        }
+
+        // Returns the retained items, best first
+        std::vector<T> sorted() const {
+            std::vector<T> result = heap;
+            std::sort(result.begin(), result.end(), [this](const T& a, const T& b) {
+                return compare(b, a);
+            });
+            return result;
+        }
+    };
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Common.h"
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <thread>
+
+namespace FileSystemManager {
+
+    // One file or directory captured in a tree snapshot
+    struct CachedEntry {
+        std::string path;
+        uint32_t nameOffset;     // Start of the file name within path
+        uint64_t size;
+        int64_t modifiedTime;    // Seconds since the Unix epoch
+        bool isDirectory;
+
+        std::string_view name() const { return std::string_view(path).substr(nameOffset); }
+    };
+
+    // Immutable metadata snapshot of a directory tree. Entries are sorted by
+    // path so every subtree is a contiguous range.
+    struct TreeSnapshot {
+        std::string root;
+        std::vector<CachedEntry> entries;
+        std::unordered_map<std::string, uint64_t> directoryBytes;   // Recursive size per directory
+        std::chrono::steady_clock::time_point builtAt;
+        bool watched = false;                                      // Kept fresh by change notifications
+        mutable std::atomic<bool> stale{false};
+    };
+
+    // Process-wide cache of tree snapshots shared by concurrent sessions.
+    // Readers take a shared_ptr to the current snapshot under a shared lock and
+    // query it without holding any lock; rebuilds happen off-lock and are
+    // swapped in atomically. On Linux, inotify marks snapshots stale when
+    // anything below their root changes; otherwise (or when the watch limit
+    // is exhausted) snapshots expire after maxAge.
+    class TreeCache {
+    private:
+        mutable std::shared_mutex snapshotMutex;
+        std::map<std::string, std::shared_ptr<const TreeSnapshot>> snapshots;
+        std::chrono::seconds maxAge;
+        std::mutex buildMutex;
+
+        std::mutex watchMutex;
+        std::unordered_map<int, std::set<std::string>> watchRoots;       // Watch descriptor -> roots
+        std::unordered_map<std::string, std::vector<int>> rootWatches;    // Root -> watch descriptors
+        std::set<std::string> changedRoots;                               // Changed since their last build started
+        int notifyFd;
+        std::atomic<bool> stopping;
+        std::thread watcherThread;
+
+        std::shared_ptr<const TreeSnapshot> findSnapshot(const std::string& path) const;
+        std::shared_ptr<TreeSnapshot> buildSnapshot(const std::string& root);
+        bool isFresh(const TreeSnapshot& snapshot) const;
+        void unwatchRoot(const std::string& root);
+        void watchLoop();
+
+    public:
+        TreeCache();
+        explicit TreeCache(std::chrono::seconds snapshotMaxAge);
+        ~TreeCache();
+
+        TreeCache(const TreeCache&) = delete;
+        TreeCache& operator=(const TreeCache&) = delete;
+
+        // Returns a fresh snapshot covering path, building one rooted at path if needed
+        std::shared_ptr<const TreeSnapshot> acquire(const std::string& path);
+
+        // Queries
+        std::vector<SearchResult> findByName(const std::string& directory, const std::string& pattern,
+                                             bool recursive = true, bool formatTimestamps = true);
+        bool getDirectorySize(const std::string& directory, uint64_t& bytes);
+
+        // Maintenance
+        // Marks every snapshot that covers path, or lies below it, stale
+        void invalidate(const std::string& path);
+        void clear();
+        size_t getSnapshotCount() const;
+        bool isWatching() const;
+    };
+
+}
@@ -0,0 +1,141 @@
+#include "AhoCorasick.h"
+#include "ByteScan.h"
+#include <algorithm>
+#include <cctype>
+#include <queue>
+
+namespace FileSystemManager {
+
+    AhoCorasick::AhoCorasick() : caseSensitive(true), classCount(1) {
+        byteClasses.fill(0);
+        build({}, true);
+    }
+
+    void AhoCorasick::build(const std::vector<std::string>& patternList, bool caseSensitive) {
+        patterns = patternList;
+        this->caseSensitive = caseSensitive;
+
+        // Class 0 is every byte no pattern uses; letters fold when case-insensitive
+        auto fold = [caseSensitive](unsigned char byte) {
+            return caseSensitive ? byte : static_cast<unsigned char>(std::tolower(byte));
+        };
+        byteClasses.fill(0);
+        classCount = 1;
+        std::array<bool, 256> used{};
+        for (const auto& pattern : patterns) {
+            for (char c : pattern) used[fold(static_cast<unsigned char>(c))] = true;
+        }
+        for (unsigned value = 0; value < 256; ++value) {
+            if (used[value]) byteClasses[value] = static_cast<uint8_t>(classCount++);
+        }
+        if (!caseSensitive) {
+            for (unsigned value = 'A'; value <= 'Z'; ++value) {
+                byteClasses[value] = byteClasses[std::tolower(static_cast<int>(value))];
+            }
+        }
+
+        // Trie; -1 marks a missing edge until the automaton is completed
+        transitions.assign(classCount, -1);
+        std::vector<std::vector<uint32_t>> ownPatterns(1);
+        for (uint32_t id = 0; id < patterns.size(); ++id) {
+            const std::string& pattern = patterns[id];
+            if (pattern.empty() || pattern.find('\n') != std::string::npos) continue;
+
+            size_t state = 0;
+            for (char c : pattern) {
+                size_t cell = state * classCount + byteClasses[static_cast<unsigned char>(c)];
+                if (transitions[cell] < 0) {
+                    transitions[cell] = static_cast<int32_t>(ownPatterns.size());
+                    ownPatterns.emplace_back();
+                    transitions.resize(transitions.size() + classCount, -1);
+                }
+                state = static_cast<size_t>(transitions[cell]);
+            }
+            ownPatterns[state].push_back(id);
+        }
+
+        // Breadth first, so a state's failure target is always finished
+        // before it; missing edges then borrow the failure target's edges
+        size_t stateCount = ownPatterns.size();
+        std::vector<int32_t> failure(stateCount, 0);
+        outputLinks.assign(stateCount, -1);
+        std::queue<int32_t> pending;
+        for (size_t c = 0; c < classCount; ++c) {
+            int32_t& target = transitions[c];
+            if (target < 0) {
+                target = 0;
+            } else {
+                pending.push(target);
+            }
+        }
+        while (!pending.empty()) {
+            int32_t state = pending.front();
+            pending.pop();
+            int32_t fail = failure[state];
+            outputLinks[state] = ownPatterns[fail].empty() ? outputLinks[fail] : fail;
+            for (size_t c = 0; c < classCount; ++c) {
+                int32_t& target = transitions[static_cast<size_t>(state) * classCount + c];
+                int32_t fallback = transitions[static_cast<size_t>(fail) * classCount + c];
+                if (target < 0) {
+                    target = fallback;
+                } else {
+                    failure[target] = fallback;
+                    pending.push(target);
+                }
+            }
+        }
+
+        outputStart.assign(1, 0);
+        outputIds.clear();
+        reportsMatch.assign(stateCount, 0);
+        for (size_t state = 0; state < stateCount; ++state) {
+            outputIds.insert(outputIds.end(), ownPatterns[state].begin(), ownPatterns[state].end());
+            outputStart.push_back(static_cast<uint32_t>(outputIds.size()));
+            reportsMatch[state] = !ownPatterns[state].empty() || outputLinks[state] >= 0;
+        }
+    }
+
+    size_t AhoCorasick::forEachMatchingLine(std::string_view buffer, const LineVisitor& visit) const {
+        const char* data = buffer.data();
+        const char* end = data + buffer.size();
+
+        size_t lines = 0;
+        size_t lineNumber = 1;
+        const char* counted = data;     // Newlines before here are in lineNumber
+        const char* lineStart = nullptr;
+        const char* lineEnd = nullptr;
+        std::vector<uint32_t> hits;
+        auto flushLine = [&]() {
+            if (hits.empty()) return;
+            std::sort(hits.begin(), hits.end());
+            hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+            visit(lineNumber, std::string_view(lineStart, static_cast<size_t>(lineEnd - lineStart)), hits);
+            hits.clear();
+            lines++;
+        };
+
+        int32_t state = 0;
+        for (const char* p = data; p < end; ++p) {
+            state = transitions[static_cast<size_t>(state) * classCount + byteClasses[static_cast<unsigned char>(*p)]];
+            if (!reportsMatch[state]) continue;
+
+            // Patterns hold no newline, so the match lies on the line around p
+            if (!lineStart || p >= lineEnd) {
+                flushLine();
+                const char* start = findLastByte(counted, p, '\n');
+                start = start ? start + 1 : counted;
+                lineNumber += countByte(counted, start, '\n');
+                counted = start;
+                lineStart = start;
+                lineEnd = findByte(p, end, '\n');
+                if (!lineEnd) lineEnd = end;
+            }
+            for (int32_t output = state; output >= 0; output = outputLinks[output]) {
+                hits.insert(hits.end(), outputIds.begin() + outputStart[output], outputIds.begin() + outputStart[output + 1]);
+            }
+        }
+        flushLine();
+        return lines;
+    }
+
+}
@@ -0,0 +1,64 @@
+#include "Instrumentation.h"
+#include <cstdlib>
+#include <new>
+
+// Allocation counting for the fsmanager executable. Replacing the global
+// allocator is the only way to see allocations made inside the standard
+// library, but it is a decision for a whole program, so it lives here
+// rather than in fsmanager_lib: programs that link the library (the
+// benchmarks among them) keep their own allocator, and count no
+// allocations. While instrumentation is off the overhead is a single
+// relaxed load per allocation.
+
+void* operator new(std::size_t size) {
+    FileSystemManager::Instrumentation::add(FileSystemManager::Counter::Allocations);
+    FileSystemManager::Instrumentation::add(FileSystemManager::Counter::AllocatedBytes, size);
+    if (size == 0) size = 1;
+    while (true) {
+        void* memory = std::malloc(size);
+        if (memory != nullptr) return memory;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
@@ -1,37 +1,1118 @@
 #include "BatchOperations.h"
+#include "Checksum.h"
+#include "ContentClassifier.h"
+#include "DirectoryWalker.h"
+#include "Instrumentation.h"
+#include "NameRegistry.h"
+#include "RenameTemplate.h"
+#include "TextTransform.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <iomanip>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace FileSystemManager {
 
-    BatchOperations::BatchOperations() : operationInProgress(false), processedFiles(0), totalFiles(0) {
+    namespace {
+
+        // Handed from BatchOperations::start to the operation it runs on the
+        // same thread, so the batch reports to (and is cancelled through) the handle
+        thread_local std::shared_ptr<BatchContext> adoptedBatch;
+
+        // Copy volume is only measured while profiling; it costs an extra stat
+        void countCopiedBytes(const fs::path& destination) {
+            if (!Instrumentation::isEnabled()) return;
+            std::error_code ec;
+            uintmax_t bytes = fs::file_size(destination, ec);
+            if (!ec) {
+                Instrumentation::add(Counter::BytesWritten, bytes);
+            }
+        }
+
+        // Single-threaded walk so entries arrive parents first
+        WalkOptions plannerOptions(bool recursive) {
+            WalkOptions options;
+            options.recursive = recursive;
+            options.threadCount = 1;
+            return options;
+        }
+
+        // Regular files (or symlinks to them) that the walk reported
+        bool isRegularEntry(const WalkEntry& entry) {
+            if (entry.type == EntryType::Regular) return true;
+            if (entry.type != EntryType::Symlink) return false;
+            EntryMetadata target;
+            return DirectoryWalker::readMetadata(entry, target, true) && target.isRegularFile;
+        }
+
+        // Regular files directly inside directory whose names match pattern;
+        // false if directory cannot be listed
+        bool collectMatchingFiles(const std::string& directory, const std::string& pattern, std::vector<std::string>& files) {
+            std::error_code ec;
+            if (!fs::is_directory(directory, ec)) return false;
+
+            GlobPattern glob(pattern);
+            DirectoryWalker walker(plannerOptions(false));
+            walker.walk(directory, [&](size_t, const WalkEntry& entry) {
+                if (glob.matches(entry.name()) && isRegularEntry(entry)) {
+                    files.push_back(entry.path());
+                }
+            });
+            return true;
+        }
+
+        // A directory held open so its entries are reached by name, without
+        // resolving the full path for every file
+        class OpenDirectory {
+        private:
+            std::string path;
+#ifndef _WIN32
+            int fd;
+#endif
+
+        public:
+            explicit OpenDirectory(std::string directory) : path(std::move(directory)) {
+#ifndef _WIN32
+                fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+            }
+
+            ~OpenDirectory() {
+#ifndef _WIN32
+                if (fd >= 0) ::close(fd);
+#endif
+            }
+
+            OpenDirectory(const OpenDirectory&) = delete;
+            OpenDirectory& operator=(const OpenDirectory&) = delete;
+
+            bool isOpen() const {
+#ifndef _WIN32
+                return fd >= 0;
+#else
+                std::error_code ec;
+                return fs::is_directory(path, ec);
+#endif
+            }
+
+            fs::path pathOf(const char* name) const {
+                return fs::path(path) / name;
+            }
+
+            bool stat(const char* name, EntryMetadata& metadata) const {
+#ifndef _WIN32
+                return DirectoryWalker::readMetadataAt(fd, name, metadata);
+#else
+                return DirectoryWalker::readPathMetadata(pathOf(name).string(), metadata);
+#endif
+            }
+
+            // Never replaces an existing target (EEXIST instead)
+            std::error_code renameInto(const char* name, const OpenDirectory& target, const char* newName) const {
+#ifndef _WIN32
+                return renameNoReplaceAt(fd, name, target.fd, newName);
+#else
+                return renameNoReplace(pathOf(name).string(), target.pathOf(newName).string());
+#endif
+            }
+        };
+
+        // Lands a file under name, or under the next free name_N.ext while
+        // place() reports EEXIST; name ends up as where it went
+        template <typename Place>
+        std::error_code placeUnique(NameRegistry& names, const std::string& fileName, std::string& name, Place place) {
+            std::error_code ec;
+            while ((ec = place(name)) == std::errc::file_exists) {
+                name = names.reclaim(fileName, name);
+            }
+            return ec;
+        }
+
+        // Bytes copied between cancellation checks: about a millisecond from
+        // the page cache, and small next to the kernel's own writeback stalls
+        constexpr size_t CopyChunkSize = 1 << 20;
+
+        std::error_code lastError() {
+            return std::error_code(errno, std::generic_category());
+        }
+
+        // Runs a whole file through state, a chunk at a time at the batch's
+        // I/O pace, stopping between chunks once cancelled. uncached first
+        // flushes the file and drops it from the page cache, so what is
+        // hashed is what the disk holds rather than what was just written.
+        void hashFile(const std::string& path, const BatchContext& batch, bool uncached, Xxh64& state,
+                      std::error_code& ec) {
+            ec.clear();
+            state.reset();
+            std::unique_ptr<char[]> buffer(new char[CopyChunkSize]);
+#ifndef _WIN32
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                ec = lastError();
+                return;
+            }
+#ifdef __linux__
+            if (uncached && ::fdatasync(fd) == 0) ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+            (void)uncached;
+#endif
+            while (batch.shouldContinue()) {
+                ssize_t count = ::read(fd, buffer.get(), CopyChunkSize);
+                if (count < 0 && errno == EINTR) continue;
+                if (count < 0) ec = lastError();
+                if (count <= 0) break;
+                state.update(buffer.get(), static_cast<size_t>(count));
+                batch.pace(static_cast<uint64_t>(count));
+            }
+            ::close(fd);
+#else
+            (void)uncached;
+            std::ifstream input(path, std::ios::binary);
+            if (!input.is_open()) {
+                ec = std::make_error_code(std::errc::no_such_file_or_directory);
+                return;
+            }
+            while (batch.shouldContinue() && input) {
+                input.read(buffer.get(), CopyChunkSize);
+                std::streamsize count = input.gcount();
+                if (count <= 0) break;
+                state.update(buffer.get(), static_cast<size_t>(count));
+                batch.pace(static_cast<uint64_t>(count));
+            }
+            if (input.bad()) ec = std::make_error_code(std::errc::io_error);
+#endif
+            if (!ec && !batch.shouldContinue()) ec = std::make_error_code(std::errc::operation_canceled);
+        }
+
+        // fs::copy_file (overwriting) in chunks, at the batch's I/O pace,
+        // stopping between chunks once cancelled with operation_canceled.
+        // Permissions follow the source, as with fs::copy_file, and a file
+        // is never copied onto itself (file_exists, as fs::copy_file
+        // reports it). A failed or cancelled copy removes what it wrote.
+        // With sourceHash the bytes go through a buffer, to be hashed on
+        // the way.
+        void copyContents(const fs::path& source, const fs::path& destination, const BatchContext& batch,
+                          std::error_code& ec, Xxh64* sourceHash = nullptr) {
+            ec.clear();
+            if (sourceHash) sourceHash->reset();
+            if (!batch.shouldContinue()) {
+                ec = std::make_error_code(std::errc::operation_canceled);
+                return;
+            }
+#ifndef _WIN32
+            int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+            if (in < 0) {
+                ec = lastError();
+                return;
+            }
+            struct stat info;
+            struct stat target;
+            int out = -1;
+            bool sameFile = false;
+            // Truncated only once it is known not to be the source
+            if (::fstat(in, &info) != 0) {
+                ec = lastError();
+            } else if ((out = ::open(destination.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, info.st_mode & 07777)) < 0 ||
+                       ::fstat(out, &target) != 0) {
+                ec = lastError();
+            } else if (target.st_dev == info.st_dev && target.st_ino == info.st_ino) {
+                sameFile = true;
+                ec = std::make_error_code(std::errc::file_exists);
+            } else if (::ftruncate(out, 0) != 0 || ::fchmod(out, info.st_mode & 07777) != 0) {
+                ec = lastError();
+            }
+
+            // In the kernel where the file systems allow it, else through a buffer
+            bool inKernel = sourceHash == nullptr;
+            std::unique_ptr<char[]> buffer;
+            while (!ec) {
+                if (!batch.shouldContinue()) {
+                    ec = std::make_error_code(std::errc::operation_canceled);
+                    break;
+                }
+                ssize_t count = -1;
+#ifdef __linux__
+                if (inKernel) {
+                    count = ::copy_file_range(in, nullptr, out, nullptr, CopyChunkSize, 0);
+                    if (count < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                        inKernel = false;
+                        continue;
+                    }
+                }
+#else
+                inKernel = false;
+#endif
+                if (!inKernel) {
+                    if (!buffer) buffer.reset(new char[CopyChunkSize]);
+                    count = ::read(in, buffer.get(), CopyChunkSize);
+                    if (count > 0 && sourceHash) sourceHash->update(buffer.get(), static_cast<size_t>(count));
+                    for (ssize_t written = 0, step = 0; count > 0 && written < count; written += step) {
+                        step = ::write(out, buffer.get() + written, static_cast<size_t>(count - written));
+                        if (step < 0 && errno == EINTR) step = 0;
+                        if (step < 0) {
+                            ec = lastError();
+                            break;
+                        }
+                    }
+                }
+                if (count < 0 && errno == EINTR) continue;
+                if (count < 0) ec = lastError();
+                if (count <= 0) break;
+                batch.pace(static_cast<uint64_t>(count));
+            }
+            ::close(in);
+            if (out >= 0 && ::close(out) != 0 && !ec) ec = lastError();
+            if (ec && out >= 0 && !sameFile) ::unlink(destination.c_str());
+#else
+            fs::copy_file(source, destination, fs::copy_options::overwrite_existing, ec);
+            if (!ec) batch.pace(fs::file_size(destination, ec));
+            if (!ec && sourceHash) hashFile(source.string(), batch, false, *sourceHash, ec);
+#endif
+        }
+
+        // Copies into destination only if nothing is there: the name is taken
+        // with an exclusive create first, then filled on the same copy path
+        void copyExclusive(const fs::path& source, const fs::path& destination, const BatchContext& batch,
+                           std::error_code& ec, Xxh64* sourceHash = nullptr) {
+            ec = createExclusive(destination.string());
+            if (ec) return;
+            copyContents(source, destination, batch, ec, sourceHash);
+            if (ec) {
+                std::error_code ignored;
+                fs::remove(destination, ignored);
+            }
+        }
+
+        // The move a rename cannot do across file systems: copy (on the same
+        // path copyFiles uses), keep the modification time, remove the source.
+        // A failure leaves the source in place and no partial copy behind.
+        std::error_code copyAcrossDevices(const fs::path& source, const fs::path& destination,
+                                          const BatchContext& batch) {
+            std::error_code ec;
+            copyExclusive(source, destination, batch, ec);
+            if (ec) return ec;
+            auto modified = fs::last_write_time(source, ec);
+            if (!ec) fs::last_write_time(destination, modified, ec);
+            if (!ec) fs::remove(source, ec);
+            if (ec) {
+                std::error_code ignored;
+                fs::remove(destination, ignored);
+                return ec;
+            }
+            Instrumentation::add(Counter::CrossDeviceMoves);
+            countCopiedBytes(destination);
+            return ec;
+        }
+
+        // Checks copies on a pool while the copy thread goes on to the next
+        // file. Each copy is read back, bypassing the page cache, and its
+        // hash compared with the one taken of the source on the way in; a
+        // copy that differs is removed. Good copies are recorded in the
+        // destination's checksum manifest, which is saved by finish().
+        class CopyVerifier {
+        private:
+            struct Readback {
+                std::error_code ec;
+                uint64_t hash = 0;
+                EntryMetadata metadata;
+            };
+
+            struct Check {
+                std::string destination;
+                std::string relative;           // Manifest key
+                uint64_t expected;
+                std::future<Readback> readback;
+            };
+
+            const BatchContext& batch;
+            std::string manifestPath;
+            ChecksumManifest manifest;
+            std::string manifestError;
+            std::deque<Check> pending;          // In copy order, so results are too
+            size_t mismatches = 0;
+            size_t recorded = 0;
+            size_t maxPending;
+            ThreadPool pool;                    // Last, so it joins before the rest goes
+
+            void settle(Check& check, OperationResult& result) {
+                Readback readback = check.readback.get();
+                if (readback.ec == std::errc::operation_canceled) return;
+                if (readback.ec) {
+                    result.success = false;
+                    result.errors.push_back("Cannot verify " + check.destination + ": " + readback.ec.message());
+                } else if (readback.hash != check.expected) {
+                    std::error_code ignored;
+                    fs::remove(check.destination, ignored);
+                    mismatches++;
+                    result.success = false;
+                    result.filesProcessed--;
+                    result.filesSkipped++;
+                    result.errors.push_back("Checksum mismatch, copy removed: " + check.destination + " (source " +
+                                            Xxh64::toHex(check.expected) + ", copy " + Xxh64::toHex(readback.hash) + ")");
+                } else {
+                    manifest.set(check.relative, {readback.hash, readback.metadata.size, readback.metadata.modifiedNs});
+                    recorded++;
+                }
+            }
+
+        public:
+            CopyVerifier(const BatchContext& copyBatch, const std::string& destinationDir)
+                : batch(copyBatch), manifestPath(ChecksumManifest::pathFor(destinationDir)),
+                  maxPending(4 * ThreadPool::defaultThreadCount()), pool(ThreadPool::defaultThreadCount()) {
+                // Entries from earlier runs stay unless this run copies over them
+                if (!manifest.load(manifestPath, manifestError)) manifest = ChecksumManifest();
+            }
+
+            // Queues the check of one finished copy. With the pool behind,
+            // the copy thread first settles the oldest check, so at most a
+            // few copies wait in the page cache.
+            void submit(const std::string& destination, const std::string& relative, uint64_t expected,
+                        OperationResult& result) {
+                if (pending.size() >= maxPending) {
+                    settle(pending.front(), result);
+                    pending.pop_front();
+                }
+                const BatchContext* context = &batch;
+                auto readback = pool.submit([context, destination]() {
+                    Readback outcome;
+                    Xxh64 state;
+                    hashFile(destination, *context, true, state, outcome.ec);
+                    if (!outcome.ec && !DirectoryWalker::readPathMetadata(destination, outcome.metadata)) {
+                        outcome.ec = std::make_error_code(std::errc::no_such_file_or_directory);
+                    }
+                    outcome.hash = state.digest();
+                    return outcome;
+                });
+                pending.push_back({destination, relative, expected, std::move(readback)});
+            }
+
+            // Waits for the checks still running and saves the manifest
+            void finish(OperationResult& result) {
+                for (auto& check : pending) settle(check, result);
+                pending.clear();
+                if (!manifestError.empty()) result.errors.push_back("Checksum manifest replaced: " + manifestError);
+                std::string error;
+                if (recorded > 0 && !manifest.save(manifestPath, error)) {
+                    result.errors.push_back("Error saving checksums: " + error);
+                }
+                if (result.message.empty()) {
+                    result.message = "Verified " + std::to_string(recorded) + " copies";
+                    if (mismatches > 0) result.message += ", " + std::to_string(mismatches) + " did not match their source";
+                }
+            }
+        };
+
+        enum class VerifyStatus : uint8_t {
+            NotRun,         // Cancelled first
+            Matched,        // Unchanged since the manifest, same hash
+            Trusted,        // Unchanged, and not reread
+            Added,          // Not in the manifest yet
+            Changed,        // Other size or time, so hashed afresh
+            Corrupt,        // Unchanged, but the hash is not
+            Failed
+        };
+
+        // One file of a verifyChecksums run
+        struct VerifyFile {
+            std::string relative;
+            EntryMetadata metadata;
+            VerifyStatus status = VerifyStatus::NotRun;
+            uint64_t hash = 0;
+            std::string message;
+        };
+
+        // Buckets are relative paths below the destination; they may nest
+        // ("%Y/%m") but must not climb out of it
+        bool isContainedBucket(const std::string& bucket) {
+            if (bucket.empty() || bucket.front() == '/' || bucket.front() == '\\') return false;
+            for (const auto& part : fs::path(bucket)) {
+                if (part == "..") return false;
+            }
+            return true;
+        }
+
+        // Lowercase extension without the dot; dotfiles and names without
+        // one share a bucket
+        std::string extensionBucket(const std::string& name) {
+            size_t dot = name.rfind('.');
+            if (dot == 0 || dot == std::string::npos || dot + 1 == name.size()) return "no_extension";
+            return toLowerCase(name.substr(dot + 1));
+        }
+
+        // Buckets found by one classification worker, in first-seen order
+        struct SliceBuckets {
+            std::unordered_map<std::string, size_t> index;
+            std::vector<std::string> names;
+            std::vector<std::vector<size_t>> files;
+            std::vector<std::string> errors;
+            size_t skipped = 0;
+        };
+
+        // Files per classification task, and per move task within a bucket
+        constexpr size_t ClassifySliceSize = 4096;
+        constexpr size_t MoveSliceSize = 4096;
+
+        // Bytes a text rewrite holds per file (its output block aside)
+        constexpr size_t RewriteBlockSize = 1 << 20;
+
+        // Reads a file front to back in blocks, and again from the start
+        class InputFile {
+        private:
+#ifndef _WIN32
+            int fd;
+            uint64_t offset;
+#else
+            std::ifstream stream;
+#endif
+            bool failed;
+
+        public:
+#ifndef _WIN32
+            InputFile() : fd(-1), offset(0), failed(false) {}
+            ~InputFile() {
+                if (fd >= 0) ::close(fd);
+            }
+#else
+            InputFile() : failed(false) {}
+#endif
+            InputFile(const InputFile&) = delete;
+            InputFile& operator=(const InputFile&) = delete;
+
+            bool open(const std::string& path) {
+#ifndef _WIN32
+                fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) return false;
+#else
+                stream.open(path, std::ios::binary);
+                if (!stream.is_open()) return false;
+#endif
+                Instrumentation::add(Counter::FilesOpened);
+                return true;
+            }
+
+            // Fills buffer unless the file ends first; 0 at the end or on error
+            size_t read(char* buffer, size_t size) {
+                size_t filled = 0;
+#ifndef _WIN32
+                while (filled < size) {
+                    ssize_t count = ::pread(fd, buffer + filled, size - filled, static_cast<off_t>(offset));
+                    if (count < 0 && errno == EINTR) continue;
+                    if (count < 0) failed = true;
+                    if (count <= 0) break;
+                    filled += static_cast<size_t>(count);
+                    offset += static_cast<uint64_t>(count);
+                }
+#else
+                stream.read(buffer, static_cast<std::streamsize>(size));
+                filled = static_cast<size_t>(stream.gcount());
+                if (stream.bad()) failed = true;
+#endif
+                Instrumentation::add(Counter::BytesRead, filled);
+                return filled;
+            }
+
+            void rewind() {
+#ifndef _WIN32
+                offset = 0;
+#else
+                stream.clear();
+                stream.seekg(0);
+#endif
+            }
+
+            bool hasFailed() const { return failed; }
+        };
+
+        // A temporary file beside the target that takes its place on commit,
+        // so readers see the old content or the new, never a mix. The target's
+        // permissions (and owner, where allowed) carry over. Dropped unless
+        // committed.
+        class ReplacementFile {
+        private:
+            std::string target;
+            std::string temporary;
+            bool committed;
+#ifndef _WIN32
+            int fd;
+#else
+            std::ofstream stream;
+#endif
+
+        public:
+#ifndef _WIN32
+            ReplacementFile() : committed(false), fd(-1) {}
+#else
+            ReplacementFile() : committed(false) {}
+#endif
+            ~ReplacementFile() {
+#ifndef _WIN32
+                if (fd >= 0) ::close(fd);
+                if (!committed && !temporary.empty()) ::unlink(temporary.c_str());
+#else
+                stream.close();
+                std::error_code ec;
+                if (!committed && !temporary.empty()) fs::remove(temporary, ec);
+#endif
+            }
+            ReplacementFile(const ReplacementFile&) = delete;
+            ReplacementFile& operator=(const ReplacementFile&) = delete;
+
+            bool open(const std::string& targetPath, std::string& error) {
+                target = targetPath;
+                fs::path path(target);
+                std::string name = "." + path.filename().string() + ".fsm-XXXXXX";
+#ifndef _WIN32
+                std::string pattern = (path.parent_path() / name).string();
+                fd = ::mkstemp(&pattern[0]);
+                if (fd < 0) {
+                    error = std::strerror(errno);
+                    return false;
+                }
+                temporary = pattern;
+                Instrumentation::add(Counter::StatCalls);
+                struct stat st;
+                if (::stat(target.c_str(), &st) == 0) {
+                    ::fchmod(fd, st.st_mode & 07777);
+                    if (::fchown(fd, st.st_uid, st.st_gid) != 0) {
+                        // Not permitted for other users' files; the rewrite is then owned by us
+                    }
+                }
+#else
+                name.replace(name.size() - 6, 6, std::to_string(reinterpret_cast<uintptr_t>(this)));
+                temporary = (path.parent_path() / name).string();
+                stream.open(temporary, std::ios::binary | std::ios::trunc);
+                if (!stream.is_open()) {
+                    temporary.clear();
+                    error = "cannot create a temporary file";
+                    return false;
+                }
+#endif
+                return true;
+            }
+
+            bool write(const std::string& data, std::string& error) {
+                Instrumentation::add(Counter::BytesWritten, data.size());
+#ifndef _WIN32
+                size_t written = 0;
+                while (written < data.size()) {
+                    ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+                    if (count < 0 && errno == EINTR) continue;
+                    if (count < 0) {
+                        error = std::strerror(errno);
+                        return false;
+                    }
+                    written += static_cast<size_t>(count);
+                }
+#else
+                stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+                if (!stream) {
+                    error = "write failed";
+                    return false;
+                }
+#endif
+                return true;
+            }
+
+            // Flushes to disk before the rename, so a crash cannot leave an
+            // empty file under the target's name
+            bool commit(std::string& error) {
+#ifndef _WIN32
+                bool synced = ::fsync(fd) == 0;
+                int closed = ::close(fd);
+                fd = -1;
+                if (!synced || closed != 0 || ::rename(temporary.c_str(), target.c_str()) != 0) {
+                    error = std::strerror(errno);
+                    return false;
+                }
+#else
+                stream.close();
+                std::error_code ec;
+                fs::rename(temporary, target, ec);
+                if (ec) {
+                    error = ec.message();
+                    return false;
+                }
+#endif
+                committed = true;
+                return true;
+            }
+        };
+
+        enum class RewriteStatus : uint8_t {
+            NotRun,         // Cancelled before the file's turn
+            Rewritten,
+            Conforming,     // Already in the target form; nothing written
+            Skipped,        // Not a file the transform applies to
+            Failed
+        };
+
+        struct RewriteOutcome {
+            RewriteStatus status = RewriteStatus::NotRun;
+            std::string message;
+        };
+
+        // Buffers one rewrite worker reuses for file after file
+        struct RewriteBuffers {
+            std::unique_ptr<char[]> block{new char[RewriteBlockSize]};
+            std::string output;
+        };
+
+        // Reads and writes at the batch's I/O pace. Stops between blocks once
+        // cancelled, leaving the file as it was and the outcome NotRun.
+        RewriteOutcome rewriteTextFile(const std::string& path, TextTransform& transform, RewriteBuffers& buffers,
+                                       const BatchContext& batch) {
+            RewriteOutcome outcome;
+            outcome.status = RewriteStatus::Failed;
+
+            // Rewrite the file a symlink points to; renaming over the link would replace it
+            std::string target = path;
+            EntryMetadata metadata;
+            if (!DirectoryWalker::readPathMetadata(target, metadata, false)) {
+                outcome.message = "File not found: " + path;
+                return outcome;
+            }
+            if (!metadata.isRegularFile) {
+                std::error_code ec;
+                fs::path resolved = fs::canonical(path, ec);
+                if (ec || !DirectoryWalker::readPathMetadata(resolved.string(), metadata, false) || !metadata.isRegularFile) {
+                    outcome.status = RewriteStatus::Skipped;
+                    outcome.message = "Not a regular file: " + path;
+                    return outcome;
+                }
+                target = resolved.string();
+            }
+
+            InputFile input;
+            if (!input.open(target)) {
+                outcome.message = "Cannot open " + path;
+                return outcome;
+            }
+            char* block = buffers.block.get();
+            size_t length = input.read(block, RewriteBlockSize);
+            batch.pace(length);
+            if (length == 0 && !input.hasFailed()) {
+                outcome.status = RewriteStatus::Conforming;
+                return outcome;
+            }
+
+            ContentVerdict verdict;
+            ContentClassifier& classifier = ContentClassifier::shared();
+            if (!classifier.classifyWithoutReading(fs::path(target).filename().string(), metadata, verdict)) {
+                verdict = classifier.classifyBuffer(metadata, block, std::min(length, ContentClassifier::SampleSize));
+            }
+            std::string reason;
+            if (!transform.accepts(verdict, reason)) {
+                outcome.status = RewriteStatus::Skipped;
+                outcome.message = "Skipped " + path + ": " + reason;
+                return outcome;
+            }
+
+            // Checking pass: usually stops at the first block that needs work
+            while (length > 0 && transform.scan(block, length)) {
+                if (!batch.shouldContinue()) {
+                    outcome.status = RewriteStatus::NotRun;
+                    return outcome;
+                }
+                length = input.read(block, RewriteBlockSize);
+                batch.pace(length);
+            }
+            if (input.hasFailed()) {
+                outcome.message = "Error reading " + path;
+                return outcome;
+            }
+            if (transform.conforms()) {
+                outcome.status = RewriteStatus::Conforming;
+                return outcome;
+            }
+
+            std::string error;
+            ReplacementFile replacement;
+            std::string& output = buffers.output;
+            bool written = replacement.open(target, error);
+            input.rewind();
+            while (written && (length = input.read(block, RewriteBlockSize)) > 0) {
+                if (!batch.shouldContinue()) {
+                    outcome.status = RewriteStatus::NotRun;
+                    return outcome;
+                }
+                output.clear();
+                written = transform.transcode(block, length, output, error) && replacement.write(output, error);
+                batch.pace(length + output.size(), 2);
+            }
+            if (written && input.hasFailed()) {
+                error = "read failed";
+                written = false;
+            }
+            if (written) {
+                output.clear();
+                written = transform.finish(output, error) && replacement.write(output, error) && replacement.commit(error);
+            }
+            // A long line ending conversion can double a block; do not keep that around
+            if (output.capacity() > 4 * RewriteBlockSize) std::string().swap(output);
+
+            if (!written) {
+                outcome.message = "Error rewriting " + path + ": " + error;
+                return outcome;
+            }
+            outcome.status = RewriteStatus::Rewritten;
+            return outcome;
+        }
+
+        // A rename batch's journal: a header line, then for every rename done
+        // its directory, old name and new name, each NUL-terminated. Each
+        // record is flushed before its rename runs and taken back if the
+        // rename fails, so an interrupted batch can be undone as far as it got.
+        const char RenameJournalHeader[] = "fsmanager rename journal 1\n";
+
+        struct JournalRecord {
+            std::string directory;
+            std::string from;
+            std::string to;
+        };
+
+        std::string renameJournalDirectory() {
+            return (fs::path(cacheDirectory()) / "renames").string();
+        }
+
+        // Journals are named by creation time in fixed-width nanoseconds, so
+        // the newest sorts last
+        std::string newestRenameJournal() {
+            std::string newest;
+            std::error_code ec;
+            for (fs::directory_iterator it(renameJournalDirectory(), ec), end; !ec && it != end; it.increment(ec)) {
+                if (it->path().extension() != ".journal") continue;
+                std::string path = it->path().string();
+                if (path > newest) newest = path;
+            }
+            return newest;
+        }
+
+        class RenameJournal {
+        private:
+            std::FILE* file;
+            std::string path;
+            long recordStart;       // Where the newest record begins
+
+        public:
+            RenameJournal() : file(nullptr), recordStart(0) {}
+            ~RenameJournal() {
+                close();
+            }
+            RenameJournal(const RenameJournal&) = delete;
+            RenameJournal& operator=(const RenameJournal&) = delete;
+
+            bool create(const std::string& journalPath, std::string& error) {
+                std::error_code ec;
+                fs::create_directories(fs::path(journalPath).parent_path(), ec);
+                file = std::fopen(journalPath.c_str(), "wbx");
+                if (!file) {
+                    error = std::strerror(errno);
+                    return false;
+                }
+                path = journalPath;
+                std::fputs(RenameJournalHeader, file);
+                return true;
+            }
+
+            // Written through to the file system before returning; false if not
+            bool record(const std::string& directory, const char* from, const char* to) {
+                recordStart = std::ftell(file);
+                std::fwrite(directory.c_str(), 1, directory.size() + 1, file);
+                std::fwrite(from, 1, std::strlen(from) + 1, file);
+                std::fwrite(to, 1, std::strlen(to) + 1, file);
+                return std::fflush(file) == 0 && std::ferror(file) == 0;
+            }
+
+            // Drops the newest record, for a rename that did not happen
+            bool retract() {
+                if (recordStart <= 0 || std::fflush(file) != 0) return false;
+                std::error_code ec;
+                fs::resize_file(path, static_cast<uintmax_t>(recordStart), ec);
+                return !ec && std::fseek(file, recordStart, SEEK_SET) == 0;
+            }
+
+            bool close() {
+                if (!file) return true;
+                bool written = std::ferror(file) == 0;
+                written = std::fclose(file) == 0 && written;
+                file = nullptr;
+                return written;
+            }
+        };
+
+        bool readRenameJournal(const std::string& path, std::vector<JournalRecord>& records, std::string& error) {
+            std::ifstream input(path, std::ios::binary);
+            if (!input.is_open()) {
+                error = "cannot open " + path;
+                return false;
+            }
+            std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            const size_t headerLength = sizeof(RenameJournalHeader) - 1;
+            if (content.compare(0, headerLength, RenameJournalHeader) != 0) {
+                error = path + " is not a rename journal";
+                return false;
+            }
+
+            size_t position = headerLength;
+            auto field = [&](std::string& value) {
+                size_t end = content.find('\0', position);
+                if (end == std::string::npos) return false;
+                value.assign(content, position, end - position);
+                position = end + 1;
+                return true;
+            };
+            // A record cut short by a crash was never acted on. A whole last
+            // record may not have been either; undoing it then fails on the
+            // missing new name and leaves the old one alone.
+            JournalRecord record;
+            while (position < content.size() && field(record.directory) && field(record.from) && field(record.to)) {
+                records.push_back(record);
+            }
+            return true;
+        }
+
+        bool writeRenameJournal(const std::string& path, const std::vector<JournalRecord>& records) {
+            std::string temporary = path + ".tmp";
+            std::error_code ec;
+            fs::remove(temporary, ec);
+            RenameJournal journal;
+            std::string error;
+            if (!journal.create(temporary, error)) return false;
+            for (const auto& record : records) {
+                journal.record(record.directory, record.from.c_str(), record.to.c_str());
+            }
+            if (!journal.close()) return false;
+            fs::rename(temporary, path, ec);
+            return !ec;
+        }
+
+        // Whether a template produced something usable as a name in the same directory
+        bool isPlainName(const std::string& name) {
+            return !name.empty() && name != "." && name != ".." && name.find('/') == std::string::npos &&
+                   name.find('\0') == std::string::npos;
+        }
+
+        // Name endings (".tmp", ".bak", "~") matched without allocating.
+        // Endings of up to eight bytes are packed, lowercased, into one
+        // integer and kept sorted per length, so a name costs one binary
+        // search per distinct length, however many endings there are.
+        class SuffixSet {
+        private:
+            std::vector<std::pair<size_t, std::vector<uint64_t>>> packed;  // Length and sorted keys
+            std::vector<std::string> longer;                               // Lowercase
+
+            static uint64_t pack(const char* data, size_t length) {
+                uint64_t key = 0;
+                for (size_t i = 0; i < length; ++i) {
+                    key = (key << 8) | static_cast<unsigned char>(::tolower(static_cast<unsigned char>(data[i])));
+                }
+                return key;
+            }
+
+        public:
+            explicit SuffixSet(const std::vector<std::string>& suffixes) {
+                for (const auto& suffix : suffixes) {
+                    if (suffix.empty()) continue;
+                    if (suffix.size() > sizeof(uint64_t)) {
+                        longer.push_back(toLowerCase(suffix));
+                        continue;
+                    }
+                    auto group = std::find_if(packed.begin(), packed.end(),
+                                              [&suffix](const auto& entry) { return entry.first == suffix.size(); });
+                    if (group == packed.end()) group = packed.insert(packed.end(), {suffix.size(), {}});
+                    group->second.push_back(pack(suffix.data(), suffix.size()));
+                }
+                for (auto& group : packed) {
+                    std::sort(group.second.begin(), group.second.end());
+                }
+            }
+
+            bool empty() const {
+                return packed.empty() && longer.empty();
+            }
+
+            bool matches(std::string_view name) const {
+                for (const auto& [length, keys] : packed) {
+                    if (name.size() < length) continue;
+                    if (std::binary_search(keys.begin(), keys.end(), pack(name.data() + name.size() - length, length))) return true;
+                }
+                for (const auto& suffix : longer) {
+                    if (name.size() < suffix.size()) continue;
+                    std::string_view tail = name.substr(name.size() - suffix.size());
+                    if (std::equal(tail.begin(), tail.end(), suffix.begin(),
+                                   [](char a, char b) { return ::tolower(static_cast<unsigned char>(a)) == b; })) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+        // What one walk worker removed
+        struct CleanupTally {
+            size_t removed = 0;
+            size_t failed = 0;
+            uint64_t bytes = 0;
+            std::vector<std::string> errors;
+        };
+
+    }
+
+    // Everything a directory copy will touch, gathered in one walk. Relative
+    // paths are packed back to back into one buffer instead of one string
+    // (or fs::path) per entry.
+    struct BatchOperations::CopyPlan {
+        std::string relativePaths;
+        std::vector<std::pair<size_t, size_t>> directories;    // Offset and length, parents first
+        std::vector<std::pair<size_t, size_t>> files;
+    };
+
+    // Files of one organize run grouped by target directory. Names are
+    // packed back to back like CopyPlan paths, each NUL-terminated so the
+    // *at() calls can use them in place.
+    struct BatchOperations::OrganizePlan {
+        std::string names;
+        std::vector<std::pair<size_t, size_t>> files;          // Offset and length in names
+        std::vector<std::string> buckets;                      // Relative to the destination
+        std::vector<std::vector<size_t>> bucketFiles;          // Indices into files, per bucket
+    };
+
+    // A slice of one bucket's files, moved by one pool task
+    struct BatchOperations::BucketMove {
+        size_t bucket;
+        size_t begin;
+        size_t end;
+        NameRegistry* names;   // The bucket's, shared by its slices; consulted on collisions only
+    };
+
+    // One rename batch. Every directory involved is listed once, and new
+    // names are checked against those listings and each other instead of
+    // probing the disk for each candidate.
+    struct BatchOperations::RenamePlan {
+        enum class Stage : uint8_t {
+            Direct,             // Old name to new name
+            ToTemporary,        // Parks the first member of a cycle
+            FromTemporary       // Lands it once the rest of the cycle has moved
+        };
+
+        struct Entry {
+            size_t directory;
+            std::string from;
+            std::string to;                 // Empty for a file left alone
+            std::string temporary;
+        };
+
+        std::vector<std::string> directories;
+        std::vector<std::unordered_set<std::string>> names;    // Everything in each directory
+        std::vector<Entry> entries;                             // In batch order, which {n} counts
+        std::vector<std::pair<size_t, Stage>> steps;            // Entries in the order they are renamed
+        std::vector<size_t> chains;                             // First step of each chain or cycle
+    };
+
+    void BatchContext::cancel() {
+        cancellation.cancel();
+    }
+
+    bool BatchHandle::isReady() const {
+        return outcome.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    OperationResult BatchHandle::get() const {
+        return outcome.get();
+    }
+
+    void BatchHandle::cancel() {
+        if (context) context->cancel();
+    }
+
+    void BatchHandle::setDeadline(std::chrono::steady_clock::time_point deadline) {
+        if (context) context->cancellation.setDeadline(deadline);
+    }
+
+    void BatchHandle::setTimeout(std::chrono::nanoseconds limit) {
+        if (context) context->cancellation.setTimeout(limit);
+    }
+
+    size_t BatchHandle::getProcessedFiles() const {
+        return context ? context->progress.filesDone() : 0;
+    }
+
+    size_t BatchHandle::getTotalFiles() const {
+        return context ? context->progress.filesTotal() : 0;
+    }
+
+    BatchOperations::BatchOperations() : progressInterval(std::chrono::milliseconds(100)), timeout(0) {
     }
 
     void BatchOperations::setProgressCallback(std::function<void(size_t, size_t, const std::string&)> callback) {
-        progressCallback.callback = callback;
+        if (!callback) {
+            setProgressReporter(ProgressTracker::Callback());
+            return;
+        }
+        setProgressReporter([callback](const ProgressSnapshot& snapshot) {
+            callback(snapshot.filesDone, snapshot.filesTotal, snapshot.currentFile);
+        });
+    }
+
+    void BatchOperations::setProgressReporter(ProgressTracker::Callback callback, std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        progressCallback = std::move(callback);
+        progressInterval = interval;
+    }
+
+    void BatchOperations::setTimeout(std::chrono::milliseconds limit) {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        timeout = limit;
+    }
+
+    void BatchOperations::setIoThrottle(std::shared_ptr<IoThrottle> ioThrottle) {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        throttle = std::move(ioThrottle);
     }
 
     bool BatchOperations::isOperationInProgress() const {
-        return operationInProgress.load();
+        std::lock_guard<std::mutex> lock(activeMutex);
+        return !active.empty();
     }
 
     double BatchOperations::getProgressPercentage() const {
-        if (totalFiles.load() == 0) return 0.0;
-        return static_cast<double>(processedFiles.load()) / totalFiles.load() * 100.0;
+        size_t total = getTotalFiles();
+        if (total == 0) return 0.0;
+        return static_cast<double>(getProcessedFiles()) / total * 100.0;
     }
 
     size_t BatchOperations::getProcessedFiles() const {
-        return processedFiles.load();
+        std::lock_guard<std::mutex> lock(activeMutex);
+        size_t done = 0;
+        for (const auto& batch : active) done += batch->progress.filesDone();
+        return done;
     }
 
     size_t BatchOperations::getTotalFiles() const {
-        return totalFiles.load();
+        std::lock_guard<std::mutex> lock(activeMutex);
+        size_t total = 0;
+        for (const auto& batch : active) total += batch->progress.filesTotal();
+        return total;
     }
 
-    OperationResult BatchOperations::copyFiles(const std::vector<std::string>& sourceFiles, const std::string& destinationDir) {
-        operationInProgress = true;
-        processedFiles = 0;
-        totalFiles = sourceFiles.size();
+    OperationResult BatchOperations::copyFiles(const std::vector<std::string>& sourceFiles, const std::string& destinationDir,
+                                               bool verify) {
+        ScopedPhase phase("batch.copy");
+        auto batch = openBatch(sourceFiles.size());
         
         OperationResult result;
         result.success = true;
@@ -40,25 +1121,45 @@ namespace FileSystemManager {
         
         try {
             fs::create_directories(destinationDir);
+            NameRegistry names(destinationDir);
+            std::unique_ptr<CopyVerifier> verifier;
+            if (verify) verifier = std::make_unique<CopyVerifier>(*batch, destinationDir);
+            Xxh64 sourceHash;
             
             for (const auto& sourceFile : sourceFiles) {
-                if (!shouldContinue()) {
+                if (!batch->shouldContinue()) {
                     result.success = false;
-                    result.message = "Operation cancelled";
+                    result.message = batch->cancellation.describe();
                     break;
                 }
                 
                 try {
                     fs::path sourcePath(sourceFile);
-                    fs::path destPath = fs::path(destinationDir) / sourcePath.filename();
                     
-                    if (fs::exists(sourcePath) && fs::is_regular_file(sourcePath)) {
-                        if (fs::exists(destPath)) {
-                            destPath = generateUniqueFileName(destinationDir, sourcePath.filename().string());
+                    Instrumentation::add(Counter::StatCalls);
+                    if (fs::is_regular_file(sourcePath)) {
+                        std::string fileName = sourcePath.filename().string();
+                        std::string name = names.claim(fileName);
+                        fs::path destPath;
+                        std::error_code ec = placeUnique(names, fileName, name, [&](const std::string& candidate) {
+                            std::error_code copied;
+                            destPath = fs::path(destinationDir) / candidate;
+                            copyExclusive(sourcePath, destPath, *batch, copied, verifier ? &sourceHash : nullptr);
+                            return copied;
+                        });
+                        if (ec) {
+                            names.release(name);
+                            // Stopped mid-file; nothing is left behind
+                            if (ec == std::errc::operation_canceled) {
+                                result.success = false;
+                                result.message = batch->cancellation.describe();
+                                break;
+                            }
+                            throw fs::filesystem_error("cannot copy", sourcePath, destPath, ec);
                         }
-                        
-                        fs::copy_file(sourcePath, destPath, fs::copy_options::overwrite_existing);
+                        countCopiedBytes(destPath);
                         result.filesProcessed++;
+                        if (verifier) verifier->submit(destPath.string(), name, sourceHash.digest(), result);
                     } else {
                         result.filesSkipped++;
                         result.errors.push_back("File not found or not a regular file: " + sourceFile);
@@ -68,22 +1169,22 @@ namespace FileSystemManager {
                     result.errors.push_back("Error copying " + sourceFile + ": " + e.what());
                 }
                 
-                processedFiles++;
-                updateProgress(processedFiles, sourceFile);
+                batch->advance(sourceFile);
             }
+            if (verifier) verifier->finish(result);
         } catch (const std::exception& e) {
             result.success = false;
             result.message = "Error creating destination directory: " + std::string(e.what());
         }
         
-        operationInProgress = false;
+        closeBatch(batch);
         return result;
     }
 
-    OperationResult BatchOperations::copyDirectory(const std::string& sourceDir, const std::string& destinationDir, bool recursive) {
-        operationInProgress = true;
-        processedFiles = 0;
-        totalFiles = 0;
+    OperationResult BatchOperations::copyDirectory(const std::string& sourceDir, const std::string& destinationDir, bool recursive,
+                                                   bool verify) {
+        ScopedPhase phase("batch.copyDirectory");
+        auto batch = openBatch(0);
         
         OperationResult result;
         result.success = true;
@@ -91,396 +1192,1484 @@ namespace FileSystemManager {
         result.filesSkipped = 0;
         
         try {
-            // Count total files first
-            if (recursive) {
-                for (const auto& entry : fs::recursive_directory_iterator(sourceDir)) {
-                    if (fs::is_regular_file(entry)) {
-                        totalFiles++;
-                    }
-                }
-            } else {
-                for (const auto& entry : fs::directory_iterator(sourceDir)) {
-                    if (fs::is_regular_file(entry)) {
-                        totalFiles++;
-                    }
+            std::error_code ec;
+            if (!fs::is_directory(sourceDir, ec)) {
+                throw fs::filesystem_error("source is not a directory", sourceDir, ec);
+            }
+
+            // Plan once, then copy; the plan also gives the progress total
+            CopyPlan plan;
+            planDirectoryCopy(sourceDir, recursive, plan);
+            batch->progress.setTotal(plan.files.size());
+            executeCopyPlan(*batch, plan, sourceDir, destinationDir, verify, result);
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.message = "Error in directory copy operation: " + std::string(e.what());
+        }
+        
+        closeBatch(batch);
+        return result;
+    }
+
+    void BatchOperations::planDirectoryCopy(const std::string& sourceDir, bool recursive, CopyPlan& plan) const {
+        const PathNode* root = nullptr;
+        DirectoryWalker walker(plannerOptions(recursive));
+        walker.walk(sourceDir, [&](size_t, const WalkEntry& entry) {
+            bool isDirectory = recursive && entry.type == EntryType::Directory;
+            if (!isDirectory && !isRegularEntry(entry)) return;
+
+            if (!root) {
+                root = entry.node;
+                while (root->parent) root = root->parent;
+            }
+            size_t offset = plan.relativePaths.size();
+            entry.node->appendRelative(root, plan.relativePaths);
+            auto span = std::make_pair(offset, plan.relativePaths.size() - offset);
+            (isDirectory ? plan.directories : plan.files).push_back(span);
+        });
+    }
+
+    void BatchOperations::executeCopyPlan(BatchContext& batch, const CopyPlan& plan, const std::string& sourceDir,
+                                          const std::string& destinationDir, bool verify, OperationResult& result) {
+        fs::create_directories(destinationDir);
+
+        // Reused path buffers: base directory plus the planned relative path
+        std::string sourcePath = sourceDir;
+        std::string destPath = destinationDir;
+        if (sourcePath.empty() || sourcePath.back() != '/') sourcePath += '/';
+        if (destPath.empty() || destPath.back() != '/') destPath += '/';
+        const size_t sourceBase = sourcePath.size();
+        const size_t destBase = destPath.size();
+
+        for (const auto& [offset, length] : plan.directories) {
+            destPath.resize(destBase);
+            destPath.append(plan.relativePaths, offset, length);
+            std::error_code ec;
+            fs::create_directory(destPath, ec);
+            if (ec) {
+                result.errors.push_back("Error creating " + destPath + ": " + ec.message());
+            }
+        }
+
+        std::unique_ptr<CopyVerifier> verifier;
+        if (verify) verifier = std::make_unique<CopyVerifier>(batch, destinationDir);
+        Xxh64 sourceHash;
+        std::string relative;
+
+        for (const auto& [offset, length] : plan.files) {
+            if (!batch.shouldContinue()) {
+                result.success = false;
+                result.message = batch.cancellation.describe();
+                break;
+            }
+
+            sourcePath.resize(sourceBase);
+            sourcePath.append(plan.relativePaths, offset, length);
+            destPath.resize(destBase);
+            destPath.append(plan.relativePaths, offset, length);
+            relative.assign(plan.relativePaths, offset, length);
+            // The source's own manifest describes the source; the copy gets its own
+            if (verifier && relative == ChecksumManifest::FileName) {
+                batch.advance(sourcePath);
+                continue;
+            }
+
+            std::error_code ec;
+            copyContents(sourcePath, destPath, batch, ec, verifier ? &sourceHash : nullptr);
+            if (ec == std::errc::operation_canceled) {
+                result.success = false;
+                result.message = batch.cancellation.describe();
+                break;
+            }
+            if (ec) {
+                result.filesSkipped++;
+                result.errors.push_back("Error copying " + sourcePath + ": " + ec.message());
+            } else {
+                countCopiedBytes(destPath);
+                result.filesProcessed++;
+                if (verifier) verifier->submit(destPath, relative, sourceHash.digest(), result);
+            }
+
+            batch.advance(sourcePath);
+        }
+        if (verifier) verifier->finish(result);
+    }
+
+    OperationResult BatchOperations::copyFilesByPattern(const std::string& sourceDir, const std::string& pattern, const std::string& destinationDir,
+                                                        bool verify) {
+        std::vector<std::string> matchingFiles;
+        
+        if (!collectMatchingFiles(sourceDir, pattern, matchingFiles)) {
+            OperationResult result;
+            result.success = false;
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Error finding files: cannot open directory " + sourceDir;
+            return result;
+        }
+        
+        return copyFiles(matchingFiles, destinationDir, verify);
+    }
+
+    OperationResult BatchOperations::verifyChecksums(const std::string& directory, bool changedOnly) {
+        ScopedPhase phase("batch.verify");
+        auto batch = openBatch(0);
+
+        OperationResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.filesSkipped = 0;
+
+        std::error_code ec;
+        std::string manifestPath = ChecksumManifest::pathFor(directory);
+        ChecksumManifest manifest;
+        std::string error;
+        if (!fs::is_directory(directory, ec)) {
+            result.success = false;
+            result.message = "Not a directory: " + directory;
+        } else if (!manifest.load(manifestPath, error)) {
+            result.success = false;
+            result.message = "Error reading checksums: " + error;
+        }
+        if (!result.success) {
+            closeBatch(batch);
+            return result;
+        }
+
+        // List first, with the size and time that tell a changed file
+        std::vector<VerifyFile> files;
+        const std::string temporaryName = std::string(ChecksumManifest::FileName) + ".tmp";
+        const PathNode* root = nullptr;
+        WalkOptions walkOptions = plannerOptions(true);
+        walkOptions.cancellation = &batch->cancellation;
+        walkOptions.throttle = batch->throttle.get();
+        DirectoryWalker walker(walkOptions);
+        walker.walk(directory, [&](size_t, const WalkEntry& entry) {
+            if (!isRegularEntry(entry)) return;
+            if (!root) {
+                root = entry.node;
+                while (root->parent) root = root->parent;
+            }
+            VerifyFile file;
+            entry.node->appendRelative(root, file.relative);
+            if (file.relative == ChecksumManifest::FileName || file.relative == temporaryName) return;
+            if (!DirectoryWalker::readMetadata(entry, file.metadata, true)) {
+                file.status = VerifyStatus::Failed;
+                file.message = "Cannot stat " + entry.path();
+            }
+            files.push_back(std::move(file));
+        });
+        batch->progress.setTotal(files.size());
+
+        // Workers take the next file from a shared index; the manifest is
+        // only read until they are done
+        std::atomic<size_t> nextFile(0);
+        std::atomic<bool> cancelled(!batch->shouldContinue());
+        auto work = [&]() {
+            Xxh64 state;
+            for (size_t i = nextFile++; i < files.size() && !cancelled; i = nextFile++) {
+                VerifyFile& file = files[i];
+                std::string path = (fs::path(directory) / file.relative).string();
+                if (file.status != VerifyStatus::Failed) {
+                    const ManifestEntry* known = manifest.find(file.relative);
+                    bool unchanged = known && known->size == file.metadata.size && known->modifiedNs == file.metadata.modifiedNs;
+                    if (unchanged && changedOnly) {
+                        file.status = VerifyStatus::Trusted;
+                        batch->advance(path);
+                        continue;
+                    }
+                    std::error_code readError;
+                    hashFile(path, *batch, false, state, readError);
+                    if (readError == std::errc::operation_canceled) {
+                        cancelled = true;
+                        break;
+                    }
+                    if (readError) {
+                        file.status = VerifyStatus::Failed;
+                        file.message = "Cannot read " + path + ": " + readError.message();
+                    } else {
+                        file.hash = state.digest();
+                        file.status = !known ? VerifyStatus::Added
+                                    : !unchanged ? VerifyStatus::Changed
+                                    : known->hash == file.hash ? VerifyStatus::Matched : VerifyStatus::Corrupt;
+                    }
+                }
+                batch->advance(path, file.metadata.size);
+            }
+        };
+
+        size_t workers = std::min(ThreadPool::defaultThreadCount(), files.size());
+        if (workers <= 1) {
+            work();
+        } else {
+            ThreadPool pool(workers);
+            std::vector<std::future<void>> pending;
+            for (size_t w = 0; w < workers; ++w) {
+                pending.push_back(pool.submit(work));
+            }
+            for (auto& task : pending) task.get();
+        }
+
+        size_t counts[7] = {};
+        bool updated = false;
+        for (auto& file : files) {
+            counts[static_cast<size_t>(file.status)]++;
+            switch (file.status) {
+                case VerifyStatus::NotRun:
+                    break;
+                case VerifyStatus::Added:
+                case VerifyStatus::Changed:
+                    manifest.set(file.relative, {file.hash, file.metadata.size, file.metadata.modifiedNs});
+                    updated = true;
+                    result.filesProcessed++;
+                    break;
+                case VerifyStatus::Matched:
+                case VerifyStatus::Trusted:
+                    result.filesProcessed++;
+                    break;
+                case VerifyStatus::Corrupt:
+                    // The recorded hash stays, so later runs keep reporting it
+                    result.success = false;
+                    result.filesSkipped++;
+                    result.errors.push_back("Checksum mismatch: " + (fs::path(directory) / file.relative).string() + " (recorded " +
+                                            Xxh64::toHex(manifest.find(file.relative)->hash) + ", now " + Xxh64::toHex(file.hash) + ")");
+                    break;
+                case VerifyStatus::Failed:
+                    result.filesSkipped++;
+                    result.errors.push_back(std::move(file.message));
+                    break;
+            }
+        }
+
+        // Files the manifest knows that are gone, unless the run was cut short
+        size_t missing = 0;
+        if (!cancelled) {
+            std::unordered_set<std::string> present;
+            for (const auto& file : files) present.insert(file.relative);
+            std::vector<std::string> gone;
+            for (const auto& [relative, entry] : manifest.getEntries()) {
+                if (!present.count(relative)) gone.push_back(relative);
+            }
+            for (const auto& relative : gone) {
+                result.errors.push_back("Missing: " + (fs::path(directory) / relative).string());
+                manifest.erase(relative);
+            }
+            missing = gone.size();
+            updated = updated || missing > 0;
+        }
+
+        if (updated && !manifest.save(manifestPath, error)) {
+            result.success = false;
+            result.errors.push_back("Error saving checksums: " + error);
+        }
+        if (cancelled) {
+            result.success = false;
+            result.message = batch->cancellation.describe();
+        } else {
+            result.message = "Checked " + std::to_string(files.size()) + " files: " +
+                             std::to_string(counts[static_cast<size_t>(VerifyStatus::Matched)]) + " matched, " +
+                             std::to_string(counts[static_cast<size_t>(VerifyStatus::Added)]) + " added, " +
+                             std::to_string(counts[static_cast<size_t>(VerifyStatus::Changed)]) + " changed, " +
+                             std::to_string(counts[static_cast<size_t>(VerifyStatus::Corrupt)]) + " corrupt, " +
+                             std::to_string(missing) + " missing";
+            if (changedOnly) {
+                result.message += ", " + std::to_string(counts[static_cast<size_t>(VerifyStatus::Trusted)]) + " unchanged and not reread";
+            }
+        }
+
+        closeBatch(batch);
+        return result;
+    }
+
+    OperationResult BatchOperations::moveFiles(const std::vector<std::string>& sourceFiles, const std::string& destinationDir) {
+        ScopedPhase phase("batch.move");
+        auto batch = openBatch(sourceFiles.size());
+        
+        OperationResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.filesSkipped = 0;
+        
+        try {
+            fs::create_directories(destinationDir);
+            NameRegistry names(destinationDir);
+            
+            for (const auto& sourceFile : sourceFiles) {
+                if (!batch->shouldContinue()) {
+                    result.success = false;
+                    result.message = batch->cancellation.describe();
+                    break;
+                }
+                
+                try {
+                    fs::path sourcePath(sourceFile);
+                    
+                    Instrumentation::add(Counter::StatCalls);
+                    if (fs::is_regular_file(sourcePath)) {
+                        std::string fileName = sourcePath.filename().string();
+                        std::string name = names.claim(fileName);
+                        fs::path destPath;
+                        std::error_code ec = placeUnique(names, fileName, name, [&](const std::string& candidate) {
+                            destPath = fs::path(destinationDir) / candidate;
+                            return renameNoReplace(sourceFile, destPath.string());
+                        });
+                        if (ec) {
+                            names.release(name);
+                            throw fs::filesystem_error("cannot move", sourcePath, destPath, ec);
+                        }
+                        batch->pace(0);
+                        result.filesProcessed++;
+                    } else {
+                        result.filesSkipped++;
+                        result.errors.push_back("File not found or not a regular file: " + sourceFile);
+                    }
+                } catch (const std::exception& e) {
+                    result.filesSkipped++;
+                    result.errors.push_back("Error moving " + sourceFile + ": " + e.what());
+                }
+                
+                batch->advance(sourceFile);
+            }
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.message = "Error creating destination directory: " + std::string(e.what());
+        }
+        
+        closeBatch(batch);
+        return result;
+    }
+
+    OperationResult BatchOperations::moveFilesByPattern(const std::string& sourceDir, const std::string& pattern, const std::string& destinationDir) {
+        std::vector<std::string> matchingFiles;
+        
+        if (!collectMatchingFiles(sourceDir, pattern, matchingFiles)) {
+            OperationResult result;
+            result.success = false;
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Error finding files: cannot open directory " + sourceDir;
+            return result;
+        }
+        
+        return moveFiles(matchingFiles, destinationDir);
+    }
+
+    OperationResult BatchOperations::deleteFiles(const std::vector<std::string>& files) {
+        ScopedPhase phase("batch.delete");
+        auto batch = openBatch(files.size());
+        
+        OperationResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.filesSkipped = 0;
+        
+        for (const auto& file : files) {
+            if (!batch->shouldContinue()) {
+                result.success = false;
+                result.message = batch->cancellation.describe();
+                break;
+            }
+            
+            try {
+                fs::path filePath(file);
+                Instrumentation::add(Counter::StatCalls, 2);
+                if (fs::exists(filePath)) {
+                    if (fs::is_regular_file(filePath)) {
+                        fs::remove(filePath);
+                        batch->pace(0);
+                        result.filesProcessed++;
+                    } else if (fs::is_directory(filePath)) {
+                        batch->pace(0, fs::remove_all(filePath));
+                        result.filesProcessed++;
+                    } else {
+                        result.filesSkipped++;
+                        result.errors.push_back("Unknown file type: " + file);
+                    }
+                } else {
+                    result.filesSkipped++;
+                    result.errors.push_back("File not found: " + file);
+                }
+            } catch (const std::exception& e) {
+                result.filesSkipped++;
+                result.errors.push_back("Error deleting " + file + ": " + e.what());
+            }
+            
+            batch->advance(file);
+        }
+        
+        closeBatch(batch);
+        return result;
+    }
+
+    OperationResult BatchOperations::deleteFilesByPattern(const std::string& directory, const std::string& pattern) {
+        std::vector<std::string> matchingFiles;
+        
+        if (!collectMatchingFiles(directory, pattern, matchingFiles)) {
+            OperationResult result;
+            result.success = false;
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Error finding files: cannot open directory " + directory;
+            return result;
+        }
+        
+        return deleteFiles(matchingFiles);
+    }
+
+    OperationResult BatchOperations::deleteEmptyDirectories(const std::string& directory, bool recursive) {
+        auto batch = openBatch(0);
+        
+        OperationResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.filesSkipped = 0;
+        
+        try {
+            if (recursive) {
+                deleteEmptyDirectoriesRecursive(*batch, directory, result);
+            } else {
+                deleteEmptyDirectoriesNonRecursive(*batch, directory, result);
+            }
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.message = "Error in empty directory deletion: " + std::string(e.what());
+        }
+        
+        closeBatch(batch);
+        return result;
+    }
+
+    void BatchOperations::deleteEmptyDirectoriesRecursive(BatchContext& batch, const std::string& directory, OperationResult& result) {
+        try {
+            for (fs::recursive_directory_iterator it(directory), end; it != end; ++it) {
+                const auto& entry = *it;
+                if (!batch.shouldContinue()) {
+                    result.success = false;
+                    result.message = batch.cancellation.describe();
+                    break;
+                }
+                
+                if (fs::is_directory(entry)) {
+                    try {
+                        if (fs::is_empty(entry)) {
+                            // The iterator would descend into it next
+                            it.disable_recursion_pending();
+                            fs::remove(entry);
+                            batch.pace(0);
+                            result.filesProcessed++;
+                        }
+                    } catch (const std::exception& e) {
+                        result.filesSkipped++;
+                        result.errors.push_back("Error deleting empty directory " + entry.path().string() + ": " + e.what());
+                    }
+                }
+                
+                batch.advance(entry.path().string());
+            }
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.message = "Error in recursive empty directory deletion: " + std::string(e.what());
+        }
+    }
+
+    void BatchOperations::deleteEmptyDirectoriesNonRecursive(BatchContext& batch, const std::string& directory, OperationResult& result) {
+        try {
+            for (const auto& entry : fs::directory_iterator(directory)) {
+                if (!batch.shouldContinue()) {
+                    result.success = false;
+                    result.message = batch.cancellation.describe();
+                    break;
+                }
+                
+                if (fs::is_directory(entry)) {
+                    try {
+                        if (fs::is_empty(entry)) {
+                            fs::remove(entry);
+                            batch.pace(0);
+                            result.filesProcessed++;
+                        }
+                    } catch (const std::exception& e) {
+                        result.filesSkipped++;
+                        result.errors.push_back("Error deleting empty directory " + entry.path().string() + ": " + e.what());
+                    }
+                }
+                
+                batch.advance(entry.path().string());
+            }
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.message = "Error in empty directory deletion: " + std::string(e.what());
+        }
+    }
+
+    OperationResult BatchOperations::organizeByExtension(const std::string& sourceDir, const std::string& destinationDir) {
+        // The listing's entry types are enough; only symlinks and unknown types are stat'ed
+        return organize(sourceDir, destinationDir, "batch.organizeByExtension", false, []() -> BucketClassifier {
+            return [](const std::string& name, const EntryMetadata&, std::string& bucket) {
+                bucket = extensionBucket(name);
+                return true;
+            };
+        });
+    }
+
+    OperationResult BatchOperations::organizeByDate(const std::string& sourceDir, const std::string& destinationDir, const std::string& dateFormat) {
+        return organize(sourceDir, destinationDir, "batch.organizeByDate", true, [dateFormat]() -> BucketClassifier {
+            auto days = std::make_shared<DayFormatter>(dateFormat);
+            return [days](const std::string&, const EntryMetadata& metadata, std::string& bucket) {
+                return days->format(metadata.modifiedNs, bucket);
+            };
+        });
+    }
+
+    OperationResult BatchOperations::organizeBySize(const std::string& sourceDir, const std::string& destinationDir,
+                                                    const std::vector<std::pair<size_t, std::string>>& sizeRanges) {
+        // Each range is an upper bound (inclusive) and a bucket; a file goes
+        // to the smallest bound that holds it and is left alone above all of them
+        auto ranges = std::make_shared<std::vector<std::pair<size_t, std::string>>>(sizeRanges);
+        std::stable_sort(ranges->begin(), ranges->end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        return organize(sourceDir, destinationDir, "batch.organizeBySize", true, [ranges]() -> BucketClassifier {
+            return [ranges](const std::string&, const EntryMetadata& metadata, std::string& bucket) {
+                auto range = std::lower_bound(ranges->begin(), ranges->end(), metadata.size,
+                                              [](const auto& entry, uint64_t size) { return entry.first < size; });
+                if (range == ranges->end()) return false;
+                bucket = range->second;
+                return true;
+            };
+        });
+    }
+
+    OperationResult BatchOperations::organize(const std::string& sourceDir, const std::string& destinationDir, const char* phaseName,
+                                              bool needsMetadata, const ClassifierFactory& makeClassifier) {
+        ScopedPhase phase(phaseName);
+        auto batch = openBatch(0);
+
+        OperationResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.filesSkipped = 0;
+
+        try {
+            std::error_code ec;
+            if (!fs::is_directory(sourceDir, ec)) {
+                throw fs::filesystem_error("source is not a directory", sourceDir, ec);
+            }
+
+            // Classify everything first, then move; the plan also gives the progress total
+            OrganizePlan plan;
+            planOrganize(sourceDir, needsMetadata, makeClassifier, plan, result);
+            size_t planned = 0;
+            for (const auto& files : plan.bucketFiles) planned += files.size();
+            batch->progress.setTotal(planned);
+            executeOrganizePlan(*batch, plan, sourceDir, destinationDir, result);
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.message = "Error organizing files: " + std::string(e.what());
+        }
+
+        closeBatch(batch);
+        return result;
+    }
+
+    void BatchOperations::planOrganize(const std::string& sourceDir, bool needsMetadata, const ClassifierFactory& makeClassifier,
+                                       OrganizePlan& plan, OperationResult& result) const {
+        // One listing of the top level; subdirectories are not descended into
+        std::vector<EntryType> types;
+        DirectoryWalker walker(plannerOptions(false));
+        walker.walk(sourceDir, [&](size_t, const WalkEntry& entry) {
+            if (entry.type == EntryType::Directory) return;
+            if (!needsMetadata && entry.type == EntryType::Other) return;
+            std::string_view name = entry.name();
+            plan.files.emplace_back(plan.names.size(), name.size());
+            plan.names.append(name);
+            plan.names += '\0';
+            types.push_back(entry.type);
+        });
+        if (plan.files.empty()) return;
+
+        OpenDirectory source(sourceDir);
+        if (!source.isOpen()) {
+            throw fs::filesystem_error("cannot open directory", sourceDir, std::error_code(errno, std::generic_category()));
+        }
+
+        // One stat per file at most, in parallel slices, each with its own
+        // classifier and bucket table
+        auto classifySlice = [&](size_t begin, size_t end, SliceBuckets& slice) {
+            BucketClassifier classify = makeClassifier();
+            std::string name;
+            std::string bucket;
+            for (size_t i = begin; i < end; ++i) {
+                const char* cname = plan.names.data() + plan.files[i].first;
+                EntryMetadata metadata;
+                if (needsMetadata || types[i] != EntryType::Regular) {
+                    if (!source.stat(cname, metadata)) {
+                        slice.skipped++;
+                        slice.errors.push_back("Cannot read " + source.pathOf(cname).string());
+                        continue;
+                    }
+                    if (!metadata.isRegularFile) continue;
+                }
+
+                name.assign(cname, plan.files[i].second);
+                if (!classify(name, metadata, bucket)) {
+                    slice.skipped++;
+                    continue;
+                }
+                if (!isContainedBucket(bucket)) {
+                    slice.skipped++;
+                    slice.errors.push_back("Invalid target directory \"" + bucket + "\" for " + name);
+                    continue;
+                }
+
+                auto found = slice.index.try_emplace(bucket, slice.names.size());
+                if (found.second) {
+                    slice.names.push_back(bucket);
+                    slice.files.emplace_back();
+                }
+                slice.files[found.first->second].push_back(i);
+            }
+        };
+
+        size_t fileCount = plan.files.size();
+        size_t sliceCount = std::min(ThreadPool::defaultThreadCount(), (fileCount + ClassifySliceSize - 1) / ClassifySliceSize);
+        std::vector<SliceBuckets> slices(sliceCount);
+        if (sliceCount == 1) {
+            classifySlice(0, fileCount, slices[0]);
+        } else {
+            ThreadPool pool(sliceCount);
+            std::vector<std::future<void>> pending;
+            for (size_t s = 0; s < sliceCount; ++s) {
+                size_t begin = fileCount * s / sliceCount;
+                size_t end = fileCount * (s + 1) / sliceCount;
+                pending.push_back(pool.submit([&, s, begin, end]() { classifySlice(begin, end, slices[s]); }));
+            }
+            for (auto& task : pending) task.get();
+        }
+
+        // Merge in slice order so buckets (and files in them) keep listing order
+        std::unordered_map<std::string, size_t> index;
+        for (auto& slice : slices) {
+            for (size_t b = 0; b < slice.names.size(); ++b) {
+                auto found = index.try_emplace(slice.names[b], plan.buckets.size());
+                if (found.second) {
+                    plan.buckets.push_back(std::move(slice.names[b]));
+                    plan.bucketFiles.emplace_back();
+                }
+                auto& files = plan.bucketFiles[found.first->second];
+                files.insert(files.end(), slice.files[b].begin(), slice.files[b].end());
+            }
+            result.filesSkipped += slice.skipped;
+            for (auto& error : slice.errors) result.errors.push_back(std::move(error));
+        }
+    }
+
+    void BatchOperations::executeOrganizePlan(BatchContext& batch, const OrganizePlan& plan, const std::string& sourceDir,
+                                              const std::string& destinationDir, OperationResult& result) {
+        if (plan.buckets.empty()) return;
+        fs::create_directories(destinationDir);
+
+        // Every bucket is created once up front, so the movers only open them
+        std::vector<std::unique_ptr<NameRegistry>> registries(plan.buckets.size());
+        std::vector<BucketMove> moves;
+        for (size_t b = 0; b < plan.buckets.size(); ++b) {
+            size_t count = plan.bucketFiles[b].size();
+            std::error_code ec;
+            fs::path bucketPath = fs::path(destinationDir) / plan.buckets[b];
+            fs::create_directories(bucketPath, ec);
+            if (ec) {
+                result.filesSkipped += count;
+                result.errors.push_back("Error creating " + bucketPath.string() + ": " + ec.message());
+                batch.progress.advance(count);
+                continue;
+            }
+            registries[b] = std::make_unique<NameRegistry>(bucketPath.string());
+            for (size_t begin = 0; begin < count; begin += MoveSliceSize) {
+                moves.push_back({b, begin, std::min(count, begin + MoveSliceSize), registries[b].get()});
+            }
+        }
+        if (moves.empty()) return;
+
+        auto runMove = [&](const BucketMove& move) {
+            OperationResult part;
+            part.success = true;
+            part.filesProcessed = 0;
+            part.filesSkipped = 0;
+            moveIntoBucket(batch, plan, move, sourceDir, destinationDir, part);
+            return part;
+        };
+
+        std::vector<OperationResult> parts;
+        if (moves.size() == 1) {
+            parts.push_back(runMove(moves[0]));
+        } else {
+            ThreadPool pool(std::min(ThreadPool::defaultThreadCount(), moves.size()));
+            std::vector<std::future<OperationResult>> pending;
+            for (const auto& move : moves) {
+                pending.push_back(pool.submit([&runMove, move]() { return runMove(move); }));
+            }
+            for (auto& task : pending) parts.push_back(task.get());
+        }
+
+        for (auto& part : parts) {
+            result.filesProcessed += part.filesProcessed;
+            result.filesSkipped += part.filesSkipped;
+            for (auto& error : part.errors) result.errors.push_back(std::move(error));
+            if (!part.success) {
+                result.success = false;
+                result.message = part.message;
+            }
+        }
+    }
+
+    void BatchOperations::moveIntoBucket(BatchContext& batch, const OrganizePlan& plan, const BucketMove& move, const std::string& sourceDir,
+                                         const std::string& destinationDir, OperationResult& result) {
+        const std::string& bucket = plan.buckets[move.bucket];
+        const auto& members = plan.bucketFiles[move.bucket];
+        OpenDirectory source(sourceDir);
+        OpenDirectory target((fs::path(destinationDir) / bucket).string());
+        if (!source.isOpen() || !target.isOpen()) {
+            size_t count = move.end - move.begin;
+            result.filesSkipped += count;
+            result.errors.push_back("Cannot open " + (source.isOpen() ? target.pathOf("") : source.pathOf("")).string());
+            batch.progress.advance(count);
+            return;
+        }
+
+        // After one EXDEV the rest of the slice goes straight to the copy path
+        bool crossDevice = false;
+        const char* name = nullptr;
+        auto place = [&](const char* targetName) {
+            if (!crossDevice) {
+                std::error_code ec = source.renameInto(name, target, targetName);
+                if (ec != std::errc::cross_device_link) return ec;
+                crossDevice = true;
+            }
+            return copyAcrossDevices(source.pathOf(name), target.pathOf(targetName), batch);
+        };
+
+        std::string uniqueName;
+        for (size_t i = move.begin; i < move.end; ++i) {
+            if (!batch.shouldContinue()) {
+                result.success = false;
+                result.message = batch.cancellation.describe();
+                break;
+            }
+
+            // Names are unique in the source, so only a bucket that already
+            // held files can collide; the registry is not touched until then
+            const auto& [offset, length] = plan.files[members[i]];
+            name = plan.names.data() + offset;
+            std::error_code ec = place(name);
+            if (ec == std::errc::file_exists) {
+                std::string fileName(name, length);
+                uniqueName = move.names->reclaim(fileName, fileName);
+                ec = placeUnique(*move.names, fileName, uniqueName, [&](const std::string& candidate) {
+                    return place(candidate.c_str());
+                });
+                if (ec) move.names->release(uniqueName);
+            }
+            if (ec == std::errc::operation_canceled) {
+                result.success = false;
+                result.message = batch.cancellation.describe();
+                break;
+            }
+            if (ec) {
+                result.errors.push_back("Error moving " + source.pathOf(name).string() + ": " + ec.message());
+                result.filesSkipped++;
+            } else {
+                batch.pace(0);
+                result.filesProcessed++;
+            }
+
+            batch.advance(source.pathOf(name).string());
+        }
+    }
+
+    OperationResult BatchOperations::renameFiles(const std::vector<std::string>& files, const std::string& newPattern) {
+        ScopedPhase phase("batch.rename");
+        RenamePlan plan;
+        std::unordered_map<std::string, size_t> directoryIndex;
+        for (const auto& file : files) {
+            fs::path path(file);
+            if (!path.has_filename()) path = path.parent_path();
+            std::string directory = path.parent_path().string();
+            if (directory.empty()) directory = ".";
+            auto [it, added] = directoryIndex.emplace(directory, plan.directories.size());
+            if (added) plan.directories.push_back(directory);
+            plan.entries.push_back({it->second, path.filename().string(), std::string(), std::string()});
+        }
+
+        // One listing per directory, however many of its files are renamed
+        plan.names.resize(plan.directories.size());
+        for (size_t d = 0; d < plan.directories.size(); ++d) {
+            std::error_code ec;
+            if (!fs::is_directory(plan.directories[d], ec)) continue;
+            DirectoryWalker walker(plannerOptions(false));
+            walker.walk(plan.directories[d], [&](size_t, const WalkEntry& entry) {
+                plan.names[d].emplace(entry.name());
+            });
+        }
+        return renameBatch(plan, "*", newPattern);
+    }
+
+    OperationResult BatchOperations::renameFilesByPattern(const std::string& directory, const std::string& oldPattern,
+                                                          const std::string& newPattern) {
+        ScopedPhase phase("batch.renameByPattern");
+        std::error_code ec;
+        if (!fs::is_directory(directory, ec)) {
+            OperationResult result;
+            result.success = false;
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Error finding files: cannot open directory " + directory;
+            return result;
+        }
+
+        RenamePlan plan;
+        plan.directories.push_back(directory);
+        plan.names.emplace_back();
+        GlobPattern glob(oldPattern);
+        DirectoryWalker walker(plannerOptions(false));
+        walker.walk(directory, [&](size_t, const WalkEntry& entry) {
+            std::string name(entry.name());
+            if (glob.matches(name) && isRegularEntry(entry)) {
+                plan.entries.push_back({0, name, std::string(), std::string()});
+            }
+            plan.names[0].emplace(std::move(name));
+        });
+        // Listing order is arbitrary; {n} counts in name order
+        std::sort(plan.entries.begin(), plan.entries.end(),
+                  [](const RenamePlan::Entry& a, const RenamePlan::Entry& b) { return a.from < b.from; });
+        return renameBatch(plan, oldPattern, newPattern);
+    }
+
+    OperationResult BatchOperations::addPrefix(const std::vector<std::string>& files, const std::string& prefix) {
+        return renameFiles(files, RenameTemplate::literal(prefix) + "{file}");
+    }
+
+    OperationResult BatchOperations::addSuffix(const std::vector<std::string>& files, const std::string& suffix) {
+        // Before the extension: report.csv -> report_old.csv
+        return renameFiles(files, "{name}" + RenameTemplate::literal(suffix) + "{ext}");
+    }
+
+    OperationResult BatchOperations::renameBatch(RenamePlan& plan, const std::string& sourcePattern, const std::string& newPattern) {
+        auto batch = openBatch(plan.entries.size());
+
+        OperationResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.filesSkipped = 0;
+
+        try {
+            RenameTemplate compiled;
+            std::string error;
+            if (!RenameTemplate::compile(sourcePattern, newPattern, compiled, error)) {
+                result.success = false;
+                result.message = "Invalid rename template: " + error;
+            } else if (planRenames(plan, compiled, result)) {
+                executeRenamePlan(*batch, plan, result);
+            }
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.message = "Error renaming files: " + std::string(e.what());
+        }
+
+        closeBatch(batch);
+        return result;
+    }
+
+    bool BatchOperations::planRenames(RenamePlan& plan, RenameTemplate& compiled, OperationResult& result) const {
+        ScopedPhase phase("rename.plan");
+        using Stage = RenamePlan::Stage;
+        constexpr size_t None = static_cast<size_t>(-1);
+        std::vector<std::string> conflicts;
+
+        // New names, in batch order so {n} follows it
+        std::vector<std::unique_ptr<OpenDirectory>> opened(plan.directories.size());
+        RenameTemplate::Captures captures;
+        for (size_t i = 0; i < plan.entries.size(); ++i) {
+            auto& entry = plan.entries[i];
+            const std::string& directory = plan.directories[entry.directory];
+            if (!plan.names[entry.directory].count(entry.from)) {
+                result.filesSkipped++;
+                result.errors.push_back("File not found: " + (fs::path(directory) / entry.from).string());
+                continue;
+            }
+            if (!compiled.match(entry.from, captures)) {
+                result.filesSkipped++;
+                continue;
+            }
+
+            EntryMetadata metadata;
+            if (compiled.needsMetadata()) {
+                auto& open = opened[entry.directory];
+                if (!open) open = std::make_unique<OpenDirectory>(directory);
+                if (!open->stat(entry.from.c_str(), metadata)) {
+                    result.filesSkipped++;
+                    result.errors.push_back("Cannot read metadata: " + (fs::path(directory) / entry.from).string());
+                    continue;
+                }
+            }
+            if (!compiled.expand(entry.from, captures, i, metadata.modifiedNs, metadata.size, entry.to) ||
+                !isPlainName(entry.to)) {
+                conflicts.push_back("Invalid new name \"" + entry.to + "\" for " + entry.from);
+                entry.to.clear();
+                continue;
+            }
+            if (entry.to == entry.from) {
+                entry.to.clear();
+                result.filesSkipped++;
+            }
+        }
+
+        // Collisions and order, per directory. Sources are distinct and so
+        // are targets, so the renames form chains (ending in a free name) and
+        // cycles; each chain runs from its free end backwards.
+        std::vector<size_t> order(plan.entries.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&plan](size_t a, size_t b) {
+            return plan.entries[a].directory < plan.entries[b].directory;
+        });
+
+        std::vector<size_t> predecessor(plan.entries.size(), None);   // The rename into this one's old name
+        std::vector<char> blocked(plan.entries.size(), 0);            // Its new name is still someone's old name
+        std::vector<char> placed(plan.entries.size(), 0);
+        std::unordered_map<std::string_view, size_t> sources;
+        std::unordered_map<std::string_view, size_t> targets;
+        for (size_t begin = 0; begin < order.size();) {
+            size_t directory = plan.entries[order[begin]].directory;
+            size_t end = begin;
+            while (end < order.size() && plan.entries[order[end]].directory == directory) ++end;
+            const auto& names = plan.names[directory];
+
+            sources.clear();
+            targets.clear();
+            sources.reserve(end - begin);
+            targets.reserve(end - begin);
+            for (size_t k = begin; k < end; ++k) {
+                const auto& entry = plan.entries[order[k]];
+                if (!entry.to.empty()) sources.emplace(entry.from, order[k]);
+            }
+            for (size_t k = begin; k < end; ++k) {
+                size_t i = order[k];
+                const auto& entry = plan.entries[i];
+                if (entry.to.empty()) continue;
+                auto [claimed, added] = targets.emplace(entry.to, i);
+                auto source = sources.find(entry.to);
+                if (!added) {
+                    conflicts.push_back(plan.entries[claimed->second].from + " and " + entry.from +
+                                        " would both be renamed to " + entry.to);
+                } else if (source != sources.end()) {
+                    predecessor[source->second] = i;
+                    blocked[i] = 1;
+                } else if (names.count(entry.to)) {
+                    conflicts.push_back(entry.from + " would be renamed to " + entry.to + ", which already exists");
                 }
             }
-            
-            // Copy files
-            if (recursive) {
-                copyDirectoryRecursive(sourceDir, destinationDir, result);
-            } else {
-                copyDirectoryNonRecursive(sourceDir, destinationDir, result);
+            if (!conflicts.empty()) {
+                begin = end;
+                continue;
             }
-        } catch (const std::exception& e) {
-            result.success = false;
-            result.message = "Error in directory copy operation: " + std::string(e.what());
-        }
-        
-        operationInProgress = false;
-        return result;
-    }
 
-    void BatchOperations::copyDirectoryRecursive(const std::string& sourceDir, const std::string& destinationDir, OperationResult& result) {
-        try {
-            for (const auto& entry : fs::recursive_directory_iterator(sourceDir)) {
-                if (!shouldContinue()) {
-                    result.success = false;
-                    result.message = "Operation cancelled";
-                    break;
+            for (size_t k = begin; k < end; ++k) {
+                size_t i = order[k];
+                if (plan.entries[i].to.empty() || blocked[i]) continue;
+                plan.chains.push_back(plan.steps.size());
+                for (size_t j = i; j != None; j = predecessor[j]) {
+                    plan.steps.emplace_back(j, Stage::Direct);
+                    placed[j] = 1;
                 }
-                
-                if (fs::is_regular_file(entry)) {
-                    try {
-                        fs::path sourcePath = entry.path();
-                        fs::path relativePath = fs::relative(sourcePath, sourceDir);
-                        fs::path destPath = fs::path(destinationDir) / relativePath;
-                        
-                        fs::create_directories(destPath.parent_path());
-                        fs::copy_file(sourcePath, destPath, fs::copy_options::overwrite_existing);
-                        result.filesProcessed++;
-                    } catch (const std::exception& e) {
-                        result.filesSkipped++;
-                        result.errors.push_back("Error copying " + entry.path().string() + ": " + e.what());
-                    }
+            }
+
+            // What is left goes round in cycles: park one member under a
+            // name nothing uses, run the rest, then land it
+            size_t temporaryCount = 0;
+            for (size_t k = begin; k < end; ++k) {
+                size_t i = order[k];
+                if (plan.entries[i].to.empty() || placed[i]) continue;
+                auto& parked = plan.entries[i];
+                do {
+                    parked.temporary = ".fsm-rename-" + std::to_string(temporaryCount++);
+                } while (names.count(parked.temporary) || targets.count(parked.temporary));
+                Instrumentation::add(Counter::RenameCycles);
+
+                plan.chains.push_back(plan.steps.size());
+                plan.steps.emplace_back(i, Stage::ToTemporary);
+                placed[i] = 1;
+                for (size_t j = predecessor[i]; j != i; j = predecessor[j]) {
+                    plan.steps.emplace_back(j, Stage::Direct);
+                    placed[j] = 1;
                 }
-                
-                processedFiles++;
-                updateProgress(processedFiles, entry.path().string());
+                plan.steps.emplace_back(i, Stage::FromTemporary);
             }
-        } catch (const std::exception& e) {
+            begin = end;
+        }
+
+        if (!conflicts.empty()) {
             result.success = false;
-            result.message = "Error in recursive directory copy: " + std::string(e.what());
+            result.message = std::to_string(conflicts.size()) + " rename conflict(s); nothing was renamed";
+            result.errors.insert(result.errors.end(), conflicts.begin(), conflicts.end());
+            return false;
         }
+        return true;
     }
 
-    void BatchOperations::copyDirectoryNonRecursive(const std::string& sourceDir, const std::string& destinationDir, OperationResult& result) {
-        try {
-            for (const auto& entry : fs::directory_iterator(sourceDir)) {
-                if (!shouldContinue()) {
+    void BatchOperations::executeRenamePlan(BatchContext& batch, const RenamePlan& plan, OperationResult& result) {
+        ScopedPhase phase("rename.execute");
+        using Stage = RenamePlan::Stage;
+        if (plan.steps.empty()) {
+            result.message = "Nothing to rename";
+            return;
+        }
+
+        // The journal comes first: no rename happens that could not be undone
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        char journalName[48];
+        std::snprintf(journalName, sizeof(journalName), "%020lld.journal",
+                      static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()));
+        std::string journalPath = (fs::path(renameJournalDirectory()) / journalName).string();
+        RenameJournal journal;
+        std::string error;
+        if (!journal.create(journalPath, error)) {
+            result.success = false;
+            result.message = "Cannot create rename journal " + journalPath + ": " + error;
+            return;
+        }
+
+        std::vector<std::string> absoluteDirectories;
+        std::vector<std::unique_ptr<OpenDirectory>> opened;
+        for (const auto& directory : plan.directories) {
+            absoluteDirectories.push_back(fs::absolute(directory).lexically_normal().string());
+            opened.push_back(std::make_unique<OpenDirectory>(directory));
+        }
+
+        size_t recorded = 0;
+        bool journalFailed = false;
+        for (size_t chain = 0; chain < plan.chains.size() && !journalFailed; ++chain) {
+            // Stop between chains only, never with a cycle half done
+            if (!batch.shouldContinue()) {
+                result.success = false;
+                result.message = batch.cancellation.describe();
+                break;
+            }
+            size_t last = chain + 1 < plan.chains.size() ? plan.chains[chain + 1] : plan.steps.size();
+            for (size_t s = plan.chains[chain]; s < last; ++s) {
+                const auto& [index, stage] = plan.steps[s];
+                const auto& entry = plan.entries[index];
+                const char* from = stage == Stage::FromTemporary ? entry.temporary.c_str() : entry.from.c_str();
+                const char* to = stage == Stage::ToTemporary ? entry.temporary.c_str() : entry.to.c_str();
+
+                // In the journal before it happens, so a batch that dies part
+                // way leaves every rename it did there to be undone
+                if (!journal.record(absoluteDirectories[entry.directory], from, to)) {
+                    journalFailed = true;
                     result.success = false;
-                    result.message = "Operation cancelled";
+                    result.message = "Cannot write rename journal " + journalPath +
+                                     "; stopped, batch undo-rename reverts the renames done";
                     break;
                 }
-                
-                if (fs::is_regular_file(entry)) {
-                    try {
-                        fs::path sourcePath = entry.path();
-                        fs::path destPath = fs::path(destinationDir) / sourcePath.filename();
-                        
-                        fs::copy_file(sourcePath, destPath, fs::copy_options::overwrite_existing);
-                        result.filesProcessed++;
-                    } catch (const std::exception& e) {
-                        result.filesSkipped++;
-                        result.errors.push_back("Error copying " + entry.path().string() + ": " + e.what());
-                    }
+
+                // Never replaces: if an earlier step failed, whatever it would
+                // have freed is still there and the next one stops on EEXIST
+                std::error_code ec = opened[entry.directory]->renameInto(from, *opened[entry.directory], to);
+                if (ec && !journal.retract()) {
+                    result.errors.push_back("Rename journal " + journalPath + " lists a rename that failed");
+                }
+                if (ec) {
+                    std::string path = opened[entry.directory]->pathOf(from).string();
+                    std::string message = "Error renaming " + path + " to " + to + ": " + ec.message();
+                    if (stage == Stage::FromTemporary) message += " (left as " + entry.temporary + ")";
+                    result.errors.push_back(message);
+                    if (stage != Stage::FromTemporary) result.filesSkipped++;
+                } else {
+                    recorded++;
+                    if (stage != Stage::ToTemporary) result.filesProcessed++;
+                }
+                if (stage != Stage::ToTemporary) {
+                    batch.advance(entry.from);
                 }
-                
-                processedFiles++;
-                updateProgress(processedFiles, entry.path().string());
             }
-        } catch (const std::exception& e) {
-            result.success = false;
-            result.message = "Error in directory copy: " + std::string(e.what());
+            // Paced per chain, so a cycle is not held half done
+            batch.pace(0, last - plan.chains[chain]);
         }
-    }
 
-    OperationResult BatchOperations::copyFilesByPattern(const std::string& sourceDir, const std::string& pattern, const std::string& destinationDir) {
-        std::vector<std::string> matchingFiles;
-        
-        try {
-            for (const auto& entry : fs::directory_iterator(sourceDir)) {
-                if (fs::is_regular_file(entry)) {
-                    std::string fileName = entry.path().filename().string();
-                    if (matchesPattern(fileName, pattern)) {
-                        matchingFiles.push_back(entry.path().string());
-                    }
-                }
-            }
-        } catch (const std::exception& e) {
-            OperationResult result;
-            result.success = false;
-            result.message = "Error finding files: " + std::string(e.what());
-            return result;
+        bool journalWritten = journal.close();
+        std::error_code ignored;
+        if (recorded == 0) {
+            fs::remove(journalPath, ignored);
+        } else if (!journalWritten) {
+            result.errors.push_back("Rename journal " + journalPath + " is incomplete; undo may miss renames");
+        }
+        if (result.message.empty()) {
+            result.message = "Renamed " + std::to_string(result.filesProcessed) + " file(s)";
+            if (recorded > 0) result.message += "; journal " + journalPath;
         }
-        
-        return copyFiles(matchingFiles, destinationDir);
     }
 
-    OperationResult BatchOperations::moveFiles(const std::vector<std::string>& sourceFiles, const std::string& destinationDir) {
-        operationInProgress = true;
-        processedFiles = 0;
-        totalFiles = sourceFiles.size();
-        
+    OperationResult BatchOperations::undoRename(const std::string& journalPath) {
+        ScopedPhase phase("batch.undoRename");
+        auto batch = openBatch(0);
+
         OperationResult result;
         result.success = true;
         result.filesProcessed = 0;
         result.filesSkipped = 0;
-        
-        try {
-            fs::create_directories(destinationDir);
-            
-            for (const auto& sourceFile : sourceFiles) {
-                if (!shouldContinue()) {
+
+        std::string path = journalPath.empty() ? newestRenameJournal() : journalPath;
+        std::vector<JournalRecord> records;
+        std::string error;
+        if (path.empty()) {
+            result.success = false;
+            result.message = "No rename journal in " + renameJournalDirectory();
+        } else if (!readRenameJournal(path, records, error)) {
+            result.success = false;
+            result.message = "Cannot undo renames: " + error;
+        } else {
+            batch->progress.setTotal(records.size());
+
+            // Backwards, so cycles unwind through their temporary names again
+            std::unordered_map<std::string, std::unique_ptr<OpenDirectory>> opened;
+            std::vector<JournalRecord> remaining;
+            size_t undone = records.size();
+            while (undone > 0) {
+                if (!batch->shouldContinue()) {
                     result.success = false;
-                    result.message = "Operation cancelled";
+                    result.message = batch->cancellation.describe();
                     break;
                 }
-                
-                try {
-                    fs::path sourcePath(sourceFile);
-                    fs::path destPath = fs::path(destinationDir) / sourcePath.filename();
-                    
-                    if (fs::exists(sourcePath) && fs::is_regular_file(sourcePath)) {
-                        if (fs::exists(destPath)) {
-                            destPath = generateUniqueFileName(destinationDir, sourcePath.filename().string());
-                        }
-                        
-                        fs::rename(sourcePath, destPath);
-                        result.filesProcessed++;
-                    } else {
-                        result.filesSkipped++;
-                        result.errors.push_back("File not found or not a regular file: " + sourceFile);
-                    }
-                } catch (const std::exception& e) {
+                const auto& record = records[undone - 1];
+                auto& directory = opened[record.directory];
+                if (!directory) directory = std::make_unique<OpenDirectory>(record.directory);
+                std::error_code ec = directory->renameInto(record.to.c_str(), *directory, record.from.c_str());
+                if (ec) {
                     result.filesSkipped++;
-                    result.errors.push_back("Error moving " + sourceFile + ": " + e.what());
+                    result.errors.push_back("Error renaming " + directory->pathOf(record.to.c_str()).string() +
+                                            " back to " + record.from + ": " + ec.message());
+                    remaining.push_back(record);
+                } else {
+                    batch->pace(0);
+                    result.filesProcessed++;
                 }
-                
-                processedFiles++;
-                updateProgress(processedFiles, sourceFile);
+                undone--;
+                batch->advance(record.from);
+            }
+
+            // Keep whatever was not undone, so undo can be run again
+            remaining.insert(remaining.end(), records.begin(), records.begin() + undone);
+            std::reverse(remaining.begin(), remaining.end());
+            std::error_code ec;
+            if (remaining.empty()) {
+                fs::remove(path, ec);
+            } else if (!writeRenameJournal(path, remaining)) {
+                result.errors.push_back("Cannot update rename journal " + path);
+            }
+            if (result.message.empty()) {
+                result.message = "Undid " + std::to_string(result.filesProcessed) + " rename(s) from " + path;
             }
-        } catch (const std::exception& e) {
-            result.success = false;
-            result.message = "Error creating destination directory: " + std::string(e.what());
         }
-        
-        operationInProgress = false;
+
+        closeBatch(batch);
         return result;
     }
 
-    OperationResult BatchOperations::moveFilesByPattern(const std::string& sourceDir, const std::string& pattern, const std::string& destinationDir) {
-        std::vector<std::string> matchingFiles;
-        
-        try {
-            for (const auto& entry : fs::directory_iterator(sourceDir)) {
-                if (fs::is_regular_file(entry)) {
-                    std::string fileName = entry.path().filename().string();
-                    if (matchesPattern(fileName, pattern)) {
-                        matchingFiles.push_back(entry.path().string());
-                    }
-                }
-            }
-        } catch (const std::exception& e) {
+    OperationResult BatchOperations::convertTextEncoding(const std::vector<std::string>& files, const std::string& fromEncoding,
+                                                         const std::string& toEncoding) {
+        Charset from;
+        Charset to;
+        if (!parseCharset(fromEncoding, true, from) || !parseCharset(toEncoding, false, to)) {
             OperationResult result;
             result.success = false;
-            result.message = "Error finding files: " + std::string(e.what());
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Unknown encoding: " + (parseCharset(fromEncoding, true, from) ? toEncoding : fromEncoding) +
+                             " (use UTF-8, UTF-16, UTF-16LE, UTF-16BE or Latin-1; auto as the source)";
             return result;
         }
-        
-        return moveFiles(matchingFiles, destinationDir);
+        return rewriteTextFiles(files, "batch.convertTextEncoding", TextTransform::charsets(from, to));
     }
 
-    OperationResult BatchOperations::deleteFiles(const std::vector<std::string>& files) {
-        operationInProgress = true;
-        processedFiles = 0;
-        totalFiles = files.size();
-        
-        OperationResult result;
-        result.success = true;
-        result.filesProcessed = 0;
-        result.filesSkipped = 0;
+    OperationResult BatchOperations::normalizeLineEndings(const std::vector<std::string>& files, const std::string& targetLineEnding) {
+        LineEnding ending;
+        if (!parseLineEnding(targetLineEnding, ending)) {
+            OperationResult result;
+            result.success = false;
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Unknown line ending: " + targetLineEnding + " (use LF, CRLF or CR)";
+            return result;
+        }
+        return rewriteTextFiles(files, "batch.normalizeLineEndings", TextTransform::lineEndings(ending));
+    }
+
+    OperationResult BatchOperations::convertTextEncodingByPattern(const std::string& directory, const std::string& pattern,
+                                                                  const std::string& fromEncoding, const std::string& toEncoding) {
+        std::vector<std::string> matchingFiles;
         
-        for (const auto& file : files) {
-            if (!shouldContinue()) {
-                result.success = false;
-                result.message = "Operation cancelled";
-                break;
-            }
-            
-            try {
-                fs::path filePath(file);
-                if (fs::exists(filePath)) {
-                    if (fs::is_regular_file(filePath)) {
-                        fs::remove(filePath);
-                        result.filesProcessed++;
-                    } else if (fs::is_directory(filePath)) {
-                        fs::remove_all(filePath);
-                        result.filesProcessed++;
-                    } else {
-                        result.filesSkipped++;
-                        result.errors.push_back("Unknown file type: " + file);
-                    }
-                } else {
-                    result.filesSkipped++;
-                    result.errors.push_back("File not found: " + file);
-                }
-            } catch (const std::exception& e) {
-                result.filesSkipped++;
-                result.errors.push_back("Error deleting " + file + ": " + e.what());
-            }
-            
-            processedFiles++;
-            updateProgress(processedFiles, file);
+        if (!collectMatchingFiles(directory, pattern, matchingFiles)) {
+            OperationResult result;
+            result.success = false;
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Error finding files: cannot open directory " + directory;
+            return result;
         }
         
-        operationInProgress = false;
-        return result;
+        return convertTextEncoding(matchingFiles, fromEncoding, toEncoding);
     }
 
-    OperationResult BatchOperations::deleteFilesByPattern(const std::string& directory, const std::string& pattern) {
+    OperationResult BatchOperations::normalizeLineEndingsByPattern(const std::string& directory, const std::string& pattern,
+                                                                   const std::string& targetLineEnding) {
         std::vector<std::string> matchingFiles;
         
-        try {
-            for (const auto& entry : fs::directory_iterator(directory)) {
-                if (fs::is_regular_file(entry)) {
-                    std::string fileName = entry.path().filename().string();
-                    if (matchesPattern(fileName, pattern)) {
-                        matchingFiles.push_back(entry.path().string());
-                    }
-                }
-            }
-        } catch (const std::exception& e) {
+        if (!collectMatchingFiles(directory, pattern, matchingFiles)) {
             OperationResult result;
             result.success = false;
-            result.message = "Error finding files: " + std::string(e.what());
+            result.filesProcessed = 0;
+            result.filesSkipped = 0;
+            result.message = "Error finding files: cannot open directory " + directory;
             return result;
         }
         
-        return deleteFiles(matchingFiles);
+        return normalizeLineEndings(matchingFiles, targetLineEnding);
     }
 
-    OperationResult BatchOperations::deleteEmptyDirectories(const std::string& directory, bool recursive) {
-        operationInProgress = true;
-        processedFiles = 0;
-        totalFiles = 0;
-        
+    OperationResult BatchOperations::rewriteTextFiles(const std::vector<std::string>& files, const char* phaseName,
+                                                      const TextTransform& prototype) {
+        ScopedPhase phase(phaseName);
+        auto batch = openBatch(files.size());
+
         OperationResult result;
         result.success = true;
         result.filesProcessed = 0;
         result.filesSkipped = 0;
-        
-        try {
-            if (recursive) {
-                deleteEmptyDirectoriesRecursive(directory, result);
-            } else {
-                deleteEmptyDirectoriesNonRecursive(directory, result);
-            }
-        } catch (const std::exception& e) {
-            result.success = false;
-            result.message = "Error in empty directory deletion: " + std::string(e.what());
-        }
-        
-        operationInProgress = false;
-        return result;
-    }
 
-    void BatchOperations::deleteEmptyDirectoriesRecursive(const std::string& directory, OperationResult& result) {
-        try {
-            for (const auto& entry : fs::recursive_directory_iterator(directory)) {
-                if (!shouldContinue()) {
-                    result.success = false;
-                    result.message = "Operation cancelled";
+        // Workers take the next file from a shared index and keep their
+        // buffers; outcomes are kept per file so errors come out in order
+        std::vector<RewriteOutcome> outcomes(files.size());
+        std::atomic<size_t> nextFile(0);
+        std::atomic<bool> cancelled(false);
+        auto work = [&]() {
+            RewriteBuffers buffers;
+            for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+                if (!batch->shouldContinue()) {
+                    cancelled = true;
                     break;
                 }
-                
-                if (fs::is_directory(entry)) {
-                    try {
-                        if (fs::is_empty(entry)) {
-                            fs::remove(entry);
-                            result.filesProcessed++;
-                        }
-                    } catch (const std::exception& e) {
-                        result.filesSkipped++;
-                        result.errors.push_back("Error deleting empty directory " + entry.path().string() + ": " + e.what());
-                    }
+                TextTransform transform = prototype;
+                try {
+                    outcomes[i] = rewriteTextFile(files[i], transform, buffers, *batch);
+                } catch (const std::exception& e) {
+                    outcomes[i].status = RewriteStatus::Failed;
+                    outcomes[i].message = "Error rewriting " + files[i] + ": " + e.what();
                 }
-                
-                processedFiles++;
-                updateProgress(processedFiles, entry.path().string());
+                if (outcomes[i].status == RewriteStatus::NotRun) {
+                    cancelled = true;
+                    break;
+                }
+                batch->advance(files[i]);
             }
-        } catch (const std::exception& e) {
+        };
+
+        size_t workers = std::min(ThreadPool::defaultThreadCount(), files.size());
+        if (workers <= 1) {
+            work();
+        } else {
+            ThreadPool pool(workers);
+            std::vector<std::future<void>> pending;
+            for (size_t w = 0; w < workers; ++w) {
+                pending.push_back(pool.submit(work));
+            }
+            for (auto& task : pending) task.get();
+        }
+
+        for (auto& outcome : outcomes) {
+            switch (outcome.status) {
+                case RewriteStatus::NotRun:
+                    break;
+                case RewriteStatus::Rewritten:
+                    result.filesProcessed++;
+                    break;
+                case RewriteStatus::Conforming:
+                    result.filesSkipped++;
+                    break;
+                case RewriteStatus::Skipped:
+                case RewriteStatus::Failed:
+                    result.filesSkipped++;
+                    result.errors.push_back(std::move(outcome.message));
+                    break;
+            }
+        }
+        if (cancelled) {
             result.success = false;
-            result.message = "Error in recursive empty directory deletion: " + std::string(e.what());
+            result.message = batch->cancellation.describe();
         }
+
+        closeBatch(batch);
+        return result;
+    }
+
+    OperationResult BatchOperations::removeEmptyFiles(const std::string& directory, bool recursive) {
+        CleanupOptions options;
+        options.emptyFiles = true;
+        options.recursive = recursive;
+        return cleanup(directory, options);
+    }
+
+    OperationResult BatchOperations::cleanupTempFiles(const std::string& directory, const std::vector<std::string>& tempExtensions) {
+        CleanupOptions options;
+        options.extensions = tempExtensions;
+        return cleanup(directory, options);
     }
 
-    void BatchOperations::deleteEmptyDirectoriesNonRecursive(const std::string& directory, OperationResult& result) {
+    OperationResult BatchOperations::cleanup(const std::string& directory, const CleanupOptions& options) {
+        ScopedPhase phase("batch.cleanup");
+        auto batch = openBatch(0);
+
+        OperationResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.filesSkipped = 0;
+
         try {
-            for (const auto& entry : fs::directory_iterator(directory)) {
-                if (!shouldContinue()) {
-                    result.success = false;
-                    result.message = "Operation cancelled";
-                    break;
-                }
-                
-                if (fs::is_directory(entry)) {
-                    try {
-                        if (fs::is_empty(entry)) {
-                            fs::remove(entry);
-                            result.filesProcessed++;
-                        }
-                    } catch (const std::exception& e) {
-                        result.filesSkipped++;
-                        result.errors.push_back("Error deleting empty directory " + entry.path().string() + ": " + e.what());
+            std::error_code ec;
+            if (!fs::is_directory(directory, ec)) {
+                throw fs::filesystem_error("not a directory", directory, ec);
+            }
+
+            SuffixSet suffixes(options.extensions);
+            int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            // Clamped so the cutoff cannot overflow; the largest age reaches back ~292 years
+            int64_t ageSeconds = std::clamp<int64_t>(options.minimumAgeSeconds, 0, INT64_MAX / 1000000000LL);
+            int64_t cutoffNs = nowNs - ageSeconds * 1000000000LL;
+            std::mutex reportMutex;
+
+            // The walk itself stops listing once the batch is cancelled, and
+            // lists at the batch's I/O pace
+            WalkOptions walkOptions;
+            walkOptions.recursive = options.recursive;
+            walkOptions.cancellation = &batch->cancellation;
+            walkOptions.throttle = batch->throttle.get();
+            DirectoryWalker walker(walkOptions);
+            std::vector<CleanupTally> tallies(walker.getThreadCount());
+            walker.walk(directory, [&](size_t workerIndex, const WalkEntry& entry) {
+                if (entry.type != EntryType::Regular && entry.type != EntryType::Unknown) return;
+                bool temporary = !suffixes.empty() && suffixes.matches(entry.name());
+                if (!temporary && !options.emptyFiles) return;
+
+                // Candidates only: one lstat gives type, size and age
+                EntryMetadata metadata;
+                if (!DirectoryWalker::readMetadata(entry, metadata, false) || !metadata.isRegularFile) return;
+                if (!temporary && metadata.size != 0) return;
+                if (metadata.modifiedNs > cutoffNs) return;
+
+                CleanupTally& tally = tallies[workerIndex];
+                if (!options.dryRun) {
+#ifndef _WIN32
+                    bool removed = entry.directoryFd >= 0 ? ::unlinkat(entry.directoryFd, entry.node->nameData(), 0) == 0
+                                                          : ::unlink(entry.path().c_str()) == 0;
+                    std::error_code removeError = removed ? std::error_code() : std::error_code(errno, std::generic_category());
+#else
+                    std::error_code removeError;
+                    fs::remove(entry.path(), removeError);
+#endif
+                    if (removeError) {
+                        tally.failed++;
+                        tally.errors.push_back("Error removing " + entry.path() + ": " + removeError.message());
+                        return;
                     }
+                    batch->pace(0);
                 }
-                
-                processedFiles++;
-                updateProgress(processedFiles, entry.path().string());
+                tally.removed++;
+                tally.bytes += metadata.size;
+                batch->progress.advance(1, metadata.size);
+                if (options.onMatch) {
+                    std::string path = entry.path();
+                    std::lock_guard<std::mutex> lock(reportMutex);
+                    options.onMatch(path, metadata.size);
+                }
+                if (batch->progress.wantsName()) batch->progress.offerName(entry.path());
+            });
+
+            uint64_t bytes = 0;
+            for (auto& tally : tallies) {
+                result.filesProcessed += tally.removed;
+                result.filesSkipped += tally.failed;
+                bytes += tally.bytes;
+                result.errors.insert(result.errors.end(), std::make_move_iterator(tally.errors.begin()),
+                                     std::make_move_iterator(tally.errors.end()));
+            }
+            if (!batch->shouldContinue()) {
+                result.success = false;
+                result.message = batch->cancellation.describe();
+            } else {
+                result.message = std::string(options.dryRun ? "Would remove " : "Removed ") +
+                                 std::to_string(result.filesProcessed) + " file(s), " + formatFileSize(bytes);
             }
         } catch (const std::exception& e) {
             result.success = false;
-            result.message = "Error in empty directory deletion: " + std::string(e.what());
+            result.message = "Error cleaning up files: " + std::string(e.what());
         }
-    }
 
-    void BatchOperations::updateProgress(size_t current, const std::string& currentFile) {
-        if (progressCallback.callback) {
-            progressCallback.callback(current, totalFiles.load(), currentFile);
-        }
+        closeBatch(batch);
+        return result;
     }
 
-    bool BatchOperations::shouldContinue() const {
-        return !operationInProgress.load() || processedFiles.load() < totalFiles.load();
+    std::shared_ptr<BatchContext> BatchOperations::openBatch(size_t fileTotal) {
+        std::shared_ptr<BatchContext> batch = std::move(adoptedBatch);
+        adoptedBatch.reset();
+        if (!batch) batch = std::make_shared<BatchContext>();
+        {
+            std::lock_guard<std::mutex> lock(activeMutex);
+            batch->progress.setCallback(progressCallback, progressInterval);
+            batch->cancellation.setTimeout(timeout);
+            batch->throttle = throttle;
+            active.push_back(batch);
+        }
+        // Workers the batch starts inherit its I/O class
+        if (batch->throttle) batch->ioPriority = std::make_unique<ScopedIoPriority>(batch->throttle->getPriority());
+        batch->progress.begin(fileTotal);
+        return batch;
     }
 
-    std::string BatchOperations::generateUniqueFileName(const std::string& directory, const std::string& fileName) {
-        fs::path basePath = fs::path(directory) / fileName;
-        fs::path result = basePath;
-        
-        int counter = 1;
-        while (fs::exists(result)) {
-            std::string stem = basePath.stem().string();
-            std::string extension = basePath.extension().string();
-            result = basePath.parent_path() / (stem + "_" + std::to_string(counter) + extension);
-            counter++;
-        }
-        
-        return result.string();
+    void BatchOperations::closeBatch(const std::shared_ptr<BatchContext>& batch) {
+        batch->ioPriority.reset();
+        batch->progress.finish();
+        std::lock_guard<std::mutex> lock(activeMutex);
+        active.erase(std::find(active.begin(), active.end(), batch));
     }
 
     void BatchOperations::cancelOperation() {
-        operationInProgress = false;
+        std::lock_guard<std::mutex> lock(activeMutex);
+        for (const auto& batch : active) batch->cancel();
     }
 
     void BatchOperations::resetProgress() {
-        processedFiles = 0;
-        totalFiles = 0;
-        operationInProgress = false;
+        // Counters belong to their batches and go with them; all that is
+        // left to reset is whatever is still running
+        cancelOperation();
     }
 
-    std::future<OperationResult> BatchOperations::copyFilesAsync(const std::vector<std::string>& sourceFiles, const std::string& destinationDir) {
-        return std::async(std::launch::async, [this, sourceFiles, destinationDir]() {
-            return copyFiles(sourceFiles, destinationDir);
+    BatchHandle BatchOperations::start(std::function<OperationResult(BatchOperations&)> operation) {
+        auto context = std::make_shared<BatchContext>();
+        std::shared_future<OperationResult> outcome = std::async(std::launch::async, [this, context, operation = std::move(operation)]() {
+            adoptedBatch = context;
+            OperationResult result = operation(*this);
+            adoptedBatch.reset();
+            return result;
+        }).share();
+        return BatchHandle(std::move(context), std::move(outcome));
+    }
+
+    BatchHandle BatchOperations::copyFilesAsync(const std::vector<std::string>& sourceFiles, const std::string& destinationDir) {
+        return start([sourceFiles, destinationDir](BatchOperations& operations) {
+            return operations.copyFiles(sourceFiles, destinationDir);
         });
     }
 
-    std::future<OperationResult> BatchOperations::deleteFilesAsync(const std::vector<std::string>& files) {
-        return std::async(std::launch::async, [this, files]() {
-            return deleteFiles(files);
+    BatchHandle BatchOperations::deleteFilesAsync(const std::vector<std::string>& files) {
+        return start([files](BatchOperations& operations) {
+            return operations.deleteFiles(files);
         });
     }
 
 }
-
@@ -0,0 +1,184 @@
+#include "ByteScan.h"
+#include <cctype>
+#include <cstring>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define FSMANAGER_SSE2 1
+#endif
+
+namespace FileSystemManager {
+
+    namespace {
+
+        // Rough frequency order of bytes in source and text files, most common
+        // first; anything not listed is treated as rarer than all of these
+        const char CommonBytes[] = " etaoinsrhldcumfpgwybvkxjqzETAOINSRHLDCUMFPGWYBVKXJQZ\n\t_.,;()=\"'/-0123456789:*{}<>";
+
+        int byteRank(unsigned char byte) {
+            const char* found = std::strchr(CommonBytes, byte);
+            if (!found || byte == 0) return static_cast<int>(sizeof(CommonBytes));
+            return static_cast<int>(found - CommonBytes);
+        }
+
+    }
+
+    const char* findByte(const char* begin, const char* end, unsigned char byte) {
+        if (begin >= end) return nullptr;
+        return static_cast<const char*>(std::memchr(begin, byte, static_cast<size_t>(end - begin)));
+    }
+
+    const char* findLastByte(const char* begin, const char* end, unsigned char byte) {
+        if (begin >= end) return nullptr;
+#if defined(__GLIBC__)
+        return static_cast<const char*>(::memrchr(begin, byte, static_cast<size_t>(end - begin)));
+#else
+        for (const char* p = end; p > begin; --p) {
+            if (static_cast<unsigned char>(p[-1]) == byte) return p - 1;
+        }
+        return nullptr;
+#endif
+    }
+
+    const char* findEitherByte(const char* begin, const char* end, unsigned char a, unsigned char b) {
+        if (a == b) return findByte(begin, end, a);
+        const char* p = begin;
+#ifdef FSMANAGER_SSE2
+        const __m128i first = _mm_set1_epi8(static_cast<char>(a));
+        const __m128i second = _mm_set1_epi8(static_cast<char>(b));
+        for (; p + 16 <= end; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, first), _mm_cmpeq_epi8(chunk, second)));
+            if (mask != 0) {
+                return p + __builtin_ctz(static_cast<unsigned>(mask));
+            }
+        }
+#endif
+        for (; p < end; ++p) {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c == a || c == b) return p;
+        }
+        return nullptr;
+    }
+
+    size_t countByte(const char* begin, const char* end, unsigned char byte) {
+        size_t count = 0;
+        const char* p = begin;
+#ifdef FSMANAGER_SSE2
+        const __m128i needle = _mm_set1_epi8(static_cast<char>(byte));
+        for (; p + 16 <= end; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            count += static_cast<size_t>(__builtin_popcount(
+                static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)))));
+        }
+#endif
+        for (; p < end; ++p) {
+            if (static_cast<unsigned char>(*p) == byte) count++;
+        }
+        return count;
+    }
+
+    size_t countControlBytes(const char* begin, const char* end) {
+        auto isTextControl = [](unsigned char c) {
+            return c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v' || c == '\b' || c == 0x1b;
+        };
+        size_t count = 0;
+        const char* p = begin;
+#ifdef FSMANAGER_SSE2
+        const __m128i highestControl = _mm_set1_epi8(0x1f);
+        const __m128i allowed[] = {
+            _mm_set1_epi8('\t'), _mm_set1_epi8('\n'), _mm_set1_epi8('\r'), _mm_set1_epi8('\f'),
+            _mm_set1_epi8('\v'), _mm_set1_epi8('\b'), _mm_set1_epi8(0x1b)
+        };
+        for (; p + 16 <= end; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // Unsigned chunk <= 0x1f
+            __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, highestControl), chunk);
+            if (_mm_movemask_epi8(control) == 0) continue;
+            __m128i text = _mm_setzero_si128();
+            for (const auto& byte : allowed) {
+                text = _mm_or_si128(text, _mm_cmpeq_epi8(chunk, byte));
+            }
+            count += static_cast<size_t>(__builtin_popcount(
+                static_cast<unsigned>(_mm_movemask_epi8(_mm_andnot_si128(text, control)))));
+        }
+#endif
+        for (; p < end; ++p) {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c < 0x20 && !isTextControl(c)) count++;
+        }
+        return count;
+    }
+
+    size_t asciiPrefix(const char* begin, const char* end) {
+        const char* p = begin;
+#ifdef FSMANAGER_SSE2
+        for (; p + 16 <= end; p += 16) {
+            // The sign bits are exactly the non-ASCII bytes
+            int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            if (mask != 0) {
+                return static_cast<size_t>(p - begin) + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+            }
+        }
+#endif
+        while (p < end && static_cast<unsigned char>(*p) < 0x80) ++p;
+        return static_cast<size_t>(p - begin);
+    }
+
+    LiteralFinder::LiteralFinder() : caseSensitive(true), anchorIndex(0), anchorLower(0), anchorUpper(0) {
+    }
+
+    LiteralFinder::LiteralFinder(const std::string& text, bool caseSensitive)
+        : literal(text), caseSensitive(caseSensitive), anchorIndex(0), anchorLower(0), anchorUpper(0) {
+        if (!caseSensitive) {
+            for (char& c : literal) {
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+        }
+
+        // Scan for the rarest byte so candidates (and verifications) stay few
+        int bestRank = -1;
+        for (size_t i = 0; i < literal.size(); ++i) {
+            int rank = byteRank(static_cast<unsigned char>(literal[i]));
+            if (rank > bestRank) {
+                bestRank = rank;
+                anchorIndex = i;
+            }
+        }
+        if (!literal.empty()) {
+            unsigned char anchor = static_cast<unsigned char>(literal[anchorIndex]);
+            anchorLower = anchor;
+            anchorUpper = caseSensitive ? anchor : static_cast<unsigned char>(std::toupper(anchor));
+        }
+    }
+
+    bool LiteralFinder::verify(const char* candidate) const {
+        if (caseSensitive) {
+            return std::memcmp(candidate, literal.data(), literal.size()) == 0;
+        }
+        for (size_t i = 0; i < literal.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(candidate[i])) != static_cast<unsigned char>(literal[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char* LiteralFinder::find(const char* begin, const char* end) const {
+        if (literal.empty()) return begin;
+        if (static_cast<size_t>(end - begin) < literal.size()) return nullptr;
+
+        // Anchor positions that leave room for the whole literal
+        const char* scan = begin + anchorIndex;
+        const char* scanEnd = end - (literal.size() - anchorIndex - 1);
+        while (scan < scanEnd) {
+            const char* hit = findEitherByte(scan, scanEnd, anchorLower, anchorUpper);
+            if (!hit) return nullptr;
+            const char* candidate = hit - anchorIndex;
+            if (verify(candidate)) return candidate;
+            scan = hit + 1;
+        }
+        return nullptr;
+    }
+
+}
@@ -1,16 +1,27 @@
 #include "CLI.h"
+#include "DateIndex.h"
+#include "RenameTemplate.h"
+#include "ScriptPlan.h"
+#include "SearchQuery.h"
+#include "ThreadPool.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <set>
 
 namespace FileSystemManager {
 
-    CLI::CLI() : fileManager(), searchEngine(), batchOps(), running(false), prompt("fsmanager> "), verbose(false) {
+    CLI::CLI() : fileManager(), searchEngine(), batchOps(), records(out, OutputFormat::Human), running(false), prompt("fsmanager> "), verbose(false) {
         initializeCommands();
+        setIoThrottle(std::make_shared<IoThrottle>());
     }
 
-    CLI::CLI(const std::string& initialPath) : fileManager(initialPath), searchEngine(initialPath), batchOps(), running(false), prompt("fsmanager> "), verbose(false) {
+    CLI::CLI(const std::string& initialPath) : fileManager(initialPath), searchEngine(initialPath), batchOps(), records(out, OutputFormat::Human), running(false), prompt("fsmanager> "), verbose(false) {
         initializeCommands();
+        setIoThrottle(std::make_shared<IoThrottle>());
     }
 
     void CLI::initializeCommands() {
@@ -36,10 +47,14 @@ namespace FileSystemManager {
         commands["cat"] = [this](const std::vector<std::string>& args) { handleCat(args); };
         commands["echo"] = [this](const std::vector<std::string>& args) { handleEcho(args); };
         commands["find"] = [this](const std::vector<std::string>& args) { handleFind(args); };
+        commands["finddate"] = [this](const std::vector<std::string>& args) { handleFindDate(args); };
+        commands["dateindex"] = [this](const std::vector<std::string>& args) { handleDateIndex(args); };
         commands["grep"] = [this](const std::vector<std::string>& args) { handleGrep(args); };
         commands["size"] = [this](const std::vector<std::string>& args) { handleSize(args); };
         commands["tree"] = [this](const std::vector<std::string>& args) { handleTree(args); };
         commands["search"] = [this](const std::vector<std::string>& args) { handleSearch(args); };
+        commands["profile"] = [this](const std::vector<std::string>& args) { handleProfile(args); };
+        commands["throttle"] = [this](const std::vector<std::string>& args) { handleThrottle(args); };
         commands["batch"] = [this](const std::vector<std::string>& args) { handleBatch(args); };
         commands["stats"] = [this](const std::vector<std::string>& args) { handleStats(args); };
         commands["clear"] = [this](const std::vector<std::string>& args) { handleClear(args); };
@@ -52,8 +67,11 @@ namespace FileSystemManager {
         
         std::string input;
         while (running) {
-            std::cout << prompt;
-            std::getline(std::cin, input);
+            out << prompt;
+            out.flush();
+            if (!std::getline(std::cin, input)) {
+                break; // End of input
+            }
             
             if (!input.empty()) {
                 commandHistory.push_back(input);
@@ -69,14 +87,97 @@ namespace FileSystemManager {
             return;
         }
         
+        running = true;
         std::string line;
-        while (std::getline(script, line) && running) {
+        while (running && std::getline(script, line)) {
             if (!line.empty() && line[0] != '#') { // Skip empty lines and comments
-                std::cout << prompt << line << std::endl;
+                if (!records.isStructured()) {
+                    out << prompt << line << '\n';
+                }
                 executeCommand(line);
             }
         }
         script.close();
+        out.flush();
+    }
+
+    void CLI::runScriptParallel(const std::string& scriptPath, size_t jobs) {
+        ScriptPlan plan;
+        if (!plan.load(scriptPath)) {
+            printError("Cannot open script file: " + scriptPath);
+            return;
+        }
+        
+        running = true;
+        ThreadPool pool(jobs);
+        
+        // One private CLI per pool thread so concurrent commands never share
+        // search or listing state with each other or with this session
+        std::vector<std::unique_ptr<CLI>> workerSessions;
+        std::vector<CLI*> idleSessions;
+        std::mutex sessionMutex;
+        for (size_t i = 0; i < pool.size(); ++i) {
+            workerSessions.push_back(std::make_unique<CLI>(getCurrentPath()));
+            idleSessions.push_back(workerSessions.back().get());
+        }
+        
+        const auto& commands = plan.getCommands();
+        for (const auto& stage : plan.getStages()) {
+            if (!running) break;
+            
+            if (stage.barrier || stage.commands.size() == 1) {
+                for (size_t index : stage.commands) {
+                    executeCommand(commands[index].text);
+                }
+                continue;
+            }
+            
+            std::vector<std::future<std::string>> outputs;
+            outputs.reserve(stage.commands.size());
+            for (size_t index : stage.commands) {
+                const std::string& commandText = commands[index].text;
+                outputs.push_back(pool.submit([this, &commandText, &idleSessions, &sessionMutex]() {
+                    CLI* session;
+                    {
+                        std::lock_guard<std::mutex> lock(sessionMutex);
+                        session = idleSessions.back();
+                        idleSessions.pop_back();
+                    }
+                    
+                    std::string captured;
+                    session->syncFrom(*this);
+                    session->out.setCaptureTarget(&captured);
+                    session->executeCommand(commandText);
+                    session->out.setCaptureTarget(nullptr);
+                    
+                    {
+                        std::lock_guard<std::mutex> lock(sessionMutex);
+                        idleSessions.push_back(session);
+                    }
+                    return captured;
+                }));
+            }
+            
+            // Merge in script order; later commands keep running meanwhile
+            for (auto& output : outputs) {
+                std::string text = output.get();
+                out.write(text.data(), text.size());
+            }
+            out.flush();
+        }
+        
+        out.flush();
+    }
+
+    void CLI::syncFrom(const CLI& source) {
+        std::string path = source.getCurrentPath();
+        if (fileManager.getCurrentPath() != path) {
+            fileManager.changeDirectory(path);
+            searchEngine.setSearchRoot(path);
+        }
+        setOutputFormat(source.records.getFormat(), source.records.includesFormattedFields());
+        treeCache = source.treeCache;
+        if (ioThrottle != source.ioThrottle) setIoThrottle(source.ioThrottle);
     }
 
     void CLI::executeCommand(const std::string& command) {
@@ -88,14 +189,19 @@ namespace FileSystemManager {
         
         auto it = commands.find(cmd);
         if (it != commands.end()) {
+            ScopedPhase phase("command", command);
             try {
                 it->second(args);
             } catch (const std::exception& e) {
                 printError("Error executing command: " + std::string(e.what()));
             }
+            invalidateCachedTrees(cmd, args);
         } else {
             printError("Unknown command: " + cmd + ". Type 'help' for available commands.");
         }
+        Instrumentation::traceCounters();
+        
+        out.endCommand();
     }
 
     std::vector<std::string> CLI::parseCommand(const std::string& input) {
@@ -111,48 +217,64 @@ namespace FileSystemManager {
     }
 
     void CLI::printBanner() {
-        std::cout << "===============================================" << std::endl;
-        std::cout << "    File System Manager v1.0.0" << std::endl;
-        std::cout << "    Advanced file operations and management" << std::endl;
-        std::cout << "    Type 'help' for available commands" << std::endl;
-        std::cout << "===============================================" << std::endl;
-        std::cout << std::endl;
+        out << "===============================================" << '\n';
+        out << "    File System Manager v1.0.0" << '\n';
+        out << "    Advanced file operations and management" << '\n';
+        out << "    Type 'help' for available commands" << '\n';
+        out << "===============================================" << '\n';
+        out << '\n';
     }
 
     void CLI::printHelp() {
-        std::cout << "Available commands:" << std::endl;
-        std::cout << "  Navigation:" << std::endl;
-        std::cout << "    pwd                    - Print current directory" << std::endl;
-        std::cout << "    cd <path>              - Change directory" << std::endl;
-        std::cout << "    ls [options]           - List files and directories" << std::endl;
-        std::cout << "    tree [depth]           - Show directory tree" << std::endl;
-        std::cout << std::endl;
-        std::cout << "  File Operations:" << std::endl;
-        std::cout << "    touch <file>           - Create empty file" << std::endl;
-        std::cout << "    mkdir <dir>            - Create directory" << std::endl;
-        std::cout << "    rm <file>              - Delete file" << std::endl;
-        std::cout << "    cp <src> <dest>        - Copy file" << std::endl;
-        std::cout << "    mv <src> <dest>        - Move/rename file" << std::endl;
-        std::cout << "    cat <file>             - Display file content" << std::endl;
-        std::cout << "    echo <text> > <file>   - Write text to file" << std::endl;
-        std::cout << std::endl;
-        std::cout << "  Search Operations:" << std::endl;
-        std::cout << "    find <pattern>         - Find files by name pattern" << std::endl;
-        std::cout << "    grep <term> [file]     - Search content in files" << std::endl;
-        std::cout << "    search <options>       - Advanced search" << std::endl;
-        std::cout << std::endl;
-        std::cout << "  Batch Operations:" << std::endl;
-        std::cout << "    batch copy <pattern> <dest>  - Copy files by pattern" << std::endl;
-        std::cout << "    batch move <pattern> <dest>  - Move files by pattern" << std::endl;
-        std::cout << "    batch delete <pattern>       - Delete files by pattern" << std::endl;
-        std::cout << std::endl;
-        std::cout << "  Utilities:" << std::endl;
-        std::cout << "    size <path>            - Show file/directory size" << std::endl;
-        std::cout << "    stats                  - Show current directory statistics" << std::endl;
-        std::cout << "    clear                  - Clear screen" << std::endl;
-        std::cout << "    help                   - Show this help" << std::endl;
-        std::cout << "    exit                   - Exit program" << std::endl;
-        std::cout << std::endl;
+        out << "Available commands:" << '\n';
+        out << "  Navigation:" << '\n';
+        out << "    pwd                    - Print current directory" << '\n';
+        out << "    cd <path>              - Change directory" << '\n';
+        out << "    ls [options]           - List files and directories" << '\n';
+        out << "    tree [depth]           - Show directory tree" << '\n';
+        out << '\n';
+        out << "  File Operations:" << '\n';
+        out << "    touch <file>           - Create empty file" << '\n';
+        out << "    mkdir <dir>            - Create directory" << '\n';
+        out << "    rm <file>              - Delete file" << '\n';
+        out << "    cp <src> <dest>        - Copy file" << '\n';
+        out << "    mv <src> <dest>        - Move/rename file" << '\n';
+        out << "    cat <file>             - Display file content" << '\n';
+        out << "    echo <text> > <file>   - Write text to file" << '\n';
+        out << '\n';
+        out << "  Search Operations:" << '\n';
+        out << "    find <pattern>         - Find files by name pattern" << '\n';
+        out << "    find [pattern] --sort <key> [--limit <n>] - Largest/newest/... first (size, mtime, name, path)" << '\n';
+        out << "    finddate <from> [to]   - Find files modified in a date range (YYYY-MM-DD[THH:MM:SS])" << '\n';
+        out << "    dateindex [build|info|remove] - Manage the date index of the current directory" << '\n';
+        out << "    grep <term> [file]     - Search content in files" << '\n';
+        out << "    grep -E <regex> [file] - Search content with an extended regex" << '\n';
+        out << "    grep -f <list> [file]  - Search content for any pattern in a file" << '\n';
+        out << "    search <options>       - Advanced search (-name -ext -path -exclude -maxdepth -size -mtime -content -regex -patterns -sort -limit)" << '\n';
+        out << '\n';
+        out << "  Batch Operations:" << '\n';
+        out << "    batch copy <pattern> <dest> [--verify] - Copy files by pattern, optionally checking each copy" << '\n';
+        out << "    batch move <pattern> <dest>  - Move files by pattern" << '\n';
+        out << "    batch delete <pattern>       - Delete files by pattern" << '\n';
+        out << "    batch eol <pattern> <lf|crlf|cr> - Normalize line endings" << '\n';
+        out << "    batch convert <pattern> <from> <to> - Convert text encoding (UTF-8, UTF-16, Latin-1)" << '\n';
+        out << "    batch organize <ext|date|size> <dest> [format] - Sort files into subdirectories" << '\n';
+        out << "    batch rename <pattern> <template> - Rename files, e.g. {name}_{n:3}{ext}" << '\n';
+        out << "    batch prefix|suffix <pattern> <text> - Add text before the name or extension" << '\n';
+        out << "    batch undo-rename [journal]  - Revert the last (or a given) rename batch" << '\n';
+        out << "    batch cleanup [temp|empty|all] [--older <age>] [--dry-run] - Remove temp and/or empty files" << '\n';
+        out << "    batch verify [dir] [--changed] - Check files against their checksum manifest" << '\n';
+        out << '\n';
+        out << "  Utilities:" << '\n';
+        out << "    size <path>            - Show file/directory size" << '\n';
+        out << "    stats                  - Show current directory statistics" << '\n';
+        out << "    stats -r [--top <n>]   - Tree-wide statistics (--csv/--json <file> to export)" << '\n';
+        out << "    profile <command>      - Run a command and report counters and timings" << '\n';
+        out << "    throttle [--bandwidth <size>] [--iops <n>] [--class default|best-effort|idle] - Limit batch and scan I/O ('throttle off' lifts it)" << '\n';
+        out << "    clear                  - Clear screen" << '\n';
+        out << "    help                   - Show this help" << '\n';
+        out << "    exit                   - Exit program" << '\n';
+        out << '\n';
     }
 
     void CLI::handleHelp(const std::vector<std::string>& args) {
@@ -160,17 +282,17 @@ namespace FileSystemManager {
     }
 
     void CLI::handleVersion(const std::vector<std::string>& args) {
-        std::cout << "File System Manager v1.0.0" << std::endl;
-        std::cout << "Built with C++17 and std::filesystem" << std::endl;
+        out << "File System Manager v1.0.0" << '\n';
+        out << "Built with C++17 and std::filesystem" << '\n';
     }
 
     void CLI::handleExit(const std::vector<std::string>& args) {
         running = false;
-        std::cout << "Goodbye!" << std::endl;
+        out << "Goodbye!" << '\n';
     }
 
     void CLI::handlePwd(const std::vector<std::string>& args) {
-        std::cout << fileManager.getCurrentPath() << std::endl;
+        out << fileManager.getCurrentPath() << '\n';
     }
 
     void CLI::handleCd(const std::vector<std::string>& args) {
@@ -206,22 +328,28 @@ namespace FileSystemManager {
         
         auto files = fileManager.listFiles(showHidden);
         
-        if (showDetails) {
-            std::cout << std::left << std::setw(20) << "Name" 
-                      << std::setw(12) << "Size" 
-                      << std::setw(20) << "Modified" 
-                      << std::setw(8) << "Type" << std::endl;
-            std::cout << std::string(60, '-') << std::endl;
+        if (records.isStructured()) {
+            for (const auto& file : files) {
+                records.writeFileInfo(file);
+            }
+        } else if (showDetails) {
+            out << padRight("Name", 20)
+                << padRight("Size", 12)
+                << padRight("Modified", 20)
+                << padRight("Type", 8) << '\n';
+            out << std::string(60, '-') << '\n';
             
             for (const auto& file : files) {
-                std::cout << std::left << std::setw(20) << file.name
-                          << std::setw(12) << formatFileSize(file.size)
-                          << std::setw(20) << file.lastModified
-                          << std::setw(8) << (file.isDirectory ? "DIR" : "FILE") << std::endl;
+                char sizeText[32];
+                size_t sizeLength = FileSystemManager::formatFileSize(file.size, sizeText, sizeof(sizeText));
+                out << padRight(file.name, 20)
+                    << padRight(std::string_view(sizeText, sizeLength), 12)
+                    << padRight(file.lastModified, 20)
+                    << padRight(file.isDirectory ? "DIR" : "FILE", 8) << '\n';
             }
         } else {
             for (const auto& file : files) {
-                std::cout << (file.isDirectory ? "📁 " : "📄 ") << file.name << std::endl;
+                out << (file.isDirectory ? "📁 " : "📄 ") << file.name << '\n';
             }
         }
     }
@@ -312,8 +440,8 @@ namespace FileSystemManager {
         for (const auto& fileName : args) {
             std::string content = fileManager.readFileContent(fileName);
             if (!content.empty()) {
-                std::cout << "=== " << fileName << " ===" << std::endl;
-                std::cout << content << std::endl;
+                out << "=== " << fileName << " ===" << '\n';
+                out << content << '\n';
             } else {
                 printError("Cannot read file: " + fileName);
             }
@@ -337,61 +465,281 @@ namespace FileSystemManager {
     }
 
     void CLI::handleFind(const std::vector<std::string>& args) {
+        std::string pattern;
+        ResultOrder order;
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            if ((arg == "--sort" || arg == "--limit") && i + 1 >= args.size()) {
+                printError("Missing value for " + arg);
+                return;
+            }
+            std::string error;
+            if (arg == "--sort") {
+                if (!ResultOrder::parse(args[++i], order, error)) {
+                    printError(error);
+                    return;
+                }
+            } else if (arg == "--limit") {
+                const std::string& value = args[++i];
+                if (value.empty() || value.size() > 18 || value.find_first_not_of("0123456789") != std::string::npos ||
+                    std::stoull(value) == 0) {
+                    printError("Invalid limit: " + value);
+                    return;
+                }
+                order.limit = static_cast<size_t>(std::stoull(value));
+            } else if (pattern.empty()) {
+                pattern = arg;
+            } else {
+                printError("Unexpected argument: " + arg);
+                return;
+            }
+        }
+        if (pattern.empty() && !order.isSet()) {
+            printError("Usage: find <pattern> [--sort size|mtime|name|path[:asc|:desc]] [--limit <n>]");
+            return;
+        }
+        
+        std::vector<SearchResult> results;
+        if (!order.isSet()) {
+            results = findByName(pattern);
+        } else if (treeCache) {
+            // The snapshot already holds every match; only ordering is left
+            ResultCollector collector(order);
+            for (auto& result : findByName(pattern.empty() ? "*" : pattern)) {
+                collector.add(std::move(result));
+            }
+            results = collector.take();
+        } else {
+            // Parallel walk with a bounded heap per worker
+            SearchQuery query;
+            if (!pattern.empty()) query.namePatterns.push_back(pattern);
+            query.order = order;
+            results = searchEngine.search(query);
+        }
+        
+        if (records.isStructured()) {
+            for (const auto& result : results) {
+                records.writeSearchResult(result);
+            }
+        } else if (results.empty()) {
+            printInfo("No files found matching pattern: " + (pattern.empty() ? std::string("*") : pattern));
+        } else {
+            out << "Found " << results.size() << " files:" << '\n';
+            for (const auto& result : results) {
+                out << "  ";
+                if (order.key == SortKey::Modified) out << result.lastModified << "  ";
+                out << result.filePath << " (" << fileSize(result.fileSize) << ")" << '\n';
+            }
+        }
+    }
+
+    void CLI::handleFindDate(const std::vector<std::string>& args) {
         if (args.empty()) {
-            printError("Usage: find <pattern>");
+            printError("Usage: finddate <from> [to]");
             return;
         }
         
-        std::string pattern = args[0];
-        auto results = searchEngine.searchByName(pattern, true);
+        std::string from = args[0];
+        std::string to = args.size() > 1 ? args[1] : "";
+        int64_t bound = 0;
+        if (!parseTimestamp(from, false, bound) || (!to.empty() && !parseTimestamp(to, true, bound))) {
+            printError("Invalid date; use YYYY-MM-DD or YYYY-MM-DDTHH:MM:SS");
+            return;
+        }
         
-        if (results.empty()) {
-            printInfo("No files found matching pattern: " + pattern);
+        auto results = searchEngine.searchByDate(from, to, true);
+        if (searchEngine.getLastSearchStats().staleIndex && !records.isStructured()) {
+            printInfo("Date index is out of date, walked the tree instead (run 'dateindex build')");
+        }
+        
+        if (records.isStructured()) {
+            for (const auto& result : results) {
+                records.writeSearchResult(result);
+            }
+        } else if (results.empty()) {
+            printInfo("No files modified in range: " + from + (to.empty() ? "" : " .. " + to));
         } else {
-            std::cout << "Found " << results.size() << " files:" << std::endl;
+            out << "Found " << results.size() << " files:" << '\n';
             for (const auto& result : results) {
-                std::cout << "  " << result.filePath << " (" << formatFileSize(result.fileSize) << ")" << std::endl;
+                out << "  " << result.lastModified << "  " << result.filePath
+                    << " (" << fileSize(result.fileSize) << ")" << '\n';
             }
         }
     }
 
+    void CLI::handleDateIndex(const std::vector<std::string>& args) {
+        std::string action = args.empty() ? "info" : args[0];
+        std::string root = fileManager.getCurrentPath();
+        std::string indexPath = DateIndex::defaultPathFor(root);
+        
+        if (action == "build") {
+            size_t recordCount = 0;
+            std::string error;
+            if (searchEngine.buildDateIndex(recordCount, error)) {
+                printSuccess("Indexed " + std::to_string(recordCount) + " files: " + indexPath);
+            } else {
+                printError(error);
+            }
+        } else if (action == "info") {
+            DateIndex index;
+            std::string error;
+            if (!index.open(indexPath, error)) {
+                printInfo("No date index for " + root + " (run 'dateindex build')");
+                return;
+            }
+            std::chrono::system_clock::time_point builtAt(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(index.getBuiltAtNs())));
+            out << "Date index: " << indexPath << '\n';
+            out << "  Root: " << index.getRoot() << '\n';
+            out << "  Files: " << index.size() << '\n';
+            out << "  Built: " << FileSystemManager::formatTimestamp(builtAt) << '\n';
+            out << "  Status: " << (index.isUpToDate() ? "up to date" : "out of date (run 'dateindex build')") << '\n';
+        } else if (action == "remove") {
+            std::error_code ec;
+            if (fs::remove(indexPath, ec)) {
+                printSuccess("Removed date index: " + indexPath);
+            } else {
+                printInfo("No date index for " + root);
+            }
+        } else {
+            printError("Usage: dateindex [build|info|remove]");
+        }
+    }
+
     void CLI::handleGrep(const std::vector<std::string>& args) {
-        if (args.empty()) {
-            printError("Usage: grep <search_term> [file_pattern]");
+        bool extended = !args.empty() && args[0] == "-E";
+        bool keywordFile = !args.empty() && args[0] == "-f";
+        size_t first = extended || keywordFile ? 1 : 0;
+        if (args.size() <= first) {
+            printError("Usage: grep [-E] <search_term> [file|directory|name_pattern] | grep -f <pattern_file> [file|directory|name_pattern]");
             return;
         }
         
-        std::string searchTerm = args[0];
-        std::string filePattern = args.size() > 1 ? args[1] : "*";
+        std::string searchTerm = args[first];
+        std::string filePattern = args.size() > first + 1 ? args[first + 1] : "*";
         
-        auto results = searchEngine.searchInContent(searchTerm, true);
+        // The file pattern is a name or path predicate, checked before any file is opened
+        SearchQuery query;
+        if (keywordFile) {
+            std::string error;
+            fs::path file(searchTerm);
+            if (file.is_relative()) file = fs::path(fileManager.getCurrentPath()) / file;
+            if (!SearchQuery::loadPatternFile(file.string(), query.keywords, error)) {
+                printError(error);
+                return;
+            }
+        } else if (extended) {
+            query.contentPatterns.push_back(searchTerm);
+        } else {
+            query.contentTerms.push_back(searchTerm);
+        }
+        if (filePattern != "*") {
+            std::string error;
+            if (!scopeGrep(filePattern, query, error)) {
+                printError(error);
+                return;
+            }
+        }
+        std::vector<SearchResult> results;
+        if (!extended && !keywordFile && filePattern == "*") {
+            results = searchEngine.searchInContent(searchTerm, true);
+        } else {
+            // Compiled once: checked here, then run as is
+            QueryPlan plan = searchEngine.plan(query);
+            if (!plan.getError().empty()) {
+                printError(plan.getError());
+                return;
+            }
+            results = searchEngine.search(plan);
+        }
         
-        if (results.empty()) {
-            printInfo("No files found containing: " + searchTerm);
+        std::string description = extended ? "matching /" + searchTerm + "/" : "containing '" + searchTerm + "'";
+        if (keywordFile) {
+            description = "containing any of " + std::to_string(query.keywords.size()) + " patterns";
+        }
+        if (records.isStructured()) {
+            for (const auto& result : results) {
+                records.writeSearchResult(result);
+            }
+        } else if (results.empty()) {
+            printInfo("No files found " + description);
         } else {
-            std::cout << "Found " << results.size() << " files containing '" << searchTerm << "':" << std::endl;
+            out << "Found " << results.size() << " files " << description << ":" << '\n';
             for (const auto& result : results) {
-                std::cout << "  " << result.filePath << std::endl;
+                out << "  " << result.filePath << '\n';
+                if (!result.matchedPatterns.empty()) {
+                    out << "    Patterns:";
+                    for (size_t i = 0; i < result.matchedPatterns.size(); ++i) {
+                        out << (i > 0 ? ", " : " ") << result.matchedPatterns[i];
+                    }
+                    out << '\n';
+                }
                 for (const auto& line : result.matchingLines) {
-                    std::cout << "    " << line << std::endl;
+                    out << "    " << describeLineMatch(line) << '\n';
                 }
             }
         }
     }
 
+    // grep's optional target. A bare pattern ("*.h") is a name glob; one
+    // with a '/', or naming an existing entry, is a path below the current
+    // directory: a single file, everything under a directory, or a path glob
+    bool CLI::scopeGrep(const std::string& target, SearchQuery& query, std::string& error) const {
+        std::string trimmed = target;
+        while (trimmed.size() > 1 && trimmed.back() == '/') trimmed.pop_back();
+        fs::path base = fs::path(fileManager.getCurrentPath()).lexically_normal();
+        fs::path full = fs::path(trimmed).is_relative() ? base / trimmed : fs::path(trimmed);
+        std::error_code ec;
+        bool exists = fs::exists(full, ec);
+        if (!exists && trimmed.find('/') == std::string::npos) {
+            query.namePatterns.push_back(target);
+            return true;
+        }
+        
+        std::string relative = full.lexically_normal().lexically_relative(base).generic_string();
+        if (relative.empty() || relative == ".." || relative.compare(0, 3, "../") == 0) {
+            error = "Not below the current directory: " + target;
+            return false;
+        }
+        if (relative == ".") return true;
+        if (exists && fs::is_directory(full, ec)) relative += "/*";
+        query.pathPattern = relative;
+        return true;
+    }
+
     void CLI::handleSize(const std::vector<std::string>& args) {
+        // Structured output reports sizes as FileInfo records with the total in `size`
+        auto writeSizeRecord = [this](const std::string& path, size_t size) {
+            FileInfo info = fileManager.getFileInfo(path);
+            info.size = size;
+            records.writeFileInfo(info);
+        };
+        
         if (args.empty()) {
             // Show current directory size
-            size_t size = fileManager.getDirectorySize(fileManager.getCurrentPath());
-            std::cout << "Directory size: " << formatFileSize(size) << std::endl;
+            size_t size = directorySize(fileManager.getCurrentPath());
+            if (records.isStructured()) {
+                writeSizeRecord(fileManager.getCurrentPath(), size);
+            } else {
+                out << "Directory size: " << fileSize(size) << '\n';
+            }
         } else {
             for (const auto& path : args) {
                 if (fileManager.fileExists(path)) {
                     auto info = fileManager.getFileInfo(path);
-                    std::cout << path << ": " << formatFileSize(info.size) << std::endl;
+                    if (records.isStructured()) {
+                        records.writeFileInfo(info);
+                    } else {
+                        out << path << ": " << fileSize(info.size) << '\n';
+                    }
                 } else if (fileManager.directoryExists(path)) {
-                    size_t size = fileManager.getDirectorySize(path);
-                    std::cout << path << ": " << formatFileSize(size) << std::endl;
+                    // Relative to the session directory, not the process one
+                    size_t size = directorySize((fs::path(fileManager.getCurrentPath()) / path).string());
+                    if (records.isStructured()) {
+                        writeSizeRecord(path, size);
+                    } else {
+                        out << path << ": " << fileSize(size) << '\n';
+                    }
                 } else {
                     printError("File or directory not found: " + path);
                 }
@@ -399,6 +747,38 @@ namespace FileSystemManager {
         }
     }
 
+    std::vector<SearchResult> CLI::findByName(const std::string& pattern) {
+        if (treeCache) {
+            bool formatTimestamps = !records.isStructured() || records.includesFormattedFields();
+            return treeCache->findByName(fileManager.getCurrentPath(), pattern, true, formatTimestamps);
+        }
+        return searchEngine.searchByName(pattern, true);
+    }
+
+    size_t CLI::directorySize(const std::string& path) {
+        uint64_t bytes = 0;
+        if (treeCache && treeCache->getDirectorySize(path, bytes)) {
+            return static_cast<size_t>(bytes);
+        }
+        return fileManager.getDirectorySize(path);
+    }
+
+    void CLI::invalidateCachedTrees(const std::string& command, const std::vector<std::string>& args) {
+        static const std::set<std::string> writers = {
+            "mkdir", "touch", "rm", "del", "cp", "copy", "mv", "move", "echo", "batch"
+        };
+        if (!treeCache || writers.count(command) == 0) return;
+
+        // Arguments that are not paths resolve inside the current directory
+        const std::string& current = fileManager.getCurrentPath();
+        treeCache->invalidate(current);
+        for (const auto& arg : args) {
+            if (arg.empty() || arg[0] == '-' || arg == ">") continue;
+            fs::path target = fs::path(current) / arg;
+            if (target.parent_path() != fs::path(current)) treeCache->invalidate(target.string());
+        }
+    }
+
     void CLI::handleTree(const std::vector<std::string>& args) {
         int maxDepth = 3;
         if (!args.empty()) {
@@ -410,48 +790,135 @@ namespace FileSystemManager {
             }
         }
         
+        if (records.isStructured()) {
+            for (const auto& entry : fileManager.getDirectoryTreeEntries("", maxDepth)) {
+                records.writeFileInfo(entry);
+            }
+            return;
+        }
+        
         auto tree = fileManager.getDirectoryTree("", maxDepth);
         for (const auto& line : tree) {
-            std::cout << line << std::endl;
+            out << line << '\n';
         }
     }
 
     void CLI::handleSearch(const std::vector<std::string>& args) {
         if (args.empty()) {
             printError("Usage: search <options>");
-            printInfo("Options: -name <pattern>, -content <term>, -size <min>-<max>, -ext <extension>");
+            printInfo("Options: -name <pattern>, -ext <ext[,ext]>, -path <pattern>, -exclude <dir>, -maxdepth <n>,");
+            printInfo("         -size <min>-<max>, -mtime <from>..<to> | -<days>, -content <term>, -regex <ere>,");
+            printInfo("         -patterns <file>, -sort size|mtime|name|path[:asc|:desc], -limit <n>, -explain");
             return;
         }
         
-        // Simple search implementation
-        std::string pattern = args[0];
-        auto results = searchEngine.searchByName(pattern, true);
+        bool explain = false;
+        std::vector<std::string> options;
+        for (const auto& arg : args) {
+            if (arg == "-explain") {
+                explain = true;
+            } else {
+                options.push_back(arg);
+            }
+        }
+        
+        SearchQuery query;
+        std::string error;
+        if (!SearchQuery::parse(options, query, error, fileManager.getCurrentPath())) {
+            printError(error);
+            return;
+        }
+        
+        QueryPlan plan = searchEngine.plan(query);
+        if (!plan.getError().empty()) {
+            printError(plan.getError());
+            return;
+        }
+        if (explain && !records.isStructured()) {
+            out << "Query plan:" << '\n';
+            for (const auto& step : plan.getSteps()) {
+                out << "  " << padRight(queryStageName(step.stage), 10) << step.description << '\n';
+            }
+        }
         
-        std::cout << "Search results for '" << pattern << "':" << std::endl;
+        // A lone name pattern can still be answered from the tree cache
+        bool nameOnly = options.size() == 1 && query.namePatterns.size() == 1;
+        auto results = nameOnly ? findByName(query.namePatterns[0]) : searchEngine.search(plan);
+        
+        if (records.isStructured()) {
+            for (const auto& result : results) {
+                records.writeSearchResult(result);
+            }
+            return;
+        }
+        
+        out << "Found " << results.size() << " files:" << '\n';
         for (const auto& result : results) {
-            std::cout << "  " << result.filePath << " (" << formatFileSize(result.fileSize) << ")" << std::endl;
+            out << "  " << result.filePath << " (" << fileSize(result.fileSize) << ")" << '\n';
+            for (const auto& line : result.matchingLines) {
+                out << "    " << describeLineMatch(line) << '\n';
+            }
         }
     }
 
     void CLI::handleBatch(const std::vector<std::string>& args) {
+        if (!args.empty() && args[0] == "undo-rename") {
+            printOperationResult(batchOps.undoRename(args.size() > 1 ? args[1] : ""));
+            return;
+        }
+        if (!args.empty() && args[0] == "cleanup") {
+            handleCleanup(args);
+            return;
+        }
+        if (!args.empty() && args[0] == "verify") {
+            handleVerify(args);
+            return;
+        }
         if (args.size() < 3) {
             printError("Usage: batch <operation> <pattern> <destination>");
-            printInfo("Operations: copy, move, delete");
+            printInfo("Operations: copy, move, delete, eol <pattern> <lf|crlf|cr>, convert <pattern> <from> <to>,");
+            printInfo("            organize <ext|date|size> <destination> [date format],");
+            printInfo("            rename <pattern> <template>, prefix|suffix <pattern> <text>, undo-rename [journal],");
+            printInfo("            cleanup [temp|empty|all] [--ext <list>] [--older <age>] [--dry-run] [--no-recurse],");
+            printInfo("            copy <pattern> <destination> --verify, verify [directory] [--changed]");
             return;
         }
         
         std::string operation = args[0];
+        if (operation == "organize") {
+            handleOrganize(args);
+            return;
+        }
         std::string pattern = args[1];
         std::string destination = args.size() > 2 ? args[2] : "";
         
         OperationResult result;
         
         if (operation == "copy") {
-            result = batchOps.copyFilesByPattern(fileManager.getCurrentPath(), pattern, destination);
+            bool verify = args.size() > 3 && args[3] == "--verify";
+            if (args.size() > (verify ? 4u : 3u)) {
+                printError("Usage: batch copy <pattern> <destination> [--verify]");
+                return;
+            }
+            result = batchOps.copyFilesByPattern(fileManager.getCurrentPath(), pattern, destination, verify);
         } else if (operation == "move") {
             result = batchOps.moveFilesByPattern(fileManager.getCurrentPath(), pattern, destination);
         } else if (operation == "delete") {
             result = batchOps.deleteFilesByPattern(fileManager.getCurrentPath(), pattern);
+        } else if (operation == "eol") {
+            result = batchOps.normalizeLineEndingsByPattern(fileManager.getCurrentPath(), pattern, destination);
+        } else if (operation == "convert") {
+            if (args.size() < 4) {
+                printError("Usage: batch convert <pattern> <from> <to>");
+                return;
+            }
+            result = batchOps.convertTextEncodingByPattern(fileManager.getCurrentPath(), pattern, args[2], args[3]);
+        } else if (operation == "rename") {
+            result = batchOps.renameFilesByPattern(fileManager.getCurrentPath(), pattern, destination);
+        } else if (operation == "prefix" || operation == "suffix") {
+            std::string affix = RenameTemplate::literal(destination);
+            std::string newPattern = operation == "prefix" ? affix + "{file}" : "{name}" + affix + "{ext}";
+            result = batchOps.renameFilesByPattern(fileManager.getCurrentPath(), pattern, newPattern);
         } else {
             printError("Unknown batch operation: " + operation);
             return;
@@ -460,7 +927,242 @@ namespace FileSystemManager {
         printOperationResult(result);
     }
 
+    void CLI::handleOrganize(const std::vector<std::string>& args) {
+        const std::string& mode = args[1];
+        fs::path destination(args[2]);
+        if (destination.is_relative()) {
+            destination = fs::path(fileManager.getCurrentPath()) / destination;
+        }
+        
+        OperationResult result;
+        if (mode == "ext" || mode == "extension") {
+            result = batchOps.organizeByExtension(fileManager.getCurrentPath(), destination.string());
+        } else if (mode == "date") {
+            std::string format = args.size() > 3 ? args[3] : "%Y-%m-%d";
+            result = batchOps.organizeByDate(fileManager.getCurrentPath(), destination.string(), format);
+        } else if (mode == "size") {
+            static const std::vector<std::pair<size_t, std::string>> sizeBuckets = {
+                {16 * 1024, "tiny"},
+                {1024 * 1024, "small"},
+                {100 * 1024 * 1024, "medium"},
+                {SIZE_MAX, "large"}
+            };
+            result = batchOps.organizeBySize(fileManager.getCurrentPath(), destination.string(), sizeBuckets);
+        } else {
+            printError("Unknown organize mode: " + mode + " (use ext, date or size)");
+            return;
+        }
+        
+        printOperationResult(result);
+    }
+
+    void CLI::handleCleanup(const std::vector<std::string>& args) {
+        static const char* usage = "Usage: batch cleanup [temp|empty|all] [--ext <.a,.b>] [--older <N>[s|m|h|d]] [--dry-run] [--no-recurse]";
+        CleanupOptions options;
+        std::string mode = "temp";
+        std::vector<std::string> extensions = {".tmp", ".temp", ".bak"};
+        
+        for (size_t i = 1; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            if (arg == "temp" || arg == "empty" || arg == "all") {
+                mode = arg;
+            } else if (arg == "--ext" && i + 1 < args.size()) {
+                extensions = splitString(args[++i], ',');
+            } else if (arg == "--older" && i + 1 < args.size()) {
+                // A count with an optional unit; days by default
+                const std::string& age = args[++i];
+                size_t digits = 0;
+                while (digits < age.size() && std::isdigit(static_cast<unsigned char>(age[digits]))) digits++;
+                std::string unit = age.substr(digits);
+                int64_t scale = unit.empty() || unit == "d" ? 86400 : unit == "h" ? 3600 : unit == "m" ? 60 : unit == "s" ? 1 : 0;
+                // At most 18 digits fit an int64_t; the product must too
+                int64_t count = digits == 0 || digits > 18 ? 0 : std::stoll(age.substr(0, digits));
+                if (digits == 0 || digits > 18 || scale == 0 || count > INT64_MAX / scale) {
+                    printError("Invalid age: " + age);
+                    return;
+                }
+                options.minimumAgeSeconds = count * scale;
+            } else if (arg == "--dry-run") {
+                options.dryRun = true;
+            } else if (arg == "--no-recurse") {
+                options.recursive = false;
+            } else {
+                printError(usage);
+                return;
+            }
+        }
+        if (mode != "empty") options.extensions = extensions;
+        options.emptyFiles = mode != "temp";
+        
+        // A dry run lists what it found, in path order
+        std::vector<std::pair<std::string, uint64_t>> matches;
+        if (options.dryRun) {
+            options.onMatch = [&matches](const std::string& path, uint64_t size) {
+                matches.emplace_back(path, size);
+            };
+        }
+        OperationResult result = batchOps.cleanup(fileManager.getCurrentPath(), options);
+        std::sort(matches.begin(), matches.end());
+        for (const auto& [path, size] : matches) {
+            out << "  " << path << " (" << formatFileSize(size) << ")" << '\n';
+        }
+        printOperationResult(result);
+    }
+
+    void CLI::handleVerify(const std::vector<std::string>& args) {
+        std::string directory = fileManager.getCurrentPath();
+        bool changedOnly = false;
+        bool directoryGiven = false;
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (args[i] == "--changed") {
+                changedOnly = true;
+            } else if (!directoryGiven && args[i].rfind("--", 0) != 0) {
+                fs::path path(args[i]);
+                directory = (path.is_relative() ? fs::path(fileManager.getCurrentPath()) / path : path).string();
+                directoryGiven = true;
+            } else {
+                printError("Usage: batch verify [directory] [--changed]");
+                return;
+            }
+        }
+        printOperationResult(batchOps.verifyChecksums(directory, changedOnly));
+    }
+
+    void CLI::handleProfile(const std::vector<std::string>& args) {
+        if (args.empty()) {
+            printError("Usage: profile <command>");
+            return;
+        }
+        
+        std::string command = args[0];
+        for (size_t i = 1; i < args.size(); ++i) {
+            command += " " + args[i];
+        }
+        
+        bool wasEnabled = Instrumentation::isEnabled();
+        Instrumentation::setEnabled(true);
+        MetricsSnapshot before = Instrumentation::snapshot();
+        auto startTime = std::chrono::steady_clock::now();
+        
+        executeCommand(command);
+        
+        auto endTime = std::chrono::steady_clock::now();
+        MetricsSnapshot metrics = Instrumentation::snapshot() - before;
+        Instrumentation::setEnabled(wasEnabled);
+        
+        uint64_t wallNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count());
+        printProfile(command, wallNs, metrics);
+    }
+
+    void CLI::handleThrottle(const std::vector<std::string>& args) {
+        static const char* usage = "Usage: throttle [off] [--bandwidth <size>] [--iops <n>] [--class default|best-effort|idle]";
+        // Only what is given changes; 0 lifts a limit
+        IoLimits limits = ioThrottle->getLimits();
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            if (arg == "off") {
+                limits = IoLimits();
+            } else if (arg == "--bandwidth" && i + 1 < args.size()) {
+                if (!parseByteSize(args[++i], limits.bytesPerSecond)) {
+                    printError("Invalid bandwidth: " + args[i]);
+                    return;
+                }
+            } else if (arg == "--iops" && i + 1 < args.size()) {
+                try {
+                    limits.operationsPerSecond = std::stoull(args[++i]);
+                } catch (const std::exception&) {
+                    printError("Invalid operation rate: " + args[i]);
+                    return;
+                }
+            } else if (arg == "--class" && i + 1 < args.size()) {
+                if (!parseIoPriority(args[++i], limits.priority)) {
+                    printError("Unknown I/O class: " + args[i] + " (expected default, best-effort or idle)");
+                    return;
+                }
+            } else {
+                printError(usage);
+                return;
+            }
+        }
+        if (!args.empty()) ioThrottle->setLimits(limits);
+
+        std::string bandwidth = limits.bytesPerSecond > 0 ? formatFileSize(limits.bytesPerSecond) + "/s" : "unlimited";
+        std::string operations = limits.operationsPerSecond > 0 ? std::to_string(limits.operationsPerSecond) + " ops/s" : "unlimited";
+        out << "I/O limits: " << bandwidth << ", " << operations << ", class " << ioPriorityName(limits.priority) << '\n';
+    }
+
     void CLI::handleStats(const std::vector<std::string>& args) {
+        bool recursive = false;
+        StatisticsEngine statsEngine;
+        std::string csvPath;
+        std::string jsonPath;
+        
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            if (arg == "-r" || arg == "--recursive") {
+                recursive = true;
+            } else if ((arg == "--top" || arg == "--threads") && i + 1 < args.size()) {
+                try {
+                    size_t value = std::stoul(args[++i]);
+                    if (arg == "--top") {
+                        statsEngine.setTopCount(value);
+                    } else {
+                        statsEngine.setThreadCount(value);
+                    }
+                } catch (const std::exception&) {
+                    printError("Invalid value for " + arg + ": " + args[i]);
+                    return;
+                }
+            } else if (arg == "--csv" && i + 1 < args.size()) {
+                csvPath = args[++i];
+                recursive = true;
+            } else if (arg == "--json" && i + 1 < args.size()) {
+                jsonPath = args[++i];
+                recursive = true;
+            } else {
+                printError("Usage: stats [-r] [--top <n>] [--threads <n>] [--csv <file>] [--json <file>]");
+                return;
+            }
+        }
+        
+        if (recursive) {
+            auto stats = statsEngine.collect(fileManager.getCurrentPath());
+            
+            if (!csvPath.empty()) {
+                if (csvPath == "-") {
+                    out << stats.toCsv();
+                } else if (statsEngine.exportCsv(stats, csvPath)) {
+                    printSuccess("Statistics exported to: " + csvPath);
+                } else {
+                    printError("Failed to export statistics to: " + csvPath);
+                }
+            }
+            if (!jsonPath.empty()) {
+                if (jsonPath == "-") {
+                    out << stats.toJson();
+                } else if (statsEngine.exportJson(stats, jsonPath)) {
+                    printSuccess("Statistics exported to: " + jsonPath);
+                } else {
+                    printError("Failed to export statistics to: " + jsonPath);
+                }
+            }
+            if (csvPath.empty() && jsonPath.empty()) {
+                if (records.isStructured()) {
+                    records.writeStats(stats.rootPath, {
+                        {"files", stats.totalFiles},
+                        {"directories", stats.totalDirectories},
+                        {"other", stats.totalOther},
+                        {"bytes", stats.totalBytes},
+                        {"max_depth", static_cast<uint64_t>(stats.maxDepth)},
+                        {"scan_ms", static_cast<uint64_t>(stats.scanTime.count())}
+                    });
+                } else {
+                    printTreeStatistics(stats);
+                }
+            }
+            return;
+        }
+        
         auto files = fileManager.listFiles();
         size_t totalFiles = 0;
         size_t totalDirs = 0;
@@ -475,14 +1177,128 @@ namespace FileSystemManager {
             }
         }
         
-        std::cout << "Directory Statistics:" << std::endl;
-        std::cout << "  Current path: " << fileManager.getCurrentPath() << std::endl;
-        std::cout << "  Files: " << totalFiles << std::endl;
-        std::cout << "  Directories: " << totalDirs << std::endl;
-        std::cout << "  Total size: " << formatFileSize(totalSize) << std::endl;
+        if (records.isStructured()) {
+            records.writeStats(fileManager.getCurrentPath(), {
+                {"files", totalFiles},
+                {"directories", totalDirs},
+                {"bytes", totalSize}
+            });
+            return;
+        }
+        
+        out << "Directory Statistics:" << '\n';
+        out << "  Current path: " << fileManager.getCurrentPath() << '\n';
+        out << "  Files: " << totalFiles << '\n';
+        out << "  Directories: " << totalDirs << '\n';
+        out << "  Total size: " << fileSize(totalSize) << '\n';
+    }
+
+    void CLI::printProfile(const std::string& command, uint64_t wallNs, const MetricsSnapshot& metrics) {
+        if (records.isStructured()) {
+            records.writeProfile(command, wallNs, metrics.toFields());
+            return;
+        }
+        
+        auto milliseconds = [](uint64_t ns) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.3f ms", static_cast<double>(ns) / 1e6);
+            return std::string(buffer);
+        };
+        
+        out << '\n' << "Profile: " << command << '\n';
+        out << "  " << padRight("wall time", 26) << milliseconds(wallNs) << '\n';
+        
+        out << "  Counters:" << '\n';
+        for (size_t i = 0; i < CounterCount; ++i) {
+            Counter counter = static_cast<Counter>(i);
+            uint64_t value = metrics.get(counter);
+            out << "    " << padRight(counterName(counter), 24) << value;
+            if ((counter == Counter::BytesRead || counter == Counter::BytesWritten || counter == Counter::AllocatedBytes) && value > 0) {
+                out << " (" << fileSize(value) << ")";
+            }
+            out << '\n';
+        }
+        
+        if (!metrics.phases.empty()) {
+            out << "  Phases:" << '\n';
+            for (const auto& [name, total] : metrics.phases) {
+                out << "    " << padRight(name, 24) << padLeft(std::to_string(total.calls), 6) << " x  "
+                    << milliseconds(total.totalNs) << '\n';
+            }
+        }
+        
+        bool headerPrinted = false;
+        for (size_t h = 0; h < HistogramCount; ++h) {
+            Histogram histogram = static_cast<Histogram>(h);
+            uint64_t samples = metrics.samples(histogram);
+            if (samples == 0) continue;
+            if (!headerPrinted) {
+                out << "  Histograms (power-of-two buckets, upper bounds):" << '\n';
+                headerPrinted = true;
+            }
+            out << "    " << padRight(histogramName(histogram), 24) << "n=" << samples
+                << "  p50<=" << metrics.quantile(histogram, 0.5)
+                << "  p90<=" << metrics.quantile(histogram, 0.9)
+                << "  max<=" << metrics.quantile(histogram, 1.0) << '\n';
+        }
+    }
+
+    void CLI::printTreeStatistics(const TreeStatistics& stats) {
+        out << "Tree Statistics:" << '\n';
+        out << "  Root: " << stats.rootPath << '\n';
+        out << "  Files: " << stats.totalFiles << '\n';
+        out << "  Directories: " << stats.totalDirectories << '\n';
+        out << "  Other entries: " << stats.totalOther << '\n';
+        out << "  Total size: " << fileSize(stats.totalBytes) << '\n';
+        out << "  Max depth: " << stats.maxDepth << '\n';
+        out << "  Scan time: " << stats.scanTime.count() << " ms" << '\n';
+        
+        std::vector<std::pair<std::string, TreeStatistics::ExtensionStats>> extensions(
+            stats.byExtension.begin(), stats.byExtension.end());
+        std::sort(extensions.begin(), extensions.end(), [](const auto& a, const auto& b) {
+            return a.second.bytes > b.second.bytes;
+        });
+        
+        out << '\n' << "By extension:" << '\n';
+        for (const auto& [extension, extStats] : extensions) {
+            out << "  " << padRight(extension, 16)
+                << padRight(std::to_string(extStats.count), 12)
+                << fileSize(extStats.bytes) << '\n';
+        }
+        
+        out << '\n' << "Size histogram:" << '\n';
+        for (size_t i = 0; i < TreeStatistics::SizeBucketCount; ++i) {
+            if (stats.sizeHistogram[i].count == 0) continue;
+            out << "  " << padRight(TreeStatistics::sizeBucketLabel(i), 24)
+                << padRight(std::to_string(stats.sizeHistogram[i].count), 12)
+                << fileSize(stats.sizeHistogram[i].bytes) << '\n';
+        }
+        
+        out << '\n' << "Age histogram:" << '\n';
+        for (size_t i = 0; i < TreeStatistics::AgeBucketCount; ++i) {
+            out << "  " << padRight(TreeStatistics::ageBucketLabel(i), 24)
+                << padRight(std::to_string(stats.ageHistogram[i].count), 12)
+                << fileSize(stats.ageHistogram[i].bytes) << '\n';
+        }
+        
+        out << '\n' << "Largest files:" << '\n';
+        for (const auto& entry : stats.largestFiles) {
+            out << "  " << padRight(formatFileSize(entry.value), 12) << entry.path << '\n';
+        }
+        
+        out << '\n' << "Deepest paths:" << '\n';
+        for (const auto& entry : stats.deepestPaths) {
+            out << "  " << padRight(std::to_string(entry.value), 12) << entry.path << '\n';
+        }
+        
+        out << '\n' << "Directories with most entries:" << '\n';
+        for (const auto& entry : stats.busiestDirectories) {
+            out << "  " << padRight(std::to_string(entry.value), 12) << entry.path << '\n';
+        }
     }
 
     void CLI::handleClear(const std::vector<std::string>& args) {
+        out.flush();
         #ifdef _WIN32
             system("cls");
         #else
@@ -491,51 +1307,70 @@ namespace FileSystemManager {
     }
 
     void CLI::printError(const std::string& message) {
-        std::cout << "❌ Error: " << message << std::endl;
+        if (records.isStructured()) {
+            records.writeError(message);
+            return;
+        }
+        out << "❌ Error: " << message << '\n';
     }
 
     void CLI::printSuccess(const std::string& message) {
-        std::cout << "✅ " << message << std::endl;
+        if (records.isStructured()) return;
+        out << "✅ " << message << '\n';
     }
 
     void CLI::printInfo(const std::string& message) {
-        std::cout << "ℹ️  " << message << std::endl;
+        if (records.isStructured()) return;
+        out << "ℹ️  " << message << '\n';
     }
 
     void CLI::printFileInfo(const FileInfo& info) {
-        std::cout << "Name: " << info.name << std::endl;
-        std::cout << "Path: " << info.path << std::endl;
-        std::cout << "Size: " << formatFileSize(info.size) << std::endl;
-        std::cout << "Modified: " << info.lastModified << std::endl;
-        std::cout << "Type: " << (info.isDirectory ? "Directory" : "File") << std::endl;
+        if (records.isStructured()) {
+            records.writeFileInfo(info);
+            return;
+        }
+        out << "Name: " << info.name << '\n';
+        out << "Path: " << info.path << '\n';
+        out << "Size: " << fileSize(info.size) << '\n';
+        out << "Modified: " << info.lastModified << '\n';
+        out << "Type: " << (info.isDirectory ? "Directory" : "File") << '\n';
     }
 
     void CLI::printSearchResult(const SearchResult& result) {
-        std::cout << "File: " << result.filePath << std::endl;
-        std::cout << "Size: " << formatFileSize(result.fileSize) << std::endl;
-        std::cout << "Modified: " << result.lastModified << std::endl;
+        if (records.isStructured()) {
+            records.writeSearchResult(result);
+            return;
+        }
+        out << "File: " << result.filePath << '\n';
+        out << "Size: " << fileSize(result.fileSize) << '\n';
+        out << "Modified: " << result.lastModified << '\n';
         if (!result.matchingLines.empty()) {
-            std::cout << "Matching lines:" << std::endl;
+            out << "Matching lines:" << '\n';
             for (const auto& line : result.matchingLines) {
-                std::cout << "  " << line << std::endl;
+                out << "  " << describeLineMatch(line) << '\n';
             }
         }
     }
 
     void CLI::printOperationResult(const OperationResult& result) {
+        if (records.isStructured()) {
+            records.writeOperationResult(result);
+            return;
+        }
         if (result.success) {
             printSuccess("Operation completed successfully");
+            if (!result.message.empty()) printInfo(result.message);
         } else {
             printError("Operation failed: " + result.message);
         }
         
-        std::cout << "Files processed: " << result.filesProcessed << std::endl;
-        std::cout << "Files skipped: " << result.filesSkipped << std::endl;
+        out << "Files processed: " << result.filesProcessed << '\n';
+        out << "Files skipped: " << result.filesSkipped << '\n';
         
         if (!result.errors.empty()) {
-            std::cout << "Errors:" << std::endl;
+            out << "Errors:" << '\n';
             for (const auto& error : result.errors) {
-                std::cout << "  " << error << std::endl;
+                out << "  " << error << '\n';
             }
         }
     }
@@ -551,15 +1386,15 @@ namespace FileSystemManager {
     void CLI::printTable(const std::vector<std::vector<std::string>>& data, const std::vector<std::string>& headers) {
         // Simple table printing implementation
         for (const auto& header : headers) {
-            std::cout << std::setw(20) << header;
+            out << padLeft(header, 20);
         }
-        std::cout << std::endl;
+        out << '\n';
         
         for (const auto& row : data) {
             for (const auto& cell : row) {
-                std::cout << std::setw(20) << cell;
+                out << padLeft(cell, 20);
             }
-            std::cout << std::endl;
+            out << '\n';
         }
     }
 
@@ -571,6 +1406,67 @@ namespace FileSystemManager {
         this->verbose = verbose;
     }
 
+    void CLI::setOutputFormat(OutputFormat format, bool withFormattedFields) {
+        records.setFormat(format, withFormattedFields);
+        // Timestamp strings are only built when someone is going to read them
+        searchEngine.setFormatTimestamps(format == OutputFormat::Human || withFormattedFields);
+    }
+
+    void CLI::setOutputDescriptor(int fd) {
+        out.setFileDescriptor(fd);
+    }
+
+    void CLI::setTreeCache(std::shared_ptr<TreeCache> cache) {
+        treeCache = std::move(cache);
+    }
+
+    void CLI::setIoThrottle(std::shared_ptr<IoThrottle> throttle) {
+        ioThrottle = std::move(throttle);
+        searchEngine.setIoThrottle(ioThrottle);
+        batchOps.setIoThrottle(ioThrottle);
+    }
+
+    void CLI::setIoLimits(const IoLimits& limits) {
+        ioThrottle->setLimits(limits);
+    }
+
+    void CLI::setOperationTimeout(std::chrono::milliseconds timeout) {
+        searchEngine.setTimeout(timeout);
+        batchOps.setTimeout(timeout);
+    }
+
+    void CLI::setProgressInterval(std::chrono::milliseconds interval) {
+        if (interval.count() <= 0) {
+            batchOps.setProgressReporter(ProgressTracker::Callback());
+            return;
+        }
+        // stderr, one line rewritten in place, so results on stdout stay clean
+        batchOps.setProgressReporter([](const ProgressSnapshot& snapshot) {
+            char line[160];
+            int length = std::snprintf(line, sizeof(line), "\r%zu", snapshot.filesDone);
+            if (snapshot.filesTotal > 0) {
+                length += std::snprintf(line + length, sizeof(line) - length, "/%zu files (%.1f%%)", snapshot.filesTotal,
+                                        100.0 * snapshot.filesDone / snapshot.filesTotal);
+            } else {
+                length += std::snprintf(line + length, sizeof(line) - length, " files");
+            }
+            length += std::snprintf(line + length, sizeof(line) - length, ", %.0f files/s", snapshot.filesPerSecond);
+            if (snapshot.bytesPerSecond > 0) {
+                std::string rate = FileSystemManager::formatFileSize(static_cast<size_t>(snapshot.bytesPerSecond));
+                length += std::snprintf(line + length, sizeof(line) - length, ", %s/s", rate.c_str());
+            }
+            if (snapshot.finished) {
+                length += std::snprintf(line + length, sizeof(line) - length, " in %.1f s\x1b[K\n", snapshot.elapsedSeconds);
+            } else if (snapshot.etaSeconds >= 0) {
+                length += std::snprintf(line + length, sizeof(line) - length, ", ETA %.0f s\x1b[K", snapshot.etaSeconds);
+            } else {
+                length += std::snprintf(line + length, sizeof(line) - length, "\x1b[K");
+            }
+            std::fwrite(line, 1, std::min(static_cast<size_t>(length), sizeof(line) - 1), stderr);
+            std::fflush(stderr);
+        }, interval);
+    }
+
     void CLI::enableAutoComplete() {
         // Placeholder for auto-complete functionality
     }
@@ -583,7 +1479,7 @@ namespace FileSystemManager {
         std::ofstream file(filePath);
         if (file.is_open()) {
             for (const auto& command : commandHistory) {
-                file << command << std::endl;
+                file << command << '\n';
             }
             file.close();
         }
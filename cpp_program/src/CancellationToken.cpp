@@ -0,0 +1,35 @@
+#include "CancellationToken.h"
+
+namespace FileSystemManager {
+
+    void CancellationToken::cancel() {
+        State running = State::Running;
+        state.compare_exchange_strong(running, State::Cancelled, std::memory_order_relaxed);
+    }
+
+    void CancellationToken::setDeadline(std::chrono::steady_clock::time_point deadline) {
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        int64_t current = deadlineNs.load(std::memory_order_relaxed);
+        while (ns < current && !deadlineNs.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    void CancellationToken::setTimeout(std::chrono::nanoseconds timeout) {
+        if (timeout.count() <= 0) return;
+        setDeadline(std::chrono::steady_clock::now() + timeout);
+    }
+
+    bool CancellationToken::hasDeadline() const {
+        return deadlineNs.load(std::memory_order_relaxed) != INT64_MAX;
+    }
+
+    CancellationToken::State CancellationToken::getState() const {
+        isCancelled();
+        return state.load(std::memory_order_relaxed);
+    }
+
+    std::string CancellationToken::describe() const {
+        return getState() == State::TimedOut ? "Operation timed out" : "Operation cancelled";
+    }
+
+}
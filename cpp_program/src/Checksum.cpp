@@ -0,0 +1,276 @@
+#include "Checksum.h"
+#include "Common.h"
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+        constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+        constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+        uint64_t rotateLeft(uint64_t value, int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // The hash is defined on little-endian words
+        uint64_t read64(const unsigned char* data) {
+            uint64_t value;
+            std::memcpy(&value, data, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = __builtin_bswap64(value);
+#endif
+            return value;
+        }
+
+        uint32_t read32(const unsigned char* data) {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = __builtin_bswap32(value);
+#endif
+            return value;
+        }
+
+        uint64_t round(uint64_t lane, uint64_t input) {
+            lane += input * Prime2;
+            return rotateLeft(lane, 31) * Prime1;
+        }
+
+        uint64_t mergeRound(uint64_t hash, uint64_t lane) {
+            hash ^= round(0, lane);
+            return hash * Prime1 + Prime4;
+        }
+
+        // Folds whole 32-byte stripes into the lanes; returns the bytes used
+        size_t consumeStripes(uint64_t* lanes, const unsigned char* data, size_t length) {
+            const unsigned char* start = data;
+            const unsigned char* limit = data + length - length % 32;
+            uint64_t v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+            for (; data < limit; data += 32) {
+                v1 = round(v1, read64(data));
+                v2 = round(v2, read64(data + 8));
+                v3 = round(v3, read64(data + 16));
+                v4 = round(v4, read64(data + 24));
+            }
+            lanes[0] = v1;
+            lanes[1] = v2;
+            lanes[2] = v3;
+            lanes[3] = v4;
+            return static_cast<size_t>(data - start);
+        }
+
+        void appendEscaped(std::string& out, const std::string& path) {
+            for (char c : path) {
+                if (c == '\\') out += "\\\\";
+                else if (c == '\n') out += "\\n";
+                else out += c;
+            }
+        }
+
+        bool unescape(std::string_view text, std::string& path) {
+            path.clear();
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] != '\\') {
+                    path += text[i];
+                    continue;
+                }
+                if (++i == text.size()) return false;
+                if (text[i] == '\\') path += '\\';
+                else if (text[i] == 'n') path += '\n';
+                else return false;
+            }
+            return true;
+        }
+
+        // "<hash> <size> <mtime> <path>"
+        bool parseLine(std::string_view line, std::string& path, ManifestEntry& entry) {
+            size_t first = line.find(' ');
+            if (first == std::string_view::npos) return false;
+            size_t second = line.find(' ', first + 1);
+            if (second == std::string_view::npos) return false;
+            size_t third = line.find(' ', second + 1);
+            if (third == std::string_view::npos || third + 1 == line.size()) return false;
+
+            if (!Xxh64::fromHex(std::string(line.substr(0, first)), entry.hash)) return false;
+            const char* sizeEnd = line.data() + second;
+            auto sized = std::from_chars(line.data() + first + 1, sizeEnd, entry.size);
+            if (sized.ec != std::errc() || sized.ptr != sizeEnd) return false;
+            const char* timeEnd = line.data() + third;
+            auto timed = std::from_chars(line.data() + second + 1, timeEnd, entry.modifiedNs);
+            if (timed.ec != std::errc() || timed.ptr != timeEnd) return false;
+            return unescape(line.substr(third + 1), path);
+        }
+
+    }
+
+    Xxh64::Xxh64(uint64_t hashSeed) : seed(hashSeed) {
+        reset();
+    }
+
+    void Xxh64::reset() {
+        lanes[0] = seed + Prime1 + Prime2;
+        lanes[1] = seed + Prime2;
+        lanes[2] = seed;
+        lanes[3] = seed - Prime1;
+        pendingLength = 0;
+        totalLength = 0;
+    }
+
+    void Xxh64::update(const void* data, size_t length) {
+        const unsigned char* input = static_cast<const unsigned char*>(data);
+        totalLength += length;
+
+        if (pendingLength + length < sizeof(pending)) {
+            std::memcpy(pending + pendingLength, input, length);
+            pendingLength += length;
+            return;
+        }
+        if (pendingLength > 0) {
+            size_t fill = sizeof(pending) - pendingLength;
+            std::memcpy(pending + pendingLength, input, fill);
+            consumeStripes(lanes, pending, sizeof(pending));
+            input += fill;
+            length -= fill;
+            pendingLength = 0;
+        }
+        size_t used = consumeStripes(lanes, input, length);
+        pendingLength = length - used;
+        std::memcpy(pending, input + used, pendingLength);
+    }
+
+    uint64_t Xxh64::digest() const {
+        uint64_t hash;
+        if (totalLength >= 32) {
+            hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+            for (uint64_t lane : lanes) hash = mergeRound(hash, lane);
+        } else {
+            hash = seed + Prime5;
+        }
+        hash += totalLength;
+
+        const unsigned char* tail = pending;
+        const unsigned char* end = pending + pendingLength;
+        for (; tail + 8 <= end; tail += 8) {
+            hash ^= round(0, read64(tail));
+            hash = rotateLeft(hash, 27) * Prime1 + Prime4;
+        }
+        if (tail + 4 <= end) {
+            hash ^= static_cast<uint64_t>(read32(tail)) * Prime1;
+            hash = rotateLeft(hash, 23) * Prime2 + Prime3;
+            tail += 4;
+        }
+        for (; tail < end; ++tail) {
+            hash ^= *tail * Prime5;
+            hash = rotateLeft(hash, 11) * Prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    uint64_t Xxh64::hash(const void* data, size_t length, uint64_t seed) {
+        Xxh64 state(seed);
+        state.update(data, length);
+        return state.digest();
+    }
+
+    std::string Xxh64::toHex(uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return std::string(text, 16);
+    }
+
+    bool Xxh64::fromHex(const std::string& text, uint64_t& value) {
+        if (text.size() != 16) return false;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value, 16);
+        return ec == std::errc() && end == text.data() + text.size();
+    }
+
+    std::string ChecksumManifest::pathFor(const std::string& directory) {
+        return (fs::path(directory) / FileName).string();
+    }
+
+    bool ChecksumManifest::load(const std::string& path, std::string& error) {
+        entries.clear();
+        std::ifstream input(path, std::ios::binary);
+        if (!input.is_open()) {
+            std::error_code ec;
+            if (!fs::exists(path, ec)) return true;
+            error = "cannot open " + path;
+            return false;
+        }
+
+        std::string line;
+        std::string relative;
+        size_t lineNumber = 0;
+        while (std::getline(input, line)) {
+            lineNumber++;
+            if (line.empty()) continue;
+            ManifestEntry entry;
+            if (!parseLine(line, relative, entry)) {
+                error = path + ":" + std::to_string(lineNumber) + ": not a checksum line";
+                entries.clear();
+                return false;
+            }
+            entries[relative] = entry;
+        }
+        return true;
+    }
+
+    bool ChecksumManifest::save(const std::string& path, std::string& error) const {
+        std::string temporary = path + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file) {
+            error = "cannot create " + temporary + ": " + std::strerror(errno);
+            return false;
+        }
+        std::string line;
+        for (const auto& [relative, entry] : entries) {
+            line = Xxh64::toHex(entry.hash);
+            line += ' ';
+            line += std::to_string(entry.size);
+            line += ' ';
+            line += std::to_string(entry.modifiedNs);
+            line += ' ';
+            appendEscaped(line, relative);
+            line += '\n';
+            std::fwrite(line.data(), 1, line.size(), file);
+        }
+        bool written = std::ferror(file) == 0;
+        written = std::fclose(file) == 0 && written;
+        std::error_code ec;
+        if (written) fs::rename(temporary, path, ec);
+        if (!written || ec) {
+            error = "cannot write " + path;
+            fs::remove(temporary, ec);
+            return false;
+        }
+        return true;
+    }
+
+    const ManifestEntry* ChecksumManifest::find(const std::string& relativePath) const {
+        auto it = entries.find(relativePath);
+        return it == entries.end() ? nullptr : &it->second;
+    }
+
+    void ChecksumManifest::set(const std::string& relativePath, const ManifestEntry& entry) {
+        entries[relativePath] = entry;
+    }
+
+    bool ChecksumManifest::erase(const std::string& relativePath) {
+        return entries.erase(relativePath) > 0;
+    }
+
+}
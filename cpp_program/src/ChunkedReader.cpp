@@ -0,0 +1,241 @@
+#include "ChunkedReader.h"
+#include "ByteScan.h"
+#include "Instrumentation.h"
+#include "IoThrottle.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    std::string ScanWindow::excerpt(const char* lineStart, const char* lineEnd, const char* focus, size_t focusLength,
+                                    size_t maxLength) const {
+        const char* begin = lineStart;
+        const char* end = lineEnd;
+        if (maxLength > 0 && static_cast<size_t>(end - begin) > maxLength) {
+            // Center the focus, then pull the window back inside the line
+            size_t context = maxLength > focusLength ? (maxLength - focusLength) / 2 : 0;
+            begin = focus - std::min(context, static_cast<size_t>(focus - lineStart));
+            end = std::min(lineEnd, begin + maxLength);
+            begin = std::max(lineStart, end - maxLength);
+        }
+
+        std::string text;
+        text.reserve(static_cast<size_t>(end - begin) + 6);
+        const char* windowStart = data.data();
+        const char* windowEnd = windowStart + data.size();
+        if (begin > lineStart || (lineStart == windowStart && startsMidLine)) text += "...";
+        text.append(begin, end);
+        if (end < lineEnd || (lineEnd == windowEnd && endsMidLine)) text += "...";
+        return text;
+    }
+
+    ChunkedReader::ChunkedReader(const ScanLimits& scanLimits, size_t overlapBytes)
+        : limits(scanLimits), overlap(0), used(0), consumed(0), carried(0), bufferOffset(0), bufferLine(1),
+          bufferStartsMidLine(false), fileOffset(0), dataEnd(0), bytesRead(0), atEnd(true),
+          holeAhead(false), truncated(false), throttle(nullptr), cancellation(nullptr)
+#ifndef _WIN32
+          , fd(-1)
+#endif
+    {
+        // A window must hold at least a page, and the overlap must leave
+        // room in it for new data
+        limits.windowSize = std::max<size_t>(limits.windowSize, 4096);
+        overlap = std::min(overlapBytes, limits.windowSize / 2);
+    }
+
+    ChunkedReader::~ChunkedReader() {
+        close();
+    }
+
+    void ChunkedReader::setThrottle(IoThrottle* ioThrottle, const CancellationToken* stop) {
+        throttle = ioThrottle;
+        cancellation = stop;
+    }
+
+    bool ChunkedReader::isOpen() const {
+#ifndef _WIN32
+        return fd >= 0;
+#else
+        return stream != nullptr;
+#endif
+    }
+
+    bool ChunkedReader::open(const std::string& path) {
+        close();
+#ifndef _WIN32
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+#else
+        stream = std::make_unique<std::ifstream>(path, std::ios::binary);
+        if (!stream->is_open()) {
+            stream.reset();
+            return false;
+        }
+#endif
+        Instrumentation::add(Counter::FilesOpened);
+        if (!buffer) buffer.reset(new char[limits.windowSize]);
+        used = 0;
+        consumed = 0;
+        carried = 0;
+        bufferOffset = 0;
+        bufferLine = 1;
+        bufferStartsMidLine = false;
+        fileOffset = 0;
+        dataEnd = 0;
+        bytesRead = 0;
+        atEnd = false;
+        holeAhead = false;
+        truncated = false;
+        return true;
+    }
+
+    void ChunkedReader::close() {
+        if (!isOpen()) return;
+#ifndef _WIN32
+        ::close(fd);
+        fd = -1;
+#else
+        stream.reset();
+#endif
+        Instrumentation::add(Counter::BytesRead, bytesRead);
+        Instrumentation::record(Histogram::FileBytesRead, bytesRead);
+    }
+
+    bool ChunkedReader::seekData() {
+#if !defined(_WIN32) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+        off_t data = ::lseek(fd, static_cast<off_t>(fileOffset), SEEK_DATA);
+        if (data < 0) {
+            // ENXIO: only a hole (or nothing) is left; otherwise SEEK_DATA is
+            // unsupported and the rest of the file is read as it comes
+            if (errno == ENXIO) return false;
+            dataEnd = UINT64_MAX;
+            return true;
+        }
+        if (static_cast<uint64_t>(data) > fileOffset) {
+            Instrumentation::add(Counter::SparseBytesSkipped, static_cast<uint64_t>(data) - fileOffset);
+            if (used > carried) {
+                holeAhead = true;
+            } else {
+                // Only the overlap is buffered, and the hole cuts it off
+                used = 0;
+                carried = 0;
+            }
+            fileOffset = static_cast<uint64_t>(data);
+        }
+        off_t hole = ::lseek(fd, data, SEEK_HOLE);
+        dataEnd = hole > data ? static_cast<uint64_t>(hole) : UINT64_MAX;
+#else
+        dataEnd = UINT64_MAX;
+#endif
+        return true;
+    }
+
+    size_t ChunkedReader::readAt(char* destination, size_t length) {
+#ifndef _WIN32
+        while (true) {
+            ssize_t count = ::pread(fd, destination, length, static_cast<off_t>(fileOffset));
+            if (count >= 0) return static_cast<size_t>(count);
+            if (errno != EINTR) return 0;
+        }
+#else
+        stream->read(destination, static_cast<std::streamsize>(length));
+        return static_cast<size_t>(stream->gcount());
+#endif
+    }
+
+    void ChunkedReader::fill(size_t target) {
+        while (used < target && !atEnd && !holeAhead) {
+            if (fileOffset >= dataEnd && !seekData()) {
+                atEnd = true;
+                break;
+            }
+            if (holeAhead) break;
+            if (used == 0) bufferOffset = fileOffset;
+
+            size_t length = target - used;
+            length = static_cast<size_t>(std::min<uint64_t>(length, dataEnd - fileOffset));
+            if (limits.maxFileBytes > 0) {
+                if (bytesRead >= limits.maxFileBytes) {
+                    // Only a scan with data left over was cut short
+                    char probe;
+                    truncated = readAt(&probe, 1) > 0;
+                    if (truncated) Instrumentation::add(Counter::ScansTruncated);
+                    atEnd = true;
+                    break;
+                }
+                length = static_cast<size_t>(std::min<uint64_t>(length, limits.maxFileBytes - bytesRead));
+            }
+
+            size_t count = readAt(buffer.get() + used, length);
+            if (count == 0) {
+                atEnd = true;
+                break;
+            }
+            used += count;
+            fileOffset += count;
+            bytesRead += count;
+            if (throttle) throttle->acquire(count, 1, cancellation);
+        }
+    }
+
+    bool ChunkedReader::peek(size_t length, std::string_view& sample, uint64_t& offset) {
+        if (!isOpen()) return false;
+        fill(std::min(length, limits.windowSize));
+        if (used == 0) return false;
+        sample = std::string_view(buffer.get(), std::min(length, used));
+        offset = bufferOffset;
+        return true;
+    }
+
+    bool ChunkedReader::next(ScanWindow& window) {
+        if (!isOpen()) return false;
+
+        // Keep what the last window left over (a partial line, or the overlap)
+        if (consumed > 0) {
+            bufferLine += countByte(buffer.get(), buffer.get() + consumed, '\n');
+            bufferOffset += consumed;
+            used -= consumed;
+            std::memmove(buffer.get(), buffer.get() + consumed, used);
+            consumed = 0;
+        }
+        fill(limits.windowSize);
+        if (used == carried) return false;
+
+        const char* begin = buffer.get();
+        window.offset = bufferOffset;
+        window.firstLine = bufferLine;
+        window.startsMidLine = bufferStartsMidLine;
+        window.endsMidLine = false;
+        size_t length = used;
+        carried = 0;
+        if (holeAhead) {
+            // The hole ends the window; nothing is repeated across it
+            window.endsMidLine = begin[used - 1] != '\n';
+            consumed = used;
+            holeAhead = false;
+        } else if (atEnd) {
+            consumed = used;
+        } else {
+            const char* lastNewline = findLastByte(begin, begin + used, '\n');
+            if (lastNewline) {
+                length = static_cast<size_t>(lastNewline - begin) + 1;
+                consumed = length;
+            } else {
+                // One line fills the window: hand it out and repeat its tail
+                window.endsMidLine = true;
+                consumed = used - overlap;
+                carried = overlap;
+            }
+        }
+        window.data = std::string_view(begin, length);
+        bufferStartsMidLine = window.endsMidLine;
+        return true;
+    }
+
+}
@@ -1,6 +1,11 @@
 #include "Common.h"
+#include "Instrumentation.h"
 #include <algorithm>
-#include <regex>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 
 namespace FileSystemManager {
 
@@ -16,8 +21,12 @@ namespace FileSystemManager {
                 auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
                     ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
                 lastModified = formatTimestamp(sctp);
+                modifiedTime = std::chrono::duration_cast<std::chrono::seconds>(sctp.time_since_epoch()).count();
                 
                 isDirectory = fs::is_directory(filePath);
+                Instrumentation::add(Counter::StatCalls, isDirectory ? 4 : 5);
+            } else {
+                Instrumentation::add(Counter::StatCalls);
             }
         } catch (const std::exception& e) {
             // Handle errors gracefully
@@ -30,8 +39,29 @@ namespace FileSystemManager {
         }
     }
 
+    std::string describeLineMatch(const LineMatch& match) {
+        std::string text = "Line " + std::to_string(match.lineNumber);
+        if (!match.keywords.empty()) {
+            text += " [";
+            for (size_t i = 0; i < match.keywords.size(); ++i) {
+                if (i > 0) text += ", ";
+                text += match.keywords[i];
+            }
+            text += ']';
+        }
+        text += ": ";
+        text += match.text;
+        return text;
+    }
+
     std::string formatFileSize(size_t bytes) {
-        const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+        char buffer[32];
+        size_t length = formatFileSize(bytes, buffer, sizeof(buffer));
+        return std::string(buffer, length);
+    }
+
+    size_t formatFileSize(uint64_t bytes, char* buffer, size_t capacity) {
+        static const char* units[] = {" B", " KB", " MB", " GB", " TB"};
         int unit = 0;
         double size = static_cast<double>(bytes);
         
@@ -40,9 +70,15 @@ namespace FileSystemManager {
             unit++;
         }
         
-        std::ostringstream oss;
-        oss << std::fixed << std::setprecision(1) << size << " " << units[unit];
-        return oss.str();
+        // to_chars avoids the locale and stream setup cost of ostringstream
+        auto conversion = std::to_chars(buffer, buffer + capacity, size, std::chars_format::fixed, 1);
+        if (conversion.ec != std::errc()) return 0;
+        
+        size_t length = static_cast<size_t>(conversion.ptr - buffer);
+        size_t unitLength = std::strlen(units[unit]);
+        if (length + unitLength > capacity) return length;
+        std::memcpy(buffer + length, units[unit], unitLength);
+        return length + unitLength;
     }
 
     std::string getCurrentTimestamp() {
@@ -52,13 +88,141 @@ namespace FileSystemManager {
 
     std::string formatTimestamp(const std::chrono::system_clock::time_point& time) {
         auto time_t = std::chrono::system_clock::to_time_t(time);
-        auto tm = *std::localtime(&time_t);
+        std::tm tm{};
+        // Reentrant variants: results are formatted from parallel walks
+#ifdef _WIN32
+        localtime_s(&tm, &time_t);
+#else
+        localtime_r(&time_t, &tm);
+#endif
         
         std::ostringstream oss;
         oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
         return oss.str();
     }
 
+    bool parseTimestamp(const std::string& text, bool endOfRange, int64_t& epochNs) {
+        int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+        char separator = 0;
+        int fields = std::sscanf(text.c_str(), "%4d-%2d-%2d%c%2d:%2d:%2d",
+                                 &year, &month, &day, &separator, &hour, &minute, &second);
+        bool dateOnly = fields == 3;
+        if (!dateOnly && !(fields >= 6 && (separator == ' ' || separator == 'T'))) return false;
+        if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+        std::tm tm{};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_min = minute;
+        tm.tm_sec = second;
+        tm.tm_isdst = -1;
+        std::time_t seconds = std::mktime(&tm);
+        if (seconds == static_cast<std::time_t>(-1)) return false;
+
+        const int64_t nsPerSecond = 1000000000LL;
+        epochNs = static_cast<int64_t>(seconds) * nsPerSecond;
+        if (endOfRange) {
+            // An upper bound covers the whole day (or second) it names
+            epochNs += (dateOnly ? 24 * 60 * 60 : 1) * nsPerSecond - 1;
+        }
+        return true;
+    }
+
+    namespace {
+
+        // Whether a strftime format shows anything finer than the day (or a
+        // zone offset, which can change within one)
+        bool showsTimeOfDay(const std::string& format) {
+            for (size_t i = 0; i + 1 < format.size(); ++i) {
+                if (format[i] != '%') continue;
+                char specifier = format[++i];
+                if ((specifier == 'E' || specifier == 'O') && i + 1 < format.size()) specifier = format[++i];
+                if (specifier != '%' && std::strchr("cHIklMpPrRsSTXzZ+", specifier)) return true;
+            }
+            return false;
+        }
+
+    }
+
+    DayFormatter::DayFormatter(const std::string& dateFormat)
+        : timeFormat(dateFormat), perSecond(showsTimeOfDay(dateFormat)), last(spans.end()) {
+    }
+
+    bool DayFormatter::format(int64_t modifiedNs, std::string& text) {
+        auto covers = [](Spans::const_iterator span, int64_t seconds) {
+            return seconds >= span->first && seconds < span->second.first;
+        };
+
+        int64_t seconds = modifiedNs / 1000000000LL;
+        if (modifiedNs % 1000000000LL < 0) --seconds;
+
+        if (last != spans.end() && covers(last, seconds)) {
+            text = last->second.second;
+            return true;
+        }
+        auto next = spans.upper_bound(seconds);
+        if (next != spans.begin() && covers(std::prev(next), seconds)) {
+            last = std::prev(next);
+            text = last->second.second;
+            return true;
+        }
+
+        std::time_t time = static_cast<std::time_t>(seconds);
+        std::tm tm{};
+#ifdef _WIN32
+        localtime_s(&tm, &time);
+#else
+        localtime_r(&time, &tm);
+#endif
+        char formatted[256];
+        size_t length = std::strftime(formatted, sizeof(formatted), timeFormat.c_str(), &tm);
+        if (length == 0) return false;
+
+        int64_t start = seconds;
+        int64_t end = seconds + 1;
+        if (!perSecond) {
+            // mktime normalises the day after the last of the month
+            // and finds midnight across DST changes
+            std::tm midnight = tm;
+            midnight.tm_hour = midnight.tm_min = midnight.tm_sec = 0;
+            midnight.tm_isdst = -1;
+            std::time_t dayStart = std::mktime(&midnight);
+            midnight = tm;
+            midnight.tm_hour = midnight.tm_min = midnight.tm_sec = 0;
+            midnight.tm_mday += 1;
+            midnight.tm_isdst = -1;
+            std::time_t dayEnd = std::mktime(&midnight);
+            if (dayStart != static_cast<std::time_t>(-1) && dayStart <= seconds && dayEnd > seconds) {
+                start = dayStart;
+                end = dayEnd;
+            }
+        }
+        last = spans.emplace(start, std::make_pair(end, std::string(formatted, length))).first;
+        text = last->second.second;
+        return true;
+    }
+
+    bool parseByteSize(const std::string& text, uint64_t& bytes) {
+        if (text.empty()) return false;
+        char* end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (end == text.c_str() || value < 0) return false;
+
+        std::string unit = toLowerCase(std::string(end));
+        double multiplier = 1;
+        if (unit.empty() || unit == "b") multiplier = 1;
+        else if (unit == "k" || unit == "kb") multiplier = 1024.0;
+        else if (unit == "m" || unit == "mb") multiplier = 1024.0 * 1024;
+        else if (unit == "g" || unit == "gb") multiplier = 1024.0 * 1024 * 1024;
+        else if (unit == "t" || unit == "tb") multiplier = 1024.0 * 1024 * 1024 * 1024;
+        else return false;
+
+        bytes = static_cast<uint64_t>(value * multiplier);
+        return true;
+    }
+
     bool isValidPath(const std::string& path) {
         try {
             fs::path p(path);
@@ -68,6 +232,21 @@ namespace FileSystemManager {
         }
     }
 
+    std::string cacheDirectory() {
+        fs::path base;
+        const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+        const char* home = std::getenv("HOME");
+        if (cacheHome && *cacheHome) {
+            base = cacheHome;
+        } else if (home && *home) {
+            base = fs::path(home) / ".cache";
+        } else {
+            std::error_code ec;
+            base = fs::temp_directory_path(ec);
+        }
+        return (base / "fsmanager").string();
+    }
+
     std::vector<std::string> splitString(const std::string& str, char delimiter) {
         std::vector<std::string> tokens;
         std::stringstream ss(str);
@@ -89,26 +268,85 @@ namespace FileSystemManager {
     }
 
     bool matchesPattern(const std::string& filename, const std::string& pattern) {
-        try {
-            // Convert glob pattern to regex
-            std::string regexPattern = pattern;
-            
-            // Escape special regex characters except * and ?
-            regexPattern = std::regex_replace(regexPattern, std::regex(R"([\[\](){}^$+\.|\\])"), R"(\$&)");
-            
-            // Convert glob patterns to regex
-            regexPattern = std::regex_replace(regexPattern, std::regex(R"(\*)"), R"(.*)");
-            regexPattern = std::regex_replace(regexPattern, std::regex(R"(\?)"), R"(.)");
-            
-            // Add anchors
-            regexPattern = "^" + regexPattern + "$";
-            
-            std::regex regex(regexPattern, std::regex_constants::icase);
-            return std::regex_match(filename, regex);
-        } catch (const std::exception&) {
-            // If regex fails, fall back to simple substring matching
-            return toLowerCase(filename).find(toLowerCase(pattern)) != std::string::npos;
+        return GlobPattern(pattern).matches(filename);
+    }
+
+    GlobPattern::GlobPattern() : caseSensitive(false) {
+    }
+
+    GlobPattern::GlobPattern(const std::string& glob, bool caseSensitive)
+        : pattern(caseSensitive ? glob : toLowerCase(glob)), caseSensitive(caseSensitive) {
+    }
+
+    bool GlobPattern::matches(std::string_view name) const {
+        // Iterative wildcard matching: on a mismatch, backtrack to the most
+        // recent '*' and let it absorb one more character
+        size_t p = 0;
+        size_t n = 0;
+        size_t starPattern = std::string::npos;
+        size_t starName = 0;
+        
+        while (n < name.size()) {
+            char c = caseSensitive ? name[n] : static_cast<char>(::tolower(static_cast<unsigned char>(name[n])));
+            if (p < pattern.size() && (pattern[p] == '?' || (pattern[p] != '*' && pattern[p] == c))) {
+                p++;
+                n++;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                starPattern = p++;
+                starName = n;
+            } else if (starPattern != std::string::npos) {
+                p = starPattern + 1;
+                n = ++starName;
+            } else {
+                return false;
+            }
+        }
+        
+        while (p < pattern.size() && pattern[p] == '*') {
+            p++;
+        }
+        return p == pattern.size();
+    }
+
+    const std::string& GlobPattern::getPattern() const {
+        return pattern;
+    }
+
+    std::string escapeJson(const std::string& str) {
+        std::string result;
+        result.reserve(str.size() + 2);
+        for (unsigned char c : str) {
+            switch (c) {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        const char* hex = "0123456789abcdef";
+                        result += "\\u00";
+                        result += hex[c >> 4];
+                        result += hex[c & 0x0F];
+                    } else {
+                        result += static_cast<char>(c);
+                    }
+            }
+        }
+        return result;
+    }
+
+    std::string escapeCsv(const std::string& str) {
+        if (str.find_first_of(",\"\r\n") == std::string::npos) {
+            return str;
         }
+        std::string result = "\"";
+        for (char c : str) {
+            if (c == '"') result += '"';
+            result += c;
+        }
+        result += '"';
+        return result;
     }
 
 }
@@ -0,0 +1,159 @@
+#include "ContentClassifier.h"
+#include "ByteScan.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        // Formats that are never worth searching as text
+        const std::unordered_set<std::string>& binaryExtensions() {
+            static const std::unordered_set<std::string> extensions = {
+                "png", "jpg", "jpeg", "gif", "bmp", "ico", "webp", "tif", "tiff", "psd", "heic",
+                "mp3", "mp4", "m4a", "m4v", "avi", "mov", "mkv", "webm", "wav", "flac", "ogg",
+                "zip", "gz", "tgz", "bz2", "xz", "zst", "7z", "rar", "jar", "war", "whl", "deb", "rpm",
+                "o", "obj", "a", "so", "dll", "exe", "dylib", "lib", "class", "pyc", "pyo", "wasm",
+                "woff", "woff2", "ttf", "otf", "eot",
+                "pdf", "doc", "docx", "xls", "xlsx", "ppt", "pptx", "odt", "ods",
+                "sqlite", "db", "iso", "dmg", "img"
+            };
+            return extensions;
+        }
+
+    }
+
+    size_t ContentClassifier::KeyHash::operator()(const Key& key) const {
+        uint64_t hash = key.inode * 0x9e3779b97f4a7c15ULL;
+        hash ^= key.device + 0x632be59bd9b4e019ULL + (hash << 6) + (hash >> 2);
+        hash ^= static_cast<uint64_t>(key.modifiedNs) + (hash << 6) + (hash >> 2);
+        hash ^= key.size + (hash << 6) + (hash >> 2);
+        return static_cast<size_t>(hash);
+    }
+
+    bool ContentClassifier::keyFor(const EntryMetadata& metadata, Key& key) {
+        // Without an inode (Windows) there is no stable identity to cache by
+        if (metadata.inode == 0) return false;
+        key = Key{metadata.device, metadata.inode, metadata.modifiedNs, metadata.size};
+        return true;
+    }
+
+    ContentClassifier& ContentClassifier::shared() {
+        static ContentClassifier classifier;
+        return classifier;
+    }
+
+    ContentVerdict ContentClassifier::classifyContent(const char* data, size_t size) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        ContentVerdict verdict;
+        verdict.kind = ContentKind::Text;
+
+        if (size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+            verdict.encoding = TextEncoding::Utf8Bom;
+            return verdict;
+        }
+        if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+            // FF FE 00 00 is UTF-32, which is not handled as text
+            if (!(size >= 4 && bytes[2] == 0 && bytes[3] == 0)) {
+                verdict.encoding = TextEncoding::Utf16LE;
+                return verdict;
+            }
+        } else if (size >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF) {
+            verdict.encoding = TextEncoding::Utf16BE;
+            return verdict;
+        }
+
+        size_t sampled = std::min(size, SampleSize);
+        const char* end = data + sampled;
+        // Any NUL, or more than one stray control byte in 32
+        if (findByte(data, end, 0) || countControlBytes(data, end) * 32 > sampled) {
+            verdict.kind = ContentKind::Binary;
+            return verdict;
+        }
+        verdict.encoding = TextEncoding::Plain;
+        return verdict;
+    }
+
+    bool ContentClassifier::hasBinaryExtension(std::string_view fileName) {
+        size_t dot = fileName.rfind('.');
+        if (dot == std::string_view::npos || dot == 0 || dot + 1 == fileName.size()) return false;
+        std::string extension(fileName.substr(dot + 1));
+        if (extension.size() > 8) return false;
+        for (char& c : extension) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return binaryExtensions().count(extension) > 0;
+    }
+
+    ContentVerdict ContentClassifier::classifyFile(const std::string& filePath) {
+        EntryMetadata metadata;
+        if (!DirectoryWalker::readPathMetadata(filePath, metadata, true) || !metadata.isRegularFile) {
+            return ContentVerdict();
+        }
+        return classifyFile(filePath, metadata);
+    }
+
+    ContentVerdict ContentClassifier::classifyFile(const std::string& filePath, const EntryMetadata& metadata) {
+        ContentVerdict verdict;
+        size_t nameStart = filePath.find_last_of("/\\");
+        std::string_view fileName = std::string_view(filePath).substr(nameStart == std::string::npos ? 0 : nameStart + 1);
+        if (classifyWithoutReading(fileName, metadata, verdict)) return verdict;
+
+        try {
+            std::ifstream file(filePath, std::ios::binary);
+            if (!file.is_open()) return ContentVerdict();
+            Instrumentation::add(Counter::FilesOpened);
+
+            char buffer[SampleSize];
+            file.read(buffer, sizeof(buffer));
+            size_t bytesRead = static_cast<size_t>(file.gcount());
+            Instrumentation::add(Counter::BytesRead, bytesRead);
+            return classifyBuffer(metadata, buffer, bytesRead);
+        } catch (const std::exception&) {
+            // Error handling
+        }
+        return ContentVerdict();
+    }
+
+    bool ContentClassifier::classifyWithoutReading(std::string_view fileName, const EntryMetadata& metadata,
+                                                   ContentVerdict& verdict) const {
+        if (hasBinaryExtension(fileName)) {
+            verdict.kind = ContentKind::Binary;
+            verdict.encoding = TextEncoding::None;
+            return true;
+        }
+
+        Key key;
+        if (!keyFor(metadata, key)) return false;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto found = verdicts.find(key);
+        if (found == verdicts.end()) return false;
+        Instrumentation::add(Counter::ClassifierCacheHits);
+        verdict = found->second;
+        return true;
+    }
+
+    ContentVerdict ContentClassifier::classifyBuffer(const EntryMetadata& metadata, const char* data, size_t size) {
+        ContentVerdict verdict = classifyContent(data, size);
+        Key key;
+        if (keyFor(metadata, key)) {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            if (verdicts.size() >= MaxCachedVerdicts) verdicts.clear();
+            verdicts[key] = verdict;
+        }
+        return verdict;
+    }
+
+    size_t ContentClassifier::getCachedCount() const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return verdicts.size();
+    }
+
+    void ContentClassifier::clear() {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        verdicts.clear();
+    }
+
+}
@@ -0,0 +1,334 @@
+#include "DaemonServer.h"
+#include "CLI.h"
+#include "ThreadPool.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <csignal>
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    namespace {
+
+        const size_t MaxRequestBytes = 64 * 1024;
+
+        // The request ends with its first exec or shutdown line
+        bool isRequestComplete(const std::string& request) {
+            size_t lineStart = 0;
+            size_t lineEnd;
+            while ((lineEnd = request.find('\n', lineStart)) != std::string::npos) {
+                if (request.compare(lineStart, 5, "exec ") == 0 || request.compare(lineStart, lineEnd - lineStart, "shutdown") == 0) {
+                    return true;
+                }
+                lineStart = lineEnd + 1;
+            }
+            return false;
+        }
+
+#ifndef _WIN32
+        DaemonServer* activeServer = nullptr;
+
+        void handleStopSignal(int) {
+            if (activeServer != nullptr) {
+                activeServer->stop();
+            }
+        }
+
+        bool fillAddress(const std::string& path, sockaddr_un& address) {
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return true;
+        }
+
+        int connectTo(const std::string& path) {
+            sockaddr_un address;
+            if (!fillAddress(path, address)) return -1;
+
+            int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) return -1;
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        bool sendAll(int fd, const std::string& data) {
+            const char* ptr = data.data();
+            size_t remaining = data.size();
+            while (remaining > 0) {
+                ssize_t written = ::send(fd, ptr, remaining, MSG_NOSIGNAL);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                ptr += written;
+                remaining -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+#endif
+
+    }
+
+    DaemonServer::DaemonServer(const std::string& path, size_t workers)
+        : socketPath(path.empty() ? defaultSocketPath() : path), listenFd(-1), running(false),
+          treeCache(std::make_shared<TreeCache>()), ioThrottle(std::make_shared<IoThrottle>()), workerCount(workers) {
+    }
+
+    DaemonServer::~DaemonServer() {
+#ifndef _WIN32
+        if (activeServer == this) {
+            activeServer = nullptr;
+        }
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            ::unlink(socketPath.c_str());
+        }
+#endif
+    }
+
+    std::string DaemonServer::defaultSocketPath() {
+#ifndef _WIN32
+        const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+        if (runtimeDir != nullptr && runtimeDir[0] != '\0') {
+            return std::string(runtimeDir) + "/fsmanager.sock";
+        }
+        return "/tmp/fsmanager-" + std::to_string(::getuid()) + ".sock";
+#else
+        return "";
+#endif
+    }
+
+    std::shared_ptr<TreeCache> DaemonServer::getTreeCache() const {
+        return treeCache;
+    }
+
+    std::shared_ptr<IoThrottle> DaemonServer::getIoThrottle() const {
+        return ioThrottle;
+    }
+
+    bool DaemonServer::start(std::string& error) {
+#ifndef _WIN32
+        sockaddr_un address;
+        if (!fillAddress(socketPath, address)) {
+            error = "Socket path is empty or too long: " + socketPath;
+            return false;
+        }
+
+        struct stat info;
+        if (::lstat(socketPath.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                error = "Refusing to replace non-socket file: " + socketPath;
+                return false;
+            }
+            int probe = connectTo(socketPath);
+            if (probe >= 0) {
+                ::close(probe);
+                error = "A daemon is already listening on " + socketPath;
+                return false;
+            }
+            // Left behind by a daemon that did not shut down cleanly
+            ::unlink(socketPath.c_str());
+        }
+
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            error = std::string("socket: ") + std::strerror(errno);
+            return false;
+        }
+
+        // Only the owner may talk to the daemon
+        mode_t previousMask = ::umask(0177);
+        int bound = ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        int bindError = errno;
+        ::umask(previousMask);
+        if (bound != 0 || ::listen(listenFd, SOMAXCONN) != 0) {
+            error = std::string("Cannot listen on ") + socketPath + ": " + std::strerror(bound != 0 ? bindError : errno);
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+
+        running = true;
+        activeServer = this;
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, handleStopSignal);
+        std::signal(SIGTERM, handleStopSignal);
+        return true;
+#else
+        error = "Daemon mode requires Unix domain sockets";
+        return false;
+#endif
+    }
+
+    void DaemonServer::stop() {
+        running = false;
+#ifndef _WIN32
+        if (listenFd >= 0) {
+            // Wakes up the blocked accept(); safe to call from a signal handler
+            ::shutdown(listenFd, SHUT_RDWR);
+        }
+#endif
+    }
+
+    void DaemonServer::serve() {
+#ifndef _WIN32
+        ThreadPool pool(workerCount);
+
+        while (running.load()) {
+            int clientFd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (clientFd < 0) {
+                if (!running.load()) break;
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EMFILE || errno == ENFILE) {
+                    // Out of descriptors; give in-flight requests a moment to finish
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    continue;
+                }
+                break;
+            }
+            pool.submit([this, clientFd]() { handleConnection(clientFd); });
+        }
+        // Pool destructor lets in-flight requests complete
+#endif
+    }
+
+    void DaemonServer::handleConnection(int clientFd) {
+#ifndef _WIN32
+        // A client that never finishes its request must not pin a worker
+        struct timeval timeout = {10, 0};
+        ::setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::string request;
+        char chunk[4096];
+        bool complete = false;
+        while (!complete && request.size() < MaxRequestBytes) {
+            ssize_t length = ::recv(clientFd, chunk, sizeof(chunk), 0);
+            if (length < 0 && errno == EINTR) continue;
+            if (length <= 0) break;
+            request.append(chunk, static_cast<size_t>(length));
+            complete = isRequestComplete(request);
+        }
+
+        std::string workingDirectory;
+        std::string command;
+        OutputFormat format = OutputFormat::Human;
+        bool formattedFields = false;
+        bool shutdownRequested = false;
+
+        size_t lineStart = 0;
+        while (lineStart < request.size()) {
+            size_t lineEnd = request.find('\n', lineStart);
+            if (lineEnd == std::string::npos) lineEnd = request.size();
+            std::string line = request.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+
+            if (line.rfind("cwd ", 0) == 0) {
+                workingDirectory = line.substr(4);
+            } else if (line.rfind("format ", 0) == 0) {
+                auto fields = splitString(line.substr(7), ' ');
+                if (!fields.empty()) parseOutputFormat(fields[0], format);
+                formattedFields = fields.size() > 1 && fields[1] == "timestamps";
+            } else if (line.rfind("exec ", 0) == 0) {
+                command = line.substr(5);
+                break;
+            } else if (line == "shutdown") {
+                shutdownRequested = true;
+                break;
+            }
+        }
+
+        if (shutdownRequested) {
+            sendAll(clientFd, "Daemon stopping\n");
+            ::close(clientFd);
+            stop();
+            return;
+        }
+
+        if (!command.empty()) {
+            try {
+                CLI session(workingDirectory.empty() ? fs::current_path().string() : workingDirectory);
+                session.setTreeCache(treeCache);
+                session.setIoThrottle(ioThrottle);
+                session.setOutputFormat(format, formattedFields);
+                session.setOutputDescriptor(clientFd);
+                session.executeCommand(command);
+            } catch (const std::exception& e) {
+                sendAll(clientFd, std::string("Error: ") + e.what() + "\n");
+            }
+        }
+        ::close(clientFd);
+#else
+        (void)clientFd;
+#endif
+    }
+
+    int DaemonServer::runClient(const std::string& path, const std::string& command,
+                                OutputFormat format, bool withFormattedFields) {
+#ifndef _WIN32
+        std::string target = path.empty() ? defaultSocketPath() : path;
+        int fd = connectTo(target);
+        if (fd < 0) {
+            std::cerr << "No daemon listening on " << target << " (start one with --daemon)" << std::endl;
+            return 1;
+        }
+
+        std::string request;
+        std::error_code ec;
+        std::string cwd = fs::current_path(ec).string();
+        if (!ec) {
+            request += "cwd " + cwd + "\n";
+        }
+        request += std::string("format ") + outputFormatName(format) + (withFormattedFields ? " timestamps" : "") + "\n";
+        request += command == "shutdown" ? std::string("shutdown\n") : "exec " + command + "\n";
+
+        if (!sendAll(fd, request)) {
+            std::cerr << "Failed to send request: " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return 1;
+        }
+        ::shutdown(fd, SHUT_WR);
+
+        // Stream the response straight through without reformatting
+        char buffer[64 * 1024];
+        while (true) {
+            ssize_t length = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (length < 0 && errno == EINTR) continue;
+            if (length <= 0) break;
+            const char* ptr = buffer;
+            size_t remaining = static_cast<size_t>(length);
+            while (remaining > 0) {
+                ssize_t written = ::write(1, ptr, remaining);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    ::close(fd);
+                    return 1;
+                }
+                ptr += written;
+                remaining -= static_cast<size_t>(written);
+            }
+        }
+        ::close(fd);
+        return 0;
+#else
+        (void)path;
+        (void)command;
+        (void)format;
+        (void)withFormattedFields;
+        std::cerr << "Daemon mode requires Unix domain sockets" << std::endl;
+        return 1;
+#endif
+    }
+
+}
@@ -0,0 +1,320 @@
+#include "DateIndex.h"
+#include "DirectoryWalker.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    namespace {
+
+        const char IndexMagic[8] = {'F', 'S', 'M', 'D', 'I', 'D', 'X', '1'};
+
+        size_t padTo8(size_t value) {
+            return (value + 7) & ~static_cast<size_t>(7);
+        }
+
+        std::string normalizeRoot(std::string root) {
+            while (root.size() > 1 && root.back() == '/') {
+                root.pop_back();
+            }
+            return root;
+        }
+
+        // Per-worker output of the build walk
+        struct WorkerRecords {
+            std::vector<DateIndex::Record> records;
+            std::vector<DateIndex::DirectoryRecord> directories;
+            std::string paths;
+        };
+
+    }
+
+    DateIndex::DateIndex()
+        : data(nullptr), dataSize(0), mapped(false), header(nullptr), records(nullptr), directories(nullptr), paths(nullptr) {
+    }
+
+    DateIndex::~DateIndex() {
+        close();
+    }
+
+    std::string DateIndex::defaultPathFor(const std::string& root) {
+        // FNV-1a of the root keeps one index file per tree
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : normalizeRoot(root)) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        char name[40];
+        std::snprintf(name, sizeof(name), "dateindex-%016llx.idx", static_cast<unsigned long long>(hash));
+
+        return (fs::path(cacheDirectory()) / name).string();
+    }
+
+    bool DateIndex::build(const std::string& root, const std::string& indexPath,
+                          size_t& recordCount, std::string& error) {
+        ScopedPhase phase("dateindex.build", root);
+        std::string normalizedRoot = normalizeRoot(root);
+
+        // Taken before the walk, so a file written while it runs is newer
+        // than the build and a directory changed after it was stat'ed no
+        // longer matches its record
+        int64_t builtAtNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        EntryMetadata rootMetadata;
+        if (!DirectoryWalker::readPathMetadata(normalizedRoot, rootMetadata, true) || !rootMetadata.isDirectory) {
+            error = "Not a directory: " + root;
+            return false;
+        }
+
+        DirectoryWalker walker;
+        std::vector<WorkerRecords> workers(walker.getThreadCount());
+        walker.walk(normalizedRoot, [&](size_t workerIndex, const WalkEntry& entry) {
+            WorkerRecords& local = workers[workerIndex];
+            EntryMetadata metadata;
+            if (entry.type == EntryType::Directory) {
+                // Stat'ed here, before the walk lists it
+                if (!DirectoryWalker::readMetadata(entry, metadata, false)) return;
+                local.directories.push_back({metadata.modifiedNs, local.paths.size()});
+            } else if (entry.type == EntryType::Regular || entry.type == EntryType::Symlink) {
+                if (!DirectoryWalker::readMetadata(entry, metadata, true) || !metadata.isRegularFile) return;
+                local.records.push_back({metadata.modifiedNs, metadata.size, local.paths.size()});
+            } else {
+                return;
+            }
+            entry.appendPath(local.paths);
+            local.paths.push_back('\0');
+        });
+
+        // Merge the per-worker path blobs, rebasing offsets
+        std::vector<Record> allRecords;
+        std::vector<DirectoryRecord> allDirectories;
+        std::string allPaths;
+        size_t totalRecords = 0;
+        size_t totalDirectories = 1;
+        size_t totalPathBytes = normalizedRoot.size() + 1;
+        for (const auto& local : workers) {
+            totalRecords += local.records.size();
+            totalDirectories += local.directories.size();
+            totalPathBytes += local.paths.size();
+        }
+        allRecords.reserve(totalRecords);
+        allDirectories.reserve(totalDirectories);
+        allPaths.reserve(totalPathBytes);
+        allDirectories.push_back({rootMetadata.modifiedNs, 0});
+        allPaths += normalizedRoot;
+        allPaths.push_back('\0');
+        for (auto& local : workers) {
+            uint64_t base = allPaths.size();
+            for (Record record : local.records) {
+                record.pathOffset += base;
+                allRecords.push_back(record);
+            }
+            for (DirectoryRecord directory : local.directories) {
+                directory.pathOffset += base;
+                allDirectories.push_back(directory);
+            }
+            allPaths += local.paths;
+            local = WorkerRecords();
+        }
+        std::sort(allRecords.begin(), allRecords.end(), [](const Record& a, const Record& b) {
+            return a.modifiedNs != b.modifiedNs ? a.modifiedNs < b.modifiedNs : a.pathOffset < b.pathOffset;
+        });
+
+        Header fileHeader{};
+        std::memcpy(fileHeader.magic, IndexMagic, sizeof(IndexMagic));
+        fileHeader.version = FormatVersion;
+        fileHeader.rootLength = static_cast<uint32_t>(normalizedRoot.size());
+        fileHeader.recordCount = allRecords.size();
+        fileHeader.directoryCount = allDirectories.size();
+        fileHeader.pathBytes = allPaths.size();
+        fileHeader.builtAtNs = builtAtNs;
+
+        try {
+            fs::path target(indexPath);
+            if (target.has_parent_path()) {
+                fs::create_directories(target.parent_path());
+            }
+
+            // Write beside the target and rename, so readers never see a partial index
+            std::string temporary = indexPath + ".tmp";
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                if (!file) {
+                    error = "Cannot write " + temporary;
+                    return false;
+                }
+                const char padding[8] = {};
+                file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+                file.write(normalizedRoot.data(), normalizedRoot.size());
+                file.write(padding, padTo8(normalizedRoot.size()) - normalizedRoot.size());
+                file.write(reinterpret_cast<const char*>(allRecords.data()), allRecords.size() * sizeof(Record));
+                file.write(reinterpret_cast<const char*>(allDirectories.data()), allDirectories.size() * sizeof(DirectoryRecord));
+                file.write(allPaths.data(), allPaths.size());
+                if (!file.flush()) {
+                    error = "Error writing " + temporary;
+                    return false;
+                }
+            }
+            Instrumentation::add(Counter::BytesWritten, sizeof(fileHeader) + padTo8(normalizedRoot.size()) +
+                                 allRecords.size() * sizeof(Record) + allDirectories.size() * sizeof(DirectoryRecord) +
+                                 allPaths.size());
+            fs::rename(temporary, target);
+        } catch (const std::exception& e) {
+            error = "Error writing date index: " + std::string(e.what());
+            return false;
+        }
+
+        recordCount = allRecords.size();
+        return true;
+    }
+
+    bool DateIndex::open(const std::string& indexPath, std::string& error) {
+        close();
+
+#ifndef _WIN32
+        int fd = ::open(indexPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "No date index at " + indexPath;
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+            ::close(fd);
+            error = "Invalid date index: " + indexPath;
+            return false;
+        }
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            error = "Cannot map date index: " + indexPath;
+            return false;
+        }
+        data = static_cast<const char*>(mapping);
+        dataSize = static_cast<size_t>(st.st_size);
+        mapped = true;
+#else
+        std::ifstream file(indexPath, std::ios::binary | std::ios::ate);
+        if (!file) {
+            error = "No date index at " + indexPath;
+            return false;
+        }
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        if (fileSize < sizeof(Header)) {
+            error = "Invalid date index: " + indexPath;
+            return false;
+        }
+        char* buffer = new char[fileSize];
+        file.seekg(0);
+        file.read(buffer, static_cast<std::streamsize>(fileSize));
+        data = buffer;
+        dataSize = fileSize;
+        mapped = false;
+#endif
+        Instrumentation::add(Counter::FilesOpened);
+
+        header = reinterpret_cast<const Header*>(data);
+        size_t recordsOffset = sizeof(Header) + padTo8(header->rootLength);
+        bool valid = std::memcmp(header->magic, IndexMagic, sizeof(IndexMagic)) == 0 &&
+                     header->version == FormatVersion &&
+                     recordsOffset <= dataSize &&
+                     header->recordCount <= (dataSize - recordsOffset) / sizeof(Record);
+        size_t directoriesOffset = valid ? recordsOffset + header->recordCount * sizeof(Record) : 0;
+        valid = valid && header->directoryCount <= (dataSize - directoriesOffset) / sizeof(DirectoryRecord);
+        size_t pathsOffset = valid ? directoriesOffset + header->directoryCount * sizeof(DirectoryRecord) : 0;
+        valid = valid && header->pathBytes == dataSize - pathsOffset;
+        if (!valid) {
+            close();
+            error = "Invalid date index: " + indexPath;
+            return false;
+        }
+
+        records = reinterpret_cast<const Record*>(data + recordsOffset);
+        directories = reinterpret_cast<const DirectoryRecord*>(data + directoriesOffset);
+        paths = data + pathsOffset;
+        return true;
+    }
+
+    void DateIndex::close() {
+        if (data) {
+#ifndef _WIN32
+            if (mapped) {
+                ::munmap(const_cast<char*>(data), dataSize);
+            } else {
+                delete[] data;
+            }
+#else
+            delete[] data;
+#endif
+        }
+        data = nullptr;
+        dataSize = 0;
+        mapped = false;
+        header = nullptr;
+        records = nullptr;
+        directories = nullptr;
+        paths = nullptr;
+    }
+
+    bool DateIndex::isOpen() const {
+        return header != nullptr;
+    }
+
+    std::string DateIndex::getRoot() const {
+        if (!header) return "";
+        return std::string(data + sizeof(Header), header->rootLength);
+    }
+
+    int64_t DateIndex::getBuiltAtNs() const {
+        return header ? header->builtAtNs : 0;
+    }
+
+    size_t DateIndex::size() const {
+        return header ? static_cast<size_t>(header->recordCount) : 0;
+    }
+
+    bool DateIndex::isUpToDate() const {
+        if (!header) return false;
+        EntryMetadata metadata;
+        for (const DirectoryRecord* directory = directories; directory != directories + header->directoryCount; ++directory) {
+            std::string_view path = pathAt(directory->pathOffset);
+            if (path.empty() || !DirectoryWalker::readPathMetadata(std::string(path), metadata, true) ||
+                !metadata.isDirectory || metadata.modifiedNs != directory->modifiedNs) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string_view DateIndex::pathAt(uint64_t offset) const {
+        if (offset >= header->pathBytes) return std::string_view();
+        const char* path = paths + offset;
+        return std::string_view(path, ::strnlen(path, static_cast<size_t>(header->pathBytes - offset)));
+    }
+
+    size_t DateIndex::forEachInRange(int64_t startNs, int64_t endNs, const RecordVisitor& visit) const {
+        if (!header || startNs > endNs) return 0;
+
+        const Record* end = records + header->recordCount;
+        const Record* first = std::lower_bound(records, end, startNs, [](const Record& record, int64_t value) {
+            return record.modifiedNs < value;
+        });
+
+        size_t visited = 0;
+        for (const Record* record = first; record != end && record->modifiedNs <= endNs; ++record) {
+            if (record->pathOffset >= header->pathBytes) continue;
+            visit(*record, pathAt(record->pathOffset));
+            visited++;
+        }
+        return visited;
+    }
+
+}
@@ -0,0 +1,841 @@
+#include "DfaRegex.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <memory>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        using ByteSet = std::array<uint64_t, 4>;
+
+        const int MaxRepeat = 1000;
+        const size_t MaxProgramSize = 200000;
+        const size_t MaxLiteralLength = 64;
+
+        void addByte(ByteSet& set, unsigned char byte) {
+            set[byte >> 6] |= uint64_t(1) << (byte & 63);
+        }
+
+        bool hasByte(const ByteSet& set, unsigned char byte) {
+            return (set[byte >> 6] >> (byte & 63)) & 1;
+        }
+
+        void addRange(ByteSet& set, unsigned char low, unsigned char high) {
+            for (unsigned value = low; value <= high; ++value) {
+                addByte(set, static_cast<unsigned char>(value));
+            }
+        }
+
+        void addWhere(ByteSet& set, int (*predicate)(int)) {
+            for (unsigned value = 0; value < 256; ++value) {
+                if (predicate(static_cast<int>(value))) addByte(set, static_cast<unsigned char>(value));
+            }
+        }
+
+        int isWordByte(int c) {
+            return std::isalnum(c) || c == '_';
+        }
+
+        // Whitespace within a line: like grep, classes never match the newline
+        int isLineSpace(int c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        ByteSet complement(const ByteSet& set) {
+            ByteSet result = {~set[0], ~set[1], ~set[2], ~set[3]};
+            result['\n' >> 6] &= ~(uint64_t(1) << ('\n' & 63));
+            return result;
+        }
+
+        struct Node {
+            enum class Kind { Empty, Bytes, Concat, Alternate, Repeat, LineStart, LineEnd };
+
+            Kind kind;
+            ByteSet bytes = {0, 0, 0, 0};
+            int literal = -1;       // The byte of a single literal character (lowercased if folding)
+            std::vector<std::unique_ptr<Node>> children;
+            int min = 0;
+            int max = 0;            // -1 = unbounded
+
+            explicit Node(Kind kind) : kind(kind) {}
+        };
+
+        using NodePtr = std::unique_ptr<Node>;
+
+        // Recursive descent over the ERE grammar:
+        //   alternation := concat ('|' concat)*
+        //   concat      := repeat*
+        //   repeat      := atom ('*' | '+' | '?' | '{m[,[n]]}')*
+        class Parser {
+        private:
+            const std::string& text;
+            size_t pos;
+            bool caseSensitive;
+
+            bool atEnd() const { return pos >= text.size(); }
+
+            bool fail(const std::string& message) {
+                if (error.empty()) {
+                    error = message + " at offset " + std::to_string(pos);
+                }
+                return false;
+            }
+
+            // Closes a set under ASCII case when matching case-insensitively
+            void foldCase(ByteSet& bytes) const {
+                if (caseSensitive) return;
+                for (unsigned value = 'a'; value <= 'z'; ++value) {
+                    unsigned char lower = static_cast<unsigned char>(value);
+                    unsigned char upper = static_cast<unsigned char>(std::toupper(lower));
+                    if (hasByte(bytes, lower) || hasByte(bytes, upper)) {
+                        addByte(bytes, lower);
+                        addByte(bytes, upper);
+                    }
+                }
+            }
+
+            NodePtr makeBytes(ByteSet bytes, int literal = -1) {
+                foldCase(bytes);
+                if (!caseSensitive && literal >= 0) literal = std::tolower(literal);
+                auto node = std::make_unique<Node>(Node::Kind::Bytes);
+                node->bytes = bytes;
+                node->literal = literal;
+                return node;
+            }
+
+            NodePtr makeLiteral(unsigned char byte) {
+                ByteSet bytes = {0, 0, 0, 0};
+                addByte(bytes, byte);
+                return makeBytes(bytes, byte);
+            }
+
+            // \d \w \s and their negations; returns false if c is not one
+            bool classEscape(char c, ByteSet& bytes) {
+                ByteSet positive = {0, 0, 0, 0};
+                switch (std::tolower(static_cast<unsigned char>(c))) {
+                    case 'd': addRange(positive, '0', '9'); break;
+                    case 'w': addWhere(positive, isWordByte); break;
+                    case 's': addWhere(positive, isLineSpace); break;
+                    default: return false;
+                }
+                bytes = std::isupper(static_cast<unsigned char>(c)) ? complement(positive) : positive;
+                return true;
+            }
+
+            // Single-byte escapes shared by atoms and bracket expressions
+            bool byteEscape(char c, unsigned char& byte) {
+                switch (c) {
+                    case 'n': byte = '\n'; return true;
+                    case 't': byte = '\t'; return true;
+                    case 'r': byte = '\r'; return true;
+                    case 'f': byte = '\f'; return true;
+                    case 'v': byte = '\v'; return true;
+                    case 'x': {
+                        if (pos + 2 > text.size() || !std::isxdigit(static_cast<unsigned char>(text[pos])) ||
+                            !std::isxdigit(static_cast<unsigned char>(text[pos + 1]))) {
+                            return fail("\\x needs two hex digits");
+                        }
+                        byte = static_cast<unsigned char>(std::stoi(text.substr(pos, 2), nullptr, 16));
+                        pos += 2;
+                        return true;
+                    }
+                    default:
+                        if (std::isalnum(static_cast<unsigned char>(c))) {
+                            if (std::isdigit(static_cast<unsigned char>(c))) return fail("backreferences are not supported");
+                            return fail(std::string("unsupported escape \\") + c);
+                        }
+                        byte = static_cast<unsigned char>(c);
+                        return true;
+                }
+            }
+
+            bool posixClass(const std::string& name, ByteSet& bytes) {
+                static const std::map<std::string, int (*)(int)> classes = {
+                    {"alpha", [](int c) { return std::isalpha(c); }}, {"digit", [](int c) { return std::isdigit(c); }},
+                    {"alnum", [](int c) { return std::isalnum(c); }}, {"upper", [](int c) { return std::isupper(c); }},
+                    {"lower", [](int c) { return std::islower(c); }}, {"space", isLineSpace},
+                    {"blank", [](int c) { return std::isblank(c); }}, {"punct", [](int c) { return std::ispunct(c); }},
+                    {"xdigit", [](int c) { return std::isxdigit(c); }}, {"print", [](int c) { return std::isprint(c); }},
+                    {"graph", [](int c) { return std::isgraph(c); }}, {"cntrl", [](int c) { return std::iscntrl(c); }}
+                };
+                auto found = classes.find(name);
+                if (found == classes.end()) return fail("unknown character class [:" + name + ":]");
+                addWhere(bytes, found->second);
+                bytes['\n' >> 6] &= ~(uint64_t(1) << ('\n' & 63));
+                return true;
+            }
+
+            NodePtr parseBracket() {
+                ByteSet bytes = {0, 0, 0, 0};
+                bool negate = !atEnd() && text[pos] == '^';
+                if (negate) pos++;
+
+                bool first = true;
+                while (true) {
+                    if (atEnd()) {
+                        fail("missing ']'");
+                        return nullptr;
+                    }
+                    char c = text[pos];
+                    if (c == ']' && !first) {
+                        pos++;
+                        break;
+                    }
+                    first = false;
+
+                    if (c == '[' && text.compare(pos, 2, "[:") == 0) {
+                        size_t close = text.find(":]", pos + 2);
+                        if (close == std::string::npos) {
+                            fail("missing ':]'");
+                            return nullptr;
+                        }
+                        if (!posixClass(text.substr(pos + 2, close - pos - 2), bytes)) return nullptr;
+                        pos = close + 2;
+                        continue;
+                    }
+
+                    unsigned char low = static_cast<unsigned char>(c);
+                    pos++;
+                    if (c == '\\') {
+                        if (atEnd()) {
+                            fail("trailing backslash");
+                            return nullptr;
+                        }
+                        char escaped = text[pos++];
+                        ByteSet classBytes;
+                        if (classEscape(escaped, classBytes)) {
+                            for (size_t i = 0; i < bytes.size(); ++i) bytes[i] |= classBytes[i];
+                            continue;
+                        }
+                        if (!byteEscape(escaped, low)) return nullptr;
+                    }
+
+                    // A range unless the '-' is the last character before ']'
+                    if (pos + 1 < text.size() && text[pos] == '-' && text[pos + 1] != ']') {
+                        pos++;
+                        unsigned char high = static_cast<unsigned char>(text[pos++]);
+                        if (high == '\\') {
+                            if (atEnd()) {
+                                fail("trailing backslash");
+                                return nullptr;
+                            }
+                            if (!byteEscape(text[pos++], high)) return nullptr;
+                        }
+                        if (high < low) {
+                            fail("invalid range");
+                            return nullptr;
+                        }
+                        addRange(bytes, low, high);
+                    } else {
+                        addByte(bytes, low);
+                    }
+                }
+                // Fold before negating so [^a] also excludes 'A'
+                foldCase(bytes);
+                return makeBytes(negate ? complement(bytes) : bytes);
+            }
+
+            NodePtr parseAtom() {
+                char c = text[pos++];
+                switch (c) {
+                    case '(': {
+                        if (text.compare(pos, 2, "?:") == 0) {
+                            pos += 2;
+                        } else if (!atEnd() && text[pos] == '?') {
+                            fail("lookaround and inline flags are not supported");
+                            return nullptr;
+                        }
+                        NodePtr inner = parseAlternation();
+                        if (!inner) return nullptr;
+                        if (atEnd() || text[pos] != ')') {
+                            fail("missing ')'");
+                            return nullptr;
+                        }
+                        pos++;
+                        return inner;
+                    }
+                    case '[':
+                        return parseBracket();
+                    case '.':
+                        return makeBytes(complement({0, 0, 0, 0}));
+                    case '^':
+                        return std::make_unique<Node>(Node::Kind::LineStart);
+                    case '$':
+                        return std::make_unique<Node>(Node::Kind::LineEnd);
+                    case '*':
+                    case '+':
+                    case '?':
+                        pos--;
+                        fail("nothing to repeat");
+                        return nullptr;
+                    case '\\': {
+                        if (atEnd()) {
+                            fail("trailing backslash");
+                            return nullptr;
+                        }
+                        char escaped = text[pos++];
+                        ByteSet bytes;
+                        if (classEscape(escaped, bytes)) return makeBytes(bytes);
+                        if (escaped == 'b' || escaped == 'B' || escaped == '<' || escaped == '>') {
+                            fail("word boundaries are not supported");
+                            return nullptr;
+                        }
+                        unsigned char byte = 0;
+                        if (!byteEscape(escaped, byte)) return nullptr;
+                        return makeLiteral(byte);
+                    }
+                    default:
+                        return makeLiteral(static_cast<unsigned char>(c));
+                }
+            }
+
+            // "{m}", "{m,}" or "{m,n}" at pos; anything else leaves '{' a literal
+            bool parseBounds(int& min, int& max) {
+                size_t cursor = pos + 1;
+                auto readNumber = [&](int& value) {
+                    size_t start = cursor;
+                    while (cursor < text.size() && std::isdigit(static_cast<unsigned char>(text[cursor]))) cursor++;
+                    if (cursor == start || cursor - start > 6) return false;
+                    value = std::stoi(text.substr(start, cursor - start));
+                    return true;
+                };
+                if (!readNumber(min)) return false;
+                max = min;
+                if (cursor < text.size() && text[cursor] == ',') {
+                    cursor++;
+                    if (!readNumber(max)) max = -1;
+                }
+                if (cursor >= text.size() || text[cursor] != '}') return false;
+                pos = cursor + 1;
+                return true;
+            }
+
+            NodePtr parseRepeat() {
+                NodePtr atom = parseAtom();
+                while (atom && !atEnd()) {
+                    int min = 0;
+                    int max = 0;
+                    char c = text[pos];
+                    if (c == '*') {
+                        min = 0; max = -1; pos++;
+                    } else if (c == '+') {
+                        min = 1; max = -1; pos++;
+                    } else if (c == '?') {
+                        min = 0; max = 1; pos++;
+                    } else if (c != '{' || !parseBounds(min, max)) {
+                        break;
+                    }
+                    if ((max >= 0 && min > max) || min > MaxRepeat || max > MaxRepeat) {
+                        fail("invalid repetition count");
+                        return nullptr;
+                    }
+                    // Lazy quantifiers match the same lines
+                    if (!atEnd() && text[pos] == '?') pos++;
+
+                    auto repeat = std::make_unique<Node>(Node::Kind::Repeat);
+                    repeat->min = min;
+                    repeat->max = max;
+                    repeat->children.push_back(std::move(atom));
+                    atom = std::move(repeat);
+                }
+                return atom;
+            }
+
+            NodePtr parseConcat() {
+                auto concat = std::make_unique<Node>(Node::Kind::Concat);
+                while (!atEnd() && text[pos] != '|' && text[pos] != ')') {
+                    NodePtr item = parseRepeat();
+                    if (!item) return nullptr;
+                    concat->children.push_back(std::move(item));
+                }
+                return concat;
+            }
+
+            NodePtr parseAlternation() {
+                NodePtr first = parseConcat();
+                if (!first || atEnd() || text[pos] != '|') return first;
+
+                auto alternate = std::make_unique<Node>(Node::Kind::Alternate);
+                alternate->children.push_back(std::move(first));
+                while (!atEnd() && text[pos] == '|') {
+                    pos++;
+                    NodePtr branch = parseConcat();
+                    if (!branch) return nullptr;
+                    alternate->children.push_back(std::move(branch));
+                }
+                return alternate;
+            }
+
+        public:
+            std::string error;
+
+            Parser(const std::string& text, bool caseSensitive) : text(text), pos(0), caseSensitive(caseSensitive) {}
+
+            NodePtr parse() {
+                NodePtr root = parseAlternation();
+                if (root && !atEnd()) {
+                    fail("unmatched ')'");
+                    return nullptr;
+                }
+                return error.empty() ? std::move(root) : nullptr;
+            }
+        };
+
+        // The strings a node contributes to the required-literal search
+        struct LiteralInfo {
+            bool exact = true;      // Every match of the node is exactly `text`
+            std::string text;
+            std::string best;       // Longest string contained in every match
+        };
+
+        void keepLonger(std::string& best, const std::string& candidate) {
+            if (candidate.size() > best.size()) best = candidate;
+        }
+
+        LiteralInfo analyzeLiterals(const Node& node) {
+            LiteralInfo info;
+            switch (node.kind) {
+                case Node::Kind::Empty:
+                case Node::Kind::LineStart:
+                case Node::Kind::LineEnd:
+                    break;
+                case Node::Kind::Bytes:
+                    if (node.literal >= 0) {
+                        info.text = std::string(1, static_cast<char>(node.literal));
+                        info.best = info.text;
+                    } else {
+                        info.exact = false;
+                    }
+                    break;
+                case Node::Kind::Concat: {
+                    // Adjacent exact children form one run; anything else breaks it
+                    std::string run;
+                    for (const auto& child : node.children) {
+                        LiteralInfo part = analyzeLiterals(*child);
+                        if (part.exact && run.size() + part.text.size() <= MaxLiteralLength) {
+                            run += part.text;
+                            continue;
+                        }
+                        info.exact = false;
+                        keepLonger(info.best, run);
+                        keepLonger(info.best, part.best);
+                        run = part.exact ? part.text : std::string();
+                    }
+                    keepLonger(info.best, run);
+                    if (info.exact) info.text = run;
+                    break;
+                }
+                case Node::Kind::Alternate:
+                    info.exact = false;
+                    break;
+                case Node::Kind::Repeat: {
+                    LiteralInfo part = analyzeLiterals(*node.children[0]);
+                    info.exact = false;
+                    if (node.min == 0) break;
+                    if (part.exact && node.min == node.max &&
+                        part.text.size() * static_cast<size_t>(node.min) <= MaxLiteralLength) {
+                        info.exact = true;
+                        for (int i = 0; i < node.min; ++i) info.text += part.text;
+                        info.best = info.text;
+                    } else {
+                        info.best = part.exact ? part.text : part.best;
+                    }
+                    break;
+                }
+            }
+            return info;
+        }
+
+        // Thompson construction: each fragment leaves dangling exits that are
+        // patched to whatever follows it
+        class Compiler {
+        private:
+            struct Fragment {
+                int start;
+                std::vector<std::pair<int, int>> exits;     // (instruction, 0 = out / 1 = out1)
+            };
+
+            std::map<ByteSet, int> setIndexes;
+
+            void patch(const std::vector<std::pair<int, int>>& exits, int target) {
+                for (const auto& exit : exits) {
+                    if (exit.second == 0) {
+                        program[exit.first].out = target;
+                    } else {
+                        program[exit.first].out1 = target;
+                    }
+                }
+            }
+
+            Fragment single(DfaRegex::OpCode op, int setIndex = -1) {
+                int index = emit(op, -1, -1, setIndex);
+                return Fragment{index, {{index, 0}}};
+            }
+
+            void append(Fragment& fragment, Fragment next) {
+                patch(fragment.exits, next.start);
+                fragment.exits = std::move(next.exits);
+            }
+
+        public:
+            std::vector<DfaRegex::Instruction>& program;
+            std::vector<ByteSet>& byteSets;
+            bool tooLarge = false;
+
+            Compiler(std::vector<DfaRegex::Instruction>& program, std::vector<ByteSet>& byteSets)
+                : program(program), byteSets(byteSets) {}
+
+            int emit(DfaRegex::OpCode op, int out, int out1, int setIndex) {
+                if (program.size() >= MaxProgramSize) tooLarge = true;
+                program.push_back({op, out, out1, setIndex});
+                return static_cast<int>(program.size() - 1);
+            }
+
+            Fragment compile(const Node& node) {
+                if (tooLarge) return single(DfaRegex::OpCode::Jump);
+                switch (node.kind) {
+                    case Node::Kind::Empty:
+                        return single(DfaRegex::OpCode::Jump);
+                    case Node::Kind::LineStart:
+                        return single(DfaRegex::OpCode::LineStart);
+                    case Node::Kind::LineEnd:
+                        return single(DfaRegex::OpCode::LineEnd);
+                    case Node::Kind::Bytes: {
+                        auto inserted = setIndexes.emplace(node.bytes, static_cast<int>(byteSets.size()));
+                        if (inserted.second) byteSets.push_back(node.bytes);
+                        return single(DfaRegex::OpCode::ByteSet, inserted.first->second);
+                    }
+                    case Node::Kind::Concat: {
+                        Fragment fragment = single(DfaRegex::OpCode::Jump);
+                        for (const auto& child : node.children) {
+                            append(fragment, compile(*child));
+                        }
+                        return fragment;
+                    }
+                    case Node::Kind::Alternate: {
+                        Fragment fragment = compile(*node.children.back());
+                        for (size_t i = node.children.size() - 1; i-- > 0;) {
+                            Fragment branch = compile(*node.children[i]);
+                            int split = emit(DfaRegex::OpCode::Split, branch.start, fragment.start, -1);
+                            branch.exits.insert(branch.exits.end(), fragment.exits.begin(), fragment.exits.end());
+                            fragment = Fragment{split, std::move(branch.exits)};
+                        }
+                        return fragment;
+                    }
+                    case Node::Kind::Repeat: {
+                        const Node& child = *node.children[0];
+                        Fragment fragment = single(DfaRegex::OpCode::Jump);
+                        for (int i = 0; i < node.min; ++i) {
+                            append(fragment, compile(child));
+                        }
+                        if (node.max < 0) {
+                            Fragment body = compile(child);
+                            int split = emit(DfaRegex::OpCode::Split, body.start, -1, -1);
+                            patch(body.exits, split);
+                            append(fragment, Fragment{split, {{split, 1}}});
+                        } else {
+                            for (int i = node.min; i < node.max; ++i) {
+                                Fragment body = compile(child);
+                                int split = emit(DfaRegex::OpCode::Split, body.start, -1, -1);
+                                body.exits.push_back({split, 1});
+                                append(fragment, Fragment{split, std::move(body.exits)});
+                            }
+                        }
+                        return fragment;
+                    }
+                }
+                return single(DfaRegex::OpCode::Jump);
+            }
+
+            int finish(const Node& root) {
+                Fragment fragment = compile(root);
+                int match = emit(DfaRegex::OpCode::Match, -1, -1, -1);
+                patch(fragment.exits, match);
+                return fragment.start;
+            }
+        };
+
+    }
+
+    DfaRegex::DfaRegex() : caseSensitive(true), valid(false), newlineMatchable(false), startAnchored(false), endAnchored(false), startInstruction(0) {
+        byteClasses.fill(0);
+    }
+
+    bool DfaRegex::compile(const std::string& regexPattern, bool caseSensitive, std::string& error) {
+        Instrumentation::add(Counter::RegexCompilations);
+        *this = DfaRegex();
+        pattern = regexPattern;
+        this->caseSensitive = caseSensitive;
+
+        Parser parser(pattern, caseSensitive);
+        NodePtr root = parser.parse();
+        if (!root) {
+            error = parser.error;
+            return false;
+        }
+
+        Compiler compiler(program, byteSets);
+        startInstruction = compiler.finish(*root);
+        if (compiler.tooLarge) {
+            error = "pattern too large";
+            return false;
+        }
+
+        for (const auto& set : byteSets) {
+            if (hasByte(set, '\n')) newlineMatchable = true;
+        }
+        for (const auto& instruction : program) {
+            if (instruction.op == OpCode::LineStart) startAnchored = true;
+            if (instruction.op == OpCode::LineEnd) endAnchored = true;
+        }
+
+        // Partition bytes by which sets contain them; '\n' is always kept
+        // apart since it decides where '^' and '$' hold
+        std::map<std::string, uint8_t> classBySignature;
+        std::string signature;
+        for (unsigned value = 0; value < 256; ++value) {
+            unsigned char byte = static_cast<unsigned char>(value);
+            signature.assign(1, byte == '\n' ? '\1' : '\0');
+            for (const auto& set : byteSets) {
+                signature += hasByte(set, byte) ? '1' : '0';
+            }
+            auto inserted = classBySignature.emplace(signature, static_cast<uint8_t>(classRepresentatives.size()));
+            if (inserted.second) classRepresentatives.push_back(byte);
+            byteClasses[byte] = inserted.first->second;
+        }
+
+        requiredLiteral = analyzeLiterals(*root).best;
+        literalFinder = LiteralFinder(requiredLiteral, caseSensitive);
+        valid = true;
+        return true;
+    }
+
+    RegexMatcher::RegexMatcher(const DfaRegex& regex) : regex(regex), flushCount(0), generation(0) {
+        startStates[0] = startStates[1] = -1;
+        visited.assign(regex.program.size(), 0);
+    }
+
+    void RegexMatcher::flush() {
+        states.clear();
+        stateFlags.clear();
+        transitions.clear();
+        stateIndex.clear();
+        startStates[0] = startStates[1] = -1;
+        flushCount++;
+    }
+
+    void RegexMatcher::closure(bool lineStart, bool lineEndKnown, bool atLineEnd, std::vector<int>& out) {
+        out.clear();
+        if (++generation == 0) {
+            std::fill(visited.begin(), visited.end(), 0);
+            generation = 1;
+        }
+
+        stack.assign(seeds.begin(), seeds.end());
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            if (visited[index] == generation) continue;
+            visited[index] = generation;
+
+            const DfaRegex::Instruction& instruction = regex.program[index];
+            switch (instruction.op) {
+                case DfaRegex::OpCode::ByteSet:
+                case DfaRegex::OpCode::Match:
+                    out.push_back(index);
+                    break;
+                case DfaRegex::OpCode::Split:
+                    stack.push_back(instruction.out1);
+                    stack.push_back(instruction.out);
+                    break;
+                case DfaRegex::OpCode::Jump:
+                    stack.push_back(instruction.out);
+                    break;
+                case DfaRegex::OpCode::LineStart:
+                    if (lineStart) stack.push_back(instruction.out);
+                    break;
+                case DfaRegex::OpCode::LineEnd:
+                    // Decided by the next byte, so kept in the set until then
+                    if (!lineEndKnown) {
+                        out.push_back(index);
+                    } else if (atLineEnd) {
+                        stack.push_back(instruction.out);
+                    }
+                    break;
+            }
+        }
+        std::sort(out.begin(), out.end());
+    }
+
+    int RegexMatcher::stateFor(const std::vector<int>& instructions, bool anchored) {
+        keyBuffer.assign(1, anchored ? '\1' : '\0');
+        keyBuffer.append(reinterpret_cast<const char*>(instructions.data()), instructions.size() * sizeof(int));
+        auto found = stateIndex.find(keyBuffer);
+        if (found != stateIndex.end()) return found->second;
+
+        if (states.size() >= MaxStates) {
+            flush();
+        }
+
+        uint8_t flags = instructions.empty() ? Dead : 0;
+        seeds.clear();
+        for (int index : instructions) {
+            const DfaRegex::Instruction& instruction = regex.program[index];
+            if (instruction.op == DfaRegex::OpCode::Match) flags |= MatchNow | MatchAtLineEnd;
+            if (instruction.op == DfaRegex::OpCode::LineEnd) seeds.push_back(instruction.out);
+        }
+        if (!(flags & MatchAtLineEnd) && !seeds.empty()) {
+            std::vector<int> resolved;
+            closure(false, true, true, resolved);
+            for (int index : resolved) {
+                if (regex.program[index].op == DfaRegex::OpCode::Match) flags |= MatchAtLineEnd;
+            }
+        }
+
+        int index = static_cast<int>(states.size());
+        states.push_back({instructions, anchored});
+        stateFlags.push_back(flags);
+        transitions.resize(transitions.size() + regex.getClassCount(), -1);
+        stateIndex.emplace(keyBuffer, index);
+        return index;
+    }
+
+    int RegexMatcher::startState(bool anchored) {
+        int& start = startStates[anchored ? 1 : 0];
+        if (start < 0) {
+            seeds.assign(1, regex.startInstruction);
+            closure(true, false, false, closureSet);
+            int index = stateFor(closureSet, anchored);
+            startStates[anchored ? 1 : 0] = index;
+            return index;
+        }
+        return start;
+    }
+
+    int RegexMatcher::computeTransition(int state, unsigned char byte) {
+        // Copied: building the target may grow (or flush) the state table
+        std::vector<int> current = states[state].instructions;
+        bool anchored = states[state].anchored;
+        bool newline = byte == '\n';
+
+        // '$' holds right before a newline
+        if (newline) {
+            seeds.clear();
+            for (int index : current) {
+                if (regex.program[index].op == DfaRegex::OpCode::LineEnd) seeds.push_back(regex.program[index].out);
+            }
+            if (!seeds.empty()) {
+                std::vector<int> resolved;
+                closure(false, true, true, resolved);
+                current.insert(current.end(), resolved.begin(), resolved.end());
+            }
+        }
+
+        seeds.clear();
+        for (int index : current) {
+            const DfaRegex::Instruction& instruction = regex.program[index];
+            if (instruction.op == DfaRegex::OpCode::ByteSet && hasByte(regex.byteSets[instruction.setIndex], byte)) {
+                seeds.push_back(instruction.out);
+            }
+        }
+        // Unanchored search: a match may also begin after this byte
+        if (!anchored) seeds.push_back(regex.startInstruction);
+        closure(newline, false, false, closureSet);
+
+        size_t flushesBefore = flushCount;
+        int target = stateFor(closureSet, anchored);
+        if (flushCount == flushesBefore) {
+            transitions[static_cast<size_t>(state) * regex.getClassCount() + regex.byteClasses[byte]] = target;
+        }
+        return target;
+    }
+
+    const char* RegexMatcher::findMatchEnd(const char* begin, const char* end) {
+        int state = startState(false);
+        const char* p = begin;
+        while (true) {
+            uint8_t flags = stateFlags[state];
+            if (flags & MatchNow) return p;
+            if ((flags & MatchAtLineEnd) && (p == end || *p == '\n')) return p;
+            if (p == end) return nullptr;
+            state = next(state, static_cast<unsigned char>(*p++));
+        }
+    }
+
+    bool RegexMatcher::fullMatch(std::string_view text) {
+        if (!regex.isValid()) return false;
+        int state = startState(true);
+        for (char c : text) {
+            if (stateFlags[state] & Dead) return false;
+            state = next(state, static_cast<unsigned char>(c));
+        }
+        return (stateFlags[state] & (MatchNow | MatchAtLineEnd)) != 0;
+    }
+
+    size_t RegexMatcher::forEachMatchingLine(std::string_view buffer, const LineVisitor& visit, size_t maxLines) {
+        if (!regex.isValid()) return 0;
+        const char* data = buffer.data();
+        const char* end = data + buffer.size();
+        const LiteralFinder& finder = regex.literalFinder;
+
+        // Nothing can match when the required literal never occurs
+        if (!finder.empty() && !finder.find(data, end)) return 0;
+
+        size_t matches = 0;
+        size_t lineNumber = 1;
+        const char* counted = data;     // Newlines before here are in lineNumber
+        auto report = [&](const char* lineStart) {
+            const char* lineEnd = findByte(lineStart, end, '\n');
+            if (!lineEnd) lineEnd = end;
+            lineNumber += countByte(counted, lineStart, '\n');
+            counted = lineStart;
+            visit(lineNumber, std::string_view(lineStart, static_cast<size_t>(lineEnd - lineStart)));
+            matches++;
+            return lineEnd;
+        };
+
+        const char* cursor = data;
+        if (!finder.empty() && !regex.canMatchNewline()) {
+            // Matches stay within a line, so only lines holding the literal
+            // are handed to the DFA; the rest is skipped by the vector scan
+            while (cursor < end && matches < maxLines) {
+                const char* candidate = finder.find(cursor, end);
+                if (!candidate) break;
+                const char* lineStart = findLastByte(cursor, candidate, '\n');
+                lineStart = lineStart ? lineStart + 1 : cursor;
+                const char* lineEnd = findByte(candidate, end, '\n');
+                if (!lineEnd) lineEnd = end;
+                if (findMatchEnd(lineStart, lineEnd)) report(lineStart);
+                if (lineEnd == end) break;
+                cursor = lineEnd + 1;
+            }
+            return matches;
+        }
+
+        // One DFA pass over the whole buffer, restarted after each matching line
+        while (cursor < end && matches < maxLines) {
+            const char* matchEnd = findMatchEnd(cursor, end);
+            if (!matchEnd) break;
+            // A match ending in '\n' belongs to the line that newline ends
+            // (only patterns that can match '\n' may consume one)
+            const char* anchor = matchEnd;
+            if (regex.canMatchNewline() && matchEnd > cursor && matchEnd[-1] == '\n') --anchor;
+            // An empty match after the final newline is not on a line
+            if (anchor == end && end[-1] == '\n') break;
+            const char* lineStart = findLastByte(cursor, anchor, '\n');
+            const char* lineEnd = report(lineStart ? lineStart + 1 : cursor);
+            if (lineEnd == end) break;
+            cursor = lineEnd + 1;
+        }
+        return matches;
+    }
+
+    bool RegexMatcher::contains(std::string_view buffer) {
+        return forEachMatchingLine(buffer, [](size_t, std::string_view) {}, 1) > 0;
+    }
+
+}
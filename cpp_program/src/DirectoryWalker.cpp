@@ -0,0 +1,292 @@
+#include "DirectoryWalker.h"
+#include "CancellationToken.h"
+#include "IoThrottle.h"
+#include "Instrumentation.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    DirectoryWalker::DirectoryWalker() : options() {
+    }
+
+    DirectoryWalker::DirectoryWalker(const WalkOptions& walkOptions) : options(walkOptions) {
+    }
+
+    size_t DirectoryWalker::getThreadCount() const {
+        if (options.threadCount > 0) return options.threadCount;
+        size_t hardware = std::thread::hardware_concurrency();
+        return hardware > 0 ? hardware : 1;
+    }
+
+    namespace {
+
+#ifndef _WIN32
+        EntryType typeFromMode(mode_t mode) {
+            if (S_ISREG(mode)) return EntryType::Regular;
+            if (S_ISDIR(mode)) return EntryType::Directory;
+            if (S_ISLNK(mode)) return EntryType::Symlink;
+            return EntryType::Other;
+        }
+
+        EntryType typeFromDirent(const struct dirent* entry) {
+#ifdef DT_UNKNOWN
+            switch (entry->d_type) {
+                case DT_REG: return EntryType::Regular;
+                case DT_DIR: return EntryType::Directory;
+                case DT_LNK: return EntryType::Symlink;
+                case DT_UNKNOWN: return EntryType::Unknown;
+                default: return EntryType::Other;
+            }
+#else
+            (void)entry;
+            return EntryType::Unknown;
+#endif
+        }
+
+        void fillMetadata(const struct stat& st, EntryMetadata& metadata) {
+            metadata.size = static_cast<uint64_t>(st.st_size);
+            metadata.modifiedNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+            metadata.device = static_cast<uint64_t>(st.st_dev);
+            metadata.inode = static_cast<uint64_t>(st.st_ino);
+            metadata.isRegularFile = S_ISREG(st.st_mode);
+            metadata.isDirectory = S_ISDIR(st.st_mode);
+        }
+#endif
+
+        // Arenas owned by one worker
+        struct WorkerArenas {
+            PathArena directories;      // Queued directories; live for the whole walk
+            PathArena scratch;          // Everything else; rewound per directory
+        };
+
+    }
+
+    void DirectoryWalker::walk(const std::string& root, const EntryVisitor& onEntry, const DirectoryVisitor& onDirectory,
+                               const DescendFilter& shouldDescend) const {
+        ScopedPhase phase("walk", root);
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        std::deque<std::pair<const PathNode*, int>> pending;
+        size_t activeWorkers = 0;
+
+        size_t threadCount = getThreadCount();
+        std::vector<WorkerArenas> arenas(threadCount);
+        pending.emplace_back(arenas[0].directories.makeRoot(root), 0);
+
+        auto cancelled = [this]() {
+            return options.cancellation && options.cancellation->isCancelled();
+        };
+
+        auto worker = [&](size_t workerIndex) {
+            WorkerArenas& arena = arenas[workerIndex];
+            std::vector<std::pair<const PathNode*, int>> subdirectories;
+            std::string directoryPath;
+
+            while (true) {
+                std::pair<const PathNode*, int> current;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    queueChanged.wait(lock, [&]() { return !pending.empty() || activeWorkers == 0; });
+                    if (cancelled()) pending.clear();
+                    if (pending.empty()) {
+                        // Nothing queued and nobody left to produce more work
+                        queueChanged.notify_all();
+                        return;
+                    }
+                    // LIFO keeps the working set close to a depth-first walk
+                    current = pending.back();
+                    pending.pop_back();
+                    activeWorkers++;
+                }
+
+                size_t entryCount = 0;
+                subdirectories.clear();
+                arena.scratch.reset();
+
+                // Visits an entry; returns whether a directory entry should be descended into
+                auto visit = [&](const WalkEntry& entry, bool descend) {
+                    entryCount++;
+                    try {
+                        onEntry(workerIndex, entry);
+                        if (descend && shouldDescend) {
+                            descend = shouldDescend(workerIndex, entry);
+                        }
+                    } catch (const std::exception&) {
+                        // A failing visitor must not take down the whole walk
+                    }
+                    return descend;
+                };
+
+                directoryPath.clear();
+                current.first->appendPath(directoryPath);
+                int childDepth = current.second + 1;
+                if (options.throttle) options.throttle->acquire(0, 1, options.cancellation);
+
+#ifndef _WIN32
+                int fd = ::open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                DIR* directory = fd >= 0 ? ::fdopendir(fd) : nullptr;
+                if (fd >= 0 && !directory) {
+                    ::close(fd);
+                }
+
+                // Unreadable directories are skipped like permission-denied ones
+                while (directory && !cancelled()) {
+                    struct dirent* dirEntry = ::readdir(directory);
+                    if (!dirEntry) break;
+                    const char* name = dirEntry->d_name;
+                    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                        continue;
+                    }
+
+                    EntryType type = typeFromDirent(dirEntry);
+                    struct stat st;
+                    if (type == EntryType::Unknown) {
+                        // Filesystems without d_type need one lstat to classify
+                        Instrumentation::add(Counter::StatCalls);
+                        if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                            type = typeFromMode(st.st_mode);
+                        }
+                    }
+
+                    bool descend = false;
+                    if (options.recursive) {
+                        if (type == EntryType::Directory) {
+                            descend = true;
+                        } else if (type == EntryType::Symlink && options.followSymlinks) {
+                            Instrumentation::add(Counter::StatCalls);
+                            descend = ::fstatat(fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+                        }
+                    }
+
+                    std::string_view nameView(name);
+                    const PathNode* node = descend ? arena.directories.makeChild(current.first, nameView)
+                                                   : arena.scratch.makeChild(current.first, nameView);
+                    if (visit(WalkEntry{node, childDepth, type, fd}, descend)) {
+                        subdirectories.emplace_back(node, childDepth);
+                    }
+                }
+                if (directory) {
+                    ::closedir(directory);
+                }
+#else
+                std::error_code ec;
+                fs::directory_iterator it(fs::path(directoryPath), fs::directory_options::skip_permission_denied, ec);
+                fs::directory_iterator end;
+                for (; !ec && it != end && !cancelled(); it.increment(ec)) {
+                    std::error_code typeEc;
+                    auto status = it->symlink_status(typeEc);
+                    EntryType type = typeEc ? EntryType::Unknown
+                                   : fs::is_symlink(status) ? EntryType::Symlink
+                                   : fs::is_directory(status) ? EntryType::Directory
+                                   : fs::is_regular_file(status) ? EntryType::Regular
+                                   : EntryType::Other;
+
+                    bool descend = options.recursive &&
+                        (type == EntryType::Directory ||
+                         (type == EntryType::Symlink && options.followSymlinks && it->is_directory(typeEc)));
+
+                    std::string name = it->path().filename().string();
+                    const PathNode* node = descend ? arena.directories.makeChild(current.first, name)
+                                                   : arena.scratch.makeChild(current.first, name);
+                    if (visit(WalkEntry{node, childDepth, type, -1}, descend)) {
+                        subdirectories.emplace_back(node, childDepth);
+                    }
+                }
+#endif
+
+                Instrumentation::add(Counter::EntriesVisited, entryCount);
+                Instrumentation::record(Histogram::DirectoryEntries, entryCount);
+
+                if (onDirectory) {
+                    try {
+                        onDirectory(workerIndex, current.first, entryCount, current.second);
+                    } catch (const std::exception&) {
+                        // Error handling
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    for (auto& subdirectory : subdirectories) {
+                        pending.push_back(subdirectory);
+                    }
+                    if (!subdirectories.empty()) {
+                        Instrumentation::add(Counter::TasksQueued, subdirectories.size());
+                        Instrumentation::record(Histogram::WalkQueueDepth, pending.size());
+                    }
+                    activeWorkers--;
+                }
+                queueChanged.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (size_t i = 1; i < threadCount; ++i) {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    bool DirectoryWalker::readMetadata(const WalkEntry& entry, EntryMetadata& metadata, bool followSymlinks) {
+#ifndef _WIN32
+        if (entry.directoryFd >= 0) {
+            return readMetadataAt(entry.directoryFd, entry.node->nameData(), metadata, followSymlinks);
+        }
+#endif
+        return readPathMetadata(entry.path(), metadata, followSymlinks);
+    }
+
+#ifndef _WIN32
+    bool DirectoryWalker::readMetadataAt(int directoryFd, const char* name, EntryMetadata& metadata, bool followSymlinks) {
+        Instrumentation::add(Counter::StatCalls);
+        struct stat st;
+        int flags = followSymlinks ? 0 : AT_SYMLINK_NOFOLLOW;
+        if (::fstatat(directoryFd, name, &st, flags) != 0) return false;
+        fillMetadata(st, metadata);
+        return true;
+    }
+#endif
+
+    bool DirectoryWalker::readPathMetadata(const std::string& filePath, EntryMetadata& metadata, bool followSymlinks) {
+        Instrumentation::add(Counter::StatCalls);
+#ifndef _WIN32
+        struct stat st;
+        int flags = followSymlinks ? 0 : AT_SYMLINK_NOFOLLOW;
+        if (::fstatat(AT_FDCWD, filePath.c_str(), &st, flags) != 0) return false;
+
+        fillMetadata(st, metadata);
+        return true;
+#else
+        std::error_code ec;
+        fs::path path(filePath);
+        auto status = followSymlinks ? fs::status(path, ec) : fs::symlink_status(path, ec);
+        if (ec) return false;
+
+        metadata.isRegularFile = fs::is_regular_file(status);
+        metadata.isDirectory = fs::is_directory(status);
+        metadata.size = metadata.isRegularFile ? fs::file_size(path, ec) : 0;
+        auto ftime = fs::last_write_time(path, ec);
+        auto sctp = std::chrono::time_point_cast<std::chrono::nanoseconds>(
+            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+        metadata.modifiedNs = sctp.time_since_epoch().count();
+        metadata.device = 0;
+        metadata.inode = 0;
+        return true;
+#endif
+    }
+
+}
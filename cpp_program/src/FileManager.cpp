@@ -1,4 +1,6 @@
 #include "FileManager.h"
+#include "ContentClassifier.h"
+#include "Instrumentation.h"
 #include <algorithm>
 #include <fstream>
 
@@ -49,11 +51,14 @@ namespace FileSystemManager {
     }
 
     void FileManager::updateCache(const std::string& path) {
+        ScopedPhase phase("list");
         try {
             std::vector<FileInfo> files;
             for (const auto& entry : fs::directory_iterator(path)) {
                 files.emplace_back(entry.path());
             }
+            Instrumentation::add(Counter::EntriesVisited, files.size());
+            Instrumentation::record(Histogram::DirectoryEntries, files.size());
             
             // Sort by name
             std::sort(files.begin(), files.end(), [](const FileInfo& a, const FileInfo& b) {
@@ -235,10 +240,13 @@ namespace FileSystemManager {
     }
 
     size_t FileManager::getDirectorySize(const std::string& dirPath) {
+        ScopedPhase phase("directory.size");
         try {
             size_t totalSize = 0;
             for (const auto& entry : fs::recursive_directory_iterator(dirPath)) {
+                Instrumentation::add(Counter::EntriesVisited);
                 if (fs::is_regular_file(entry)) {
+                    Instrumentation::add(Counter::StatCalls);
                     totalSize += fs::file_size(entry);
                 }
             }
@@ -257,6 +265,9 @@ namespace FileSystemManager {
                     std::string content((std::istreambuf_iterator<char>(file)),
                                        std::istreambuf_iterator<char>());
                     file.close();
+                    Instrumentation::add(Counter::FilesOpened);
+                    Instrumentation::add(Counter::BytesRead, content.size());
+                    Instrumentation::record(Histogram::FileBytesRead, content.size());
                     return content;
                 }
             }
@@ -337,6 +348,32 @@ namespace FileSystemManager {
         }
     }
 
+    std::vector<FileInfo> FileManager::getDirectoryTreeEntries(const std::string& path, int maxDepth) {
+        std::vector<FileInfo> result;
+        try {
+            std::string searchPath = path.empty() ? currentPath : path;
+            getDirectoryTreeEntriesRecursive(searchPath, result, 0, maxDepth);
+        } catch (const std::exception&) {
+            // Error handling
+        }
+        return result;
+    }
+
+    void FileManager::getDirectoryTreeEntriesRecursive(const std::string& path, std::vector<FileInfo>& result, int currentDepth, int maxDepth) {
+        if (currentDepth >= maxDepth) return;
+        
+        try {
+            for (const auto& entry : fs::directory_iterator(path)) {
+                result.emplace_back(entry.path());
+                if (result.back().isDirectory) {
+                    getDirectoryTreeEntriesRecursive(entry.path().string(), result, currentDepth + 1, maxDepth);
+                }
+            }
+        } catch (const std::exception&) {
+            // Error handling
+        }
+    }
+
     void FileManager::addWatchedDirectory(const std::string& path) {
         watchedDirectories.insert(path);
     }
@@ -355,23 +392,7 @@ namespace FileSystemManager {
     }
 
     bool FileManager::isTextFile(const std::string& filePath) {
-        try {
-            std::ifstream file(filePath, std::ios::binary);
-            if (!file.is_open()) return false;
-            
-            char buffer[1024];
-            file.read(buffer, sizeof(buffer));
-            size_t bytesRead = file.gcount();
-            
-            for (size_t i = 0; i < bytesRead; ++i) {
-                if (buffer[i] == 0) {
-                    return false; // Binary file
-                }
-            }
-            return true;
-        } catch (const std::exception&) {
-            return false;
-        }
+        return ContentClassifier::shared().classifyFile(filePath).isText();
     }
 
 }
@@ -0,0 +1,403 @@
+#include "Instrumentation.h"
+#include "Common.h"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace FileSystemManager {
+
+    std::atomic<bool> Instrumentation::enabled(false);
+
+    namespace {
+
+        // Counters owned by one thread at a time. Only the owner writes, so
+        // plain load/store pairs suffice; readers may see a slightly old value.
+        struct ThreadBlock {
+            std::array<std::atomic<uint64_t>, CounterCount> counters;
+            std::array<std::array<std::atomic<uint64_t>, HistogramBuckets>, HistogramCount> histograms;
+            bool inUse;
+
+            ThreadBlock() : inUse(true) {
+                for (auto& counter : counters) counter.store(0, std::memory_order_relaxed);
+                for (auto& histogram : histograms) {
+                    for (auto& bucket : histogram) bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        struct TraceEvent {
+            std::string name;
+            std::string detail;
+            char type;           // 'X' complete event, 'C' counter sample
+            uint64_t timestampUs;
+            uint64_t durationUs;
+            uint32_t threadId;
+        };
+
+        struct Registry {
+            std::mutex blockMutex;
+            // Blocks are recycled when their thread exits so totals never drop
+            std::vector<std::unique_ptr<ThreadBlock>> blocks;
+
+            std::mutex phaseMutex;
+            std::map<std::string, PhaseTotal> phases;
+
+            bool tracing = false;
+            std::string tracePath;
+            std::chrono::steady_clock::time_point traceStart;
+            std::vector<TraceEvent> traceEvents;
+        };
+
+        // Counts from threads without a block (allocations made while one is
+        // being set up, or during thread teardown)
+        std::array<std::atomic<uint64_t>, CounterCount> unownedCounters{};
+
+        thread_local ThreadBlock* currentBlock = nullptr;
+        thread_local bool insideHook = false;
+        thread_local bool threadFinished = false;
+        thread_local uint32_t traceThreadId = 0;
+        std::atomic<uint32_t> nextTraceThreadId(1);
+
+        // Never destroyed: threads may still count during static destruction
+        Registry& registry() {
+            static Registry* instance = []() {
+                // Creating it allocates; keep the allocation hook from recursing here
+                bool wasInsideHook = insideHook;
+                insideHook = true;
+                Registry* created = new Registry();
+                insideHook = wasInsideHook;
+                return created;
+            }();
+            return *instance;
+        }
+
+        struct BlockReleaser {
+            ~BlockReleaser() {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.blockMutex);
+                if (currentBlock != nullptr) {
+                    currentBlock->inUse = false;
+                    currentBlock = nullptr;
+                }
+                threadFinished = true;
+            }
+        };
+
+        ThreadBlock* threadBlock() {
+            if (currentBlock != nullptr) return currentBlock;
+            // Acquiring allocates, which re-enters through operator new
+            if (insideHook || threadFinished) return nullptr;
+
+            insideHook = true;
+            Registry& reg = registry();
+            {
+                std::lock_guard<std::mutex> lock(reg.blockMutex);
+                for (auto& block : reg.blocks) {
+                    if (!block->inUse) {
+                        block->inUse = true;
+                        currentBlock = block.get();
+                        break;
+                    }
+                }
+                if (currentBlock == nullptr) {
+                    reg.blocks.push_back(std::make_unique<ThreadBlock>());
+                    currentBlock = reg.blocks.back().get();
+                }
+            }
+            static thread_local BlockReleaser releaser;
+            (void)releaser;
+            insideHook = false;
+            return currentBlock;
+        }
+
+        size_t bucketFor(uint64_t value) {
+            size_t bucket = 0;
+            while (value != 0) {
+                value >>= 1;
+                bucket++;
+            }
+            return bucket;
+        }
+
+        uint32_t currentTraceThreadId() {
+            if (traceThreadId == 0) {
+                traceThreadId = nextTraceThreadId.fetch_add(1);
+            }
+            return traceThreadId;
+        }
+
+        uint64_t microsecondsSince(std::chrono::steady_clock::time_point origin, std::chrono::steady_clock::time_point when) {
+            if (when < origin) return 0;
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(when - origin).count());
+        }
+
+    }
+
+    uint64_t MetricsSnapshot::samples(Histogram histogram) const {
+        uint64_t total = 0;
+        for (uint64_t count : histograms[static_cast<size_t>(histogram)]) {
+            total += count;
+        }
+        return total;
+    }
+
+    uint64_t MetricsSnapshot::quantile(Histogram histogram, double q) const {
+        uint64_t total = samples(histogram);
+        if (total == 0) return 0;
+
+        uint64_t target = static_cast<uint64_t>(q * static_cast<double>(total));
+        if (target >= total) target = total - 1;
+        uint64_t seen = 0;
+        const auto& buckets = histograms[static_cast<size_t>(histogram)];
+        for (size_t i = 0; i < HistogramBuckets; ++i) {
+            seen += buckets[i];
+            if (seen > target) {
+                return i == 0 ? 0 : (i >= 64 ? UINT64_MAX : (uint64_t(1) << i) - 1);
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    MetricsSnapshot MetricsSnapshot::operator-(const MetricsSnapshot& earlier) const {
+        MetricsSnapshot delta = *this;
+        for (size_t i = 0; i < CounterCount; ++i) {
+            delta.counters[i] -= earlier.counters[i];
+        }
+        for (size_t h = 0; h < HistogramCount; ++h) {
+            for (size_t b = 0; b < HistogramBuckets; ++b) {
+                delta.histograms[h][b] -= earlier.histograms[h][b];
+            }
+        }
+        for (auto it = delta.phases.begin(); it != delta.phases.end(); ) {
+            auto previous = earlier.phases.find(it->first);
+            if (previous != earlier.phases.end()) {
+                it->second.calls -= previous->second.calls;
+                it->second.totalNs -= previous->second.totalNs;
+            }
+            if (it->second.calls == 0) {
+                it = delta.phases.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return delta;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> MetricsSnapshot::toFields() const {
+        auto key = [](std::string text) {
+            for (char& c : text) {
+                if (c == ' ' || c == '.') c = '_';
+            }
+            return text;
+        };
+
+        std::vector<std::pair<std::string, uint64_t>> fields;
+        for (size_t i = 0; i < CounterCount; ++i) {
+            fields.emplace_back(key(counterName(static_cast<Counter>(i))), counters[i]);
+        }
+        for (const auto& [name, total] : phases) {
+            fields.emplace_back("phase_" + key(name) + "_ns", total.totalNs);
+            fields.emplace_back("phase_" + key(name) + "_calls", total.calls);
+        }
+        for (size_t h = 0; h < HistogramCount; ++h) {
+            Histogram histogram = static_cast<Histogram>(h);
+            if (samples(histogram) == 0) continue;
+            std::string base = key(histogramName(histogram));
+            fields.emplace_back(base + "_p50", quantile(histogram, 0.5));
+            fields.emplace_back(base + "_p90", quantile(histogram, 0.9));
+            fields.emplace_back(base + "_max", quantile(histogram, 1.0));
+        }
+        return fields;
+    }
+
+    const char* counterName(Counter counter) {
+        switch (counter) {
+            case Counter::EntriesVisited: return "entries visited";
+            case Counter::StatCalls: return "stat calls";
+            case Counter::FilesOpened: return "files opened";
+            case Counter::BytesRead: return "bytes read";
+            case Counter::BytesWritten: return "bytes written";
+            case Counter::RegexCompilations: return "regex compilations";
+            case Counter::Allocations: return "allocations";
+            case Counter::AllocatedBytes: return "allocated bytes";
+            case Counter::TasksQueued: return "tasks queued";
+            case Counter::ClassifierCacheHits: return "classifier cache hits";
+            case Counter::SparseBytesSkipped: return "sparse bytes skipped";
+            case Counter::ScansTruncated: return "scans truncated";
+            case Counter::CrossDeviceMoves: return "cross-device moves";
+            case Counter::RenameCycles: return "rename cycles";
+            case Counter::ThrottleWaitNs: return "throttle wait ns";
+            default: return "unknown";
+        }
+    }
+
+    const char* histogramName(Histogram histogram) {
+        switch (histogram) {
+            case Histogram::WalkQueueDepth: return "walk queue depth";
+            case Histogram::PoolQueueDepth: return "pool queue depth";
+            case Histogram::FileBytesRead: return "bytes read per file";
+            case Histogram::DirectoryEntries: return "entries per directory";
+            default: return "unknown";
+        }
+    }
+
+    void Instrumentation::setEnabled(bool value) {
+        enabled.store(value, std::memory_order_relaxed);
+    }
+
+    void Instrumentation::addSlow(Counter counter, uint64_t amount) {
+        size_t index = static_cast<size_t>(counter);
+        ThreadBlock* block = threadBlock();
+        if (block != nullptr) {
+            auto& slot = block->counters[index];
+            slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        } else {
+            unownedCounters[index].fetch_add(amount, std::memory_order_relaxed);
+        }
+    }
+
+    void Instrumentation::recordSlow(Histogram histogram, uint64_t value) {
+        ThreadBlock* block = threadBlock();
+        if (block == nullptr) return;
+        auto& slot = block->histograms[static_cast<size_t>(histogram)][bucketFor(value)];
+        slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void Instrumentation::recordPhase(const char* name, const std::string& detail,
+                                      std::chrono::steady_clock::time_point start,
+                                      std::chrono::steady_clock::time_point end) {
+        if (!isEnabled()) return;
+
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.phaseMutex);
+        PhaseTotal& total = reg.phases[name];
+        total.calls++;
+        total.totalNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+        if (reg.tracing) {
+            uint64_t begin = microsecondsSince(reg.traceStart, start);
+            reg.traceEvents.push_back(TraceEvent{name, detail, 'X', begin,
+                                                 microsecondsSince(reg.traceStart, end) - begin, currentTraceThreadId()});
+        }
+    }
+
+    MetricsSnapshot Instrumentation::snapshot() {
+        MetricsSnapshot result;
+        Registry& reg = registry();
+        {
+            std::lock_guard<std::mutex> lock(reg.blockMutex);
+            for (const auto& block : reg.blocks) {
+                for (size_t i = 0; i < CounterCount; ++i) {
+                    result.counters[i] += block->counters[i].load(std::memory_order_relaxed);
+                }
+                for (size_t h = 0; h < HistogramCount; ++h) {
+                    for (size_t b = 0; b < HistogramBuckets; ++b) {
+                        result.histograms[h][b] += block->histograms[h][b].load(std::memory_order_relaxed);
+                    }
+                }
+            }
+            for (size_t i = 0; i < CounterCount; ++i) {
+                result.counters[i] += unownedCounters[i].load(std::memory_order_relaxed);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(reg.phaseMutex);
+            result.phases = reg.phases;
+        }
+        return result;
+    }
+
+    void Instrumentation::startTrace(const std::string& path) {
+        Registry& reg = registry();
+        {
+            std::lock_guard<std::mutex> lock(reg.phaseMutex);
+            reg.tracing = true;
+            reg.tracePath = path;
+            reg.traceStart = std::chrono::steady_clock::now();
+            reg.traceEvents.clear();
+        }
+        setEnabled(true);
+    }
+
+    bool Instrumentation::isTracing() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.phaseMutex);
+        return reg.tracing;
+    }
+
+    void Instrumentation::traceCounters() {
+        if (!isTracing()) return;
+
+        MetricsSnapshot current = snapshot();
+        std::string args;
+        for (size_t i = 0; i < CounterCount; ++i) {
+            if (i > 0) args += ',';
+            args += "\"" + std::string(counterName(static_cast<Counter>(i))) + "\":" + std::to_string(current.counters[i]);
+        }
+
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.phaseMutex);
+        reg.traceEvents.push_back(TraceEvent{"counters", args, 'C',
+                                             microsecondsSince(reg.traceStart, std::chrono::steady_clock::now()), 0,
+                                             currentTraceThreadId()});
+    }
+
+    bool Instrumentation::stopTrace(std::string& error) {
+        traceCounters();
+
+        Registry& reg = registry();
+        std::vector<TraceEvent> events;
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(reg.phaseMutex);
+            if (!reg.tracing) return true;
+            reg.tracing = false;
+            events.swap(reg.traceEvents);
+            path = reg.tracePath;
+        }
+
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) {
+            error = "Cannot write trace file: " + path;
+            return false;
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for (size_t i = 0; i < events.size(); ++i) {
+            const TraceEvent& event = events[i];
+            file << (i > 0 ? ",\n" : "") << "{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"" << event.type
+                 << "\",\"ts\":" << event.timestampUs << ",\"pid\":1,\"tid\":" << event.threadId;
+            if (event.type == 'X') {
+                file << ",\"dur\":" << event.durationUs;
+                if (!event.detail.empty()) {
+                    file << ",\"args\":{\"detail\":\"" << escapeJson(event.detail) << "\"}";
+                }
+            } else {
+                file << ",\"args\":{" << event.detail << "}";
+            }
+            file << "}";
+        }
+        file << "\n]}\n";
+        file.close();
+        if (!file) {
+            error = "Failed to write trace file: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    ScopedPhase::ScopedPhase(const char* phaseName, std::string phaseDetail)
+        : name(phaseName), detail(std::move(phaseDetail)), active(Instrumentation::isEnabled()) {
+        if (active) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ScopedPhase::~ScopedPhase() {
+        if (active) {
+            Instrumentation::recordPhase(name, detail, start, std::chrono::steady_clock::now());
+        }
+    }
+
+}
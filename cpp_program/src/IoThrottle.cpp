@@ -0,0 +1,147 @@
+#include "IoThrottle.h"
+#include "CancellationToken.h"
+#include "Common.h"
+#include "Instrumentation.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    namespace {
+
+        // A waiter cannot be woken by a cancellation, so it looks this often
+        constexpr std::chrono::milliseconds CancellationPoll(10);
+
+#ifdef __linux__
+        // From linux/ioprio.h, which glibc does not wrap
+        constexpr int IoprioWhoProcess = 1;     // With id 0: the calling thread
+        constexpr int IoprioClassShift = 13;
+        constexpr int IoprioClassBestEffort = 2;
+        constexpr int IoprioClassIdle = 3;
+        constexpr int IoprioLowestLevel = 7;
+
+        int getThreadIoPriority() {
+            return static_cast<int>(::syscall(SYS_ioprio_get, IoprioWhoProcess, 0));
+        }
+
+        bool setThreadIoPriority(int value) {
+            return ::syscall(SYS_ioprio_set, IoprioWhoProcess, 0, value) == 0;
+        }
+#endif
+
+    }
+
+    bool parseIoPriority(const std::string& text, IoPriority& priority) {
+        std::string name = toLowerCase(text);
+        if (name == "default" || name == "normal") {
+            priority = IoPriority::Default;
+        } else if (name == "best-effort" || name == "be") {
+            priority = IoPriority::BestEffort;
+        } else if (name == "idle") {
+            priority = IoPriority::Idle;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char* ioPriorityName(IoPriority priority) {
+        switch (priority) {
+            case IoPriority::BestEffort: return "best-effort";
+            case IoPriority::Idle: return "idle";
+            default: return "default";
+        }
+    }
+
+    IoThrottle::IoThrottle() : refilled(std::chrono::steady_clock::now()), generation(0), limited(false) {
+    }
+
+    void IoThrottle::setLimits(const IoLimits& newLimits) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            limits = newLimits;
+            // A fresh start at the new rates: no burst saved up, no debt left over
+            bytes.rate = static_cast<double>(limits.bytesPerSecond);
+            bytes.level = 0;
+            operations.rate = static_cast<double>(limits.operationsPerSecond);
+            operations.level = 0;
+            refilled = std::chrono::steady_clock::now();
+            generation++;
+            limited.store(limits.bytesPerSecond > 0 || limits.operationsPerSecond > 0, std::memory_order_relaxed);
+        }
+        changed.notify_all();
+    }
+
+    IoLimits IoThrottle::getLimits() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return limits;
+    }
+
+    IoPriority IoThrottle::getPriority() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return limits.priority;
+    }
+
+    void IoThrottle::refill(std::chrono::steady_clock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - refilled).count();
+        refilled = now;
+        for (Bucket* bucket : {&bytes, &operations}) {
+            if (bucket->rate <= 0) continue;
+            bucket->level = std::min(bucket->rate * BurstSeconds, bucket->level + bucket->rate * elapsed);
+        }
+    }
+
+    void IoThrottle::wait(uint64_t byteCount, uint64_t operationCount, const CancellationToken* cancellation) {
+        auto now = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        refill(now);
+
+        // Every caller takes its share at once, so callers queue up behind
+        // each other's debt and each sleeps until its own share is paid
+        double seconds = 0;
+        if (bytes.rate > 0) {
+            bytes.level -= static_cast<double>(byteCount);
+            if (bytes.level < 0) seconds = std::max(seconds, -bytes.level / bytes.rate);
+        }
+        if (operations.rate > 0) {
+            operations.level -= static_cast<double>(operationCount);
+            if (operations.level < 0) seconds = std::max(seconds, -operations.level / operations.rate);
+        }
+        if (seconds <= 0) return;
+
+        auto until = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+        uint64_t waitingFor = generation;
+        while (generation == waitingFor && !(cancellation && cancellation->isCancelled())) {
+            auto current = std::chrono::steady_clock::now();
+            if (current >= until) break;
+            changed.wait_until(lock, std::min(until, current + CancellationPoll));
+        }
+        lock.unlock();
+        Instrumentation::add(Counter::ThrottleWaitNs, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - now).count()));
+    }
+
+    ScopedIoPriority::ScopedIoPriority(IoPriority priority) : previous(-1) {
+#ifdef __linux__
+        if (priority == IoPriority::Default) return;
+        int current = getThreadIoPriority();
+        if (current < 0) return;
+        int value = priority == IoPriority::Idle ? IoprioClassIdle << IoprioClassShift
+                                                 : (IoprioClassBestEffort << IoprioClassShift) | IoprioLowestLevel;
+        if (setThreadIoPriority(value)) previous = current;
+#else
+        (void)priority;
+#endif
+    }
+
+    ScopedIoPriority::~ScopedIoPriority() {
+#ifdef __linux__
+        if (previous >= 0) setThreadIoPriority(previous);
+#endif
+    }
+
+}
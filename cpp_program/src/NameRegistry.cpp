@@ -0,0 +1,132 @@
+#include "NameRegistry.h"
+#include "Common.h"
+#include "DirectoryWalker.h"
+#include "Instrumentation.h"
+#include <cerrno>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    namespace {
+
+        std::error_code lastError() {
+            return std::error_code(errno, std::generic_category());
+        }
+
+    }
+
+    NameRegistry::NameRegistry(std::string destinationDir) : directory(std::move(destinationDir)), listed(false) {
+    }
+
+    void NameRegistry::list() {
+        listed = true;
+        std::error_code ec;
+        if (!fs::is_directory(directory, ec)) return;
+
+        WalkOptions options;
+        options.recursive = false;
+        options.threadCount = 1;
+        DirectoryWalker walker(options);
+        walker.walk(directory, [this](size_t, const WalkEntry& entry) {
+            taken.emplace(entry.name());
+        });
+    }
+
+    std::string NameRegistry::claimLocked(const std::string& name) {
+        if (taken.insert(name).second) return name;
+
+        // Same stem/extension split generateUniqueFileName used: ".bashrc"
+        // has no extension, "a.tar.gz" has ".gz"
+        fs::path path(name);
+        std::string stem = path.stem().string();
+        std::string extension = path.extension().string();
+        size_t& next = nextSuffix[name];
+        if (next == 0) next = 1;
+        std::string candidate;
+        while (true) {
+            candidate = stem;
+            candidate += '_';
+            candidate += std::to_string(next++);
+            candidate += extension;
+            if (taken.insert(candidate).second) return candidate;
+        }
+    }
+
+    std::string NameRegistry::claim(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return claimLocked(name);
+    }
+
+    std::string NameRegistry::reclaim(const std::string& name, const std::string& existing) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!listed) list();
+        taken.insert(existing);
+        return claimLocked(name);
+    }
+
+    void NameRegistry::release(const std::string& claimed) {
+        std::lock_guard<std::mutex> lock(mutex);
+        taken.erase(claimed);
+    }
+
+    std::error_code createExclusive(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0) return lastError();
+        ::close(fd);
+#else
+        std::FILE* file = std::fopen(path.c_str(), "wbx");
+        if (!file) return lastError();
+        std::fclose(file);
+#endif
+        return std::error_code();
+    }
+
+#ifndef _WIN32
+    std::error_code renameNoReplaceAt(int fromDirectory, const char* from, int toDirectory, const char* to) {
+#if defined(__linux__) && defined(RENAME_NOREPLACE)
+        if (::renameat2(fromDirectory, from, toDirectory, to, RENAME_NOREPLACE) == 0) return std::error_code();
+        // EINVAL: the file system cannot refuse to replace; try the other ways
+        if (errno != EINVAL && errno != ENOSYS) return lastError();
+#endif
+        // A hard link does not replace anything either; the old name goes once
+        // the new one exists
+        if (::linkat(fromDirectory, from, toDirectory, to, 0) == 0) {
+            if (::unlinkat(fromDirectory, from, 0) != 0) {
+                std::error_code ec = lastError();
+                ::unlinkat(toDirectory, to, 0);
+                return ec;
+            }
+            return std::error_code();
+        }
+        if (errno == EEXIST || errno == EXDEV || errno == ENOENT) return lastError();
+
+        // No hard links here (or a directory): check, then rename
+        Instrumentation::add(Counter::StatCalls);
+        struct stat st;
+        if (::fstatat(toDirectory, to, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            return std::make_error_code(std::errc::file_exists);
+        }
+        if (::renameat(fromDirectory, from, toDirectory, to) != 0) return lastError();
+        return std::error_code();
+    }
+#endif
+
+    std::error_code renameNoReplace(const std::string& from, const std::string& to) {
+#ifndef _WIN32
+        return renameNoReplaceAt(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str());
+#else
+        std::error_code ec;
+        if (fs::exists(fs::symlink_status(to, ec))) return std::make_error_code(std::errc::file_exists);
+        fs::rename(from, to, ec);
+        return ec;
+#endif
+    }
+
+}
@@ -0,0 +1,159 @@
+#include "OutputWriter.h"
+#include "Common.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#include <cstdio>
+#else
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    OutputWriter::OutputWriter() : OutputWriter(1) {
+    }
+
+    OutputWriter::OutputWriter(int fd, size_t bufferSize) : fileDescriptor(fd), interactive(false), buffer(bufferSize > 0 ? bufferSize : DefaultBufferSize), used(0), captureTarget(nullptr) {
+#ifdef _WIN32
+        interactive = _isatty(fd) != 0;
+#else
+        interactive = ::isatty(fd) != 0;
+#endif
+    }
+
+    OutputWriter::~OutputWriter() {
+        flush();
+    }
+
+    void OutputWriter::writeToTarget(const char* data, size_t length) {
+        if (captureTarget != nullptr) {
+            captureTarget->append(data, length);
+            return;
+        }
+        while (length > 0) {
+#ifdef _WIN32
+            int written = _write(fileDescriptor, data, static_cast<unsigned int>(length));
+#else
+            ssize_t written = ::write(fileDescriptor, data, length);
+#endif
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return; // Output target went away (e.g. closed pipe); drop the data
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
+
+    void OutputWriter::append(const char* data, size_t length) {
+        if (length > buffer.size() - used) {
+            flush();
+            if (length >= buffer.size()) {
+                // Larger than the whole buffer; no point copying it
+                writeToTarget(data, length);
+                return;
+            }
+        }
+        std::memcpy(buffer.data() + used, data, length);
+        used += length;
+    }
+
+    void OutputWriter::write(const char* data, size_t length) {
+        append(data, length);
+        if (isInteractive() && std::memchr(data, '\n', length) != nullptr) {
+            flush();
+        }
+    }
+
+    void OutputWriter::write(std::string_view text) {
+        write(text.data(), text.size());
+    }
+
+    void OutputWriter::writeChar(char c) {
+        if (used == buffer.size()) {
+            flush();
+        }
+        buffer[used++] = c;
+        if (c == '\n' && isInteractive()) {
+            flush();
+        }
+    }
+
+    void OutputWriter::writeUnsigned(uint64_t value) {
+        char digits[24];
+        auto conversion = std::to_chars(digits, digits + sizeof(digits), value);
+        append(digits, static_cast<size_t>(conversion.ptr - digits));
+    }
+
+    void OutputWriter::writeSigned(int64_t value) {
+        char digits[24];
+        auto conversion = std::to_chars(digits, digits + sizeof(digits), value);
+        append(digits, static_cast<size_t>(conversion.ptr - digits));
+    }
+
+    void OutputWriter::writeFileSize(uint64_t bytes) {
+        char text[32];
+        size_t length = formatFileSize(bytes, text, sizeof(text));
+        append(text, length);
+    }
+
+    void OutputWriter::writePadded(std::string_view text, size_t width, bool alignRight) {
+        static const char spaces[] = "                                                                ";
+        size_t padding = text.size() < width ? width - text.size() : 0;
+
+        if (!alignRight) {
+            append(text.data(), text.size());
+        }
+        while (padding > 0) {
+            size_t chunk = std::min(padding, sizeof(spaces) - 1);
+            append(spaces, chunk);
+            padding -= chunk;
+        }
+        if (alignRight) {
+            append(text.data(), text.size());
+        }
+    }
+
+    void OutputWriter::flush() {
+        if (used > 0) {
+            writeToTarget(buffer.data(), used);
+            used = 0;
+        }
+    }
+
+    void OutputWriter::endCommand() {
+        flush();
+    }
+
+    void OutputWriter::setCaptureTarget(std::string* target) {
+        flush();
+        captureTarget = target;
+    }
+
+    void OutputWriter::setFileDescriptor(int fd) {
+        flush();
+        fileDescriptor = fd;
+#ifdef _WIN32
+        interactive = _isatty(fd) != 0;
+#else
+        interactive = ::isatty(fd) != 0;
+#endif
+    }
+
+    bool OutputWriter::isInteractive() const {
+        return interactive && captureTarget == nullptr;
+    }
+
+    void OutputWriter::setInteractive(bool value) {
+        interactive = value;
+    }
+
+    size_t OutputWriter::bufferedBytes() const {
+        return used;
+    }
+
+}
@@ -0,0 +1,128 @@
+#include "PathArena.h"
+#include <cstring>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        const size_t NodeAlignment = alignof(PathNode);
+
+        size_t alignUp(size_t value) {
+            return (value + NodeAlignment - 1) & ~(NodeAlignment - 1);
+        }
+
+        bool endsWithSeparator(const PathNode* node) {
+            if (node->nameLength == 0) return false;
+            char last = node->nameData()[node->nameLength - 1];
+#ifdef _WIN32
+            return last == '/' || last == '\\';
+#else
+            return last == '/';
+#endif
+        }
+
+        // Separator inserted between a node and its child; an empty root
+        // yields relative child paths
+        size_t separatorLength(const PathNode* parent) {
+            if (parent->nameLength == 0 && parent->parent == nullptr) return 0;
+            return endsWithSeparator(parent) ? 0 : 1;
+        }
+
+        // Writes node's components back to front, ending at end; stops at stop
+        void fillBackwards(const PathNode* node, const PathNode* stop, char* end) {
+            char* cursor = end;
+            for (; node != stop; node = node->parent) {
+                cursor -= node->nameLength;
+                std::memcpy(cursor, node->nameData(), node->nameLength);
+                if (node->parent != stop && separatorLength(node->parent) > 0) {
+                    *--cursor = '/';
+                }
+            }
+        }
+
+    }
+
+    void PathNode::appendPath(std::string& out) const {
+        out.resize(out.size() + pathLength);
+        fillBackwards(this, nullptr, &out[0] + out.size());
+    }
+
+    std::string PathNode::path() const {
+        std::string result;
+        appendPath(result);
+        return result;
+    }
+
+    void PathNode::appendRelative(const PathNode* ancestor, std::string& out) const {
+        if (this == ancestor) return;
+        size_t length = pathLength - ancestor->pathLength - separatorLength(ancestor);
+        out.resize(out.size() + length);
+        fillBackwards(this, ancestor, &out[0] + out.size());
+    }
+
+    PathArena::PathArena() : currentChunk(0), offset(0), bytesUsed(0) {
+    }
+
+    PathNode* PathArena::allocate(const PathNode* parent, std::string_view name, uint32_t pathLength) {
+        size_t needed = alignUp(sizeof(PathNode) + name.size() + 1);
+
+        if (chunks.empty() || offset + needed > chunks[currentChunk].capacity) {
+            // Move on to the next retained chunk if it fits, otherwise add one
+            size_t next = chunks.empty() ? 0 : currentChunk + 1;
+            while (next < chunks.size() && chunks[next].capacity < needed) {
+                next++;
+            }
+            if (next >= chunks.size()) {
+                size_t capacity = needed > ChunkSize ? needed : ChunkSize;
+                chunks.push_back({std::unique_ptr<char[]>(new char[capacity]), capacity});
+                next = chunks.size() - 1;
+            }
+            currentChunk = next;
+            offset = 0;
+        }
+
+        char* memory = chunks[currentChunk].data.get() + offset;
+        offset += needed;
+        bytesUsed += needed;
+
+        PathNode* node = reinterpret_cast<PathNode*>(memory);
+        node->parent = parent;
+        node->nameLength = static_cast<uint32_t>(name.size());
+        node->pathLength = pathLength;
+        char* nameStorage = memory + sizeof(PathNode);
+        std::memcpy(nameStorage, name.data(), name.size());
+        nameStorage[name.size()] = '\0';
+        return node;
+    }
+
+    const PathNode* PathArena::makeRoot(std::string_view path) {
+        while (path.size() > 1 && (path.back() == '/'
+#ifdef _WIN32
+                                   || path.back() == '\\'
+#endif
+                                   )) {
+            path.remove_suffix(1);
+        }
+        return allocate(nullptr, path, static_cast<uint32_t>(path.size()));
+    }
+
+    const PathNode* PathArena::makeChild(const PathNode* parent, std::string_view name) {
+        uint32_t pathLength = static_cast<uint32_t>(parent->pathLength + separatorLength(parent) + name.size());
+        return allocate(parent, name, pathLength);
+    }
+
+    void PathArena::reset() {
+        currentChunk = 0;
+        offset = 0;
+        bytesUsed = 0;
+    }
+
+    size_t PathArena::getBytesUsed() const {
+        return bytesUsed;
+    }
+
+    size_t PathArena::getChunkCount() const {
+        return chunks.size();
+    }
+
+}
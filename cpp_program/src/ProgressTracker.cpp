@@ -0,0 +1,163 @@
+#include "ProgressTracker.h"
+#include <cmath>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        // Rates follow the last few seconds, so the ETA settles instead of
+        // jumping with every sample
+        constexpr double RateTimeConstantSeconds = 3.0;
+
+        double secondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+            return std::chrono::duration<double>(to - from).count();
+        }
+
+    }
+
+    ProgressTracker::ProgressTracker()
+        : files(0), bytes(0), totalFiles(0), totalBytes(0), nameWanted(false),
+          interval(std::chrono::milliseconds(100)), stopping(false),
+          sampledFiles(0), sampledBytes(0), filesRate(0), bytesRate(0) {
+    }
+
+    ProgressTracker::~ProgressTracker() {
+        stopReporter();
+    }
+
+    void ProgressTracker::setCallback(Callback reportCallback, std::chrono::milliseconds reportInterval) {
+        callback = std::move(reportCallback);
+        interval = reportInterval.count() > 0 ? reportInterval : std::chrono::milliseconds(1);
+    }
+
+    void ProgressTracker::begin(size_t fileTotal, uint64_t byteTotal) {
+        stopReporter();
+        files = 0;
+        bytes = 0;
+        totalFiles = fileTotal;
+        totalBytes = byteTotal;
+        {
+            std::lock_guard<std::mutex> lock(nameMutex);
+            name.clear();
+        }
+        started = std::chrono::steady_clock::now();
+        sampledAt = started;
+        sampledFiles = 0;
+        sampledBytes = 0;
+        filesRate = 0;
+        bytesRate = 0;
+
+        if (!callback) {
+            nameWanted = false;
+            return;
+        }
+        nameWanted = true;
+        stopping = false;
+        reporter = std::thread(&ProgressTracker::runReporter, this);
+    }
+
+    void ProgressTracker::setTotal(size_t fileTotal, uint64_t byteTotal) {
+        totalFiles = fileTotal;
+        totalBytes = byteTotal;
+    }
+
+    void ProgressTracker::finish() {
+        bool reporting = reporter.joinable();
+        stopReporter();
+        if (reporting) callback(sample(true));
+        nameWanted = false;
+    }
+
+    void ProgressTracker::reset() {
+        stopReporter();
+        files = 0;
+        bytes = 0;
+        totalFiles = 0;
+        totalBytes = 0;
+        nameWanted = false;
+    }
+
+    void ProgressTracker::offerName(std::string_view currentFile) {
+        // Only the first worker to clear the flag pays for the copy
+        if (!nameWanted.exchange(false, std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(nameMutex);
+        name.assign(currentFile);
+    }
+
+    size_t ProgressTracker::filesDone() const {
+        return files.load(std::memory_order_relaxed);
+    }
+
+    size_t ProgressTracker::filesTotal() const {
+        return totalFiles.load(std::memory_order_relaxed);
+    }
+
+    void ProgressTracker::runReporter() {
+        std::unique_lock<std::mutex> lock(reporterMutex);
+        while (!wake.wait_for(lock, interval, [this]() { return stopping; })) {
+            lock.unlock();
+            callback(sample(false));
+            lock.lock();
+        }
+    }
+
+    void ProgressTracker::stopReporter() {
+        if (!reporter.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(reporterMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        reporter.join();
+    }
+
+    ProgressSnapshot ProgressTracker::sample(bool finished) {
+        auto now = std::chrono::steady_clock::now();
+        ProgressSnapshot snapshot;
+        snapshot.filesDone = files.load(std::memory_order_relaxed);
+        snapshot.bytesDone = bytes.load(std::memory_order_relaxed);
+        snapshot.filesTotal = totalFiles.load(std::memory_order_relaxed);
+        snapshot.bytesTotal = totalBytes.load(std::memory_order_relaxed);
+        snapshot.elapsedSeconds = secondsBetween(started, now);
+        snapshot.finished = finished;
+        {
+            std::lock_guard<std::mutex> lock(nameMutex);
+            snapshot.currentFile = name;
+        }
+        nameWanted.store(true, std::memory_order_relaxed);
+
+        double step = secondsBetween(sampledAt, now);
+        if (finished) {
+            // The whole batch's average, not the tail's
+            if (snapshot.elapsedSeconds > 0) {
+                filesRate = snapshot.filesDone / snapshot.elapsedSeconds;
+                bytesRate = snapshot.bytesDone / snapshot.elapsedSeconds;
+            }
+        } else if (step > 0) {
+            double filesNow = (snapshot.filesDone - sampledFiles) / step;
+            double bytesNow = (snapshot.bytesDone - sampledBytes) / step;
+            bool first = sampledAt == started;
+            double weight = first ? 1.0 : 1.0 - std::exp(-step / RateTimeConstantSeconds);
+            filesRate += weight * (filesNow - filesRate);
+            bytesRate += weight * (bytesNow - bytesRate);
+        }
+        sampledFiles = snapshot.filesDone;
+        sampledBytes = snapshot.bytesDone;
+        sampledAt = now;
+        snapshot.filesPerSecond = filesRate;
+        snapshot.bytesPerSecond = bytesRate;
+
+        // Bytes give the better estimate when files differ in size
+        if (finished) {
+            snapshot.etaSeconds = 0;
+        } else if (snapshot.bytesTotal > 0 && bytesRate > 0) {
+            uint64_t left = snapshot.bytesTotal > snapshot.bytesDone ? snapshot.bytesTotal - snapshot.bytesDone : 0;
+            snapshot.etaSeconds = left / bytesRate;
+        } else if (snapshot.filesTotal > 0 && filesRate > 0) {
+            size_t left = snapshot.filesTotal > snapshot.filesDone ? snapshot.filesTotal - snapshot.filesDone : 0;
+            snapshot.etaSeconds = left / filesRate;
+        }
+        return snapshot;
+    }
+
+}
@@ -0,0 +1,450 @@
+#include "RecordWriter.h"
+
+namespace FileSystemManager {
+
+    bool parseOutputFormat(const std::string& name, OutputFormat& format) {
+        std::string lower = toLowerCase(name);
+        if (lower == "human" || lower == "text") {
+            format = OutputFormat::Human;
+        } else if (lower == "ndjson" || lower == "jsonl") {
+            format = OutputFormat::Ndjson;
+        } else if (lower == "tsv") {
+            format = OutputFormat::Tsv;
+        } else if (lower == "bin" || lower == "binary") {
+            format = OutputFormat::Binary;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char* outputFormatName(OutputFormat format) {
+        switch (format) {
+            case OutputFormat::Ndjson: return "ndjson";
+            case OutputFormat::Tsv: return "tsv";
+            case OutputFormat::Binary: return "bin";
+            default: return "human";
+        }
+    }
+
+    RecordWriter::RecordWriter(OutputWriter& writer, OutputFormat outputFormat, bool withFormattedFields)
+        : out(writer), format(outputFormat), includeFormatted(withFormattedFields), headerWritten(false) {
+    }
+
+    void RecordWriter::setFormat(OutputFormat outputFormat, bool withFormattedFields) {
+        format = outputFormat;
+        includeFormatted = withFormattedFields;
+    }
+
+    OutputFormat RecordWriter::getFormat() const {
+        return format;
+    }
+
+    bool RecordWriter::isStructured() const {
+        return format != OutputFormat::Human;
+    }
+
+    bool RecordWriter::includesFormattedFields() const {
+        return includeFormatted;
+    }
+
+    void RecordWriter::writeJsonString(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        out.writeChar('"');
+
+        // Copy runs of plain characters in one go, escaping only where needed
+        size_t runStart = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+            out.write(text.data() + runStart, i - runStart);
+            runStart = i + 1;
+            switch (c) {
+                case '"': out.write("\\\"", 2); break;
+                case '\\': out.write("\\\\", 2); break;
+                case '\n': out.write("\\n", 2); break;
+                case '\r': out.write("\\r", 2); break;
+                case '\t': out.write("\\t", 2); break;
+                default: {
+                    char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+                    out.write(escaped, sizeof(escaped));
+                }
+            }
+        }
+        out.write(text.data() + runStart, text.size() - runStart);
+        out.writeChar('"');
+    }
+
+    void RecordWriter::writeTsvField(std::string_view text) {
+        size_t runStart = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (c != '\t' && c != '\n' && c != '\r' && c != '\\') continue;
+
+            out.write(text.data() + runStart, i - runStart);
+            runStart = i + 1;
+            switch (c) {
+                case '\t': out.write("\\t", 2); break;
+                case '\n': out.write("\\n", 2); break;
+                case '\r': out.write("\\r", 2); break;
+                default: out.write("\\\\", 2); break;
+            }
+        }
+        out.write(text.data() + runStart, text.size() - runStart);
+    }
+
+    void RecordWriter::writeBinaryU32(uint32_t value) {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+        out.write(bytes, sizeof(bytes));
+    }
+
+    void RecordWriter::writeBinaryU64(uint64_t value) {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+        out.write(bytes, sizeof(bytes));
+    }
+
+    void RecordWriter::writeBinaryString(std::string_view text) {
+        writeBinaryU32(static_cast<uint32_t>(text.size()));
+        out.write(text.data(), text.size());
+    }
+
+    void RecordWriter::writeBinaryHeader(uint8_t type, size_t payloadLength) {
+        if (!headerWritten) {
+            out.write("FSMB\x02", 5);
+            headerWritten = true;
+        }
+        out.writeChar(static_cast<char>(type));
+        writeBinaryU32(static_cast<uint32_t>(payloadLength));
+    }
+
+    size_t RecordWriter::binaryListSize(const std::vector<std::string>& list) {
+        size_t total = 4;
+        for (const auto& item : list) {
+            total += binaryStringSize(item);
+        }
+        return total;
+    }
+
+    void RecordWriter::writeSearchResult(const SearchResult& result) {
+        switch (format) {
+            case OutputFormat::Ndjson: {
+                out.write("{\"type\":\"search\",\"path\":");
+                writeJsonString(result.filePath);
+                out.write(",\"name\":");
+                writeJsonString(result.fileName);
+                out << ",\"size\":" << result.fileSize << ",\"mtime\":" << result.modifiedTime;
+                if (includeFormatted) {
+                    out << ",\"sizeText\":\"" << fileSize(result.fileSize) << "\",\"modified\":";
+                    writeJsonString(result.lastModified);
+                }
+                if (!result.matchingLines.empty()) {
+                    out.write(",\"lines\":[");
+                    for (size_t i = 0; i < result.matchingLines.size(); ++i) {
+                        const LineMatch& line = result.matchingLines[i];
+                        if (i > 0) out.writeChar(',');
+                        out << "{\"line\":" << line.lineNumber << ",\"text\":";
+                        writeJsonString(line.text);
+                        if (!line.keywords.empty()) {
+                            out.write(",\"keywords\":[");
+                            for (size_t k = 0; k < line.keywords.size(); ++k) {
+                                if (k > 0) out.writeChar(',');
+                                writeJsonString(line.keywords[k]);
+                            }
+                            out.writeChar(']');
+                        }
+                        out.writeChar('}');
+                    }
+                    out.writeChar(']');
+                }
+                if (!result.matchedPatterns.empty()) {
+                    out.write(",\"patterns\":[");
+                    for (size_t i = 0; i < result.matchedPatterns.size(); ++i) {
+                        if (i > 0) out.writeChar(',');
+                        writeJsonString(result.matchedPatterns[i]);
+                    }
+                    out.writeChar(']');
+                }
+                out.write("}\n");
+                break;
+            }
+            case OutputFormat::Tsv: {
+                out.write("search\t");
+                writeTsvField(result.filePath);
+                out.writeChar('\t');
+                writeTsvField(result.fileName);
+                out << '\t' << result.fileSize << '\t' << result.modifiedTime;
+                if (includeFormatted) {
+                    out << '\t' << fileSize(result.fileSize) << '\t';
+                    writeTsvField(result.lastModified);
+                }
+                out.writeChar('\n');
+                // match, path, line number, text, then one column per keyword
+                for (const auto& line : result.matchingLines) {
+                    out.write("match\t");
+                    writeTsvField(result.filePath);
+                    out << '\t' << line.lineNumber << '\t';
+                    writeTsvField(line.text);
+                    for (const auto& keyword : line.keywords) {
+                        out.writeChar('\t');
+                        writeTsvField(keyword);
+                    }
+                    out.writeChar('\n');
+                }
+                for (const auto& pattern : result.matchedPatterns) {
+                    out.write("pattern\t");
+                    writeTsvField(result.filePath);
+                    out.writeChar('\t');
+                    writeTsvField(pattern);
+                    out.writeChar('\n');
+                }
+                break;
+            }
+            case OutputFormat::Binary: {
+                size_t payload = binaryStringSize(result.filePath) + binaryStringSize(result.fileName) + 8 + 8 +
+                                 (includeFormatted ? binaryStringSize(result.lastModified) : 0) +
+                                 4 + binaryListSize(result.matchedPatterns);
+                for (const auto& line : result.matchingLines) {
+                    payload += 8 + binaryStringSize(line.text) + binaryListSize(line.keywords);
+                }
+                writeBinaryHeader(SearchResultRecord, payload);
+                writeBinaryString(result.filePath);
+                writeBinaryString(result.fileName);
+                writeBinaryU64(result.fileSize);
+                writeBinaryU64(static_cast<uint64_t>(result.modifiedTime));
+                if (includeFormatted) {
+                    writeBinaryString(result.lastModified);
+                }
+                writeBinaryU32(static_cast<uint32_t>(result.matchingLines.size()));
+                for (const auto& line : result.matchingLines) {
+                    writeBinaryU64(line.lineNumber);
+                    writeBinaryString(line.text);
+                    writeBinaryU32(static_cast<uint32_t>(line.keywords.size()));
+                    for (const auto& keyword : line.keywords) {
+                        writeBinaryString(keyword);
+                    }
+                }
+                writeBinaryU32(static_cast<uint32_t>(result.matchedPatterns.size()));
+                for (const auto& pattern : result.matchedPatterns) {
+                    writeBinaryString(pattern);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void RecordWriter::writeFileInfo(const FileInfo& info) {
+        switch (format) {
+            case OutputFormat::Ndjson: {
+                out.write("{\"type\":\"file\",\"path\":");
+                writeJsonString(info.path);
+                out.write(",\"name\":");
+                writeJsonString(info.name);
+                out.write(",\"ext\":");
+                writeJsonString(info.extension);
+                out << ",\"size\":" << info.size << ",\"mtime\":" << info.modifiedTime
+                    << ",\"dir\":" << (info.isDirectory ? "true" : "false");
+                if (includeFormatted) {
+                    out << ",\"sizeText\":\"" << fileSize(info.size) << "\",\"modified\":";
+                    writeJsonString(info.lastModified);
+                }
+                out.write("}\n");
+                break;
+            }
+            case OutputFormat::Tsv: {
+                out.write("file\t");
+                writeTsvField(info.path);
+                out.writeChar('\t');
+                writeTsvField(info.name);
+                out.writeChar('\t');
+                writeTsvField(info.extension);
+                out << '\t' << info.size << '\t' << info.modifiedTime << '\t' << (info.isDirectory ? '1' : '0');
+                if (includeFormatted) {
+                    out << '\t' << fileSize(info.size) << '\t';
+                    writeTsvField(info.lastModified);
+                }
+                out.writeChar('\n');
+                break;
+            }
+            case OutputFormat::Binary: {
+                size_t payload = binaryStringSize(info.path) + binaryStringSize(info.name) +
+                                 binaryStringSize(info.extension) + 8 + 8 + 1 +
+                                 (includeFormatted ? binaryStringSize(info.lastModified) : 0);
+                writeBinaryHeader(FileInfoRecord, payload);
+                writeBinaryString(info.path);
+                writeBinaryString(info.name);
+                writeBinaryString(info.extension);
+                writeBinaryU64(info.size);
+                writeBinaryU64(static_cast<uint64_t>(info.modifiedTime));
+                out.writeChar(info.isDirectory ? 1 : 0);
+                if (includeFormatted) {
+                    writeBinaryString(info.lastModified);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void RecordWriter::writeOperationResult(const OperationResult& result) {
+        switch (format) {
+            case OutputFormat::Ndjson: {
+                out << "{\"type\":\"result\",\"success\":" << (result.success ? "true" : "false") << ",\"message\":";
+                writeJsonString(result.message);
+                out << ",\"processed\":" << result.filesProcessed << ",\"skipped\":" << result.filesSkipped << ",\"errors\":[";
+                for (size_t i = 0; i < result.errors.size(); ++i) {
+                    if (i > 0) out.writeChar(',');
+                    writeJsonString(result.errors[i]);
+                }
+                out.write("]}\n");
+                break;
+            }
+            case OutputFormat::Tsv: {
+                out << "result\t" << (result.success ? '1' : '0') << '\t';
+                writeTsvField(result.message);
+                out << '\t' << result.filesProcessed << '\t' << result.filesSkipped << '\t' << result.errors.size() << '\n';
+                for (const auto& error : result.errors) {
+                    out.write("error\t");
+                    writeTsvField(error);
+                    out.writeChar('\n');
+                }
+                break;
+            }
+            case OutputFormat::Binary: {
+                size_t payload = 1 + binaryStringSize(result.message) + 8 + 8 + binaryListSize(result.errors);
+                writeBinaryHeader(OperationResultRecord, payload);
+                out.writeChar(result.success ? 1 : 0);
+                writeBinaryString(result.message);
+                writeBinaryU64(result.filesProcessed);
+                writeBinaryU64(result.filesSkipped);
+                writeBinaryU32(static_cast<uint32_t>(result.errors.size()));
+                for (const auto& error : result.errors) {
+                    writeBinaryString(error);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void RecordWriter::writeError(const std::string& message) {
+        switch (format) {
+            case OutputFormat::Ndjson:
+                out.write("{\"type\":\"error\",\"message\":");
+                writeJsonString(message);
+                out.write("}\n");
+                break;
+            case OutputFormat::Tsv:
+                out.write("error\t");
+                writeTsvField(message);
+                out.writeChar('\n');
+                break;
+            case OutputFormat::Binary:
+                writeBinaryHeader(ErrorRecord, binaryStringSize(message));
+                writeBinaryString(message);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void RecordWriter::writeProfile(const std::string& command, uint64_t wallNs,
+                                    const std::vector<std::pair<std::string, uint64_t>>& fields) {
+        switch (format) {
+            case OutputFormat::Ndjson: {
+                out.write("{\"type\":\"profile\",\"command\":");
+                writeJsonString(command);
+                out << ",\"wall_ns\":" << wallNs;
+                for (const auto& [name, value] : fields) {
+                    out.writeChar(',');
+                    writeJsonString(name);
+                    out << ':' << value;
+                }
+                out.write("}\n");
+                break;
+            }
+            case OutputFormat::Tsv: {
+                out.write("profile\t");
+                writeTsvField(command);
+                out << "\twall_ns\t" << wallNs << '\n';
+                for (const auto& [name, value] : fields) {
+                    out.write("metric\t");
+                    writeTsvField(name);
+                    out << '\t' << value << '\n';
+                }
+                break;
+            }
+            case OutputFormat::Binary: {
+                size_t payload = binaryStringSize(command) + 8 + 4;
+                for (const auto& field : fields) {
+                    payload += binaryStringSize(field.first) + 8;
+                }
+                writeBinaryHeader(ProfileRecord, payload);
+                writeBinaryString(command);
+                writeBinaryU64(wallNs);
+                writeBinaryU32(static_cast<uint32_t>(fields.size()));
+                for (const auto& [name, value] : fields) {
+                    writeBinaryString(name);
+                    writeBinaryU64(value);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void RecordWriter::writeStats(const std::string& path, const std::vector<std::pair<std::string, uint64_t>>& fields) {
+        switch (format) {
+            case OutputFormat::Ndjson: {
+                out.write("{\"type\":\"stats\",\"path\":");
+                writeJsonString(path);
+                for (const auto& [name, value] : fields) {
+                    out.writeChar(',');
+                    writeJsonString(name);
+                    out << ':' << value;
+                }
+                out.write("}\n");
+                break;
+            }
+            case OutputFormat::Tsv: {
+                out.write("stats\t");
+                writeTsvField(path);
+                out.writeChar('\n');
+                for (const auto& [name, value] : fields) {
+                    out.write("stat\t");
+                    writeTsvField(name);
+                    out << '\t' << value << '\n';
+                }
+                break;
+            }
+            case OutputFormat::Binary: {
+                size_t payload = binaryStringSize(path) + 4;
+                for (const auto& field : fields) {
+                    payload += binaryStringSize(field.first) + 8;
+                }
+                writeBinaryHeader(StatsRecord, payload);
+                writeBinaryString(path);
+                writeBinaryU32(static_cast<uint32_t>(fields.size()));
+                for (const auto& [name, value] : fields) {
+                    writeBinaryString(name);
+                    writeBinaryU64(value);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+}
@@ -0,0 +1,237 @@
+#include "RenameTemplate.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        // Same split as fs::path stem/extension: ".bashrc" has no extension,
+        // "a.tar.gz" has ".gz"
+        size_t extensionOffset(std::string_view name) {
+            size_t dot = name.rfind('.');
+            if (dot == std::string_view::npos || dot == 0) return name.size();
+            return dot;
+        }
+
+        bool parseNumber(std::string_view text, uint64_t& value) {
+            if (text.empty()) return false;
+            auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return ec == std::errc() && end == text.data() + text.size();
+        }
+
+        char folded(char c) {
+            return static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+        }
+
+    }
+
+    RenameTemplate::RenameTemplate() : pattern("*"), wildcards{0}, metadata(false) {
+    }
+
+    bool RenameTemplate::compile(const std::string& sourcePattern, const std::string& target,
+                                 RenameTemplate& compiled, std::string& error) {
+        compiled = RenameTemplate();
+        compiled.pattern = toLowerCase(sourcePattern.empty() ? std::string("*") : sourcePattern);
+        compiled.wildcards.clear();
+        for (size_t i = 0; i < compiled.pattern.size(); ++i) {
+            if (compiled.pattern[i] == '*' || compiled.pattern[i] == '?') compiled.wildcards.push_back(i);
+        }
+
+        if (target.empty()) {
+            error = "empty rename template";
+            return false;
+        }
+        std::string text;
+        for (size_t i = 0; i < target.size(); ++i) {
+            char c = target[i];
+            if (c == '{' && i + 1 < target.size() && target[i + 1] == '{') {
+                text += '{';
+                ++i;
+            } else if (c == '}' && i + 1 < target.size() && target[i + 1] == '}') {
+                text += '}';
+                ++i;
+            } else if (c == '{') {
+                size_t close = target.find('}', i + 1);
+                if (close == std::string::npos) {
+                    error = "unclosed '{' in rename template";
+                    return false;
+                }
+                compiled.addLiteral(text);
+                text.clear();
+                if (!compiled.addToken(std::string_view(target).substr(i + 1, close - i - 1), error)) return false;
+                i = close;
+            } else if (c == '}') {
+                error = "unmatched '}' in rename template";
+                return false;
+            } else {
+                text += c;
+            }
+        }
+        compiled.addLiteral(text);
+        return true;
+    }
+
+    void RenameTemplate::addLiteral(std::string_view text) {
+        if (text.empty()) return;
+        if (!parts.empty() && parts.back().kind == Kind::Literal) {
+            parts.back().text.append(text);
+            return;
+        }
+        Part part;
+        part.kind = Kind::Literal;
+        part.text.assign(text);
+        parts.push_back(std::move(part));
+    }
+
+    bool RenameTemplate::addToken(std::string_view token, std::string& error) {
+        size_t colon = token.find(':');
+        std::string_view key = token.substr(0, colon);
+        std::string_view argument = colon == std::string_view::npos ? std::string_view() : token.substr(colon + 1);
+        bool hasArgument = colon != std::string_view::npos;
+
+        Part part;
+        uint64_t number = 0;
+        if (key == "file" || key == "name" || key == "ext" || key == "size") {
+            if (hasArgument) {
+                error = "{" + std::string(key) + "} takes no argument";
+                return false;
+            }
+            part.kind = key == "file" ? Kind::File : key == "name" ? Kind::Name : key == "ext" ? Kind::Extension : Kind::Size;
+            metadata = metadata || part.kind == Kind::Size;
+        } else if (key == "n") {
+            part.kind = Kind::Counter;
+            if (hasArgument) {
+                size_t second = argument.find(':');
+                uint64_t width = 0;
+                bool valid = parseNumber(argument.substr(0, second), width) && width <= 20;
+                if (valid && second != std::string_view::npos) valid = parseNumber(argument.substr(second + 1), part.start);
+                if (!valid) {
+                    error = "bad counter {" + std::string(token) + "}: use {n}, {n:width} or {n:width:start}";
+                    return false;
+                }
+                part.number = static_cast<size_t>(width);
+            }
+        } else if (key == "date") {
+            part.kind = Kind::Date;
+            part.dates = std::make_shared<DayFormatter>(hasArgument ? std::string(argument) : std::string("%Y-%m-%d"));
+            metadata = true;
+        } else if (parseNumber(key, number) && !hasArgument) {
+            if (number == 0 || number > wildcards.size()) {
+                error = "{" + std::string(key) + "}: the pattern has " + std::to_string(wildcards.size()) + " wildcard(s)";
+                return false;
+            }
+            part.kind = Kind::Capture;
+            part.number = static_cast<size_t>(number);
+        } else {
+            error = "unknown token {" + std::string(token) + "} in rename template";
+            return false;
+        }
+        parts.push_back(std::move(part));
+        return true;
+    }
+
+    std::string RenameTemplate::literal(const std::string& text) {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c : text) {
+            if (c == '{' || c == '}') escaped += c;
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    bool RenameTemplate::needsMetadata() const {
+        return metadata;
+    }
+
+    bool RenameTemplate::match(std::string_view name, Captures& captures) const {
+        // GlobPattern's matcher, noting where each wildcard starts. Only the
+        // most recent '*' ever grows, and everything after it is matched
+        // again, so the starts left at the end belong to the final match.
+        captures.assign(wildcards.size(), {0, 0});
+        auto slot = [this](size_t position) {
+            return static_cast<size_t>(std::lower_bound(wildcards.begin(), wildcards.end(), position) - wildcards.begin());
+        };
+
+        size_t p = 0;
+        size_t n = 0;
+        size_t starPattern = std::string::npos;
+        size_t starName = 0;
+        while (n < name.size()) {
+            if (p < pattern.size() && pattern[p] == '?') {
+                captures[slot(p)].first = n;
+                p++;
+                n++;
+            } else if (p < pattern.size() && pattern[p] != '*' && pattern[p] == folded(name[n])) {
+                p++;
+                n++;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                captures[slot(p)].first = n;
+                starPattern = p++;
+                starName = n;
+            } else if (starPattern != std::string::npos) {
+                p = starPattern + 1;
+                n = ++starName;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            captures[slot(p)].first = n;
+            p++;
+        }
+        if (p != pattern.size()) return false;
+
+        // A '*' ends where the next wildcard starts, less the literal text between
+        for (size_t k = 0; k < wildcards.size(); ++k) {
+            if (pattern[wildcards[k]] == '?') {
+                captures[k].second = 1;
+                continue;
+            }
+            size_t next = k + 1 < wildcards.size() ? wildcards[k + 1] : pattern.size();
+            size_t nextStart = k + 1 < wildcards.size() ? captures[k + 1].first : name.size();
+            captures[k].second = nextStart - (next - wildcards[k] - 1) - captures[k].first;
+        }
+        return true;
+    }
+
+    bool RenameTemplate::expand(std::string_view name, const Captures& captures, size_t index,
+                                int64_t modifiedNs, uint64_t size, std::string& out) {
+        size_t dot = extensionOffset(name);
+        std::string date;
+        char digits[32];
+        for (const auto& part : parts) {
+            switch (part.kind) {
+                case Kind::Literal: out += part.text; break;
+                case Kind::File: out.append(name); break;
+                case Kind::Name: out.append(name.substr(0, dot)); break;
+                case Kind::Extension: out.append(name.substr(dot)); break;
+                case Kind::Capture: {
+                    const auto& [offset, length] = captures[part.number - 1];
+                    out.append(name.substr(offset, length));
+                    break;
+                }
+                case Kind::Counter: {
+                    int length = std::snprintf(digits, sizeof(digits), "%0*llu", static_cast<int>(part.number),
+                                               static_cast<unsigned long long>(part.start + index));
+                    out.append(digits, static_cast<size_t>(length));
+                    break;
+                }
+                case Kind::Date:
+                    if (!part.dates->format(modifiedNs, date)) return false;
+                    out += date;
+                    break;
+                case Kind::Size: {
+                    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), size);
+                    out.append(digits, end);
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+}
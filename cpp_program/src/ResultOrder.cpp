@@ -0,0 +1,123 @@
+#include "ResultOrder.h"
+
+namespace FileSystemManager {
+
+    bool ResultOrder::parse(const std::string& text, ResultOrder& order, std::string& error) {
+        std::string name = toLowerCase(text);
+        std::string direction;
+        size_t colon = name.find(':');
+        if (colon != std::string::npos) {
+            direction = name.substr(colon + 1);
+            name.erase(colon);
+        }
+
+        if (name == "size") {
+            order.key = SortKey::Size;
+        } else if (name == "mtime" || name == "modified" || name == "date") {
+            order.key = SortKey::Modified;
+        } else if (name == "name") {
+            order.key = SortKey::Name;
+        } else if (name == "path") {
+            order.key = SortKey::Path;
+        } else {
+            error = "Unknown sort key: " + text + " (use size, mtime, name or path)";
+            return false;
+        }
+
+        if (direction.empty()) {
+            order.descending = order.key == SortKey::Size || order.key == SortKey::Modified;
+        } else if (direction == "asc" || direction == "desc") {
+            order.descending = direction == "desc";
+        } else {
+            error = "Unknown sort direction: " + direction + " (use asc or desc)";
+            return false;
+        }
+        return true;
+    }
+
+    bool ResultOrder::precedes(const SearchResult& a, const SearchResult& b) const {
+        int ranking = 0;
+        switch (key) {
+            case SortKey::Size:
+                ranking = a.fileSize < b.fileSize ? -1 : a.fileSize > b.fileSize ? 1 : 0;
+                break;
+            case SortKey::Modified:
+                ranking = a.modifiedTime < b.modifiedTime ? -1 : a.modifiedTime > b.modifiedTime ? 1 : 0;
+                break;
+            case SortKey::Name:
+                ranking = a.fileName.compare(b.fileName);
+                break;
+            case SortKey::None:
+            case SortKey::Path:
+                break;
+        }
+        if (ranking == 0) {
+            // Path is the tie-break for every key, always ascending
+            int byPath = a.filePath.compare(b.filePath);
+            return key == SortKey::Path && descending ? byPath > 0 : byPath < 0;
+        }
+        return descending ? ranking > 0 : ranking < 0;
+    }
+
+    const char* sortKeyName(SortKey key) {
+        switch (key) {
+            case SortKey::None: return "none";
+            case SortKey::Path: return "path";
+            case SortKey::Name: return "name";
+            case SortKey::Size: return "size";
+            case SortKey::Modified: return "mtime";
+        }
+        return "";
+    }
+
+    ResultCollector::ResultCollector(const ResultOrder& resultOrder)
+        : order(resultOrder), best(resultOrder.key == SortKey::None ? 0 : resultOrder.limit, RanksBelow{resultOrder}) {
+    }
+
+    bool ResultCollector::wouldKeep(const SearchResult& candidate) const {
+        if (order.limit == 0) return true;
+        if (!bounded()) return all.size() < order.limit;
+        return best.wouldAccept(candidate);
+    }
+
+    void ResultCollector::add(SearchResult&& result) {
+        if (bounded()) {
+            best.push(std::move(result));
+        } else if (order.limit == 0 || all.size() < order.limit) {
+            all.push_back(std::move(result));
+        }
+    }
+
+    void ResultCollector::merge(ResultCollector&& other) {
+        if (bounded()) {
+            best.merge(std::move(other.best));
+            return;
+        }
+        for (auto& result : other.all) {
+            if (order.limit > 0 && all.size() >= order.limit) break;
+            all.push_back(std::move(result));
+        }
+        other.all.clear();
+    }
+
+    size_t ResultCollector::size() const {
+        return bounded() ? best.size() : all.size();
+    }
+
+    std::vector<SearchResult> ResultCollector::take() {
+        if (bounded()) {
+            std::vector<SearchResult> results = best.sorted();
+            best = TopK<SearchResult, RanksBelow>(order.limit, RanksBelow{order});
+            return results;
+        }
+        std::vector<SearchResult> results = std::move(all);
+        all.clear();
+        if (order.key != SortKey::None) {
+            std::sort(results.begin(), results.end(), [this](const SearchResult& a, const SearchResult& b) {
+                return order.precedes(a, b);
+            });
+        }
+        return results;
+    }
+
+}
@@ -0,0 +1,88 @@
+#include "ScriptPlan.h"
+#include <set>
+
+namespace FileSystemManager {
+
+    bool ScriptPlan::load(const std::string& scriptPath) {
+        std::ifstream script(scriptPath);
+        if (!script.is_open()) {
+            return false;
+        }
+
+        commands.clear();
+        stages.clear();
+
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(script, line)) {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#') { // Skip empty lines and comments
+                addCommand(lineNumber, line);
+            }
+        }
+        return true;
+    }
+
+    void ScriptPlan::addCommand(size_t lineNumber, const std::string& text) {
+        std::vector<std::string> args;
+        std::istringstream ss(text);
+        std::string arg;
+        while (ss >> arg) {
+            args.push_back(arg);
+        }
+        if (args.empty()) return;
+
+        Command command{lineNumber, text, args[0], isReadOnlyCommand(args)};
+        commands.push_back(command);
+
+        size_t index = commands.size() - 1;
+        if (command.readOnly && !stages.empty() && !stages.back().barrier) {
+            stages.back().commands.push_back(index);
+        } else {
+            stages.push_back(Stage{{index}, !command.readOnly});
+        }
+    }
+
+    const std::vector<ScriptPlan::Command>& ScriptPlan::getCommands() const {
+        return commands;
+    }
+
+    const std::vector<ScriptPlan::Stage>& ScriptPlan::getStages() const {
+        return stages;
+    }
+
+    size_t ScriptPlan::getParallelCommandCount() const {
+        size_t count = 0;
+        for (const auto& stage : stages) {
+            if (!stage.barrier && stage.commands.size() > 1) {
+                count += stage.commands.size();
+            }
+        }
+        return count;
+    }
+
+    bool ScriptPlan::isReadOnlyCommand(const std::vector<std::string>& args) {
+        static const std::set<std::string> readOnlyCommands = {
+            "help", "h", "version", "v", "pwd", "ls", "dir", "cat",
+            "find", "finddate", "grep", "size", "tree", "search", "stats"
+        };
+
+        if (args.empty() || readOnlyCommands.find(args[0]) == readOnlyCommands.end()) {
+            return false;
+        }
+
+        // Exporting statistics writes a file
+        if (args[0] == "stats") {
+            for (size_t i = 1; i + 1 < args.size(); ++i) {
+                if ((args[i] == "--csv" || args[i] == "--json") && args[i + 1] != "-") {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+}
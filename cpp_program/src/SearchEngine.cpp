@@ -1,117 +1,394 @@
 #include "SearchEngine.h"
-#include <fstream>
+#include "DateIndex.h"
+#include "SearchQuery.h"
+#include "Instrumentation.h"
+#include "DfaRegex.h"
+#include "ContentClassifier.h"
+#include "ByteScan.h"
 #include <algorithm>
+#include <memory>
 
 namespace FileSystemManager {
 
-    SearchEngine::SearchEngine() : searchRoot(fs::current_path().string()), caseSensitive(false), useRegex(false) {
+    namespace {
+
+        // Regex matches up to this long are still found across the cut when
+        // a line is longer than the scan window
+        const size_t RegexOverlap = 4096;
+
+        // What one content search looks for; regex matchers carry DFA state,
+        // so every worker has its own set
+        struct ContentMatchers {
+            std::vector<LiteralFinder> terms;
+            std::vector<RegexMatcher> regexes;
+            std::vector<LiteralFinder> regexLiterals;   // Where to center excerpts of long lines
+            const AhoCorasick* keywords = nullptr;
+            std::unique_ptr<ChunkedReader> reader;      // Reused from file to file
+            const CancellationToken* cancellation = nullptr;
+            IoThrottle* throttle = nullptr;             // Charged for every read
+        };
+
+        // Windows overlap by the longest literal, so no match is lost at a cut
+        void prepareReader(ContentMatchers& matchers, const ScanLimits& limits) {
+            size_t overlap = 0;
+            for (const auto& term : matchers.terms) {
+                overlap = std::max(overlap, term.getLiteral().size());
+            }
+            if (matchers.keywords) {
+                for (uint32_t id = 0; id < matchers.keywords->getPatternCount(); ++id) {
+                    overlap = std::max(overlap, matchers.keywords->getPattern(id).size());
+                }
+            }
+            if (!matchers.regexes.empty()) overlap = std::max(overlap, RegexOverlap);
+            matchers.reader = std::make_unique<ChunkedReader>(limits, overlap > 0 ? overlap - 1 : 0);
+            matchers.reader->setThrottle(matchers.throttle, matchers.cancellation);
+        }
+
+        IoPriority priorityOf(const SearchContext& query) {
+            return query.settings.throttle ? query.settings.throttle->getPriority() : IoPriority::Default;
+        }
+
+        // One pass over an open file, window by window, for every matcher at
+        // once. Lines are reported once each, even where windows overlap.
+        // True if every term, every regex and (if any) a keyword matched.
+        bool scanWindows(ChunkedReader& reader, const EntryMetadata& metadata, bool classified,
+                         ContentMatchers& matchers, const ScanLimits& limits, SearchResult& result) {
+            if (!classified) {
+                // A leading hole reads as NUL bytes, which makes the file binary
+                std::string_view sample;
+                uint64_t offset = 0;
+                if (!reader.peek(ContentClassifier::SampleSize, sample, offset) || offset > 0) return false;
+                if (!ContentClassifier::shared().classifyBuffer(metadata, sample.data(), sample.size()).isSearchable()) {
+                    return false;
+                }
+            }
+
+            std::vector<std::vector<LineMatch>> termLines(matchers.terms.size());
+            std::vector<size_t> termLast(matchers.terms.size(), 0);
+            std::vector<std::vector<LineMatch>> regexLines(matchers.regexes.size());
+            std::vector<size_t> regexLast(matchers.regexes.size(), 0);
+            std::vector<LineMatch> keywordLines;
+            size_t keywordLast = 0;
+            std::vector<bool> found(matchers.keywords ? matchers.keywords->getPatternCount() : 0, false);
+
+            ScanWindow window;
+            while (reader.next(window)) {
+                if (matchers.cancellation && matchers.cancellation->isCancelled()) return false;
+                const char* data = window.data.data();
+                const char* end = data + window.data.size();
+
+                for (size_t i = 0; i < matchers.terms.size(); ++i) {
+                    const LiteralFinder& finder = matchers.terms[i];
+                    size_t lineNumber = window.firstLine;
+                    const char* counted = data;
+                    const char* cursor = data;
+                    while (cursor < end) {
+                        const char* hit = finder.find(cursor, end);
+                        if (!hit) break;
+                        lineNumber += countByte(counted, hit, '\n');
+                        counted = hit;
+                        const char* lineStart = findLastByte(cursor, hit, '\n');
+                        lineStart = lineStart ? lineStart + 1 : cursor;
+                        const char* lineEnd = findByte(hit, end, '\n');
+                        if (!lineEnd) lineEnd = end;
+                        if (lineNumber != termLast[i]) {
+                            termLast[i] = lineNumber;
+                            termLines[i].push_back({lineNumber,
+                                                    window.excerpt(lineStart, lineEnd, hit, finder.getLiteral().size(),
+                                                                   limits.maxLineLength),
+                                                    {}});
+                        }
+                        if (lineEnd == end) break;
+                        cursor = lineEnd + 1;
+                    }
+                }
+
+                for (size_t i = 0; i < matchers.regexes.size(); ++i) {
+                    RegexMatcher& matcher = matchers.regexes[i];
+                    // '^' and '$' do not hold where a window cuts a line
+                    bool startCut = window.startsMidLine && matcher.getRegex().hasLineStartAnchor();
+                    bool endCut = window.endsMidLine && matcher.getRegex().hasLineEndAnchor();
+                    matcher.forEachMatchingLine(window.data, [&](size_t lineInWindow, std::string_view line) {
+                        size_t lineNumber = window.firstLine + lineInWindow - 1;
+                        const char* lineStart = line.data();
+                        const char* lineEnd = lineStart + line.size();
+                        if ((startCut && lineStart == data) || (endCut && lineEnd == end)) return;
+                        if (lineNumber == regexLast[i]) return;
+                        regexLast[i] = lineNumber;
+                        const char* focus = lineStart;
+                        size_t focusLength = 0;
+                        const LiteralFinder& literal = matchers.regexLiterals[i];
+                        if (line.size() > limits.maxLineLength && !literal.empty()) {
+                            const char* hit = literal.find(lineStart, lineEnd);
+                            if (hit) {
+                                focus = hit;
+                                focusLength = literal.getLiteral().size();
+                            }
+                        }
+                        regexLines[i].push_back({lineNumber,
+                                                 window.excerpt(lineStart, lineEnd, focus, focusLength, limits.maxLineLength),
+                                                 {}});
+                    });
+                }
+
+                if (matchers.keywords) {
+                    const AhoCorasick& keywords = *matchers.keywords;
+                    keywords.forEachMatchingLine(window.data, [&](size_t lineInWindow, std::string_view line,
+                                                                  const std::vector<uint32_t>& patternIds) {
+                        size_t lineNumber = window.firstLine + lineInWindow - 1;
+                        for (uint32_t id : patternIds) {
+                            found[id] = true;
+                        }
+                        if (lineNumber == keywordLast) return;
+                        keywordLast = lineNumber;
+                        LineMatch hit;
+                        hit.lineNumber = lineNumber;
+                        for (uint32_t id : patternIds) {
+                            hit.keywords.push_back(keywords.getPattern(id));
+                        }
+                        const char* lineStart = line.data();
+                        const char* lineEnd = lineStart + line.size();
+                        const char* focus = lineStart;
+                        const std::string& first = keywords.getPattern(patternIds[0]);
+                        if (line.size() > limits.maxLineLength) {
+                            const char* at = LiteralFinder(first, keywords.isCaseSensitive()).find(lineStart, lineEnd);
+                            if (at) focus = at;
+                        }
+                        hit.text = window.excerpt(lineStart, lineEnd, focus, first.size(), limits.maxLineLength);
+                        keywordLines.push_back(std::move(hit));
+                    });
+                }
+            }
+
+            for (const auto& lines : termLines) {
+                if (lines.empty()) return false;
+            }
+            for (const auto& lines : regexLines) {
+                if (lines.empty()) return false;
+            }
+            if (matchers.keywords && keywordLines.empty()) return false;
+
+            for (auto& lines : regexLines) {
+                std::move(lines.begin(), lines.end(), std::back_inserter(result.matchingLines));
+            }
+            std::move(keywordLines.begin(), keywordLines.end(), std::back_inserter(result.matchingLines));
+            for (auto& lines : termLines) {
+                std::move(lines.begin(), lines.end(), std::back_inserter(result.matchingLines));
+            }
+            for (uint32_t id = 0; id < found.size(); ++id) {
+                if (found[id]) result.matchedPatterns.push_back(matchers.keywords->getPattern(id));
+            }
+            return true;
+        }
+
+        bool scanContent(const std::string& filePath, const EntryMetadata& metadata, bool classified,
+                         ContentMatchers& matchers, const ScanLimits& limits, SearchResult& result) {
+            ChunkedReader& reader = *matchers.reader;
+            if (!reader.open(filePath)) return false;
+            bool matched = scanWindows(reader, metadata, classified, matchers, limits, result);
+            reader.close();
+            return matched;
+        }
+
+    }
+
+    bool SearchHandle::isReady() const {
+        return done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    void SearchHandle::wait() const {
+        done.wait();
+    }
+
+    const std::vector<SearchResult>& SearchHandle::getResults() const {
+        done.wait();
+        return context->results;
+    }
+
+    const SearchStats& SearchHandle::getStats() const {
+        done.wait();
+        return context->stats;
+    }
+
+    void SearchHandle::cancel() {
+        if (context) context->cancellation.cancel();
+    }
+
+    SearchEngine::SearchEngine() {
+        settings.searchRoot = fs::current_path().string();
     }
 
-    SearchEngine::SearchEngine(const std::string& rootPath) : searchRoot(rootPath), caseSensitive(false), useRegex(false) {
-        if (!fs::exists(searchRoot)) {
-            searchRoot = fs::current_path().string();
+    SearchEngine::SearchEngine(const std::string& rootPath) {
+        settings.searchRoot = rootPath;
+        if (!fs::exists(settings.searchRoot)) {
+            settings.searchRoot = fs::current_path().string();
         }
     }
 
     void SearchEngine::setSearchRoot(const std::string& path) {
         if (fs::exists(path) && fs::is_directory(path)) {
-            searchRoot = path;
+            std::lock_guard<std::mutex> lock(settingsMutex);
+            settings.searchRoot = path;
         }
     }
 
     void SearchEngine::setCaseSensitive(bool sensitive) {
-        caseSensitive = sensitive;
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.caseSensitive = sensitive;
     }
 
     void SearchEngine::setUseRegex(bool useRegex) {
-        this->useRegex = useRegex;
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.useRegex = useRegex;
+    }
+
+    void SearchEngine::setFormatTimestamps(bool format) {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.formatTimestamps = format;
+    }
+
+    void SearchEngine::setDateIndexPath(const std::string& path) {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.dateIndexPath = path;
+    }
+
+    void SearchEngine::setResultOrder(const ResultOrder& order) {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.resultOrder = order;
+    }
+
+    void SearchEngine::setScanLimits(const ScanLimits& limits) {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.scanLimits = limits;
+    }
+
+    ScanLimits SearchEngine::getScanLimits() const {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        return settings.scanLimits;
+    }
+
+    void SearchEngine::setTimeout(std::chrono::milliseconds limit) {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.timeout = limit;
+    }
+
+    void SearchEngine::setIoThrottle(std::shared_ptr<IoThrottle> ioThrottle) {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        settings.throttle = std::move(ioThrottle);
+    }
+
+    SearchSettings SearchEngine::snapshot() const {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        return settings;
+    }
+
+    std::vector<SearchResult> SearchEngine::publish(SearchContext& query) {
+        std::lock_guard<std::mutex> lock(lastMutex);
+        lastResults = std::move(query.results);
+        lastSearchStats = query.stats;
+        return lastResults;
+    }
+
+    void SearchEngine::finishQuery(SearchContext& query, std::string pattern) {
+        auto endTime = std::chrono::steady_clock::now();
+        query.stats.searchTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - query.started);
+        query.stats.filesSearched = query.filesExamined;
+        query.stats.filesMatched = query.results.size();
+        query.stats.searchPattern = std::move(pattern);
+        query.stats.cancelled = query.cancellation.isCancelled();
     }
 
     std::vector<SearchResult> SearchEngine::searchByName(const std::string& pattern, bool recursive) {
-        searchStartTime = std::chrono::steady_clock::now();
-        lastResults.clear();
+        SearchContext query(snapshot());
+        runByName(query, pattern, recursive);
+        return publish(query);
+    }
+
+    void SearchEngine::runByName(SearchContext& query, const std::string& pattern, bool recursive) {
+        ScopedPhase phase("search.name");
+        ScopedIoPriority priority(priorityOf(query));
+        query.started = std::chrono::steady_clock::now();
         
         try {
-            if (recursive) {
-                searchByNameRecursive(searchRoot, pattern);
-            } else {
-                searchByNameInDirectory(searchRoot, pattern);
-            }
-        } catch (const std::exception&) {
-            // Error handling
+            ResultCollector results(query.settings.resultOrder);
+            searchByNameIn(query, query.settings.searchRoot, pattern, recursive, results);
+            query.results = results.take();
+        } catch (const std::exception& e) {
+            query.stats.error = e.what();
         }
         
-        auto endTime = std::chrono::steady_clock::now();
-        lastSearchStats.searchTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - searchStartTime);
-        lastSearchStats.filesSearched = lastResults.size();
-        lastSearchStats.filesMatched = lastResults.size();
-        lastSearchStats.searchPattern = pattern;
-        
-        return lastResults;
+        finishQuery(query, pattern);
     }
 
-    void SearchEngine::searchByNameRecursive(const std::string& directory, const std::string& pattern) {
-        try {
-            for (const auto& entry : fs::recursive_directory_iterator(directory)) {
-                if (fs::is_regular_file(entry)) {
-                    std::string fileName = entry.path().filename().string();
-                    if (matchesFileName(fileName, pattern)) {
-                        SearchResult result;
-                        result.filePath = entry.path().string();
-                        result.fileName = fileName;
-                        result.fileSize = fs::file_size(entry);
-                        
-                        auto ftime = fs::last_write_time(entry);
-                        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                        result.lastModified = formatTimestamp(sctp);
-                        
-                        lastResults.push_back(result);
-                    }
-                }
+    void SearchEngine::forEachFile(SearchContext& query, const std::string& directory, bool recursive, const FileVisitor& visit) {
+        WalkOptions options;
+        options.recursive = recursive;
+        options.threadCount = 1;    // Results keep the walk order
+
+        options.cancellation = &query.cancellation;
+        options.throttle = query.settings.throttle.get();
+
+        DirectoryWalker walker(options);
+        walker.walk(directory, [&](size_t, const WalkEntry& entry) {
+            if (entry.type == EntryType::Symlink) {
+                // Symlinks to regular files count, as with fs::is_regular_file
+                EntryMetadata target;
+                if (!DirectoryWalker::readMetadata(entry, target, true) || !target.isRegularFile) return;
+            } else if (entry.type != EntryType::Regular) {
+                return;
             }
-        } catch (const std::exception&) {
-            // Error handling
-        }
+            query.filesExamined++;
+            visit(entry);
+        });
     }
 
-    void SearchEngine::searchByNameInDirectory(const std::string& directory, const std::string& pattern) {
-        try {
-            for (const auto& entry : fs::directory_iterator(directory)) {
-                if (fs::is_regular_file(entry)) {
-                    std::string fileName = entry.path().filename().string();
-                    if (matchesFileName(fileName, pattern)) {
-                        SearchResult result;
-                        result.filePath = entry.path().string();
-                        result.fileName = fileName;
-                        result.fileSize = fs::file_size(entry);
-                        
-                        auto ftime = fs::last_write_time(entry);
-                        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                        result.lastModified = formatTimestamp(sctp);
-                        
-                        lastResults.push_back(result);
-                    }
-                }
+    void SearchEngine::searchByNameIn(SearchContext& query, const std::string& directory, const std::string& pattern,
+                                      bool recursive, ResultCollector& results) {
+        // Compile the matcher once per search rather than once per file
+        GlobPattern glob(pattern);
+        DfaRegex regex;
+        std::unique_ptr<RegexMatcher> matcher;
+        if (query.settings.useRegex) {
+            // An invalid pattern is reported, not mistaken for "no matches"
+            std::string error;
+            if (!regex.compile(pattern, query.settings.caseSensitive, error)) {
+                query.stats.error = "Invalid regex '" + pattern + "': " + error;
+                return;
             }
-        } catch (const std::exception&) {
-            // Error handling
+            matcher = std::make_unique<RegexMatcher>(regex);
         }
-    }
 
-    bool SearchEngine::matchesFileName(const std::string& fileName, const std::string& pattern) {
-        if (useRegex) {
-            try {
-                std::regex regex(pattern, caseSensitive ? std::regex_constants::ECMAScript : 
-                                               std::regex_constants::ECMAScript | std::regex_constants::icase);
-                return std::regex_match(fileName, regex);
-            } catch (const std::exception&) {
-                return false;
+        forEachFile(query, directory, recursive, [&](const WalkEntry& entry) {
+            std::string_view name = entry.name();
+            bool matched = matcher ? matcher->fullMatch(name) : glob.matches(name);
+            if (!matched) return;
+
+            EntryMetadata metadata;
+            if (DirectoryWalker::readMetadata(entry, metadata, true)) {
+                results.add(makeSearchResult(query, entry, metadata));
             }
-        } else {
-            return matchesPattern(fileName, pattern);
+        });
+    }
+
+    SearchResult SearchEngine::makeSearchResult(const SearchContext& query, const WalkEntry& entry, const EntryMetadata& metadata) {
+        return makeSearchResult(query, entry.path(), entry.node->pathLength - entry.node->nameLength,
+                                metadata.size, metadata.modifiedNs);
+    }
+
+    SearchResult SearchEngine::makeSearchResult(const SearchContext& query, std::string filePath, size_t nameOffset,
+                                                uint64_t fileSize, int64_t modifiedNs) {
+        SearchResult result;
+        result.fileName = filePath.substr(nameOffset);
+        result.filePath = std::move(filePath);
+        result.fileSize = static_cast<size_t>(fileSize);
+        result.modifiedTime = modifiedNs / 1000000000LL;
+        if (query.settings.formatTimestamps) {
+            std::chrono::system_clock::time_point modified(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(modifiedNs)));
+            result.lastModified = formatTimestamp(modified);
         }
+        
+        return result;
     }
 
     std::vector<SearchResult> SearchEngine::searchByExtension(const std::string& extension, bool recursive) {
@@ -120,261 +397,402 @@ namespace FileSystemManager {
     }
 
     std::vector<SearchResult> SearchEngine::searchBySize(size_t minSize, size_t maxSize, bool recursive) {
-        searchStartTime = std::chrono::steady_clock::now();
-        lastResults.clear();
+        SearchContext query(snapshot());
+        runBySize(query, minSize, maxSize, recursive);
+        return publish(query);
+    }
+
+    void SearchEngine::runBySize(SearchContext& query, size_t minSize, size_t maxSize, bool recursive) {
+        ScopedPhase phase("search.size");
+        ScopedIoPriority priority(priorityOf(query));
+        query.started = std::chrono::steady_clock::now();
         
         try {
-            if (recursive) {
-                searchBySizeRecursive(searchRoot, minSize, maxSize);
-            } else {
-                searchBySizeInDirectory(searchRoot, minSize, maxSize);
-            }
-        } catch (const std::exception&) {
-            // Error handling
+            ResultCollector results(query.settings.resultOrder);
+            searchBySizeIn(query, query.settings.searchRoot, minSize, maxSize, recursive, results);
+            query.results = results.take();
+        } catch (const std::exception& e) {
+            query.stats.error = e.what();
         }
         
-        auto endTime = std::chrono::steady_clock::now();
-        lastSearchStats.searchTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - searchStartTime);
-        lastSearchStats.filesSearched = lastResults.size();
-        lastSearchStats.filesMatched = lastResults.size();
-        lastSearchStats.searchPattern = "size:" + std::to_string(minSize) + "-" + std::to_string(maxSize);
-        
-        return lastResults;
+        finishQuery(query, "size:" + std::to_string(minSize) + "-" + std::to_string(maxSize));
     }
 
-    void SearchEngine::searchBySizeRecursive(const std::string& directory, size_t minSize, size_t maxSize) {
-        try {
-            for (const auto& entry : fs::recursive_directory_iterator(directory)) {
-                if (fs::is_regular_file(entry)) {
-                    size_t fileSize = fs::file_size(entry);
-                    if (fileSize >= minSize && fileSize <= maxSize) {
-                        SearchResult result;
-                        result.filePath = entry.path().string();
-                        result.fileName = entry.path().filename().string();
-                        result.fileSize = fileSize;
-                        
-                        auto ftime = fs::last_write_time(entry);
-                        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                        result.lastModified = formatTimestamp(sctp);
-                        
-                        lastResults.push_back(result);
-                    }
-                }
+    void SearchEngine::searchBySizeIn(SearchContext& query, const std::string& directory, size_t minSize, size_t maxSize,
+                                      bool recursive, ResultCollector& results) {
+        forEachFile(query, directory, recursive, [&](const WalkEntry& entry) {
+            EntryMetadata metadata;
+            if (!DirectoryWalker::readMetadata(entry, metadata, true)) return;
+            if (metadata.size >= minSize && metadata.size <= maxSize) {
+                results.add(makeSearchResult(query, entry, metadata));
             }
-        } catch (const std::exception&) {
-            // Error handling
-        }
+        });
     }
 
-    void SearchEngine::searchBySizeInDirectory(const std::string& directory, size_t minSize, size_t maxSize) {
-        try {
-            for (const auto& entry : fs::directory_iterator(directory)) {
-                if (fs::is_regular_file(entry)) {
-                    size_t fileSize = fs::file_size(entry);
-                    if (fileSize >= minSize && fileSize <= maxSize) {
-                        SearchResult result;
-                        result.filePath = entry.path().string();
-                        result.fileName = entry.path().filename().string();
-                        result.fileSize = fileSize;
-                        
-                        auto ftime = fs::last_write_time(entry);
-                        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                        result.lastModified = formatTimestamp(sctp);
-                        
-                        lastResults.push_back(result);
-                    }
-                }
-            }
-        } catch (const std::exception&) {
-            // Error handling
-        }
+    std::vector<SearchResult> SearchEngine::searchByDate(const std::string& startDate, const std::string& endDate, bool recursive) {
+        SearchContext query(snapshot());
+        runByDate(query, startDate, endDate, recursive);
+        return publish(query);
     }
 
-    std::vector<SearchResult> SearchEngine::searchInContent(const std::string& searchTerm, bool recursive) {
-        searchStartTime = std::chrono::steady_clock::now();
-        lastResults.clear();
+    void SearchEngine::runByDate(SearchContext& query, const std::string& startDate, const std::string& endDate, bool recursive) {
+        ScopedPhase phase("search.date");
+        ScopedIoPriority priority(priorityOf(query));
+        query.started = std::chrono::steady_clock::now();
         
-        try {
-            if (recursive) {
-                searchInContentRecursive(searchRoot, searchTerm);
-            } else {
-                searchInContentInDirectory(searchRoot, searchTerm);
-            }
-        } catch (const std::exception&) {
-            // Error handling
+        // Bounds are parsed once; files are compared on raw nanosecond mtimes
+        int64_t startNs = 0;
+        int64_t endNs = INT64_MAX;
+        bool validRange = true;
+        if (!parseTimestamp(startDate, false, startNs)) {
+            query.stats.error = "Invalid date: " + startDate;
+            validRange = false;
+        } else if (!endDate.empty() && !parseTimestamp(endDate, true, endNs)) {
+            query.stats.error = "Invalid date: " + endDate;
+            validRange = false;
         }
         
-        auto endTime = std::chrono::steady_clock::now();
-        lastSearchStats.searchTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - searchStartTime);
-        lastSearchStats.filesSearched = lastResults.size();
-        lastSearchStats.filesMatched = lastResults.size();
-        lastSearchStats.searchPattern = "content:" + searchTerm;
+        // Oldest first unless asked otherwise, matching the index order
+        ResultOrder order = query.settings.resultOrder;
+        if (order.key == SortKey::None) {
+            order.key = SortKey::Modified;
+            order.descending = false;
+        }
         
-        return lastResults;
-    }
-
-    void SearchEngine::searchInContentRecursive(const std::string& directory, const std::string& searchTerm) {
         try {
-            for (const auto& entry : fs::recursive_directory_iterator(directory)) {
-                if (fs::is_regular_file(entry) && !isBinaryFile(entry.path().string())) {
-                    if (matchesFileContent(entry.path().string(), searchTerm)) {
-                        SearchResult result;
-                        result.filePath = entry.path().string();
-                        result.fileName = entry.path().filename().string();
-                        result.fileSize = fs::file_size(entry);
-                        
-                        auto ftime = fs::last_write_time(entry);
-                        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                        result.lastModified = formatTimestamp(sctp);
-                        
-                        result.matchingLines = findMatchingLines(entry.path().string(), searchTerm);
-                        lastResults.push_back(result);
-                    }
-                }
+            ResultCollector results(order);
+            if (validRange && !(recursive && searchByDateIndexed(query, startNs, endNs, results))) {
+                searchByDateIn(query, query.settings.searchRoot, startNs, endNs, recursive, results);
             }
-        } catch (const std::exception&) {
-            // Error handling
+            query.results = results.take();
+        } catch (const std::exception& e) {
+            query.stats.error = e.what();
         }
+        
+        finishQuery(query, "date:" + startDate + (endDate.empty() ? "" : ".." + endDate));
     }
 
-    void SearchEngine::searchInContentInDirectory(const std::string& directory, const std::string& searchTerm) {
-        try {
-            for (const auto& entry : fs::directory_iterator(directory)) {
-                if (fs::is_regular_file(entry) && !isBinaryFile(entry.path().string())) {
-                    if (matchesFileContent(entry.path().string(), searchTerm)) {
-                        SearchResult result;
-                        result.filePath = entry.path().string();
-                        result.fileName = entry.path().filename().string();
-                        result.fileSize = fs::file_size(entry);
-                        
-                        auto ftime = fs::last_write_time(entry);
-                        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                        result.lastModified = formatTimestamp(sctp);
-                        
-                        result.matchingLines = findMatchingLines(entry.path().string(), searchTerm);
-                        lastResults.push_back(result);
-                    }
-                }
+    bool SearchEngine::searchByDateIndexed(SearchContext& query, int64_t startNs, int64_t endNs, ResultCollector& results) {
+        DateIndex index;
+        std::string error;
+        const SearchSettings& settings = query.settings;
+        std::string indexPath = settings.dateIndexPath.empty() ? DateIndex::defaultPathFor(settings.searchRoot) : settings.dateIndexPath;
+        if (!index.open(indexPath, error)) return false;
+
+        // An index of some other tree cannot answer for this one
+        std::string root = settings.searchRoot;
+        while (root.size() > 1 && root.back() == '/') root.pop_back();
+        if (index.getRoot() != root) return false;
+
+        // Files written since the build have newer mtimes than the index
+        // knows, so only a range that ends before it can be answered
+        if (endNs >= index.getBuiltAtNs()) return false;
+        // Entries created, removed or renamed since the build
+        if (!index.isUpToDate()) {
+            query.stats.staleIndex = true;
+            return false;
+        }
+
+        // Each match is stat'ed again; one rewritten since the build means
+        // the index no longer holds
+        std::vector<SearchResult> found;
+        bool current = true;
+        size_t examined = index.forEachInRange(startNs, endNs, [&](const DateIndex::Record& record, std::string_view path) {
+            std::string filePath(path);
+            EntryMetadata metadata;
+            if (!current || !DirectoryWalker::readPathMetadata(filePath, metadata, true) ||
+                metadata.modifiedNs != record.modifiedNs) {
+                current = false;
+                return;
             }
-        } catch (const std::exception&) {
-            // Error handling
+            size_t slash = path.rfind('/');
+            size_t nameOffset = slash == std::string_view::npos ? 0 : slash + 1;
+            found.push_back(makeSearchResult(query, std::move(filePath), nameOffset, metadata.size, metadata.modifiedNs));
+        });
+        if (!current) {
+            query.stats.staleIndex = true;
+            return false;
+        }
+
+        query.filesExamined = examined;
+        for (auto& result : found) {
+            results.add(std::move(result));
         }
+        return true;
     }
 
-    bool SearchEngine::matchesFileContent(const std::string& filePath, const std::string& searchTerm) {
-        try {
-            std::ifstream file(filePath);
-            if (!file.is_open()) return false;
-            
-            std::string line;
-            std::string search = caseSensitive ? searchTerm : toLowerCase(searchTerm);
-            
-            while (std::getline(file, line)) {
-                std::string lineToSearch = caseSensitive ? line : toLowerCase(line);
-                if (lineToSearch.find(search) != std::string::npos) {
-                    file.close();
-                    return true;
-                }
+    void SearchEngine::searchByDateIn(SearchContext& query, const std::string& directory, int64_t startNs, int64_t endNs,
+                                      bool recursive, ResultCollector& results) {
+        // Parallel walk with per-worker results, merged once it finishes
+        WalkOptions options;
+        options.recursive = recursive;
+        options.cancellation = &query.cancellation;
+        options.throttle = query.settings.throttle.get();
+        DirectoryWalker walker(options);
+
+        std::vector<ResultCollector> workerResults(walker.getThreadCount(), results);
+        std::vector<size_t> workerExamined(walker.getThreadCount(), 0);
+        walker.walk(directory, [&](size_t workerIndex, const WalkEntry& entry) {
+            if (entry.type != EntryType::Regular && entry.type != EntryType::Symlink) return;
+            EntryMetadata metadata;
+            if (!DirectoryWalker::readMetadata(entry, metadata, true) || !metadata.isRegularFile) return;
+
+            workerExamined[workerIndex]++;
+            if (metadata.modifiedNs >= startNs && metadata.modifiedNs <= endNs) {
+                workerResults[workerIndex].add(makeSearchResult(query, entry, metadata));
             }
-            file.close();
-        } catch (const std::exception&) {
-            // Error handling
+        });
+
+        for (size_t i = 0; i < workerResults.size(); ++i) {
+            query.filesExamined += workerExamined[i];
+            results.merge(std::move(workerResults[i]));
         }
-        return false;
     }
 
-    std::vector<std::string> SearchEngine::findMatchingLines(const std::string& filePath, const std::string& searchTerm) {
-        std::vector<std::string> matchingLines;
+    bool SearchEngine::buildDateIndex(size_t& recordCount, std::string& error) {
+        SearchSettings current = snapshot();
+        std::string indexPath = current.dateIndexPath.empty() ? DateIndex::defaultPathFor(current.searchRoot) : current.dateIndexPath;
+        return DateIndex::build(current.searchRoot, indexPath, recordCount, error);
+    }
+
+    std::vector<SearchResult> SearchEngine::searchInContent(const std::string& searchTerm, bool recursive) {
+        SearchContext query(snapshot());
+        runInContent(query, searchTerm, recursive);
+        return publish(query);
+    }
+
+    void SearchEngine::runInContent(SearchContext& query, const std::string& searchTerm, bool recursive) {
+        if (query.settings.useRegex) {
+            SearchQuery search;
+            search.contentPatterns.push_back(searchTerm);
+            search.recursive = recursive;
+            search.order = query.settings.resultOrder;
+            runSearch(query, search);
+            return;
+        }
+
+        ScopedPhase phase("search.content");
+        ScopedIoPriority priority(priorityOf(query));
+        query.started = std::chrono::steady_clock::now();
+        
         try {
-            std::ifstream file(filePath);
-            if (!file.is_open()) return matchingLines;
-            
-            std::string line;
-            std::string search = caseSensitive ? searchTerm : toLowerCase(searchTerm);
-            int lineNumber = 1;
-            
-            while (std::getline(file, line)) {
-                std::string lineToSearch = caseSensitive ? line : toLowerCase(line);
-                if (lineToSearch.find(search) != std::string::npos) {
-                    matchingLines.push_back("Line " + std::to_string(lineNumber) + ": " + line);
-                }
-                lineNumber++;
-            }
-            file.close();
-        } catch (const std::exception&) {
-            // Error handling
+            ResultCollector results(query.settings.resultOrder);
+            searchInContentIn(query, query.settings.searchRoot, searchTerm, recursive, results);
+            query.results = results.take();
+        } catch (const std::exception& e) {
+            query.stats.error = e.what();
         }
-        return matchingLines;
+        
+        finishQuery(query, "content:" + searchTerm);
     }
 
-    bool SearchEngine::isBinaryFile(const std::string& filePath) {
-        try {
-            std::ifstream file(filePath, std::ios::binary);
-            if (!file.is_open()) return true;
-            
-            char buffer[1024];
-            file.read(buffer, sizeof(buffer));
-            size_t bytesRead = file.gcount();
-            
-            for (size_t i = 0; i < bytesRead; ++i) {
-                if (buffer[i] == 0) {
-                    return true; // Binary file
-                }
+    void SearchEngine::searchInContentIn(SearchContext& query, const std::string& directory, const std::string& searchTerm,
+                                         bool recursive, ResultCollector& results) {
+        const ScanLimits& scanLimits = query.settings.scanLimits;
+        ContentMatchers matchers;
+        matchers.terms.emplace_back(searchTerm, query.settings.caseSensitive);
+        matchers.cancellation = &query.cancellation;
+        matchers.throttle = query.settings.throttle.get();
+        prepareReader(matchers, scanLimits);
+        forEachFile(query, directory, recursive, [&](const WalkEntry& entry) {
+            EntryMetadata metadata;
+            if (!DirectoryWalker::readMetadata(entry, metadata, true)) return;
+            SearchResult result = makeSearchResult(query, entry, metadata);
+            if (!results.wouldKeep(result)) return;
+
+            // Known binaries (by extension or cached verdict) are never opened
+            ContentVerdict verdict;
+            bool known = ContentClassifier::shared().classifyWithoutReading(entry.name(), metadata, verdict);
+            if (known && !verdict.isSearchable()) return;
+            if (scanContent(result.filePath, metadata, known, matchers, scanLimits, result)) {
+                results.add(std::move(result));
             }
-            return false;
-        } catch (const std::exception&) {
-            return true;
-        }
+        });
     }
 
     std::vector<SearchResult> SearchEngine::searchInContent(const std::string& searchTerm, const std::string& fileExtension, bool recursive) {
-        auto results = searchInContent(searchTerm, recursive);
-        std::vector<SearchResult> filteredResults;
+        // The extension is checked on the name before any file is opened
+        SearchQuery query;
+        query.contentTerms.push_back(searchTerm);
+        if (!fileExtension.empty()) {
+            query.extensions.push_back(fileExtension[0] == '.' ? fileExtension : "." + fileExtension);
+        }
+        query.recursive = recursive;
+        query.order = snapshot().resultOrder;
+        return search(query);
+    }
+
+    std::vector<SearchResult> SearchEngine::searchAdvanced(const std::string& namePattern, const std::string& contentTerm,
+                                                          const std::string& extension, size_t minSize,
+                                                          size_t maxSize, bool recursive) {
+        SearchQuery query;
+        if (!namePattern.empty()) query.namePatterns.push_back(namePattern);
+        if (!contentTerm.empty()) query.contentTerms.push_back(contentTerm);
+        if (!extension.empty()) query.extensions.push_back(extension[0] == '.' ? extension : "." + extension);
+        query.minSize = minSize;
+        if (maxSize != SIZE_MAX) query.maxSize = maxSize;
+        query.recursive = recursive;
+        query.order = snapshot().resultOrder;
+        return search(query);
+    }
+
+    std::vector<SearchResult> SearchEngine::search(const SearchQuery& search) {
+        SearchContext query(snapshot());
+        runSearch(query, search);
+        return publish(query);
+    }
+
+    QueryPlan SearchEngine::plan(const SearchQuery& query) const {
+        return QueryPlan(query, snapshot().caseSensitive);
+    }
+
+    std::vector<SearchResult> SearchEngine::search(const QueryPlan& plan) {
+        SearchContext query(snapshot());
+        runPlan(query, plan);
+        return publish(query);
+    }
+
+    void SearchEngine::runSearch(SearchContext& query, const SearchQuery& search) {
+        runPlan(query, QueryPlan(search, query.settings.caseSensitive));
+    }
+
+    void SearchEngine::runPlan(SearchContext& query, const QueryPlan& plan) {
+        ScopedPhase phase("search.query");
+        ScopedIoPriority priority(priorityOf(query));
+        query.started = std::chrono::steady_clock::now();
         
-        std::string ext = fileExtension;
-        if (!ext.empty() && ext[0] != '.') {
-            ext = "." + ext;
+        query.stats.error = plan.getError();
+        try {
+            runQuery(query, plan);
+        } catch (const std::exception& e) {
+            query.stats.error = e.what();
         }
         
-        std::copy_if(results.begin(), results.end(), std::back_inserter(filteredResults),
-            [&ext](const SearchResult& result) {
-                return fs::path(result.filePath).extension().string() == ext;
+        finishQuery(query, "query");
+    }
+
+    void SearchEngine::runQuery(SearchContext& query, const QueryPlan& plan) {
+        // Content scans dominate, so the walk (and the scans) run in parallel;
+        // each worker collects (or with a limit, keeps the best of) its own
+        // results and the collectors are merged in order afterwards
+        WalkOptions options;
+        options.cancellation = &query.cancellation;
+        options.throttle = query.settings.throttle.get();
+        DirectoryWalker walker(options);
+        size_t workerCount = walker.getThreadCount();
+        std::vector<ResultCollector> workerResults(workerCount, ResultCollector(plan.getQuery().order));
+        std::vector<size_t> workerExamined(workerCount, 0);
+        std::vector<std::string> workerPaths(workerCount);
+        if (!plan.getError().empty()) return;
+
+        // Every content predicate is checked in the same chunked pass; regexes
+        // through a lazy DFA per worker, keywords through the shared automaton
+        ScanLimits limits = query.settings.scanLimits;
+        if (plan.getQuery().maxScanBytes > 0) limits.maxFileBytes = plan.getQuery().maxScanBytes;
+        std::vector<ContentMatchers> workerMatchers(workerCount);
+        for (auto& matchers : workerMatchers) {
+            for (const auto& term : plan.getQuery().contentTerms) {
+                matchers.terms.emplace_back(term, query.settings.caseSensitive);
+            }
+            for (const auto& regex : plan.getContentRegexes()) {
+                matchers.regexes.emplace_back(regex);
+                matchers.regexLiterals.emplace_back(regex.getRequiredLiteral(), regex.isCaseSensitive());
+            }
+            if (plan.hasKeywords()) matchers.keywords = &plan.getKeywordMatcher();
+            matchers.cancellation = &query.cancellation;
+            matchers.throttle = query.settings.throttle.get();
+            prepareReader(matchers, limits);
+        }
+
+        walker.walk(query.settings.searchRoot,
+            [&](size_t workerIndex, const WalkEntry& entry) {
+                // Name stage: entry type from d_type, then name/extension/path
+                if (entry.type != EntryType::Regular && entry.type != EntryType::Symlink) return;
+
+                std::string& path = workerPaths[workerIndex];
+                path.clear();
+                if (plan.needsPath()) {
+                    const PathNode* base = entry.node;
+                    for (int depth = entry.depth; depth > 0; --depth) base = base->parent;
+                    entry.node->appendRelative(base, path);
+                }
+                if (!plan.matchesName(entry.name(), path)) return;
+                workerExamined[workerIndex]++;
+
+                // Metadata stage: one stat, also resolving symlinks
+                EntryMetadata metadata;
+                if (!DirectoryWalker::readMetadata(entry, metadata, true) || !plan.matchesMetadata(metadata)) return;
+
+                // Content stage: only files that passed everything cheaper and
+                // could still make the cut
+                SearchResult result = makeSearchResult(query, entry, metadata);
+                if (!workerResults[workerIndex].wouldKeep(result)) return;
+                if (plan.needsContent()) {
+                    // Known binaries (by extension or cached verdict) are never opened
+                    ContentVerdict verdict;
+                    bool known = ContentClassifier::shared().classifyWithoutReading(entry.name(), metadata, verdict);
+                    if (known && !verdict.isSearchable()) return;
+                    if (!scanContent(result.filePath, metadata, known, workerMatchers[workerIndex], limits, result)) return;
+                }
+                workerResults[workerIndex].add(std::move(result));
+            },
+            DirectoryWalker::DirectoryVisitor(),
+            [&](size_t, const WalkEntry& directory) {
+                return plan.shouldDescend(directory);
             });
-        
-        return filteredResults;
+
+        ResultCollector results(plan.getQuery().order);
+        for (size_t i = 0; i < workerCount; ++i) {
+            query.filesExamined += workerExamined[i];
+            results.merge(std::move(workerResults[i]));
+        }
+        query.results = results.take();
     }
 
     std::vector<SearchResult> SearchEngine::getLastResults() const {
+        std::lock_guard<std::mutex> lock(lastMutex);
         return lastResults;
     }
 
     void SearchEngine::clearResults() {
+        std::lock_guard<std::mutex> lock(lastMutex);
         lastResults.clear();
     }
 
     size_t SearchEngine::getResultCount() const {
+        std::lock_guard<std::mutex> lock(lastMutex);
         return lastResults.size();
     }
 
-    SearchEngine::SearchStats SearchEngine::getLastSearchStats() const {
+    SearchStats SearchEngine::getLastSearchStats() const {
+        std::lock_guard<std::mutex> lock(lastMutex);
         return lastSearchStats;
     }
 
-    std::future<std::vector<SearchResult>> SearchEngine::searchByNameAsync(const std::string& pattern, bool recursive) {
-        return std::async(std::launch::async, [this, pattern, recursive]() {
-            return searchByName(pattern, recursive);
+    SearchHandle SearchEngine::launch(SearchSettings querySettings, std::function<void(SearchContext&)> run) {
+        auto context = std::make_shared<SearchContext>(std::move(querySettings));
+        std::shared_future<void> finished = std::async(std::launch::async, [context, run = std::move(run)]() {
+            run(*context);
+        }).share();
+        return SearchHandle(std::move(context), std::move(finished));
+    }
+
+    SearchHandle SearchEngine::searchByNameAsync(const std::string& pattern, bool recursive) {
+        return launch(snapshot(), [pattern, recursive](SearchContext& query) {
+            runByName(query, pattern, recursive);
         });
     }
 
-    std::future<std::vector<SearchResult>> SearchEngine::searchInContentAsync(const std::string& searchTerm, bool recursive) {
-        return std::async(std::launch::async, [this, searchTerm, recursive]() {
-            return searchInContent(searchTerm, recursive);
+    SearchHandle SearchEngine::searchInContentAsync(const std::string& searchTerm, bool recursive) {
+        return launch(snapshot(), [searchTerm, recursive](SearchContext& query) {
+            runInContent(query, searchTerm, recursive);
         });
     }
 
-}
+    SearchHandle SearchEngine::searchAsync(const SearchQuery& search) {
+        return launch(snapshot(), [search](SearchContext& query) {
+            runSearch(query, search);
+        });
+    }
 
+}
@@ -0,0 +1,337 @@
+#include "SearchQuery.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <unordered_set>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        const int64_t NsPerSecond = 1000000000LL;
+        const int64_t SecondsPerDay = 24 * 60 * 60;
+
+        bool parseSizeRange(const std::string& text, SearchQuery& query) {
+            if (text.size() > 1 && text[0] == '+') {
+                return parseByteSize(text.substr(1), query.minSize);
+            }
+            if (text.size() > 1 && text[0] == '-') {
+                return parseByteSize(text.substr(1), query.maxSize);
+            }
+            size_t dash = text.find('-');
+            if (dash == std::string::npos) {
+                if (!parseByteSize(text, query.minSize)) return false;
+                query.maxSize = query.minSize;
+                return true;
+            }
+            std::string low = text.substr(0, dash);
+            std::string high = text.substr(dash + 1);
+            return parseByteSize(low, query.minSize) && (high.empty() || parseByteSize(high, query.maxSize));
+        }
+
+        bool parseDays(const std::string& text, int64_t& days) {
+            if (text.empty()) return false;
+            for (char c : text) {
+                if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+            }
+            days = std::strtoll(text.c_str(), nullptr, 10);
+            return true;
+        }
+
+        bool parseTimeRange(const std::string& text, SearchQuery& query) {
+            int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            int64_t days = 0;
+            if (text.size() > 1 && (text[0] == '-' || text[0] == '+') && parseDays(text.substr(1), days)) {
+                int64_t cutoff = nowNs - days * SecondsPerDay * NsPerSecond;
+                if (text[0] == '-') {
+                    query.modifiedAfterNs = cutoff;
+                } else {
+                    query.modifiedBeforeNs = cutoff;
+                }
+                return true;
+            }
+
+            size_t dots = text.find("..");
+            std::string from = dots == std::string::npos ? text : text.substr(0, dots);
+            std::string to = dots == std::string::npos ? "" : text.substr(dots + 2);
+            if (from.empty() && to.empty()) return false;
+            if (!from.empty() && !parseTimestamp(from, false, query.modifiedAfterNs)) return false;
+            if (!to.empty() && !parseTimestamp(to, true, query.modifiedBeforeNs)) return false;
+            return true;
+        }
+
+        bool hasWildcard(const std::string& text) {
+            return text.find_first_of("*?") != std::string::npos;
+        }
+
+        std::string joined(const std::vector<std::string>& values, const char* separator) {
+            std::string result;
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (i > 0) result += separator;
+                result += values[i];
+            }
+            return result;
+        }
+
+    }
+
+    bool SearchQuery::parse(const std::vector<std::string>& args, SearchQuery& query, std::string& error,
+                            const std::string& baseDirectory) {
+        query = SearchQuery();
+
+        if (args.size() == 1 && !args[0].empty() && args[0][0] != '-') {
+            query.namePatterns.push_back(args[0]);
+            return true;
+        }
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& option = args[i];
+            if (i + 1 >= args.size()) {
+                error = "Missing value for " + option;
+                return false;
+            }
+            const std::string& value = args[++i];
+
+            if (option == "-name") {
+                query.namePatterns.push_back(value);
+            } else if (option == "-ext") {
+                for (const auto& extension : splitString(value, ',')) {
+                    query.extensions.push_back(extension[0] == '.' ? extension : "." + extension);
+                }
+            } else if (option == "-path") {
+                query.pathPattern = value;
+            } else if (option == "-exclude") {
+                query.excludeDirectories.push_back(value);
+            } else if (option == "-maxdepth") {
+                int64_t depth = 0;
+                if (!parseDays(value, depth) || depth < 1) {
+                    error = "Invalid depth: " + value;
+                    return false;
+                }
+                query.maxDepth = static_cast<int>(depth);
+            } else if (option == "-size") {
+                if (!parseSizeRange(value, query)) {
+                    error = "Invalid size range: " + value;
+                    return false;
+                }
+            } else if (option == "-mtime") {
+                if (!parseTimeRange(value, query)) {
+                    error = "Invalid time range: " + value;
+                    return false;
+                }
+            } else if (option == "-content") {
+                query.contentTerms.push_back(value);
+            } else if (option == "-regex") {
+                query.contentPatterns.push_back(value);
+            } else if (option == "-patterns") {
+                fs::path file(value);
+                if (file.is_relative() && !baseDirectory.empty()) file = fs::path(baseDirectory) / file;
+                if (!loadPatternFile(file.string(), query.keywords, error)) return false;
+            } else if (option == "-maxbytes") {
+                if (!parseByteSize(value, query.maxScanBytes) || query.maxScanBytes == 0) {
+                    error = "Invalid byte cap: " + value;
+                    return false;
+                }
+            } else if (option == "-sort") {
+                if (!ResultOrder::parse(value, query.order, error)) return false;
+            } else if (option == "-limit") {
+                int64_t limit = 0;
+                if (!parseDays(value, limit) || limit < 1) {
+                    error = "Invalid limit: " + value;
+                    return false;
+                }
+                query.order.limit = static_cast<size_t>(limit);
+            } else {
+                error = "Unknown search option: " + option;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SearchQuery::loadPatternFile(const std::string& path, std::vector<std::string>& patterns, std::string& error) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            error = "Cannot open pattern file: " + path;
+            return false;
+        }
+
+        std::unordered_set<std::string> seen(patterns.begin(), patterns.end());
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty() && seen.insert(line).second) {
+                patterns.push_back(line);
+            }
+        }
+        if (patterns.empty()) {
+            error = "No patterns in " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool SearchQuery::hasSizeFilter() const {
+        return minSize > 0 || maxSize != std::numeric_limits<uint64_t>::max();
+    }
+
+    bool SearchQuery::hasTimeFilter() const {
+        return modifiedAfterNs != std::numeric_limits<int64_t>::min() ||
+               modifiedBeforeNs != std::numeric_limits<int64_t>::max();
+    }
+
+    QueryPlan::QueryPlan(const SearchQuery& searchQuery, bool caseSensitive)
+        : query(searchQuery), caseSensitive(caseSensitive) {
+        if (!query.recursive) {
+            query.maxDepth = 1;
+        }
+        if (query.order.key == SortKey::None) {
+            query.order.key = SortKey::Path;
+        }
+
+        for (const auto& pattern : query.namePatterns) {
+            nameGlobs.emplace_back(pattern, caseSensitive);
+        }
+        for (const auto& extension : query.extensions) {
+            lowerExtensions.push_back(caseSensitive ? extension : toLowerCase(extension));
+        }
+        for (const auto& pattern : query.excludeDirectories) {
+            excludeGlobs.emplace_back(pattern, caseSensitive);
+        }
+        for (const auto& pattern : query.contentPatterns) {
+            DfaRegex regex;
+            std::string compileError;
+            if (!regex.compile(pattern, caseSensitive, compileError)) {
+                if (error.empty()) error = "Invalid regex '" + pattern + "': " + compileError;
+                continue;
+            }
+            contentRegexes.push_back(std::move(regex));
+        }
+        if (!query.keywords.empty()) {
+            keywordMatcher.build(query.keywords, caseSensitive);
+        }
+        while (query.pathPattern.compare(0, 2, "./") == 0) {
+            query.pathPattern.erase(0, 2);
+        }
+        if (!query.pathPattern.empty()) {
+            pathGlob = GlobPattern(query.pathPattern, caseSensitive);
+            // Directories off the literal leading components cannot contain a match
+            auto components = splitString(query.pathPattern, '/');
+            for (size_t i = 0; i + 1 < components.size() && !hasWildcard(components[i]); ++i) {
+                pathPrefix.emplace_back(components[i], caseSensitive);
+            }
+        }
+
+        // Cheapest first; each stage only sees entries that passed the previous ones
+        if (query.maxDepth > 0) {
+            steps.push_back({Stage::Prune, "depth <= " + std::to_string(query.maxDepth)});
+        }
+        if (!pathPrefix.empty()) {
+            std::string prefix;
+            for (const auto& component : pathPrefix) {
+                prefix += component.getPattern() + "/";
+            }
+            steps.push_back({Stage::Prune, "only under " + prefix});
+        }
+        if (!excludeGlobs.empty()) {
+            steps.push_back({Stage::Prune, "skip directories " + joined(query.excludeDirectories, ", ")});
+        }
+        steps.push_back({Stage::Name, "regular files and symlinks (d_type)"});
+        if (!lowerExtensions.empty()) {
+            steps.push_back({Stage::Name, "extension in " + joined(lowerExtensions, ", ")});
+        }
+        for (const auto& pattern : query.namePatterns) {
+            steps.push_back({Stage::Name, "name ~ " + pattern});
+        }
+        if (!query.pathPattern.empty()) {
+            steps.push_back({Stage::Name, "path ~ " + query.pathPattern});
+        }
+        std::string metadata = "stat";
+        if (query.hasSizeFilter()) {
+            metadata += ", size " + std::to_string(query.minSize) + ".." +
+                        (query.maxSize == std::numeric_limits<uint64_t>::max() ? std::string() : std::to_string(query.maxSize));
+        }
+        if (query.hasTimeFilter()) {
+            metadata += ", mtime range";
+        }
+        steps.push_back({Stage::Metadata, metadata});
+        if (query.order.limit > 0) {
+            // Ranks are known once stat has run, so files that cannot make
+            // the cut are never opened
+            steps.push_back({Stage::Metadata, "keep the first " + std::to_string(query.order.limit) + " by " +
+                                              sortKeyName(query.order.key) + (query.order.descending ? " (descending)" : "") +
+                                              ", one bounded heap per worker"});
+        }
+        for (const auto& term : query.contentTerms) {
+            steps.push_back({Stage::Content, "content contains \"" + term + "\""});
+        }
+        for (const auto& regex : contentRegexes) {
+            std::string description = "content ~ /" + regex.getPattern() + "/ (lazy DFA";
+            if (!regex.getRequiredLiteral().empty()) {
+                description += ", prefilter \"" + regex.getRequiredLiteral() + "\"";
+            }
+            steps.push_back({Stage::Content, description + ")"});
+        }
+        if (!query.keywords.empty()) {
+            steps.push_back({Stage::Content, "content contains any of " + std::to_string(query.keywords.size()) +
+                                             " patterns (Aho-Corasick, " + std::to_string(keywordMatcher.getStateCount()) +
+                                             " states)"});
+        }
+        if (needsContent() && query.maxScanBytes > 0) {
+            steps.push_back({Stage::Content, "read at most " + std::to_string(query.maxScanBytes) + " bytes per file"});
+        }
+    }
+
+    bool QueryPlan::shouldDescend(const WalkEntry& directory) const {
+        if (query.maxDepth > 0 && directory.depth >= query.maxDepth) return false;
+
+        std::string_view name = directory.name();
+        size_t depth = static_cast<size_t>(directory.depth);
+        if (depth <= pathPrefix.size() && !pathPrefix[depth - 1].matches(name)) return false;
+
+        for (const auto& glob : excludeGlobs) {
+            if (glob.matches(name)) return false;
+        }
+        return true;
+    }
+
+    bool QueryPlan::matchesName(std::string_view name, std::string_view relativePath) const {
+        if (!lowerExtensions.empty()) {
+            bool matched = false;
+            for (const auto& extension : lowerExtensions) {
+                if (name.size() <= extension.size()) continue;
+                std::string_view tail = name.substr(name.size() - extension.size());
+                matched = caseSensitive ? tail == extension
+                                        : std::equal(tail.begin(), tail.end(), extension.begin(), [](char a, char b) {
+                                              return std::tolower(static_cast<unsigned char>(a)) == b;
+                                          });
+                if (matched) break;
+            }
+            if (!matched) return false;
+        }
+        for (const auto& glob : nameGlobs) {
+            if (!glob.matches(name)) return false;
+        }
+        if (!query.pathPattern.empty() && !pathGlob.matches(relativePath)) return false;
+        return true;
+    }
+
+    bool QueryPlan::matchesMetadata(const EntryMetadata& metadata) const {
+        return metadata.isRegularFile &&
+               metadata.size >= query.minSize && metadata.size <= query.maxSize &&
+               metadata.modifiedNs >= query.modifiedAfterNs && metadata.modifiedNs <= query.modifiedBeforeNs;
+    }
+
+    const char* queryStageName(QueryPlan::Stage stage) {
+        switch (stage) {
+            case QueryPlan::Stage::Prune: return "prune";
+            case QueryPlan::Stage::Name: return "name";
+            case QueryPlan::Stage::Metadata: return "metadata";
+            case QueryPlan::Stage::Content: return "content";
+        }
+        return "";
+    }
+
+}
@@ -0,0 +1,316 @@
+#include "StatisticsEngine.h"
+#include "TopK.h"
+#include <unordered_map>
+#include <fstream>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        const int64_t SecondsPerDay = 24 * 60 * 60;
+
+        // Upper bounds (exclusive, in days) of the age histogram buckets
+        const int64_t AgeBucketLimits[TreeStatistics::AgeBucketCount - 1] = {1, 7, 30, 90, 365, 730, 1825};
+
+        const char* AgeBucketLabels[TreeStatistics::AgeBucketCount] = {
+            "<1d", "1d-7d", "7d-30d", "30d-90d", "90d-1y", "1y-2y", "2y-5y", ">5y"
+        };
+
+        // Per-worker accumulator; merged once the walk finishes
+        struct WorkerStatistics {
+            size_t files = 0;
+            size_t directories = 0;
+            size_t other = 0;
+            uint64_t bytes = 0;
+            int maxDepth = 0;
+            std::unordered_map<std::string, TreeStatistics::ExtensionStats> byExtension;
+            std::array<TreeStatistics::HistogramBucket, TreeStatistics::SizeBucketCount> sizeHistogram{};
+            std::array<TreeStatistics::HistogramBucket, TreeStatistics::AgeBucketCount> ageHistogram{};
+            TopK<TreeStatistics::RankedPath> largestFiles;
+            TopK<TreeStatistics::RankedPath> deepestPaths;
+            TopK<TreeStatistics::RankedPath> busiestDirectories;
+
+            explicit WorkerStatistics(size_t topK)
+                : largestFiles(topK), deepestPaths(topK), busiestDirectories(topK) {
+            }
+        };
+
+        // Same rules as fs::path::extension, without building a path
+        std::string extensionKey(std::string_view fileName) {
+            size_t dot = fileName.rfind('.');
+            if (dot == std::string_view::npos || dot == 0) return "(none)";
+            return toLowerCase(std::string(fileName.substr(dot)));
+        }
+
+        void appendRankedJson(std::ostringstream& oss, const char* name, const char* valueName,
+                              const std::vector<TreeStatistics::RankedPath>& ranked) {
+            oss << "  \"" << name << "\": [";
+            for (size_t i = 0; i < ranked.size(); ++i) {
+                oss << (i == 0 ? "\n" : ",\n");
+                oss << "    {\"path\": \"" << escapeJson(ranked[i].path) << "\", \""
+                    << valueName << "\": " << ranked[i].value << "}";
+            }
+            oss << (ranked.empty() ? "]" : "\n  ]");
+        }
+
+    }
+
+    std::string TreeStatistics::sizeBucketLabel(size_t bucket) {
+        if (bucket == 0) return "0 B";
+        if (bucket >= SizeBucketCount) return "";
+        uint64_t lower = 1ULL << (bucket - 1);
+        std::string label = formatFileSize(lower) + " - ";
+        if (bucket == SizeBucketCount - 1) {
+            return label + "max";
+        }
+        return label + formatFileSize(1ULL << bucket);
+    }
+
+    std::string TreeStatistics::ageBucketLabel(size_t bucket) {
+        return bucket < AgeBucketCount ? AgeBucketLabels[bucket] : "";
+    }
+
+    std::string TreeStatistics::toCsv() const {
+        std::ostringstream oss;
+        oss << "section,key,count,bytes\n";
+        oss << "total,files," << totalFiles << "," << totalBytes << "\n";
+        oss << "total,directories," << totalDirectories << ",0\n";
+        oss << "total,other," << totalOther << ",0\n";
+        oss << "total,max_depth," << maxDepth << ",0\n";
+
+        for (const auto& [extension, stats] : byExtension) {
+            oss << "extension," << escapeCsv(extension) << "," << stats.count << "," << stats.bytes << "\n";
+        }
+        for (size_t i = 0; i < SizeBucketCount; ++i) {
+            if (sizeHistogram[i].count == 0) continue;
+            uint64_t lower = i == 0 ? 0 : (1ULL << (i - 1));
+            oss << "size_log2," << lower << "," << sizeHistogram[i].count << "," << sizeHistogram[i].bytes << "\n";
+        }
+        for (size_t i = 0; i < AgeBucketCount; ++i) {
+            oss << "age," << ageBucketLabel(i) << "," << ageHistogram[i].count << "," << ageHistogram[i].bytes << "\n";
+        }
+        for (const auto& entry : largestFiles) {
+            oss << "largest," << escapeCsv(entry.path) << ",1," << entry.value << "\n";
+        }
+        for (const auto& entry : deepestPaths) {
+            oss << "deepest," << escapeCsv(entry.path) << "," << entry.value << ",0\n";
+        }
+        for (const auto& entry : busiestDirectories) {
+            oss << "directory_entries," << escapeCsv(entry.path) << "," << entry.value << ",0\n";
+        }
+        return oss.str();
+    }
+
+    std::string TreeStatistics::toJson() const {
+        std::ostringstream oss;
+        oss << "{\n";
+        oss << "  \"root\": \"" << escapeJson(rootPath) << "\",\n";
+        oss << "  \"scanTimeMs\": " << scanTime.count() << ",\n";
+        oss << "  \"files\": " << totalFiles << ",\n";
+        oss << "  \"directories\": " << totalDirectories << ",\n";
+        oss << "  \"other\": " << totalOther << ",\n";
+        oss << "  \"bytes\": " << totalBytes << ",\n";
+        oss << "  \"maxDepth\": " << maxDepth << ",\n";
+
+        oss << "  \"extensions\": {";
+        bool first = true;
+        for (const auto& [extension, stats] : byExtension) {
+            oss << (first ? "\n" : ",\n");
+            oss << "    \"" << escapeJson(extension) << "\": {\"count\": " << stats.count << ", \"bytes\": " << stats.bytes << "}";
+            first = false;
+        }
+        oss << (byExtension.empty() ? "},\n" : "\n  },\n");
+
+        oss << "  \"sizeHistogram\": [";
+        first = true;
+        for (size_t i = 0; i < SizeBucketCount; ++i) {
+            if (sizeHistogram[i].count == 0) continue;
+            uint64_t lower = i == 0 ? 0 : (1ULL << (i - 1));
+            oss << (first ? "\n" : ",\n");
+            oss << "    {\"minBytes\": " << lower << ", \"count\": " << sizeHistogram[i].count
+                << ", \"bytes\": " << sizeHistogram[i].bytes << "}";
+            first = false;
+        }
+        oss << (first ? "],\n" : "\n  ],\n");
+
+        oss << "  \"ageHistogram\": [";
+        for (size_t i = 0; i < AgeBucketCount; ++i) {
+            oss << (i == 0 ? "\n" : ",\n");
+            oss << "    {\"age\": \"" << ageBucketLabel(i) << "\", \"count\": " << ageHistogram[i].count
+                << ", \"bytes\": " << ageHistogram[i].bytes << "}";
+        }
+        oss << "\n  ],\n";
+
+        appendRankedJson(oss, "largestFiles", "bytes", largestFiles);
+        oss << ",\n";
+        appendRankedJson(oss, "deepestPaths", "depth", deepestPaths);
+        oss << ",\n";
+        appendRankedJson(oss, "busiestDirectories", "entries", busiestDirectories);
+        oss << "\n}\n";
+        return oss.str();
+    }
+
+    StatisticsEngine::StatisticsEngine() : walkOptions(), topCount(10) {
+    }
+
+    StatisticsEngine::StatisticsEngine(size_t topK) : walkOptions(), topCount(topK) {
+    }
+
+    void StatisticsEngine::setTopCount(size_t topK) {
+        topCount = topK;
+    }
+
+    void StatisticsEngine::setThreadCount(size_t threads) {
+        walkOptions.threadCount = threads;
+    }
+
+    void StatisticsEngine::setRecursive(bool recursive) {
+        walkOptions.recursive = recursive;
+    }
+
+    size_t StatisticsEngine::sizeBucketFor(uint64_t bytes) {
+        size_t bucket = 0;
+        while (bytes != 0) {
+            bytes >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    size_t StatisticsEngine::ageBucketFor(int64_t ageSeconds) {
+        int64_t ageDays = ageSeconds / SecondsPerDay;
+        for (size_t i = 0; i < TreeStatistics::AgeBucketCount - 1; ++i) {
+            if (ageDays < AgeBucketLimits[i]) return i;
+        }
+        return TreeStatistics::AgeBucketCount - 1;
+    }
+
+    TreeStatistics StatisticsEngine::collect(const std::string& rootPath) const {
+        auto startTime = std::chrono::steady_clock::now();
+        const int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        DirectoryWalker walker(walkOptions);
+        std::vector<WorkerStatistics> workers;
+        workers.reserve(walker.getThreadCount());
+        for (size_t i = 0; i < walker.getThreadCount(); ++i) {
+            workers.emplace_back(topCount);
+        }
+
+        walker.walk(rootPath,
+            [&](size_t workerIndex, const WalkEntry& entry) {
+                WorkerStatistics& local = workers[workerIndex];
+                int depth = entry.depth;
+                if (depth > local.maxDepth) local.maxDepth = depth;
+
+                if (local.deepestPaths.wouldAccept({static_cast<uint64_t>(depth), std::string()})) {
+                    local.deepestPaths.push({static_cast<uint64_t>(depth), entry.path()});
+                }
+
+                if (entry.type == EntryType::Directory) {
+                    local.directories++;
+                    return;
+                }
+                if (entry.type != EntryType::Regular) {
+                    local.other++;
+                    return;
+                }
+
+                EntryMetadata metadata;
+                if (!DirectoryWalker::readMetadata(entry, metadata, false) || !metadata.isRegularFile) {
+                    local.other++;
+                    return;
+                }
+
+                local.files++;
+                local.bytes += metadata.size;
+
+                auto& extension = local.byExtension[extensionKey(entry.name())];
+                extension.count++;
+                extension.bytes += metadata.size;
+
+                auto& sizeBucket = local.sizeHistogram[sizeBucketFor(metadata.size)];
+                sizeBucket.count++;
+                sizeBucket.bytes += metadata.size;
+
+                int64_t ageSeconds = (nowNs - metadata.modifiedNs) / 1000000000LL;
+                auto& ageBucket = local.ageHistogram[ageBucketFor(ageSeconds < 0 ? 0 : ageSeconds)];
+                ageBucket.count++;
+                ageBucket.bytes += metadata.size;
+
+                if (local.largestFiles.wouldAccept({metadata.size, std::string()})) {
+                    local.largestFiles.push({metadata.size, entry.path()});
+                }
+            },
+            [&](size_t workerIndex, const PathNode* directory, size_t entryCount, int) {
+                WorkerStatistics& local = workers[workerIndex];
+                if (local.busiestDirectories.wouldAccept({entryCount, std::string()})) {
+                    local.busiestDirectories.push({entryCount, directory->path()});
+                }
+            });
+
+        TreeStatistics stats;
+        stats.rootPath = rootPath;
+
+        TopK<TreeStatistics::RankedPath> largestFiles(topCount);
+        TopK<TreeStatistics::RankedPath> deepestPaths(topCount);
+        TopK<TreeStatistics::RankedPath> busiestDirectories(topCount);
+
+        for (auto& local : workers) {
+            stats.totalFiles += local.files;
+            stats.totalDirectories += local.directories;
+            stats.totalOther += local.other;
+            stats.totalBytes += local.bytes;
+            stats.maxDepth = std::max(stats.maxDepth, local.maxDepth);
+
+            for (const auto& [extension, extensionStats] : local.byExtension) {
+                auto& merged = stats.byExtension[extension];
+                merged.count += extensionStats.count;
+                merged.bytes += extensionStats.bytes;
+            }
+            for (size_t i = 0; i < TreeStatistics::SizeBucketCount; ++i) {
+                stats.sizeHistogram[i].count += local.sizeHistogram[i].count;
+                stats.sizeHistogram[i].bytes += local.sizeHistogram[i].bytes;
+            }
+            for (size_t i = 0; i < TreeStatistics::AgeBucketCount; ++i) {
+                stats.ageHistogram[i].count += local.ageHistogram[i].count;
+                stats.ageHistogram[i].bytes += local.ageHistogram[i].bytes;
+            }
+
+            largestFiles.merge(std::move(local.largestFiles));
+            deepestPaths.merge(std::move(local.deepestPaths));
+            busiestDirectories.merge(std::move(local.busiestDirectories));
+        }
+
+        stats.largestFiles = largestFiles.sorted();
+        stats.deepestPaths = deepestPaths.sorted();
+        stats.busiestDirectories = busiestDirectories.sorted();
+
+        stats.scanTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime);
+        return stats;
+    }
+
+    bool StatisticsEngine::exportCsv(const TreeStatistics& stats, const std::string& filePath) const {
+        try {
+            std::ofstream file(filePath);
+            if (!file.is_open()) return false;
+            file << stats.toCsv();
+            return static_cast<bool>(file);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    bool StatisticsEngine::exportJson(const TreeStatistics& stats, const std::string& filePath) const {
+        try {
+            std::ofstream file(filePath);
+            if (!file.is_open()) return false;
+            file << stats.toJson();
+            return static_cast<bool>(file);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+}
@@ -0,0 +1,456 @@
+#include "TextTransform.h"
+#include "ByteScan.h"
+#include <cstdio>
+
+namespace FileSystemManager {
+
+    namespace {
+
+        // One UTF-8 sequence at p: its length, 0 if [p, end) stops inside a
+        // sequence that is valid so far, or -1 if it is invalid (overlong
+        // forms, surrogates and values past U+10FFFF included)
+        int decodeUtf8(const unsigned char* p, const unsigned char* end, uint32_t& codePoint) {
+            unsigned char lead = p[0];
+            if (lead < 0x80) {
+                codePoint = lead;
+                return 1;
+            }
+            int length;
+            unsigned char low = 0x80;
+            unsigned char high = 0xBF;
+            if (lead >= 0xC2 && lead <= 0xDF) {
+                length = 2;
+                codePoint = lead & 0x1F;
+            } else if (lead >= 0xE0 && lead <= 0xEF) {
+                length = 3;
+                codePoint = lead & 0x0F;
+                if (lead == 0xE0) low = 0xA0;
+                if (lead == 0xED) high = 0x9F;
+            } else if (lead >= 0xF0 && lead <= 0xF4) {
+                length = 4;
+                codePoint = lead & 0x07;
+                if (lead == 0xF0) low = 0x90;
+                if (lead == 0xF4) high = 0x8F;
+            } else {
+                return -1;
+            }
+            for (int i = 1; i < length; ++i) {
+                if (p + i >= end) return 0;
+                unsigned char next = p[i];
+                if (next < (i == 1 ? low : 0x80) || next > (i == 1 ? high : 0xBF)) return -1;
+                codePoint = (codePoint << 6) | (next & 0x3F);
+            }
+            return length;
+        }
+
+        // One UTF-16 character (a unit or a surrogate pair), as decodeUtf8
+        int decodeUtf16(const unsigned char* p, const unsigned char* end, bool bigEndian, uint32_t& codePoint) {
+            auto unitAt = [bigEndian](const unsigned char* q) {
+                return bigEndian ? static_cast<uint32_t>(q[0] << 8 | q[1]) : static_cast<uint32_t>(q[1] << 8 | q[0]);
+            };
+            if (end - p < 2) return 0;
+            uint32_t unit = unitAt(p);
+            if (unit < 0xD800 || unit > 0xDFFF) {
+                codePoint = unit;
+                return 2;
+            }
+            if (unit > 0xDBFF) return -1;
+            if (end - p < 4) return 0;
+            uint32_t low = unitAt(p + 2);
+            if (low < 0xDC00 || low > 0xDFFF) return -1;
+            codePoint = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+            return 4;
+        }
+
+        void appendUtf8(uint32_t codePoint, std::string& out) {
+            if (codePoint < 0x80) {
+                out += static_cast<char>(codePoint);
+            } else if (codePoint < 0x800) {
+                out += static_cast<char>(0xC0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else if (codePoint < 0x10000) {
+                out += static_cast<char>(0xE0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        void appendUtf16Unit(uint32_t unit, bool bigEndian, std::string& out) {
+            char high = static_cast<char>(unit >> 8);
+            char low = static_cast<char>(unit & 0xFF);
+            out += bigEndian ? high : low;
+            out += bigEndian ? low : high;
+        }
+
+        void appendUtf16(uint32_t codePoint, bool bigEndian, std::string& out) {
+            if (codePoint < 0x10000) {
+                appendUtf16Unit(codePoint, bigEndian, out);
+                return;
+            }
+            codePoint -= 0x10000;
+            appendUtf16Unit(0xD800 + (codePoint >> 10), bigEndian, out);
+            appendUtf16Unit(0xDC00 + (codePoint & 0x3FF), bigEndian, out);
+        }
+
+        // Length of the source charset's byte order mark at p, if there is one
+        size_t byteOrderMarkLength(Charset charset, const unsigned char* p, const unsigned char* end) {
+            size_t available = static_cast<size_t>(end - p);
+            switch (charset) {
+                case Charset::Utf8:
+                    return available >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF ? 3 : 0;
+                case Charset::Utf16LE:
+                    return available >= 2 && p[0] == 0xFF && p[1] == 0xFE ? 2 : 0;
+                case Charset::Utf16BE:
+                    return available >= 2 && p[0] == 0xFE && p[1] == 0xFF ? 2 : 0;
+                case Charset::Auto:
+                case Charset::Latin1:
+                    break;
+            }
+            return 0;
+        }
+
+        bool isUtf16(Charset charset) {
+            return charset == Charset::Utf16LE || charset == Charset::Utf16BE;
+        }
+
+    }
+
+    bool parseLineEnding(const std::string& text, LineEnding& ending) {
+        std::string name = toLowerCase(text);
+        if (name == "lf" || name == "unix") {
+            ending = LineEnding::LF;
+        } else if (name == "crlf" || name == "dos" || name == "windows") {
+            ending = LineEnding::CRLF;
+        } else if (name == "cr" || name == "mac") {
+            ending = LineEnding::CR;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool parseCharset(const std::string& text, bool allowAuto, Charset& charset) {
+        std::string name = toLowerCase(text);
+        if (name == "utf-8" || name == "utf8") {
+            charset = Charset::Utf8;
+        } else if (name == "utf-16" || name == "utf16" || name == "utf-16le" || name == "utf16le") {
+            charset = Charset::Utf16LE;
+        } else if (name == "utf-16be" || name == "utf16be") {
+            charset = Charset::Utf16BE;
+        } else if (name == "latin1" || name == "latin-1" || name == "iso-8859-1" || name == "iso8859-1") {
+            charset = Charset::Latin1;
+        } else if (allowAuto && name == "auto") {
+            charset = Charset::Auto;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char* charsetName(Charset charset) {
+        switch (charset) {
+            case Charset::Auto: return "auto";
+            case Charset::Utf8: return "UTF-8";
+            case Charset::Utf16LE: return "UTF-16LE";
+            case Charset::Utf16BE: return "UTF-16BE";
+            case Charset::Latin1: return "Latin-1";
+        }
+        return "";
+    }
+
+    TextTransform::TextTransform(Kind transformKind, LineEnding lineEnding, Charset fromCharset, Charset toCharset)
+        : kind(transformKind), ending(lineEnding), from(fromCharset), to(toCharset), source(fromCharset),
+          scanCarriageReturn(false), mismatch(false), identity(false), validating(false), utf8Valid(true),
+          utf8Ascii(true), carriageReturn(false), atStart(true), consumed(0) {
+    }
+
+    TextTransform TextTransform::lineEndings(LineEnding target) {
+        return TextTransform(Kind::LineEndings, target, Charset::Utf8, Charset::Utf8);
+    }
+
+    TextTransform TextTransform::charsets(Charset fromCharset, Charset toCharset) {
+        return TextTransform(Kind::Charsets, LineEnding::LF, fromCharset, toCharset);
+    }
+
+    bool TextTransform::accepts(const ContentVerdict& verdict, std::string& reason) {
+        bool markedUtf16 = verdict.encoding == TextEncoding::Utf16LE || verdict.encoding == TextEncoding::Utf16BE;
+        if (kind == Kind::LineEndings) {
+            // Line endings are rewritten byte-wise, which UTF-16 does not survive
+            if (verdict.isSearchable()) return true;
+            reason = markedUtf16 ? "UTF-16 text" : "not text";
+            return false;
+        }
+
+        if (isUtf16(from)) {
+            // Declared UTF-16 has NUL bytes and may be classified as binary
+            source = from;
+        } else if (markedUtf16) {
+            Charset marked = verdict.encoding == TextEncoding::Utf16LE ? Charset::Utf16LE : Charset::Utf16BE;
+            if (marked == to) {
+                identity = true;
+                return true;
+            }
+            if (from != Charset::Auto) {
+                reason = std::string("UTF-16 text, not ") + charsetName(from);
+                return false;
+            }
+            source = marked;
+        } else if (!verdict.isText()) {
+            reason = "not text";
+            return false;
+        }
+
+        identity = source == to;
+        bool byteCharsets = (source == Charset::Utf8 || source == Charset::Latin1) &&
+                            (to == Charset::Utf8 || to == Charset::Latin1);
+        validating = !identity && (source == Charset::Auto || byteCharsets);
+        return true;
+    }
+
+    bool TextTransform::scan(const char* data, size_t size) {
+        if (kind == Kind::LineEndings) return scanLineEndings(data, size);
+        if (!validating) return false;
+        scanUtf8(data, size);
+        if (!utf8Valid) return false;
+        // Only ASCII is the same in UTF-8 and Latin-1; Auto has to see it all
+        if (to == Charset::Latin1 && source == Charset::Utf8 && !utf8Ascii) return false;
+        return true;
+    }
+
+    bool TextTransform::conforms() {
+        if (kind == Kind::LineEndings) return !mismatch && !scanCarriageReturn;
+        if (identity) return true;
+        if (!validating) return false;
+
+        // A sequence cut off by the end of the file
+        if (!scanPending.empty()) utf8Valid = false;
+        if (source == Charset::Auto) source = utf8Valid ? Charset::Utf8 : Charset::Latin1;
+        if (source == to) return true;
+        if (to == Charset::Utf8) return utf8Valid;
+        return to == Charset::Latin1 && utf8Valid && utf8Ascii;
+    }
+
+    bool TextTransform::transcode(const char* data, size_t size, std::string& out, std::string& error) {
+        if (kind == Kind::LineEndings) {
+            convertLineEndings(data, size, out);
+            return true;
+        }
+
+        // Complete a sequence cut by the last block one byte at a time
+        while (!pending.empty() && size > 0) {
+            pending += *data++;
+            --size;
+            size_t used = 0;
+            if (!convertUnits(pending.data(), pending.size(), false, used, out, error)) return false;
+            pending.erase(0, used);
+        }
+        if (!pending.empty()) return true;
+
+        size_t used = 0;
+        if (!convertUnits(data, size, false, used, out, error)) return false;
+        pending.assign(data + used, size - used);
+        return true;
+    }
+
+    bool TextTransform::finish(std::string& out, std::string& error) {
+        if (kind == Kind::LineEndings) {
+            if (carriageReturn) {
+                out +=ending == LineEnding::CR ? "\r" : ending == LineEnding::LF ? "\n" : "\r\n";
+                carriageReturn = false;
+            }
+            return true;
+        }
+        size_t used = 0;
+        if (!convertUnits(pending.data(), pending.size(), true, used, out, error)) return false;
+        pending.clear();
+        return true;
+    }
+
+    bool TextTransform::scanLineEndings(const char* data, size_t size) {
+        const char* p = data;
+        const char* end = data + size;
+        if (ending == LineEnding::LF) {
+            mismatch = findByte(p, end, '\r') != nullptr;
+            return !mismatch;
+        }
+        if (ending == LineEnding::CR) {
+            mismatch = findByte(p, end, '\n') != nullptr;
+            return !mismatch;
+        }
+
+        // CRLF: every CR is followed by LF and every LF preceded by CR
+        if (scanCarriageReturn && p < end) {
+            scanCarriageReturn = false;
+            if (*p != '\n') {
+                mismatch = true;
+                return false;
+            }
+            ++p;
+        }
+        while (const char* hit = findEitherByte(p, end, '\r', '\n')) {
+            if (*hit == '\n') {
+                mismatch = true;
+                return false;
+            }
+            if (hit + 1 == end) {
+                scanCarriageReturn = true;
+                return true;
+            }
+            if (hit[1] != '\n') {
+                mismatch = true;
+                return false;
+            }
+            p = hit + 2;
+        }
+        return true;
+    }
+
+    void TextTransform::scanUtf8(const char* data, size_t size) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* end = p + size;
+        uint32_t codePoint;
+
+        while (!scanPending.empty() && p < end) {
+            scanPending += static_cast<char>(*p++);
+            const unsigned char* sequence = reinterpret_cast<const unsigned char*>(scanPending.data());
+            int length = decodeUtf8(sequence, sequence + scanPending.size(), codePoint);
+            if (length < 0) {
+                utf8Valid = false;
+                return;
+            }
+            if (length > 0) scanPending.clear();
+        }
+
+        while (p < end) {
+            p += asciiPrefix(reinterpret_cast<const char*>(p), reinterpret_cast<const char*>(end));
+            if (p == end) break;
+            utf8Ascii = false;
+            int length = decodeUtf8(p, end, codePoint);
+            if (length < 0) {
+                utf8Valid = false;
+                return;
+            }
+            if (length == 0) {
+                scanPending.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(end - p));
+                return;
+            }
+            p += length;
+        }
+    }
+
+    void TextTransform::convertLineEndings(const char* data, size_t size, std::string& out) {
+        const char* lineEnd = ending == LineEnding::LF ? "\n" : ending == LineEnding::CR ? "\r" : "\r\n";
+        const size_t lineEndLength = ending == LineEnding::CRLF ? 2 : 1;
+        const char* p = data;
+        const char* end = data + size;
+
+        if (carriageReturn && p < end) {
+            carriageReturn = false;
+            out.append(lineEnd, lineEndLength);
+            if (*p == '\n') ++p;
+        }
+        while (p < end) {
+            const char* hit = findEitherByte(p, end, '\r', '\n');
+            if (!hit) {
+                out.append(p, end);
+                break;
+            }
+            out.append(p, hit);
+            if (*hit == '\r' && hit + 1 == end) {
+                // The next block decides whether this CR starts a CRLF
+                carriageReturn = true;
+                break;
+            }
+            out.append(lineEnd, lineEndLength);
+            p = *hit == '\r' && hit[1] == '\n' ? hit + 2 : hit + 1;
+        }
+    }
+
+    bool TextTransform::convertUnits(const char* data, size_t size, bool final, size_t& used, std::string& out,
+                                     std::string& error) {
+        const unsigned char* begin = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* p = begin;
+        const unsigned char* end = begin + size;
+        auto fail = [&](const std::string& what) {
+            error = what + " at byte " + std::to_string(consumed + static_cast<uint64_t>(p - begin));
+            return false;
+        };
+
+        if (atStart) {
+            // Wait for enough bytes to recognise a byte order mark
+            if (!final && size < 3) {
+                used = 0;
+                return true;
+            }
+            atStart = false;
+            p += byteOrderMarkLength(source, p, end);
+            if (isUtf16(to)) appendUtf16Unit(0xFEFF, to == Charset::Utf16BE, out);
+        }
+
+        const bool byteSource = source == Charset::Utf8 || source == Charset::Latin1;
+        while (p < end) {
+            if (byteSource) {
+                size_t ascii = asciiPrefix(reinterpret_cast<const char*>(p), reinterpret_cast<const char*>(end));
+                if (ascii > 0) {
+                    appendAscii(reinterpret_cast<const char*>(p), ascii, out);
+                    p += ascii;
+                    continue;
+                }
+            }
+
+            uint32_t codePoint = 0;
+            int length = 1;
+            if (source == Charset::Latin1) {
+                codePoint = *p;
+            } else if (source == Charset::Utf8) {
+                length = decodeUtf8(p, end, codePoint);
+            } else {
+                length = decodeUtf16(p, end, source == Charset::Utf16BE, codePoint);
+            }
+            if (length == 0) {
+                if (!final) break;
+                return fail(std::string("Truncated ") + charsetName(source) + " sequence");
+            }
+            if (length < 0) return fail(std::string("Invalid ") + charsetName(source));
+
+            if (to == Charset::Utf8) {
+                appendUtf8(codePoint, out);
+            } else if (isUtf16(to)) {
+                appendUtf16(codePoint, to == Charset::Utf16BE, out);
+            } else if (codePoint <= 0xFF) {
+                out += static_cast<char>(codePoint);
+            } else {
+                char name[16];
+                std::snprintf(name, sizeof(name), "U+%04X", static_cast<unsigned>(codePoint));
+                return fail(std::string(name) + " has no Latin-1 form");
+            }
+            p += length;
+        }
+
+        used = static_cast<size_t>(p - begin);
+        consumed += used;
+        return true;
+    }
+
+    void TextTransform::appendAscii(const char* data, size_t size, std::string& out) const {
+        if (!isUtf16(to)) {
+            out.append(data, size);
+            return;
+        }
+        // Widen to 16-bit units
+        size_t offset = out.size();
+        out.resize(offset + size * 2);
+        char* target = &out[offset];
+        const size_t high = to == Charset::Utf16BE ? 0 : 1;
+        for (size_t i = 0; i < size; ++i) {
+            target[2 * i + (1 - high)] = data[i];
+            target[2 * i + high] = 0;
+        }
+    }
+
+}
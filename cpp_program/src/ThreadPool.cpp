@@ -0,0 +1,49 @@
+#include "ThreadPool.h"
+
+namespace FileSystemManager {
+
+    ThreadPool::ThreadPool(size_t threadCount) : stopping(false) {
+        size_t count = threadCount > 0 ? threadCount : defaultThreadCount();
+        workers.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueChanged.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::size() const {
+        return workers.size();
+    }
+
+    size_t ThreadPool::defaultThreadCount() {
+        size_t hardware = std::thread::hardware_concurrency();
+        return hardware > 0 ? hardware : 1;
+    }
+
+    void ThreadPool::workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueChanged.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return; // Stopping and fully drained
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+}
@@ -0,0 +1,373 @@
+#include "TreeCache.h"
+#include "DirectoryWalker.h"
+#include "Instrumentation.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace FileSystemManager {
+
+    namespace {
+
+        std::string normalizePath(const std::string& path) {
+            std::error_code ec;
+            fs::path absolute = fs::absolute(path, ec);
+            if (ec) return path;
+            fs::path canonical = fs::weakly_canonical(absolute, ec);
+            std::string result = ec ? absolute.lexically_normal().string() : canonical.string();
+            while (result.size() > 1 && result.back() == '/') {
+                result.pop_back();
+            }
+            return result;
+        }
+
+        bool isWithin(const std::string& path, const std::string& root) {
+            if (path == root) return true;
+            if (root == "/") return !path.empty() && path[0] == '/';
+            return path.size() > root.size() && path.compare(0, root.size(), root) == 0 && path[root.size()] == '/';
+        }
+
+        std::string parentOf(const std::string& path) {
+            size_t slash = path.rfind('/');
+            if (slash == std::string::npos) return path;
+            return slash == 0 ? "/" : path.substr(0, slash);
+        }
+
+#ifdef __linux__
+        const uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM |
+                                   IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+    }
+
+    TreeCache::TreeCache() : TreeCache(std::chrono::seconds(60)) {
+    }
+
+    TreeCache::TreeCache(std::chrono::seconds snapshotMaxAge) : maxAge(snapshotMaxAge), notifyFd(-1), stopping(false) {
+#ifdef __linux__
+        notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notifyFd >= 0) {
+            watcherThread = std::thread([this]() { watchLoop(); });
+        }
+#endif
+    }
+
+    TreeCache::~TreeCache() {
+        stopping = true;
+        if (watcherThread.joinable()) {
+            watcherThread.join();
+        }
+#ifdef __linux__
+        if (notifyFd >= 0) {
+            ::close(notifyFd);
+        }
+#endif
+    }
+
+    bool TreeCache::isWatching() const {
+        return notifyFd >= 0;
+    }
+
+    std::shared_ptr<const TreeSnapshot> TreeCache::findSnapshot(const std::string& path) const {
+        std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+        std::shared_ptr<const TreeSnapshot> best;
+        for (const auto& [root, snapshot] : snapshots) {
+            if (isWithin(path, root) && (!best || root.size() > best->root.size())) {
+                best = snapshot;
+            }
+        }
+        return best;
+    }
+
+    bool TreeCache::isFresh(const TreeSnapshot& snapshot) const {
+        if (snapshot.stale.load()) return false;
+        if (snapshot.watched) return true;
+        return std::chrono::steady_clock::now() - snapshot.builtAt < maxAge;
+    }
+
+    std::shared_ptr<const TreeSnapshot> TreeCache::acquire(const std::string& path) {
+        std::string normalized = normalizePath(path);
+
+        auto snapshot = findSnapshot(normalized);
+        if (snapshot && isFresh(*snapshot)) {
+            return snapshot;
+        }
+
+        // Only one rebuild at a time; whoever waited may find it already done
+        std::lock_guard<std::mutex> buildLock(buildMutex);
+        snapshot = findSnapshot(normalized);
+        if (snapshot && isFresh(*snapshot)) {
+            return snapshot;
+        }
+
+        std::string root = snapshot ? snapshot->root : normalized;
+        std::error_code ec;
+        if (!fs::is_directory(root, ec)) {
+            std::unique_lock<std::shared_mutex> lock(snapshotMutex);
+            snapshots.erase(root);
+            return nullptr;
+        }
+
+        auto fresh = buildSnapshot(root);
+        {
+            std::unique_lock<std::shared_mutex> lock(snapshotMutex);
+            snapshots[root] = fresh;
+        }
+        {
+            // A change that landed while walking may not be in the snapshot
+            std::lock_guard<std::mutex> lock(watchMutex);
+            if (changedRoots.count(root) > 0) {
+                fresh->stale = true;
+            }
+        }
+        return fresh;
+    }
+
+    std::shared_ptr<TreeSnapshot> TreeCache::buildSnapshot(const std::string& root) {
+        ScopedPhase phase("cache.build", root);
+        auto snapshot = std::make_shared<TreeSnapshot>();
+        snapshot->root = root;
+        snapshot->builtAt = std::chrono::steady_clock::now();
+
+        // Watches are registered before a directory is listed so no change
+        // between listing and watching can slip through
+        unwatchRoot(root);
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            changedRoots.erase(root);
+        }
+        std::atomic<bool> watchesComplete(notifyFd >= 0);
+        std::vector<int> watches;
+        auto addWatch = [&](const std::string& directory) {
+#ifdef __linux__
+            if (!watchesComplete.load()) return;
+            int wd = inotify_add_watch(notifyFd, directory.c_str(), WatchMask);
+            if (wd < 0) {
+                // Typically the per-user watch limit; fall back to expiry
+                watchesComplete = false;
+                return;
+            }
+            std::lock_guard<std::mutex> lock(watchMutex);
+            watchRoots[wd].insert(root);
+            watches.push_back(wd);
+#else
+            (void)directory;
+#endif
+        };
+        addWatch(root);
+
+        DirectoryWalker walker;
+        size_t workerCount = walker.getThreadCount();
+        std::vector<std::vector<CachedEntry>> workerEntries(workerCount);
+        std::vector<std::unordered_map<std::string, uint64_t>> workerDirectBytes(workerCount);
+        // A directory is listed start to finish by one worker, so its file
+        // bytes can be summed here and keyed by path once per directory
+        std::vector<uint64_t> listingBytes(workerCount, 0);
+
+        walker.walk(root, [&](size_t workerIndex, const WalkEntry& entry) {
+            EntryMetadata metadata;
+            if (!DirectoryWalker::readMetadata(entry, metadata, true)) return;
+
+            bool isDirectory = metadata.isDirectory && entry.type != EntryType::Symlink;
+            if (!isDirectory && !metadata.isRegularFile) return;
+
+            CachedEntry cached;
+            cached.path = entry.path();
+            cached.nameOffset = entry.node->pathLength - entry.node->nameLength;
+            cached.size = isDirectory ? 0 : metadata.size;
+            cached.modifiedTime = metadata.modifiedNs / 1000000000LL;
+            cached.isDirectory = isDirectory;
+
+            if (isDirectory) {
+                addWatch(cached.path);
+            } else {
+                listingBytes[workerIndex] += cached.size;
+            }
+            workerEntries[workerIndex].push_back(std::move(cached));
+        },
+        [&](size_t workerIndex, const PathNode* directory, size_t, int) {
+            uint64_t bytes = listingBytes[workerIndex];
+            if (bytes == 0) return;
+            listingBytes[workerIndex] = 0;
+            workerDirectBytes[workerIndex][directory->parent ? directory->path() : root] += bytes;
+        });
+
+        size_t total = 0;
+        for (const auto& entries : workerEntries) {
+            total += entries.size();
+        }
+        snapshot->entries.reserve(total);
+        for (auto& entries : workerEntries) {
+            std::move(entries.begin(), entries.end(), std::back_inserter(snapshot->entries));
+        }
+        std::sort(snapshot->entries.begin(), snapshot->entries.end(), [](const CachedEntry& a, const CachedEntry& b) {
+            return a.path < b.path;
+        });
+
+        // Roll direct file bytes up into every ancestor up to the root
+        snapshot->directoryBytes[root] = 0;
+        for (const auto& directBytes : workerDirectBytes) {
+            for (const auto& [directory, bytes] : directBytes) {
+                std::string current = directory;
+                while (true) {
+                    snapshot->directoryBytes[current] += bytes;
+                    if (current == root || current.size() <= root.size()) break;
+                    current = parentOf(current);
+                }
+            }
+        }
+
+        snapshot->watched = watchesComplete.load();
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            rootWatches[root] = std::move(watches);
+        }
+        return snapshot;
+    }
+
+    void TreeCache::unwatchRoot(const std::string& root) {
+#ifdef __linux__
+        std::lock_guard<std::mutex> lock(watchMutex);
+        auto it = rootWatches.find(root);
+        if (it == rootWatches.end()) return;
+
+        for (int wd : it->second) {
+            auto rootsIt = watchRoots.find(wd);
+            if (rootsIt == watchRoots.end()) continue;
+            rootsIt->second.erase(root);
+            if (rootsIt->second.empty()) {
+                // No other snapshot shares this directory
+                inotify_rm_watch(notifyFd, wd);
+                watchRoots.erase(rootsIt);
+            }
+        }
+        rootWatches.erase(it);
+#else
+        (void)root;
+#endif
+    }
+
+    void TreeCache::watchLoop() {
+#ifdef __linux__
+        alignas(struct inotify_event) char buffer[64 * 1024];
+
+        while (!stopping.load()) {
+            struct pollfd pfd = {notifyFd, POLLIN, 0};
+            if (::poll(&pfd, 1, 250) <= 0) continue;
+
+            ssize_t length = ::read(notifyFd, buffer, sizeof(buffer));
+            if (length <= 0) continue;
+
+            std::set<std::string> changed;
+            {
+                std::lock_guard<std::mutex> lock(watchMutex);
+                for (char* ptr = buffer; ptr < buffer + length; ) {
+                    auto* event = reinterpret_cast<struct inotify_event*>(ptr);
+                    ptr += sizeof(struct inotify_event) + event->len;
+
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        // Events were dropped; everything is suspect
+                        for (const auto& [root, watches] : rootWatches) {
+                            changed.insert(root);
+                        }
+                        continue;
+                    }
+
+                    auto it = watchRoots.find(event->wd);
+                    if (it == watchRoots.end()) continue;
+                    changed.insert(it->second.begin(), it->second.end());
+                    if (event->mask & IN_IGNORED) {
+                        // The kernel dropped the watch (directory deleted)
+                        watchRoots.erase(it);
+                    }
+                }
+                changedRoots.insert(changed.begin(), changed.end());
+            }
+
+            std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+            for (const auto& root : changed) {
+                auto it = snapshots.find(root);
+                if (it != snapshots.end()) {
+                    it->second->stale = true;
+                }
+            }
+        }
+#endif
+    }
+
+    std::vector<SearchResult> TreeCache::findByName(const std::string& directory, const std::string& pattern,
+                                                    bool recursive, bool formatTimestamps) {
+        std::vector<SearchResult> results;
+        auto snapshot = acquire(directory);
+        if (!snapshot) return results;
+
+        std::string normalized = normalizePath(directory);
+        std::string prefix = normalized == "/" ? "/" : normalized + "/";
+        GlobPattern glob(pattern);
+
+        auto it = std::lower_bound(snapshot->entries.begin(), snapshot->entries.end(), prefix,
+            [](const CachedEntry& entry, const std::string& value) { return entry.path < value; });
+
+        for (; it != snapshot->entries.end(); ++it) {
+            const CachedEntry& entry = *it;
+            if (entry.path.compare(0, prefix.size(), prefix) != 0) break;
+            if (entry.isDirectory) continue;
+            if (!recursive && entry.path.find('/', prefix.size()) != std::string::npos) continue;
+            if (!glob.matches(entry.name())) continue;
+
+            SearchResult result;
+            result.filePath = entry.path;
+            result.fileName = std::string(entry.name());
+            result.fileSize = entry.size;
+            result.modifiedTime = entry.modifiedTime;
+            if (formatTimestamps) {
+                result.lastModified = formatTimestamp(std::chrono::system_clock::from_time_t(static_cast<time_t>(entry.modifiedTime)));
+            }
+            results.push_back(std::move(result));
+        }
+        return results;
+    }
+
+    bool TreeCache::getDirectorySize(const std::string& directory, uint64_t& bytes) {
+        auto snapshot = acquire(directory);
+        if (!snapshot) return false;
+
+        auto it = snapshot->directoryBytes.find(normalizePath(directory));
+        bytes = it != snapshot->directoryBytes.end() ? it->second : 0;
+        return true;
+    }
+
+    void TreeCache::invalidate(const std::string& path) {
+        std::string normalized = normalizePath(path);
+        std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+        for (const auto& [root, snapshot] : snapshots) {
+            if (isWithin(normalized, root) || isWithin(root, normalized)) {
+                snapshot->stale = true;
+            }
+        }
+    }
+
+    void TreeCache::clear() {
+        std::vector<std::string> roots;
+        {
+            std::unique_lock<std::shared_mutex> lock(snapshotMutex);
+            for (const auto& [root, snapshot] : snapshots) {
+                roots.push_back(root);
+            }
+            snapshots.clear();
+        }
+        for (const auto& root : roots) {
+            unwatchRoot(root);
+        }
+    }
+
+    size_t TreeCache::getSnapshotCount() const {
+        std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+        return snapshots.size();
+    }
+
+}
@@ -1,14 +1,128 @@
 #include "CLI.h"
+#include "DaemonServer.h"
 #include <iostream>
 #include <string>
+#include <vector>
+
+namespace {
+
+    // Writes the --trace file however main() exits
+    struct TraceSession {
+        bool active = false;
+
+        ~TraceSession() {
+            if (!active) return;
+            std::string error;
+            if (!FileSystemManager::Instrumentation::stopTrace(error)) {
+                std::cerr << error << std::endl;
+            }
+        }
+    };
+
+}
 
 int main(int argc, char* argv[]) {
     try {
+        // Global options may appear anywhere on the command line
+        FileSystemManager::OutputFormat format = FileSystemManager::OutputFormat::Human;
+        bool formattedFields = false;
+        size_t scriptJobs = 0;
+        bool parallelScript = false;
+        std::string socketPath;
+        std::string tracePath;
+        long progressMs = 0;
+        double timeoutSeconds = 0;
+        FileSystemManager::IoLimits ioLimits;
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--format=", 0) == 0) {
+                if (!FileSystemManager::parseOutputFormat(arg.substr(9), format)) {
+                    std::cerr << "Unknown output format: " << arg.substr(9) << " (expected ndjson, tsv or bin)" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--timestamps") {
+                formattedFields = true;
+            } else if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+                try {
+                    scriptJobs = std::stoul(argv[++i]);
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid job count: " << argv[i] << std::endl;
+                    return 1;
+                }
+                parallelScript = true;
+            } else if (arg == "--trace" && i + 1 < argc) {
+                tracePath = argv[++i];
+            } else if (arg.rfind("--trace=", 0) == 0) {
+                tracePath = arg.substr(8);
+            } else if (arg == "--progress") {
+                progressMs = 200;
+            } else if (arg.rfind("--progress=", 0) == 0) {
+                try {
+                    progressMs = std::stol(arg.substr(11));
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid progress interval: " << arg.substr(11) << std::endl;
+                    return 1;
+                }
+            } else if ((arg == "--timeout" && i + 1 < argc) || arg.rfind("--timeout=", 0) == 0) {
+                std::string value = arg == "--timeout" ? argv[++i] : arg.substr(10);
+                try {
+                    timeoutSeconds = std::stod(value);
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid timeout: " << value << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--bandwidth" && i + 1 < argc) {
+                if (!FileSystemManager::parseByteSize(argv[++i], ioLimits.bytesPerSecond)) {
+                    std::cerr << "Invalid bandwidth: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--iops" && i + 1 < argc) {
+                try {
+                    ioLimits.operationsPerSecond = std::stoull(argv[++i]);
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid operation rate: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--io-class" && i + 1 < argc) {
+                if (!FileSystemManager::parseIoPriority(argv[++i], ioLimits.priority)) {
+                    std::cerr << "Unknown I/O class: " << argv[i] << " (expected default, best-effort or idle)" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--socket" && i + 1 < argc) {
+                socketPath = argv[++i];
+            } else if (arg == "--client") {
+                // Everything after --client is the command to run in the daemon
+                std::string command;
+                for (++i; i < argc; ++i) {
+                    if (!command.empty()) command += ' ';
+                    command += argv[i];
+                }
+                if (command.empty()) {
+                    std::cerr << "Usage: " << argv[0] << " --client <command...>" << std::endl;
+                    return 1;
+                }
+                return FileSystemManager::DaemonServer::runClient(socketPath, command, format, formattedFields);
+            } else {
+                args.push_back(arg);
+            }
+        }
+        
+        TraceSession trace;
+        if (!tracePath.empty()) {
+            FileSystemManager::Instrumentation::startTrace(tracePath);
+            trace.active = true;
+        }
+        
         FileSystemManager::CLI cli;
+        cli.setOutputFormat(format, formattedFields);
+        cli.setProgressInterval(std::chrono::milliseconds(progressMs));
+        cli.setOperationTimeout(std::chrono::milliseconds(static_cast<long long>(timeoutSeconds * 1000)));
+        cli.setIoLimits(ioLimits);
         
         // Check for command line arguments
-        if (argc > 1) {
-            std::string arg = argv[1];
+        if (!args.empty()) {
+            std::string arg = args[0];
             
             if (arg == "--help" || arg == "-h") {
                 std::cout << "File System Manager v1.0.0" << std::endl;
@@ -18,6 +132,18 @@ int main(int argc, char* argv[]) {
                 std::cout << "  --help, -h     Show this help message" << std::endl;
                 std::cout << "  --version, -v  Show version information" << std::endl;
                 std::cout << "  --script <file> Run commands from script file" << std::endl;
+                std::cout << "  --jobs, -j <n> Run independent read-only script commands in parallel (0 = all cores)" << std::endl;
+                std::cout << "  --format=<fmt> Machine-readable output: ndjson, tsv or bin" << std::endl;
+                std::cout << "  --timestamps   Include formatted sizes and dates in --format output" << std::endl;
+                std::cout << "  --trace <file> Record per-command timings and counters as Chrome-trace JSON" << std::endl;
+                std::cout << "  --progress[=ms] Show batch progress on stderr (default every 200 ms)" << std::endl;
+                std::cout << "  --timeout <s>  Stop any search or batch command still running after s seconds" << std::endl;
+                std::cout << "  --bandwidth <size> Limit searches and batches to size bytes per second, e.g. 20M" << std::endl;
+                std::cout << "  --iops <n>     Limit searches and batches to n I/O operations per second" << std::endl;
+                std::cout << "  --io-class <c> Run searches and batches in I/O class default, best-effort or idle" << std::endl;
+                std::cout << "  --daemon       Serve commands over a Unix socket with warm caches" << std::endl;
+                std::cout << "  --client <cmd> Run a command in the running daemon (\"shutdown\" stops it)" << std::endl;
+                std::cout << "  --socket <path> Daemon socket (default $XDG_RUNTIME_DIR/fsmanager.sock)" << std::endl;
                 std::cout << std::endl;
                 std::cout << "Arguments:" << std::endl;
                 std::cout << "  initial_path   Start in the specified directory" << std::endl;
@@ -26,13 +152,32 @@ int main(int argc, char* argv[]) {
                 std::cout << "File System Manager v1.0.0" << std::endl;
                 std::cout << "Built with C++17 and std::filesystem" << std::endl;
                 return 0;
-            } else if (arg == "--script" && argc > 2) {
-                std::string scriptPath = argv[2];
-                cli.runScript(scriptPath);
+            } else if (arg == "--daemon") {
+                FileSystemManager::DaemonServer server(socketPath, scriptJobs);
+                server.getIoThrottle()->setLimits(ioLimits);
+                std::string error;
+                if (!server.start(error)) {
+                    std::cerr << error << std::endl;
+                    return 1;
+                }
+                std::cerr << "Listening on " << (socketPath.empty() ? FileSystemManager::DaemonServer::defaultSocketPath() : socketPath) << std::endl;
+                server.serve();
+                return 0;
+            } else if (arg == "--script" && args.size() > 1) {
+                std::string scriptPath = args[1];
+                if (parallelScript) {
+                    cli.runScriptParallel(scriptPath, scriptJobs);
+                } else {
+                    cli.runScript(scriptPath);
+                }
                 return 0;
             } else {
                 // Treat as initial path
                 FileSystemManager::CLI cliWithPath(arg);
+                cliWithPath.setOutputFormat(format, formattedFields);
+                cliWithPath.setProgressInterval(std::chrono::milliseconds(progressMs));
+                cliWithPath.setOperationTimeout(std::chrono::milliseconds(static_cast<long long>(timeoutSeconds * 1000)));
+                cliWithPath.setIoLimits(ioLimits);
                 cliWithPath.run();
             }
         } else {
@@ -0,0 +1,60 @@
+#include "BatchOperations.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace FileSystemManager;
+
+// Regression checks for batch copies; exits non-zero on the first failure
+namespace {
+
+    int failures = 0;
+
+    void expect(bool condition, const char* what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    void writeFile(const fs::path& path, const std::string& contents) {
+        std::ofstream(path, std::ios::binary) << contents;
+    }
+
+    std::string readFile(const fs::path& path) {
+        std::ifstream input(path, std::ios::binary);
+        std::ostringstream contents;
+        contents << input.rdbuf();
+        return contents.str();
+    }
+
+    // Copying a directory onto itself must leave every file as it was
+    void copyDirectoryOntoItself(const fs::path& base) {
+        fs::path tree = base / "self";
+        fs::create_directories(tree / "sub");
+        writeFile(tree / "a.txt", "alpha");
+        writeFile(tree / "sub" / "b.txt", "bravo");
+
+        BatchOperations operations;
+        OperationResult result = operations.copyDirectory(tree.string(), tree.string());
+
+        expect(readFile(tree / "a.txt") == "alpha", "copyDirectory onto itself keeps a.txt");
+        expect(readFile(tree / "sub" / "b.txt") == "bravo", "copyDirectory onto itself keeps sub/b.txt");
+        expect(result.filesProcessed == 0, "copyDirectory onto itself copies nothing");
+        expect(result.filesSkipped == 2 && result.errors.size() == 2, "copyDirectory onto itself reports each file");
+    }
+
+}
+
+int main() {
+    fs::path base = fs::temp_directory_path() / ("fsmanager-test-" + std::to_string(::getpid()));
+    fs::remove_all(base);
+    fs::create_directories(base);
+
+    copyDirectoryOntoItself(base);
+
+    fs::remove_all(base);
+    if (failures == 0) std::printf("All batch copy checks passed\n");
+    return failures == 0 ? 0 : 1;
+}